@@ -236,3 +236,97 @@ int arGetStereoMatching(AR3DStereoHandle *handle, ARdouble pos2dL[2], ARdouble p
                                                                                                    
     return 0;
 }
+
+int arGetStereoEpipolarWindow( AR3DStereoHandle *handle, const ARParamLTf *paramLTfR, int xsizeR, int ysizeR,
+                               ARMarkerInfo *marker_infoL, ARdouble width, int win[4] )
+{
+    ARdouble  (*cL)[4], (*cR)[4];
+    ARdouble   matL2C[3][4], matL2R[3][4];
+    ARdouble   rayL[3], rayR[3], tR[3];
+    ARdouble   x, y, z, d, sideMax, f;
+    ARdouble   invDepthMin, invDepthMax, invDepth;
+    ARdouble   bx0, by0, bx1, by1;
+    float      ox, oy;
+    int        margin, found;
+    int        i, j, k;
+
+    if (!handle || !paramLTfR || !marker_infoL || !win) return -1;
+    cL = handle->icpStereoHandle->matXcl2Ul;
+    cR = handle->icpStereoHandle->matXcr2Ur;
+
+    // Left camera to right camera.
+    if (arUtilMatInv( (const ARdouble (*)[4])handle->icpStereoHandle->matC2L, matL2C ) < 0) return -1;
+    arUtilMatMul( (const ARdouble (*)[4])handle->icpStereoHandle->matC2R, (const ARdouble (*)[4])matL2C, matL2R );
+
+    // Range of inverse distance from the left camera. Without a width, from infinity to the baseline.
+    sideMax = 0.0;
+    for (i = 0; i < 4; i++) {
+        x = marker_infoL->vertex[(i+1)%4][0] - marker_infoL->vertex[i][0];
+        y = marker_infoL->vertex[(i+1)%4][1] - marker_infoL->vertex[i][1];
+        d = sqrt(x*x + y*y);
+        if (d > sideMax) sideMax = d;
+    }
+    if (sideMax < 1.0) return -1;
+    if (width > 0.0) {
+        // The longest side is the least foreshortened.
+        f = (cL[0][0] + cL[1][1]) * 0.5;
+        z = f * width / sideMax;
+        invDepthMin = 1.0 / (z * AR_STEREO_EPIPOLAR_DEPTH_RANGE);
+        invDepthMax = AR_STEREO_EPIPOLAR_DEPTH_RANGE / z;
+    } else {
+        d = sqrt(matL2R[0][3]*matL2R[0][3] + matL2R[1][3]*matL2R[1][3] + matL2R[2][3]*matL2R[2][3]);
+        if (d <= 0.0) return -1;
+        invDepthMin = 0.0;
+        invDepthMax = 1.0 / d;
+    }
+
+    // Project each corner's ray, at sampled inverse distances, into the right image.
+    found = 0;
+    bx0 = by0 = bx1 = by1 = 0.0;
+    for (i = 0; i < 4; i++) {
+        rayL[1] = (marker_infoL->vertex[i][1] - cL[1][2]) / cL[1][1];
+        rayL[0] = (marker_infoL->vertex[i][0] - cL[0][2] - cL[0][1]*rayL[1]) / cL[0][0];
+        rayL[2] = 1.0;
+        for (j = 0; j < 3; j++) {
+            rayR[j] = matL2R[j][0]*rayL[0] + matL2R[j][1]*rayL[1] + matL2R[j][2]*rayL[2];
+            tR[j] = matL2R[j][3];
+        }
+        for (k = 0; k <= AR_STEREO_EPIPOLAR_SAMPLES; k++) {
+            // Point at distance 1/invDepth along the ray, scaled by invDepth.
+            invDepth = invDepthMin + (invDepthMax - invDepthMin) * k / AR_STEREO_EPIPOLAR_SAMPLES;
+            x = rayR[0] + tR[0]*invDepth;
+            y = rayR[1] + tR[1]*invDepth;
+            z = rayR[2] + tR[2]*invDepth;
+            if (z <= 0.0) continue; // Behind the right camera.
+            ox = (float)((cR[0][0]*x + cR[0][1]*y + cR[0][2]*z) / z);
+            oy = (float)((cR[1][0]*x + cR[1][1]*y + cR[1][2]*z) / z);
+            // Outside the lookup table, the point is outside the image anyway, and ideal coordinates will do.
+            arParamIdeal2ObservLTf( paramLTfR, ox, oy, &ox, &oy );
+            if (!found) {
+                bx0 = bx1 = ox;
+                by0 = by1 = oy;
+                found = 1;
+            } else {
+                if (ox < bx0) bx0 = ox;
+                if (ox > bx1) bx1 = ox;
+                if (oy < by0) by0 = oy;
+                if (oy > by1) by1 = oy;
+            }
+        }
+    }
+    if (!found) return -1;
+
+    // Margin as for ROI tracking, from the marker's size in the left image. Even bounds, so windows can be labeled in field mode.
+    margin = (int)(sideMax * AR_ROI_TRACKING_MARGIN);
+    if (margin < AR_ROI_TRACKING_MARGIN_MIN) margin = AR_ROI_TRACKING_MARGIN_MIN;
+    bx0 -= margin; by0 -= margin;
+    bx1 += margin + 2; by1 += margin + 2;
+    if (bx1 <= 0.0 || by1 <= 0.0 || bx0 >= xsizeR || by0 >= ysizeR) return -1;
+    win[0] = (bx0 < 0.0 ? 0 : (int)bx0 & ~1);
+    win[1] = (by0 < 0.0 ? 0 : (int)by0 & ~1);
+    win[2] = (bx1 > xsizeR ? xsizeR : (int)bx1) & ~1;
+    win[3] = (by1 > ysizeR ? ysizeR : (int)by1) & ~1;
+    if (win[2] <= win[0] || win[3] <= win[1]) return -1;
+
+    return 0;
+}
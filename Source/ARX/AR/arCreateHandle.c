@@ -47,8 +47,10 @@
  *******************************************************/
 
 #include <ARX/AR/ar.h>
+#include <ARX/ARUtil/thread_sub.h>
 #include <stdio.h>
 #include <math.h>
+#include "matrixCode.h"
 
 ARHandle *arCreateHandle(ARParamLT *paramLT)
 {
@@ -74,6 +76,21 @@ ARHandle *arCreateHandle(ARParamLT *paramLT)
     handle->areaMax                 = AR_AREA_MAX;
     handle->areaMin                 = AR_AREA_MIN;
     handle->squareFitThresh         = AR_SQUARE_FIT_THRESH;
+    handle->arLabelingThreadCount   = 1;
+    handle->arLabelingBandsInfo     = NULL;
+    handle->arMarkerInfoThreadCount = 1;
+    handle->arMarkerInfoThreads     = NULL;
+    handle->arROITrackingMode       = AR_DEFAULT_ROI_TRACKING_MODE;
+    handle->arROITrackingFullScanInterval = AR_ROI_TRACKING_FULL_SCAN_INTERVAL_DEFAULT;
+    handle->arROITrackingFullScanTTL = 0;
+    handle->arROINum                = 0;
+    handle->arROIMarkerNum          = 0;
+    handle->arWindowImage           = NULL;
+    handle->arPyramidImage          = NULL;
+    handle->pyramidAreaMax          = AR_PYRAMID_AREA_MAX;
+    handle->pyramidAreaMin          = AR_PYRAMID_AREA_MIN;
+    handle->arLabelingThreshAutoBracketingMode = AR_DEFAULT_LABELING_THRESH_AUTO_BRACKETING_MODE;
+    handle->arBracketingThreads     = NULL;
 
     handle->arParamLT           = paramLT;
     handle->xsize               = paramLT->param.xsize;
@@ -95,6 +112,8 @@ ARHandle *arCreateHandle(ARParamLT *paramLT)
     handle->arLabelingThreshAutoAdaptiveBias = AR_LABELING_THRESH_ADAPTIVE_BIAS_DEFAULT;
     arSetLabelingThreshMode(handle, AR_LABELING_THRESH_MODE_DEFAULT);
     arSetLabelingThreshModeAutoInterval(handle, AR_LABELING_THRESH_AUTO_INTERVAL_DEFAULT);
+    arSetLabelingThreadCount(handle, AR_LABELING_THREAD_COUNT_DEFAULT);
+    arSetMarkerInfoThreadCount(handle, AR_MARKER_INFO_THREAD_COUNT_DEFAULT);
     
     return handle;
 }
@@ -107,9 +126,14 @@ int arDeleteHandle(ARHandle *handle)
         arImageProcFinal(handle->arImageProcInfo);
         handle->arImageProcInfo = NULL;
     }
+    if (handle->arLabelingBandsInfo) arLabelingBandsFinal(&handle->arLabelingBandsInfo);
+    if (handle->arMarkerInfoThreads) arMarkerInfoThreadsFinal(&handle->arMarkerInfoThreads);
+    if (handle->arBracketingThreads) arBracketingThreadsFinal(&handle->arBracketingThreads);
     
     //if(handle->arParamLT != NULL) arParamLTFree(&handle->arParamLT);
     free(handle->labelInfo.labelImage);
+    free(handle->arWindowImage);
+    free(handle->arPyramidImage);
 #if !AR_DISABLE_LABELING_DEBUG_MODE
     if (handle->labelInfo.bwImage) free(handle->labelInfo.bwImage);
 #endif
@@ -164,6 +188,60 @@ int arGetLabelingMode(ARHandle *handle)
     return (handle->arLabelingMode);
 }
 
+void arSetLabelingThreadCount(ARHandle *handle, int threadCount)
+{
+    if (!handle) return;
+
+    if (threadCount == AR_LABELING_THREAD_COUNT_AUTO) threadCount = threadGetCPU();
+    if (threadCount < 1) threadCount = 1;
+    else if (threadCount > AR_LABELING_THREAD_MAX) threadCount = AR_LABELING_THREAD_MAX;
+    if (threadCount == handle->arLabelingThreadCount) return;
+
+    if (handle->arLabelingBandsInfo) arLabelingBandsFinal(&handle->arLabelingBandsInfo);
+    if (threadCount > 1) {
+        handle->arLabelingBandsInfo = arLabelingBandsInit(threadCount);
+        if (!handle->arLabelingBandsInfo) {
+            ARLOGe("Unable to start labeling threads. Labeling will be serial.\n");
+            threadCount = 1;
+        }
+    }
+    handle->arLabelingThreadCount = threadCount;
+}
+
+int arGetLabelingThreadCount(ARHandle *handle)
+{
+    if (!handle) return (AR_LABELING_THREAD_COUNT_DEFAULT);
+
+    return (handle->arLabelingThreadCount);
+}
+
+void arSetMarkerInfoThreadCount(ARHandle *handle, int threadCount)
+{
+    if (!handle) return;
+
+    if (threadCount == AR_MARKER_INFO_THREAD_COUNT_AUTO) threadCount = threadGetCPU();
+    if (threadCount < 1) threadCount = 1;
+    else if (threadCount > AR_MARKER_INFO_THREAD_MAX) threadCount = AR_MARKER_INFO_THREAD_MAX;
+    if (threadCount == handle->arMarkerInfoThreadCount && handle->arMarkerInfoThreads) return;
+
+    // Even with serial decoding, arMarkerInfoThreads holds the pattern scratch buffers.
+    if (handle->arMarkerInfoThreads) arMarkerInfoThreadsFinal(&handle->arMarkerInfoThreads);
+    handle->arMarkerInfoThreads = arMarkerInfoThreadsInit(threadCount);
+    if (!handle->arMarkerInfoThreads && threadCount > 1) {
+        ARLOGe("Unable to start marker info threads. Decoding will be serial.\n");
+        threadCount = 1;
+        handle->arMarkerInfoThreads = arMarkerInfoThreadsInit(threadCount);
+    }
+    handle->arMarkerInfoThreadCount = threadCount;
+}
+
+int arGetMarkerInfoThreadCount(ARHandle *handle)
+{
+    if (!handle) return (AR_MARKER_INFO_THREAD_COUNT_DEFAULT);
+
+    return (handle->arMarkerInfoThreadCount);
+}
+
 void arSetLabelingThresh(ARHandle *handle, int thresh)
 {
     if (!handle) return;
@@ -180,6 +258,19 @@ int arGetLabelingThresh(ARHandle *handle)
     return (handle->arLabelingThresh);
 }
 
+// Starts the bracketing threads when bracketing passes are to be run concurrently, and stops them otherwise.
+static void bracketingThreadsUpdate(ARHandle *handle)
+{
+    if (handle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_BRACKETING && handle->arLabelingThreshAutoBracketingMode != AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL) {
+        if (!handle->arBracketingThreads) {
+            handle->arBracketingThreads = arBracketingThreadsInit(handle->xsize, handle->ysize);
+            if (!handle->arBracketingThreads) ARLOGe("Unable to start bracketing threads. Bracketing will be serial.\n");
+        }
+    } else {
+        if (handle->arBracketingThreads) arBracketingThreadsFinal(&handle->arBracketingThreads);
+    }
+}
+
 void arSetLabelingThreshMode(ARHandle *handle, const AR_LABELING_THRESH_MODE mode)
 {
     AR_LABELING_THRESH_MODE mode1;
@@ -218,6 +309,7 @@ void arSetLabelingThreshMode(ARHandle *handle, const AR_LABELING_THRESH_MODE mod
             };
             ARLOGe("Labeling threshold mode set to %s.\n", modeDescs[mode1]);
         }
+        bracketingThreadsUpdate(handle);
     }
 }
 
@@ -236,6 +328,23 @@ void arSetLabelingThreshModeAutoInterval(ARHandle *handle, const int interval)
     handle->arLabelingThreshAutoIntervalTTL = 0;
 }
 
+void arSetLabelingThreshAutoBracketingMode(ARHandle *handle, int mode)
+{
+    if (!handle) return;
+
+    if (mode != AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL && mode != AR_LABELING_THRESH_AUTO_BRACKETING_THREADED && mode != AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS) return;
+
+    handle->arLabelingThreshAutoBracketingMode = mode;
+    bracketingThreadsUpdate(handle);
+}
+
+int arGetLabelingThreshAutoBracketingMode(ARHandle *handle)
+{
+    if (!handle) return (AR_DEFAULT_LABELING_THRESH_AUTO_BRACKETING_MODE);
+
+    return (handle->arLabelingThreshAutoBracketingMode);
+}
+
 void arSetLabelingThreshAutoAdaptiveKernelSize(ARHandle *handle, const int labelingThreshAutoAdaptiveKernelSize)
 {
     if (!handle) return;
@@ -273,6 +382,27 @@ int arGetLabelingThreshModeAutoInterval(const ARHandle *handle)
     return (handle->arLabelingThreshAutoInterval);
 }
 
+// Allocates or frees the working images used by ROI tracking and pyramid modes to match the current modes.
+static void windowImagesUpdate(ARHandle *handle)
+{
+    int factor;
+    
+    if      (handle->arImageProcMode == AR_IMAGE_PROC_PYRAMID_2X) factor = 2;
+    else if (handle->arImageProcMode == AR_IMAGE_PROC_PYRAMID_4X) factor = 4;
+    else                                                          factor = 0;
+    
+    free(handle->arPyramidImage);
+    handle->arPyramidImage = NULL;
+    if (factor) arMalloc(handle->arPyramidImage, ARUint8, (handle->xsize/factor)*(handle->ysize/factor));
+    
+    if (factor || handle->arROITrackingMode == AR_ROI_TRACKING_ENABLE) {
+        if (!handle->arWindowImage) arMalloc(handle->arWindowImage, ARUint8, handle->xsize*handle->ysize);
+    } else {
+        free(handle->arWindowImage);
+        handle->arWindowImage = NULL;
+    }
+}
+
 void arSetImageProcMode(ARHandle *handle, int mode)
 {
     if (!handle) return;
@@ -280,12 +410,16 @@ void arSetImageProcMode(ARHandle *handle, int mode)
     switch (mode) {
         case AR_IMAGE_PROC_FRAME_IMAGE:
         case AR_IMAGE_PROC_FIELD_IMAGE:
+        case AR_IMAGE_PROC_PYRAMID_2X:
+        case AR_IMAGE_PROC_PYRAMID_4X:
             break;
         default:
             return;
     }
 
     handle->arImageProcMode = mode;
+    handle->arROINum = 0; // Next frame is a full-frame scan.
+    windowImagesUpdate(handle);
 }
 
 int arGetImageProcMode(ARHandle *handle)
@@ -318,6 +452,7 @@ void arSetMatrixCodeType(ARHandle *handle, const AR_MATRIX_CODE_TYPE type)
     if (!handle) return;
 
     handle->matrixCodeType = type;
+    bchTableEnsure(handle->pattHandle, type);
 }
 
 AR_MATRIX_CODE_TYPE arGetMatrixCodeType(ARHandle *handle)
@@ -457,6 +592,36 @@ void arSetCornerRefinementMode(ARHandle *handle, int mode)
     handle->arCornerRefinementMode = mode;
 }
 
+void arSetPyramidAreaMax(ARHandle *handle, const ARdouble areaMax)
+{
+    if (!handle) return;
+    if (areaMax <= 0.0) return;
+    
+    handle->pyramidAreaMax = areaMax;
+}
+
+ARdouble arGetPyramidAreaMax(ARHandle *handle)
+{
+    if (!handle) return (AR_PYRAMID_AREA_MAX);
+    
+    return (handle->pyramidAreaMax);
+}
+
+void arSetPyramidAreaMin(ARHandle *handle, const ARdouble areaMin)
+{
+    if (!handle) return;
+    if (areaMin <= 0.0) return;
+    
+    handle->pyramidAreaMin = areaMin;
+}
+
+ARdouble arGetPyramidAreaMin(ARHandle *handle)
+{
+    if (!handle) return (AR_PYRAMID_AREA_MIN);
+    
+    return (handle->pyramidAreaMin);
+}
+
 void arSetAreaMax(ARHandle *handle, const ARdouble areaMax)
 {
     if (!handle) return;
@@ -509,6 +674,46 @@ int arGetCornerRefinementMode(ARHandle *handle)
     return (handle->arCornerRefinementMode);
 }
 
+void arSetROITrackingMode(ARHandle *handle, int mode)
+{
+    if (!handle) return;
+    
+    switch (mode) {
+        case AR_ROI_TRACKING_DISABLE:
+        case AR_ROI_TRACKING_ENABLE:
+            break;
+        default:
+            return;
+    }
+    
+    handle->arROITrackingMode = mode;
+    handle->arROINum = 0; // Next frame is a full-frame scan.
+    windowImagesUpdate(handle);
+}
+
+int arGetROITrackingMode(ARHandle *handle)
+{
+    if (!handle) return (AR_DEFAULT_ROI_TRACKING_MODE);
+    
+    return (handle->arROITrackingMode);
+}
+
+void arSetROITrackingFullScanInterval(ARHandle *handle, int interval)
+{
+    if (!handle) return;
+    if (interval < 0) return;
+    
+    handle->arROITrackingFullScanInterval = interval;
+    if (handle->arROITrackingFullScanTTL > interval) handle->arROITrackingFullScanTTL = interval;
+}
+
+int arGetROITrackingFullScanInterval(ARHandle *handle)
+{
+    if (!handle) return (AR_ROI_TRACKING_FULL_SCAN_INTERVAL_DEFAULT);
+    
+    return (handle->arROITrackingFullScanInterval);
+}
+
 int arGetMarkerNum(ARHandle *handle)
 {
     if (!handle) return -1;
@@ -37,8 +37,11 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ARX/AR/ar.h>
 #include <ARX/AR/arImageProc.h>
+#include <ARX/ARUtil/thread_sub.h>
 #include "arRefineCorners.h"
 #if DEBUG_PATT_GETID
 extern int cnt;
@@ -54,17 +57,54 @@ const char *arMarkerInfoCutoffPhaseDescriptions[AR_MARKER_INFO_CUTOFF_PHASE_DESC
     "Matching confidence cutoff value not reached.",
     "Maximum allowable pose error exceeded.",
     "Multi-marker pose error value exceeded.",
-    "Rejected frequently misrecognised matrix marker."
+    "Rejected frequently misrecognised matrix marker.",
+    "Identity differs from marker in other stereo camera."
 };
 
+static int  applyHistory(ARHandle *arHandle, int (*win)[4], const ARMarkerInfo *expected[], int winNum);
+static void stereoMismatchCutoff(ARHandle *arHandle, int (*win)[4], const ARMarkerInfo *expected[], int winNum);
 static void confidenceCutoff(ARHandle *arHandle);
+static int  markerIsIdentified(ARHandle *arHandle, ARMarkerInfo *markerInfo);
+static int  fullResImageProcMode(ARHandle *arHandle);
+static int  findSquares(ARHandle *arHandle, AR2VideoBufferT *frame, int thresh);
+static int  findSquaresPyramid(ARHandle *arHandle, AR2VideoBufferT *frame, int thresh);
+static int  findSquaresInWindows(ARHandle *arHandle, AR2VideoBufferT *frame, int (*win)[4], int winNum, int thresh);
+static void mergeWindows(int (*win)[4], int *winNum);
+static int  detectROI(ARHandle *arHandle, AR2VideoBufferT *frame);
+static void updateROI(ARHandle *arHandle);
+static int  bracketingPasses(ARHandle *arHandle, AR2VideoBufferT *frame, const int thresholds[3], int marker_nums[3]);
+static int  countIdentified(const ARMarkerInfo *markerInfo, int marker_num);
+
+// One of the two bracketing passes run on worker threads, at the thresholds above and below the current one.
+typedef struct {
+    ARBracketingThreads   *threads;
+    THREAD_HANDLE_T       *threadHandle;
+    int                    thresh;
+    ARLabelInfo            labelInfo;
+    ARMarkerInfo2          markerInfo2[AR_SQUARE_MAX];
+    int                    marker2_num;
+    ARMarkerInfo           markerInfo[AR_SQUARE_MAX];
+    int                    marker_num;
+    ARMarkerInfoThreads   *markerInfoThreads;          ///< Pattern scratch buffers for this pass.
+    int                    ret;
+} ARBracketingPass;
+
+struct _ARBracketingThreads {
+    int                    xsize;
+    int                    ysize;
+    ARBracketingPass       pass[2];
+    // Parameters of the current frame.
+    ARHandle              *arHandle;
+    AR2VideoBufferT       *frame;
+    int                    labelDone;                  ///< Set when the passes' label images have already been filled by arLabelingMulti().
+};
+
+static void *bracketingWorker(THREAD_HANDLE_T *threadHandle);
+static void bracketingPassProcess(ARBracketingPass *pass);
 
 int arDetectMarker(ARHandle *arHandle, AR2VideoBufferT *frame)
 {
-    ARdouble    rarea, rlen, rlenmin;
-    ARdouble    diff, diffmin;
-    int         cid, cdir;
-    int         i, j, k;
+    int         i, j;
     int         detectionIsDone = 0;
     int         threshDiff;
 
@@ -76,7 +116,21 @@ cnt = 0;
     
     arHandle->marker_num = 0;
     
-    if (arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_BRACKETING) {
+    if (arHandle->arROITrackingMode == AR_ROI_TRACKING_ENABLE) {
+        if (arHandle->arROINum > 0 && arHandle->arROITrackingFullScanTTL > 0 && arHandle->arDebug == AR_DEBUG_DISABLE
+            && (arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_MANUAL || arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_MEDIAN || arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_OTSU)) {
+            arHandle->arROITrackingFullScanTTL--;
+            if (detectROI(arHandle, frame) < 0) return -1;
+            // If fewer markers were identified than last frame, one may have left its window, so scan the whole frame.
+            j = 0;
+            for (i = 0; i < arHandle->marker_num; i++) if (markerIsIdentified(arHandle, &(arHandle->markerInfo[i]))) j++;
+            if (j >= arHandle->arROIMarkerNum) detectionIsDone = 1;
+            else arHandle->marker_num = 0;
+        }
+        if (!detectionIsDone) arHandle->arROITrackingFullScanTTL = arHandle->arROITrackingFullScanInterval;
+    }
+    
+    if (!detectionIsDone && arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_BRACKETING) {
         if (arHandle->arLabelingThreshAutoIntervalTTL > 0) {
             arHandle->arLabelingThreshAutoIntervalTTL--;
         } else {
@@ -89,13 +143,7 @@ cnt = 0;
             if (thresholds[1] < 0) thresholds[1] = 0;
             thresholds[2] = arHandle->arLabelingThresh;
             
-            for (i = 0; i < 3; i++) {
-                if (arLabeling(frame->buffLuma, arHandle->xsize, arHandle->ysize, arHandle->arDebug, arHandle->arLabelingMode, thresholds[i], arHandle->arImageProcMode, &(arHandle->labelInfo), NULL) < 0) return -1;
-                if (arDetectMarker2(arHandle->xsize, arHandle->ysize, &(arHandle->labelInfo), arHandle->arImageProcMode, arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh, arHandle->markerInfo2, &(arHandle->marker2_num)) < 0) return -1;
-                if (arGetMarkerInfo(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat, arHandle->markerInfo2, arHandle->marker2_num, arHandle->pattHandle, arHandle->arImageProcMode, arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio, arHandle->markerInfo, &(arHandle->marker_num), arHandle->matrixCodeType) < 0) return -1;
-                marker_nums[i] = 0;
-                for (j = 0; j < arHandle->marker_num; j++) if (arHandle->markerInfo[j].idPatt != -1 || arHandle->markerInfo[j].idMatrix != -1) marker_nums[i]++;
-            }
+            if (bracketingPasses(arHandle, frame, thresholds, marker_nums) < 0) return -1;
 
             if (arHandle->arDebug == AR_DEBUG_ENABLE) ARLOGe("Auto threshold (bracket) marker counts -[%3d: %3d] [%3d: %3d] [%3d: %3d]+.\n", thresholds[1], marker_nums[1], thresholds[2], marker_nums[2], thresholds[0], marker_nums[0]);
         
@@ -135,12 +183,19 @@ cnt = 0;
             ret = arImageProcLumaHistAndBoxFilterWithBias(arHandle->arImageProcInfo, frame->buffLuma, arHandle->arLabelingThreshAutoAdaptiveKernelSize, arHandle->arLabelingThreshAutoAdaptiveBias);
             if (ret < 0) return (ret);
             
-            ret = arLabeling(frame->buffLuma, arHandle->arImageProcInfo->imageX, arHandle->arImageProcInfo->imageY,
-                             arHandle->arDebug, arHandle->arLabelingMode,
-                             0, AR_IMAGE_PROC_FRAME_IMAGE,
-                             &(arHandle->labelInfo), arHandle->arImageProcInfo->image2);
+            ret = arLabelingBands(frame->buffLuma, arHandle->arImageProcInfo->imageX, arHandle->arImageProcInfo->imageY,
+                                  arHandle->arDebug, arHandle->arLabelingMode,
+                                  0, AR_IMAGE_PROC_FRAME_IMAGE,
+                                  &(arHandle->labelInfo), arHandle->arImageProcInfo->image2, arHandle->arLabelingBandsInfo);
             if (ret < 0) return (ret);
             
+            if( arDetectMarker2( arHandle->xsize, arHandle->ysize,
+                                &(arHandle->labelInfo), fullResImageProcMode(arHandle),
+                                arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh,
+                                arHandle->markerInfo2, &(arHandle->marker2_num) ) < 0 ) {
+                return -1;
+            }
+            
         } else { // !adaptive
             
             if (arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_MEDIAN || arHandle->arLabelingThreshMode == AR_LABELING_THRESH_MODE_AUTO_OTSU) {
@@ -159,53 +214,46 @@ cnt = 0;
                 }
             }
             
-            if( arLabeling(frame->buffLuma, arHandle->xsize, arHandle->ysize,
-                           arHandle->arDebug, arHandle->arLabelingMode,
-                           arHandle->arLabelingThresh, arHandle->arImageProcMode,
-                           &(arHandle->labelInfo), NULL) < 0 ) {
+            if( findSquares(arHandle, frame, arHandle->arLabelingThresh) < 0 ) {
                 return -1;
             }
             
         }
         
-        if( arDetectMarker2( arHandle->xsize, arHandle->ysize,
-                            &(arHandle->labelInfo), arHandle->arImageProcMode,
-                            arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh,
-                            arHandle->markerInfo2, &(arHandle->marker2_num) ) < 0 ) {
-            return -1;
-        }
-        
-        if( arGetMarkerInfo(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat,
+        if( arGetMarkerInfoParallel(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat,
                             arHandle->markerInfo2, arHandle->marker2_num,
-                            arHandle->pattHandle, arHandle->arImageProcMode,
+                            arHandle->pattHandle, fullResImageProcMode(arHandle),
                             arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio,
                             arHandle->markerInfo, &(arHandle->marker_num),
-                            arHandle->matrixCodeType ) < 0 ) {
+                            arHandle->matrixCodeType, arHandle->arMarkerInfoThreads ) < 0 ) {
             return -1;
         }
     } // !detectionIsDone
     
     if (arHandle->arCornerRefinementMode == AR_CORNER_REFINEMENT_ENABLE) {
         // Refine marker co-ordinates.
-        ARfloat obVertex[4][2];
-        for (int i = 0; i < 4; i++) {
-            float arXIn = (float)arHandle->markerInfo->vertex[i][0];
-            float arYIn = (float)arHandle->markerInfo->vertex[i][1];
-            arParamIdeal2ObservLTf(&arHandle->arParamLT->paramLTf, arXIn, arYIn, &obVertex[i][0], &obVertex[i][1]);
-        }
-        arRefineCorners((float (*)[2])obVertex, frame->buffLuma, arHandle->xsize, arHandle->ysize);
-        for (int i = 0; i < 4; i++) {
-            float newX, newY;
-            arParamObserv2IdealLTf(&arHandle->arParamLT->paramLTf, obVertex[i][0], obVertex[i][1], &newX, &newY);
-            arHandle->markerInfo->vertex[i][0] = (ARdouble)newX;
-            arHandle->markerInfo->vertex[i][1] = (ARdouble)newY;
-        }
-        //free(obVertex);
+        arRefineCornersParallel(arHandle->markerInfo, arHandle->marker_num, frame->buffLuma, arHandle->xsize, arHandle->ysize,
+                                &(arHandle->arParamLT->paramLTf), arHandle->arMarkerInfoThreads);
     }
     
+    return applyHistory(arHandle, NULL, NULL, 0);
+}
+
+// Applies the tracking history (if enabled) and the confidence cutoff to the markers just detected,
+// and sets the regions of interest for the next frame. If expected is non-NULL, markers are also
+// checked against the identities expected in each window before they are recorded in the history.
+static int applyHistory(ARHandle *arHandle, int (*win)[4], const ARMarkerInfo *expected[], int winNum)
+{
+    ARdouble    rarea, rlen, rlenmin;
+    ARdouble    diff, diffmin;
+    int         cid, cdir;
+    int         i, j, k;
+
     // If history mode is not enabled, just perform a basic confidence cutoff.
     if (arHandle->arMarkerExtractionMode == AR_NOUSE_TRACKING_HISTORY) {
         confidenceCutoff(arHandle);
+        if (expected) stereoMismatchCutoff(arHandle, win, expected, winNum);
+        if (arHandle->arROITrackingMode == AR_ROI_TRACKING_ENABLE) updateROI(arHandle);
         return 0;
     }
 
@@ -295,6 +343,8 @@ cnt = 0;
     }
 
     confidenceCutoff(arHandle);
+    if (expected) stereoMismatchCutoff(arHandle, win, expected, winNum);
+    if (arHandle->arROITrackingMode == AR_ROI_TRACKING_ENABLE) updateROI(arHandle);
 
     // Age all history records (and expire old records, i.e. where count >= 4).
     for( i = j = 0; i < arHandle->history_num; i++ ) {
@@ -379,3 +429,403 @@ static void confidenceCutoff(ARHandle *arHandle)
     }
 }
 
+static int markerIsIdentified(ARHandle *arHandle, ARMarkerInfo *markerInfo)
+{
+    if (arHandle->arPatternDetectionMode == AR_TEMPLATE_MATCHING_COLOR_AND_MATRIX || arHandle->arPatternDetectionMode == AR_TEMPLATE_MATCHING_MONO_AND_MATRIX) {
+        return ((markerInfo->idPatt >= 0 && markerInfo->cfPatt >= AR_CONFIDENCE_CUTOFF_DEFAULT) || (markerInfo->idMatrix >= 0 && markerInfo->cfMatrix >= AR_CONFIDENCE_CUTOFF_DEFAULT));
+    }
+    return (markerInfo->id >= 0 && markerInfo->cf >= AR_CONFIDENCE_CUTOFF_DEFAULT);
+}
+
+// AR_IMAGE_PROC_FIELD_IMAGE, or AR_IMAGE_PROC_FRAME_IMAGE for stages which work on the full-resolution frame in pyramid modes.
+static int fullResImageProcMode(ARHandle *arHandle)
+{
+    return (arHandle->arImageProcMode == AR_IMAGE_PROC_FIELD_IMAGE ? AR_IMAGE_PROC_FIELD_IMAGE : AR_IMAGE_PROC_FRAME_IMAGE);
+}
+
+// Labels the frame at the given threshold, and extracts candidate squares into markerInfo2.
+static int findSquares(ARHandle *arHandle, AR2VideoBufferT *frame, int thresh)
+{
+    // In debug mode, the full frame is labeled so that the debug image is full-size.
+    if ((arHandle->arImageProcMode == AR_IMAGE_PROC_PYRAMID_2X || arHandle->arImageProcMode == AR_IMAGE_PROC_PYRAMID_4X) && arHandle->arDebug == AR_DEBUG_DISABLE) {
+        return (findSquaresPyramid(arHandle, frame, thresh));
+    }
+
+    if (arLabelingBands(frame->buffLuma, arHandle->xsize, arHandle->ysize,
+                        arHandle->arDebug, arHandle->arLabelingMode,
+                        thresh, fullResImageProcMode(arHandle),
+                        &(arHandle->labelInfo), NULL, arHandle->arLabelingBandsInfo) < 0) {
+        return -1;
+    }
+    return (arDetectMarker2(arHandle->xsize, arHandle->ysize,
+                            &(arHandle->labelInfo), fullResImageProcMode(arHandle),
+                            arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh,
+                            arHandle->markerInfo2, &(arHandle->marker2_num)));
+}
+
+// Labels a 2x or 4x decimated copy of the frame to find regions which may be markers, using
+// the pyramid area limits. Each region's bounding box, mapped back up and dilated to allow
+// for decimation, is then labeled at full resolution, so that contours (and hence the lines
+// fitted to them by arGetLine() in arGetMarkerInfo()) have full-resolution accuracy.
+static int findSquaresPyramid(ARHandle *arHandle, AR2VideoBufferT *frame, int thresh)
+{
+    const int      factor = (arHandle->arImageProcMode == AR_IMAGE_PROC_PYRAMID_4X ? 4 : 2);
+    const int      pxsize = arHandle->xsize / factor;
+    const int      pysize = arHandle->ysize / factor;
+    const int      margin = 2*factor + 2;
+    ARMarkerInfo2 *m2;
+    int            win[AR_SQUARE_MAX][4];
+    int            winNum;
+    int            x0, y0, x1, y1;
+    int            i, k;
+
+    arImageProcLumaDecimate(frame->buffLuma, arHandle->xsize, arHandle->ysize, factor, arHandle->arPyramidImage);
+    if (arLabelingBands(arHandle->arPyramidImage, pxsize, pysize,
+                        AR_DEBUG_DISABLE, arHandle->arLabelingMode,
+                        thresh, AR_IMAGE_PROC_FRAME_IMAGE,
+                        &(arHandle->labelInfo), NULL, arHandle->arLabelingBandsInfo) < 0) {
+        return -1;
+    }
+    if (arDetectMarker2(pxsize, pysize, &(arHandle->labelInfo), AR_IMAGE_PROC_FRAME_IMAGE,
+                        (int)(arHandle->pyramidAreaMax / (factor*factor)), (int)(arHandle->pyramidAreaMin / (factor*factor)), arHandle->squareFitThresh,
+                        arHandle->markerInfo2, &(arHandle->marker2_num)) < 0) {
+        return -1;
+    }
+
+    winNum = 0;
+    for (i = 0; i < arHandle->marker2_num; i++) {
+        m2 = &(arHandle->markerInfo2[i]);
+        x0 = x1 = m2->x_coord[0];
+        y0 = y1 = m2->y_coord[0];
+        for (k = 1; k < m2->coord_num; k++) {
+            if (m2->x_coord[k] < x0) x0 = m2->x_coord[k];
+            else if (m2->x_coord[k] > x1) x1 = m2->x_coord[k];
+            if (m2->y_coord[k] < y0) y0 = m2->y_coord[k];
+            else if (m2->y_coord[k] > y1) y1 = m2->y_coord[k];
+        }
+        win[winNum][0] = (x0*factor - margin < 0 ? 0 : x0*factor - margin);
+        win[winNum][1] = (y0*factor - margin < 0 ? 0 : y0*factor - margin);
+        win[winNum][2] = ((x1 + 1)*factor + margin > arHandle->xsize ? arHandle->xsize : (x1 + 1)*factor + margin);
+        win[winNum][3] = ((y1 + 1)*factor + margin > arHandle->ysize ? arHandle->ysize : (y1 + 1)*factor + margin);
+        winNum++;
+    }
+    mergeWindows(win, &winNum);
+    return (findSquaresInWindows(arHandle, frame, win, winNum, thresh));
+}
+
+// Labels each window of the frame separately, and extracts candidate squares into markerInfo2.
+// Each window's luma is copied to a contiguous buffer, and its candidate squares are offset back
+// into full-frame coordinates, so that matching proceeds as for a full frame.
+static int findSquaresInWindows(ARHandle *arHandle, AR2VideoBufferT *frame, int (*win)[4], int winNum, int thresh)
+{
+    int i, j;
+    int x0, y0, wx, wy;
+    int marker2_num;
+
+    arHandle->marker2_num = 0;
+    for (i = 0; i < winNum && arHandle->marker2_num < AR_SQUARE_MAX; i++) {
+        x0 = win[i][0];
+        y0 = win[i][1];
+        wx = win[i][2] - x0;
+        wy = win[i][3] - y0;
+        for (j = 0; j < wy; j++) memcpy(&(arHandle->arWindowImage[j*wx]), &(frame->buffLuma[(y0 + j)*arHandle->xsize + x0]), wx);
+
+        if (arLabelingBands(arHandle->arWindowImage, wx, wy, AR_DEBUG_DISABLE, arHandle->arLabelingMode,
+                            thresh, fullResImageProcMode(arHandle),
+                            &(arHandle->labelInfo), NULL, arHandle->arLabelingBandsInfo) < 0) {
+            return -1;
+        }
+        if (arDetectMarker2Window(wx, wy, x0, y0, &(arHandle->labelInfo), fullResImageProcMode(arHandle),
+                                  arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh,
+                                  &(arHandle->markerInfo2[arHandle->marker2_num]), AR_SQUARE_MAX - arHandle->marker2_num, &marker2_num) < 0) {
+            return -1;
+        }
+        arHandle->marker2_num += marker2_num;
+    }
+
+    return 0;
+}
+
+// Merges overlapping windows, so that no region is searched twice.
+static void mergeWindows(int (*win)[4], int *winNum)
+{
+    int i, j, k, merged;
+
+    do {
+        merged = 0;
+        for (i = 0; i < *winNum; i++) {
+            for (j = i + 1; j < *winNum; j++) {
+                if (win[i][0] < win[j][2] && win[j][0] < win[i][2] && win[i][1] < win[j][3] && win[j][1] < win[i][3]) {
+                    if (win[j][0] < win[i][0]) win[i][0] = win[j][0];
+                    if (win[j][1] < win[i][1]) win[i][1] = win[j][1];
+                    if (win[j][2] > win[i][2]) win[i][2] = win[j][2];
+                    if (win[j][3] > win[i][3]) win[i][3] = win[j][3];
+                    for (k = 0; k < 4; k++) win[j][k] = win[*winNum - 1][k];
+                    (*winNum)--;
+                    merged = 1;
+                    j--;
+                }
+            }
+        }
+    } while (merged);
+}
+
+int arDetectMarkerInWindows(ARHandle *arHandle, AR2VideoBufferT *frame, int win[][4], const ARMarkerInfo *expected[], int winNum)
+{
+    int            merged[AR_SQUARE_MAX][4];
+    int            mergedNum;
+    int            i, k;
+
+    if (!arHandle || !frame || !win || winNum < 0 || winNum > AR_SQUARE_MAX) return (-1);
+
+    arHandle->marker_num = 0;
+
+    for (i = 0; i < winNum; i++) for (k = 0; k < 4; k++) merged[i][k] = win[i][k];
+    mergedNum = winNum;
+    mergeWindows(merged, &mergedNum);
+
+    // The working buffer is otherwise only kept when ROI tracking or a pyramid mode needs it.
+    if (!arHandle->arWindowImage) arMalloc(arHandle->arWindowImage, ARUint8, arHandle->xsize*arHandle->ysize);
+    if (findSquaresInWindows(arHandle, frame, merged, mergedNum, arHandle->arLabelingThresh) < 0) return -1;
+
+    if (arGetMarkerInfoParallel(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat,
+                                arHandle->markerInfo2, arHandle->marker2_num,
+                                arHandle->pattHandle, fullResImageProcMode(arHandle),
+                                arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio,
+                                arHandle->markerInfo, &(arHandle->marker_num),
+                                arHandle->matrixCodeType, arHandle->arMarkerInfoThreads) < 0) {
+        return -1;
+    }
+
+    if (arHandle->arCornerRefinementMode == AR_CORNER_REFINEMENT_ENABLE) {
+        arRefineCornersParallel(arHandle->markerInfo, arHandle->marker_num, frame->buffLuma, arHandle->xsize, arHandle->ysize,
+                                &(arHandle->arParamLT->paramLTf), arHandle->arMarkerInfoThreads);
+    }
+
+    return applyHistory(arHandle, win, expected, winNum);
+}
+
+// Rejects identified markers whose position does not fall in a window expecting the same identity.
+static void stereoMismatchCutoff(ARHandle *arHandle, int (*win)[4], const ARMarkerInfo *expected[], int winNum)
+{
+    ARMarkerInfo  *m;
+    float          ox, oy;
+    int            i, j;
+
+    for (i = 0; i < arHandle->marker_num; i++) {
+        m = &(arHandle->markerInfo[i]);
+        if (m->idPatt < 0 && m->idMatrix < 0) continue;
+        // Windows are in observed coordinates.
+        if (arParamIdeal2ObservLTf(&(arHandle->arParamLT->paramLTf), (float)m->pos[0], (float)m->pos[1], &ox, &oy) < 0) {
+            ox = (float)m->pos[0];
+            oy = (float)m->pos[1];
+        }
+        for (j = 0; j < winNum; j++) {
+            if (!expected[j] || ox < win[j][0] || ox >= win[j][2] || oy < win[j][1] || oy >= win[j][3]) continue;
+            if (m->idPatt >= 0 && m->idPatt == expected[j]->idPatt) break;
+            if (m->idMatrix >= 0 && m->idMatrix == expected[j]->idMatrix && m->globalID == expected[j]->globalID) break;
+        }
+        if (j == winNum) {
+            m->id = m->idPatt = m->idMatrix = -1;
+            m->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_STEREO_MISMATCH;
+        }
+    }
+}
+
+// Searches only the windows set by updateROI() for the previous frame.
+static int detectROI(ARHandle *arHandle, AR2VideoBufferT *frame)
+{
+    if (findSquaresInWindows(arHandle, frame, arHandle->arROI, arHandle->arROINum, arHandle->arLabelingThresh) < 0) return -1;
+
+    return (arGetMarkerInfoParallel(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat,
+                                    arHandle->markerInfo2, arHandle->marker2_num,
+                                    arHandle->pattHandle, fullResImageProcMode(arHandle),
+                                    arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio,
+                                    arHandle->markerInfo, &(arHandle->marker_num),
+                                    arHandle->matrixCodeType, arHandle->arMarkerInfoThreads));
+}
+
+// Sets the windows to be searched in the next frame from the markers identified in this one.
+static void updateROI(ARHandle *arHandle)
+{
+    ARMarkerInfo2 *m2;
+    int           *roi;
+    int            x0, y0, x1, y1, margin;
+    int            i, k;
+
+    arHandle->arROINum = 0;
+    arHandle->arROIMarkerNum = 0;
+    for (i = 0; i < arHandle->marker_num; i++) {
+        if (!markerIsIdentified(arHandle, &(arHandle->markerInfo[i]))) continue;
+        arHandle->arROIMarkerNum++;
+
+        // Bounding box of the observed (distorted) corners.
+        m2 = arHandle->markerInfo[i].markerInfo2Ptr;
+        x0 = x1 = m2->x_coord[m2->vertex[0]];
+        y0 = y1 = m2->y_coord[m2->vertex[0]];
+        for (k = 1; k < 4; k++) {
+            if (m2->x_coord[m2->vertex[k]] < x0) x0 = m2->x_coord[m2->vertex[k]];
+            if (m2->x_coord[m2->vertex[k]] > x1) x1 = m2->x_coord[m2->vertex[k]];
+            if (m2->y_coord[m2->vertex[k]] < y0) y0 = m2->y_coord[m2->vertex[k]];
+            if (m2->y_coord[m2->vertex[k]] > y1) y1 = m2->y_coord[m2->vertex[k]];
+        }
+        margin = (int)((x1 - x0 > y1 - y0 ? x1 - x0 : y1 - y0) * AR_ROI_TRACKING_MARGIN);
+        if (margin < AR_ROI_TRACKING_MARGIN_MIN) margin = AR_ROI_TRACKING_MARGIN_MIN;
+
+        // Even bounds, so windows can be labeled in field mode.
+        roi = arHandle->arROI[arHandle->arROINum++];
+        roi[0] = (x0 - margin < 0 ? 0 : (x0 - margin) & ~1);
+        roi[1] = (y0 - margin < 0 ? 0 : (y0 - margin) & ~1);
+        roi[2] = (x1 + margin + 2 > arHandle->xsize ? arHandle->xsize : (x1 + margin + 2)) & ~1;
+        roi[3] = (y1 + margin + 2 > arHandle->ysize ? arHandle->ysize : (y1 + margin + 2)) & ~1;
+    }
+
+    mergeWindows(arHandle->arROI, &(arHandle->arROINum));
+}
+
+static int countIdentified(const ARMarkerInfo *markerInfo, int marker_num)
+{
+    int i, count = 0;
+
+    for (i = 0; i < marker_num; i++) if (markerInfo[i].idPatt != -1 || markerInfo[i].idMatrix != -1) count++;
+    return (count);
+}
+
+// Detects markers at each of the three bracketing thresholds, and counts the identified markers
+// found at each. The results at thresholds[2] are left in arHandle, as the caller may keep them.
+// With bracketing threads, the passes at thresholds[0] and thresholds[1] run on the worker threads
+// into their own buffers, while the pass at thresholds[2] runs on this thread.
+static int bracketingPasses(ARHandle *arHandle, AR2VideoBufferT *frame, const int thresholds[3], int marker_nums[3])
+{
+    ARBracketingThreads *bt = arHandle->arBracketingThreads;
+    ARLabelInfo         *labelInfo[3];
+    int                  ret;
+    int                  i;
+
+    // The debug image must come from the last pass, and pyramid modes label through the handle's own buffers.
+    if (!bt || arHandle->arDebug == AR_DEBUG_ENABLE || fullResImageProcMode(arHandle) != arHandle->arImageProcMode) {
+        for (i = 0; i < 3; i++) {
+            if (findSquares(arHandle, frame, thresholds[i]) < 0) return -1;
+            if (arGetMarkerInfoParallel(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat, arHandle->markerInfo2, arHandle->marker2_num, arHandle->pattHandle, fullResImageProcMode(arHandle), arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio, arHandle->markerInfo, &(arHandle->marker_num), arHandle->matrixCodeType, arHandle->arMarkerInfoThreads) < 0) return -1;
+            marker_nums[i] = countIdentified(arHandle->markerInfo, arHandle->marker_num);
+        }
+        return 0;
+    }
+
+    bt->arHandle = arHandle;
+    bt->frame = frame;
+    bt->labelDone = 0;
+    for (i = 0; i < 2; i++) bt->pass[i].thresh = thresholds[i];
+    if (arHandle->arLabelingThreshAutoBracketingMode == AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS) {
+        labelInfo[0] = &(bt->pass[0].labelInfo);
+        labelInfo[1] = &(bt->pass[1].labelInfo);
+        labelInfo[2] = &(arHandle->labelInfo);
+        if (arLabelingMulti(frame->buffLuma, arHandle->xsize, arHandle->ysize, arHandle->arLabelingMode, thresholds, 3, arHandle->arImageProcMode, labelInfo) < 0) return -1;
+        bt->labelDone = 1;
+    }
+
+    for (i = 0; i < 2; i++) threadStartSignal(bt->pass[i].threadHandle);
+    if (bt->labelDone) {
+        ret = arDetectMarker2(arHandle->xsize, arHandle->ysize, &(arHandle->labelInfo), arHandle->arImageProcMode,
+                              arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh,
+                              arHandle->markerInfo2, &(arHandle->marker2_num));
+    } else {
+        ret = findSquares(arHandle, frame, thresholds[2]);
+    }
+    if (ret >= 0) {
+        ret = arGetMarkerInfoParallel(frame->buff, arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat, arHandle->markerInfo2, arHandle->marker2_num, arHandle->pattHandle, arHandle->arImageProcMode, arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio, arHandle->markerInfo, &(arHandle->marker_num), arHandle->matrixCodeType, arHandle->arMarkerInfoThreads);
+    }
+    for (i = 0; i < 2; i++) threadEndWait(bt->pass[i].threadHandle);
+    if (ret < 0) return -1;
+
+    for (i = 0; i < 2; i++) {
+        if (bt->pass[i].ret < 0) return -1;
+        marker_nums[i] = countIdentified(bt->pass[i].markerInfo, bt->pass[i].marker_num);
+    }
+    marker_nums[2] = countIdentified(arHandle->markerInfo, arHandle->marker_num);
+    return 0;
+}
+
+ARBracketingThreads *arBracketingThreadsInit( int xsize, int ysize )
+{
+    ARBracketingThreads *bt;
+    int                  i;
+
+    arMallocClear(bt, ARBracketingThreads, 1);
+    bt->xsize = xsize;
+    bt->ysize = ysize;
+    for (i = 0; i < 2; i++) {
+        bt->pass[i].threads = bt;
+        arMalloc(bt->pass[i].labelInfo.labelImage, AR_LABELING_LABEL_TYPE, xsize*ysize);
+        bt->pass[i].markerInfoThreads = arMarkerInfoThreadsInit(1);
+        if (!bt->pass[i].markerInfoThreads) {
+            arBracketingThreadsFinal(&bt);
+            return (NULL);
+        }
+        bt->pass[i].threadHandle = threadInit(i, &(bt->pass[i]), bracketingWorker);
+        if (!bt->pass[i].threadHandle) {
+            ARLOGe("Error: unable to start bracketing thread %d.\n", i);
+            arBracketingThreadsFinal(&bt);
+            return (NULL);
+        }
+    }
+
+    return (bt);
+}
+
+int arBracketingThreadsFinal( ARBracketingThreads **threads_p )
+{
+    ARBracketingThreads *bt;
+    int                  i;
+
+    if (!threads_p || !*threads_p) return (-1);
+    bt = *threads_p;
+
+    for (i = 0; i < 2; i++) {
+        if (bt->pass[i].threadHandle) {
+            threadWaitQuit(bt->pass[i].threadHandle);
+            threadFree(&(bt->pass[i].threadHandle));
+        }
+        if (bt->pass[i].markerInfoThreads) arMarkerInfoThreadsFinal(&(bt->pass[i].markerInfoThreads));
+        free(bt->pass[i].labelInfo.labelImage);
+    }
+    free(bt);
+    *threads_p = NULL;
+
+    return (0);
+}
+
+static void *bracketingWorker(THREAD_HANDLE_T *threadHandle)
+{
+    ARBracketingPass *pass = (ARBracketingPass *)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0) {
+        bracketingPassProcess(pass);
+        threadEndSignal(threadHandle);
+    }
+    return (NULL);
+}
+
+static void bracketingPassProcess(ARBracketingPass *pass)
+{
+    ARBracketingThreads *bt = pass->threads;
+    ARHandle            *arHandle = bt->arHandle;
+    AR2VideoBufferT     *frame = bt->frame;
+
+    pass->marker2_num = pass->marker_num = 0;
+    if (!bt->labelDone) {
+        pass->ret = arLabeling(frame->buffLuma, bt->xsize, bt->ysize,
+                               AR_DEBUG_DISABLE, arHandle->arLabelingMode, pass->thresh, arHandle->arImageProcMode,
+                               &(pass->labelInfo), NULL);
+        if (pass->ret < 0) return;
+    }
+    pass->ret = arDetectMarker2(bt->xsize, bt->ysize, &(pass->labelInfo), arHandle->arImageProcMode,
+                                arHandle->areaMax, arHandle->areaMin, arHandle->squareFitThresh,
+                                pass->markerInfo2, &(pass->marker2_num));
+    if (pass->ret < 0) return;
+    pass->ret = arGetMarkerInfoParallel(frame->buff, bt->xsize, bt->ysize, arHandle->arPixelFormat,
+                                        pass->markerInfo2, pass->marker2_num,
+                                        arHandle->pattHandle, arHandle->arImageProcMode,
+                                        arHandle->arPatternDetectionMode, &(arHandle->arParamLT->paramLTf), arHandle->pattRatio,
+                                        pass->markerInfo, &(pass->marker_num), arHandle->matrixCodeType, pass->markerInfoThreads);
+}
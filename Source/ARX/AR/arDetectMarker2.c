@@ -56,6 +56,13 @@ static int get_vertex( int x_coord[], int y_coord[], int st, int ed,
 int arDetectMarker2( int xsize, int ysize, ARLabelInfo *labelInfo, int imageProcMode,
                      int areaMax, int areaMin, ARdouble squareFitThresh,
                      ARMarkerInfo2 *markerInfo2, int *marker2_num )
+{
+    return (arDetectMarker2Window(xsize, ysize, 0, 0, labelInfo, imageProcMode, areaMax, areaMin, squareFitThresh, markerInfo2, AR_SQUARE_MAX, marker2_num));
+}
+
+int arDetectMarker2Window( int xsize, int ysize, int x0, int y0, ARLabelInfo *labelInfo, int imageProcMode,
+                           int areaMax, int areaMin, ARdouble squareFitThresh,
+                           ARMarkerInfo2 *markerInfo2, int marker2_max, int *marker2_num )
 {
     ARMarkerInfo2     *pm;
     int               i, j, ret;
@@ -69,6 +76,7 @@ int arDetectMarker2( int xsize, int ysize, ARLabelInfo *labelInfo, int imageProc
     }
 
     *marker2_num = 0;
+    if( marker2_max <= 0 ) return 0;
     for( i = 0; i < labelInfo->label_num; i++ ) {
         if( labelInfo->area[i] < areaMin || labelInfo->area[i] > areaMax ) continue;
         if( labelInfo->clip[i][0] == 1 || labelInfo->clip[i][1] == xsize-2 ) continue;
@@ -85,8 +93,8 @@ int arDetectMarker2( int xsize, int ysize, ARLabelInfo *labelInfo, int imageProc
         markerInfo2[*marker2_num].pos[0] = labelInfo->pos[i][0];
         markerInfo2[*marker2_num].pos[1] = labelInfo->pos[i][1];
         (*marker2_num)++;
-        if( *marker2_num == AR_SQUARE_MAX ) {
-            ARLOGd("Max # of label regions (%d) found.\n", AR_SQUARE_MAX);
+        if( *marker2_num == marker2_max ) {
+            ARLOGd("Max # of label regions (%d) found.\n", marker2_max);
             break;
         }
     }
@@ -132,6 +140,19 @@ int arDetectMarker2( int xsize, int ysize, ARLabelInfo *labelInfo, int imageProc
         }
     }
 
+    if( x0 != 0 || y0 != 0 ) {
+        pm = &(markerInfo2[0]);
+        for( i = 0; i < *marker2_num; i++ ) {
+            pm->pos[0] += x0;
+            pm->pos[1] += y0;
+            for( j = 0; j< pm->coord_num; j++ ) {
+                pm->x_coord[j] += x0;
+                pm->y_coord[j] += y0;
+            }
+            pm++;
+        }
+    }
+
     return 0;
 }
 
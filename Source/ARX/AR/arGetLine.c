@@ -47,6 +47,7 @@
  *******************************************************/
 
 #include <stdio.h>
+#include <math.h>
 #include <ARX/AR/ar.h>
 
 #ifdef ARDOUBLE_IS_FLOAT
@@ -63,46 +64,103 @@
 #  define FABS(x) fabs(x)
 #endif
 
+#define VZERO 1e-16
+
+int arGetLineFit(int x_coord[], int y_coord[], int st, int ed, ARParamLTf *paramLTf, ARdouble line[3])
+{
+    const float *lt;
+    float        ltc[2];
+    double       x0, y0, x, y;
+    double       sx, sy, sxx, sxy, syy;
+    double       cxx, cxy, cyy, d, l1, ex, ey, e;
+    int          n, px, py;
+    int          j;
+
+    n = ed - st + 1;
+    if (n < 2) return -1;
+
+    // Accumulate the sums of the undistorted points and their products in a single pass. Points
+    // are taken relative to the first, which keeps the sums small enough to not lose precision.
+    x0 = y0 = 0.0;
+    sx = sy = sxx = sxy = syy = 0.0;
+    for (j = st; j <= ed; j++) {
+        if (paramLTf->paramLTi) {
+            // Compact tables are only accessible via interpolation.
+            if (arParamObserv2IdealLTf(paramLTf, (float)x_coord[j], (float)y_coord[j], &ltc[0], &ltc[1]) < 0) return -1;
+            lt = ltc;
+        } else {
+            // As arParamObserv2IdealLTf(), for integer observed coordinates.
+            px = x_coord[j] + paramLTf->xOff;
+            py = y_coord[j] + paramLTf->yOff;
+            if (px < 0 || px >= paramLTf->xsize || py < 0 || py >= paramLTf->ysize) return -1;
+            lt = paramLTf->o2i + (py*paramLTf->xsize + px)*2;
+        }
+        if (j == st) {
+            x0 = lt[0];
+            y0 = lt[1];
+            continue;
+        }
+        x = lt[0] - x0;
+        y = lt[1] - y0;
+        sx += x;
+        sy += y;
+        sxx += x*x;
+        sxy += x*y;
+        syy += y*y;
+    }
+
+    // Covariance, and its larger eigenvalue in closed form.
+    sx /= n;
+    sy /= n;
+    cxx = sxx/n - sx*sx;
+    cxy = sxy/n - sx*sy;
+    cyy = syy/n - sy*sy;
+    d = sqrt((cxx - cyy)*(cxx - cyy)*0.25 + cxy*cxy);
+    l1 = (cxx + cyy)*0.5 + d;
+
+    if (l1 < VZERO) {
+        // All points coincide, so there is no direction. As for arMatrixPCA(), give a null line.
+        line[0] = line[1] = line[2] = _0_0;
+        return 0;
+    }
+
+    // Eigenvector (ex, ey) of l1, from whichever row of (C - l1*I) is better conditioned.
+    if (cxx >= cyy) {
+        ex = l1 - cyy;
+        ey = cxy;
+    } else {
+        ex = cxy;
+        ey = l1 - cxx;
+    }
+    e = sqrt(ex*ex + ey*ey);
+    if (e < VZERO) {
+        ex = 1.0;
+        ey = 0.0;
+    } else {
+        ex /= e;
+        ey /= e;
+    }
+
+    // The line through the mean, normal to the principal direction.
+    line[0] = (ARdouble)ey;
+    line[1] = (ARdouble)-ex;
+    line[2] = (ARdouble)-(ey*(sx + x0) - ex*(sy + y0));
+    return 0;
+}
+
 int arGetLine(int x_coord[], int y_coord[], int coord_num, int vertex[], ARParamLTf *paramLTf,
               ARdouble line[4][3], ARdouble v[4][2])
 {
-    ARMat    *input, *evec;
-    ARVec    *ev, *mean;
     ARdouble   w1;
-    int      st, ed, n;
-    int      i, j;
+    int      st, ed;
+    int      i;
 
-    ev     = arVecAlloc( 2 );
-    mean   = arVecAlloc( 2 );
-    evec   = arMatrixAlloc( 2, 2 );
     for( i = 0; i < 4; i++ ) {
         w1 = (ARdouble)(vertex[i+1]-vertex[i]+1) * _0_05 + _0_5;
         st = (int)(vertex[i]   + w1);
         ed = (int)(vertex[i+1] - w1);
-        n = ed - st + 1;
-        input  = arMatrixAlloc( n, 2 );
-        for( j = 0; j < n; j++ ) {
-#ifdef ARDOUBLE_IS_FLOAT
-            if (arParamObserv2IdealLTf( paramLTf, (float)x_coord[st+j], (float)y_coord[st+j],
-                                       &(input->m[j*2+0]), &(input->m[j*2+1]) ) < 0) goto bail;
-#else
-            float m0, m1;
-            if (arParamObserv2IdealLTf( paramLTf, (float)x_coord[st+j], (float)y_coord[st+j], &m0, &m1 ) < 0) goto bail;
-            input->m[j*2+0] = (ARdouble)m0;
-            input->m[j*2+1] = (ARdouble)m1;
-#endif
-            //arParamObserv2Ideal( dist_factor, (ARdouble)x_coord[st+j], (ARdouble)y_coord[st+j],
-            //                     &(input->m[j*2+0]), &(input->m[j*2+1]), dist_function_version );
-        }
-        if( arMatrixPCA(input, evec, ev, mean) < 0 ) goto bail;
-        line[i][0] =  evec->m[1];
-        line[i][1] = -evec->m[0];
-        line[i][2] = -(line[i][0]*mean->v[0] + line[i][1]*mean->v[1]);
-        arMatrixFree( input );
+        if( arGetLineFit(x_coord, y_coord, st, ed, paramLTf, line[i]) < 0 ) return -1;
     }
-    arMatrixFree( evec );
-    arVecFree( mean );
-    arVecFree( ev );
 
     for( i = 0; i < 4; i++ ) {
         w1 = line[(i+3)%4][0] * line[i][1] - line[i][0] * line[(i+3)%4][1];
@@ -115,11 +173,4 @@ int arGetLine(int x_coord[], int y_coord[], int coord_num, int vertex[], ARParam
     }
 
     return 0;
-    
-bail:
-    arMatrixFree( input );
-    arMatrixFree( evec );
-    arVecFree( mean );
-    arVecFree( ev );
-    return -1;
 }
@@ -47,63 +47,301 @@
  *******************************************************/
 
 #include <ARX/AR/ar.h>
+#include <ARX/ARUtil/thread_sub.h>
+#include "arRefineCorners.h"
+
+enum {
+    AR_MARKER_INFO_THREADS_JOB_DECODE,
+    AR_MARKER_INFO_THREADS_JOB_REFINE_CORNERS
+};
+
+typedef struct {
+    ARMarkerInfoThreads *threads;
+    int                  index;             ///< This worker handles candidates index, index + threadNum, ...
+    ARPattScratch       *pattScratch;       ///< Pattern extraction and matching buffers for this worker.
+} ARMarkerInfoThreadArg;
+
+struct _ARMarkerInfoThreads {
+    int                    threadNum;
+    THREAD_HANDLE_T       *threadHandle[AR_MARKER_INFO_THREAD_MAX];
+    ARMarkerInfoThreadArg  arg[AR_MARKER_INFO_THREAD_MAX];
+    ARMarkerInfo           markerInfo[AR_SQUARE_MAX]; ///< Result for each candidate, in candidate order.
+    int                    valid[AR_SQUARE_MAX];
+    // Parameters of the current call to arGetMarkerInfoParallel() or arRefineCornersParallel().
+    int                    job;
+    int                    workerNum;
+    ARUint8               *image;
+    int                    xsize;
+    int                    ysize;
+    int                    pixelFormat;
+    ARMarkerInfo2         *markerInfo2;
+    int                    marker2_num;
+    ARPattHandle          *pattHandle;
+    int                    imageProcMode;
+    int                    pattDetectMode;
+    ARParamLTf            *arParamLTf;
+    ARdouble               pattRatio;
+    AR_MATRIX_CODE_TYPE    matrixCodeType;
+    ARMarkerInfo          *refineMarkerInfo;
+    int                    refineMarkerNum;
+    const ARUint8         *refineImage;
+};
+
+static int getMarkerInfoSerial( ARUint8 *image, int xsize, int ysize, int pixelFormat, ARMarkerInfo2 *markerInfo2, int marker2_num,
+                                ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
+                                ARMarkerInfo *markerInfo, int *marker_num,
+                                const AR_MATRIX_CODE_TYPE matrixCodeType, ARPattScratch *pattScratch );
+static int getMarkerInfo1( ARUint8 *image, int xsize, int ysize, int pixelFormat, ARMarkerInfo2 *markerInfo2,
+                           ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
+                           ARMarkerInfo *markerInfo, const AR_MATRIX_CODE_TYPE matrixCodeType, ARPattScratch *pattScratch );
+static void *arMarkerInfoThreadsWorker(THREAD_HANDLE_T *threadHandle);
+static void arMarkerInfoThreadsProcess(ARMarkerInfoThreadArg *arg);
 
 int arGetMarkerInfo( ARUint8 *image, int xsize, int ysize, int pixelFormat, ARMarkerInfo2 *markerInfo2, int marker2_num,
                      ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
                      ARMarkerInfo *markerInfo, int *marker_num,
                      const AR_MATRIX_CODE_TYPE matrixCodeType )
 {
-    int            i, j, result;
+    ARPattScratch *pattScratch;
+    int            ret;
+
+    pattScratch = arPattScratchCreate(pattHandle ? pattHandle->pattSize : 0);
+    ret = getMarkerInfoSerial(image, xsize, ysize, pixelFormat, markerInfo2, marker2_num, pattHandle, imageProcMode, pattDetectMode, arParamLTf, pattRatio,
+                              markerInfo, marker_num, matrixCodeType, pattScratch);
+    arPattScratchDelete(&pattScratch);
+    return (ret);
+}
+
+static int getMarkerInfoSerial( ARUint8 *image, int xsize, int ysize, int pixelFormat, ARMarkerInfo2 *markerInfo2, int marker2_num,
+                                ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
+                                ARMarkerInfo *markerInfo, int *marker_num,
+                                const AR_MATRIX_CODE_TYPE matrixCodeType, ARPattScratch *pattScratch )
+{
+    int            i, j;
+
+    for( i = j = 0; i < marker2_num; i++ ) { // marker2_num is capped at AR_SQUARE_MAX by arLabeling().
+        if (getMarkerInfo1(image, xsize, ysize, pixelFormat, &markerInfo2[i], pattHandle, imageProcMode, pattDetectMode, arParamLTf, pattRatio,
+                           &markerInfo[j], matrixCodeType, pattScratch) < 0) continue;
+        j++;
+    }
+    *marker_num = j;
+
+    return 0;
+}
+
+// Fills in *markerInfo from candidate *markerInfo2. Returns -1 if the candidate should be dropped.
+static int getMarkerInfo1( ARUint8 *image, int xsize, int ysize, int pixelFormat, ARMarkerInfo2 *markerInfo2,
+                           ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
+                           ARMarkerInfo *markerInfo, const AR_MATRIX_CODE_TYPE matrixCodeType, ARPattScratch *pattScratch )
+{
+    int            result;
 #ifndef ARDOUBLE_IS_FLOAT
     float pos0, pos1;
 #endif
 
-    for( i = j = 0; i < marker2_num; i++ ) { // marker2_num is capped at AR_SQUARE_MAX by arLabeling().
-        markerInfo[j].area   = markerInfo2[i].area;
+    markerInfo->area   = markerInfo2->area;
+    markerInfo->markerInfo2Ptr = markerInfo2;
 #ifdef ARDOUBLE_IS_FLOAT
-        if (arParamObserv2IdealLTf(arParamLTf, markerInfo2[i].pos[0], markerInfo2[i].pos[1],
-                                   &(markerInfo[j].pos[0]), &(markerInfo[j].pos[1]) ) < 0) continue;
+    if (arParamObserv2IdealLTf(arParamLTf, markerInfo2->pos[0], markerInfo2->pos[1],
+                               &(markerInfo->pos[0]), &(markerInfo->pos[1]) ) < 0) return -1;
 #else
-        if (arParamObserv2IdealLTf(arParamLTf, (float)markerInfo2[i].pos[0], (float)markerInfo2[i].pos[1], &pos0, &pos1) < 0) continue;
-        markerInfo[j].pos[0] = (ARdouble)pos0;
-        markerInfo[j].pos[1] = (ARdouble)pos1;
+    if (arParamObserv2IdealLTf(arParamLTf, (float)markerInfo2->pos[0], (float)markerInfo2->pos[1], &pos0, &pos1) < 0) return -1;
+    markerInfo->pos[0] = (ARdouble)pos0;
+    markerInfo->pos[1] = (ARdouble)pos1;
 #endif
-        //arParamObserv2Ideal( dist_factor, markerInfo2[i].pos[0], markerInfo2[i].pos[1],
-        //                     &(markerInfo[j].pos[0]), &(markerInfo[j].pos[1]), dist_function_version );
-
-        if( arGetLine(markerInfo2[i].x_coord, markerInfo2[i].y_coord, markerInfo2[i].coord_num,
-                      markerInfo2[i].vertex, arParamLTf,
-                      markerInfo[j].line, markerInfo[j].vertex) < 0 ) continue;
-
-        result = arPattGetIDGlobal( pattHandle, imageProcMode, pattDetectMode, image, xsize, ysize, pixelFormat, arParamLTf, markerInfo[j].vertex, pattRatio, 
-                     &markerInfo[j].idPatt, &markerInfo[j].dirPatt, &markerInfo[j].cfPatt,
-                     &markerInfo[j].idMatrix, &markerInfo[j].dirMatrix, &markerInfo[j].cfMatrix,
-                      matrixCodeType, &markerInfo[j].errorCorrected, &markerInfo[j].globalID );
-
-        if      (result == 0)  markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_NONE;
-        else if (result == -1) markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_GENERIC;
-        else if (result == -2) markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_CONTRAST;
-        else if (result == -3) markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_BARCODE_NOT_FOUND;
-        else if (result == -4) markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_BARCODE_EDC_FAIL;
-        else if (result == -5) markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_HEURISTIC_TROUBLESOME_MATRIX_CODES;
-        else if (result == -6) markerInfo[j].cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_PATTERN_EXTRACTION;
-  
-        // If not mixing template matching and matrix code detection, then copy id, dir and cf
-        // from values in appropriate type.
-        if (pattDetectMode == AR_TEMPLATE_MATCHING_COLOR || pattDetectMode == AR_TEMPLATE_MATCHING_MONO) {
-            markerInfo[j].id  = markerInfo[j].idPatt;
-            markerInfo[j].dir = markerInfo[j].dirPatt;
-            markerInfo[j].cf  = markerInfo[j].cfPatt;
-        } else if( pattDetectMode == AR_MATRIX_CODE_DETECTION ) {
-            markerInfo[j].id  = markerInfo[j].idMatrix;
-            markerInfo[j].dir = markerInfo[j].dirMatrix;
-            markerInfo[j].cf  = markerInfo[j].cfMatrix;
+    //arParamObserv2Ideal( dist_factor, markerInfo2->pos[0], markerInfo2->pos[1],
+    //                     &(markerInfo->pos[0]), &(markerInfo->pos[1]), dist_function_version );
+
+    if( arGetLine(markerInfo2->x_coord, markerInfo2->y_coord, markerInfo2->coord_num,
+                  markerInfo2->vertex, arParamLTf,
+                  markerInfo->line, markerInfo->vertex) < 0 ) return -1;
+
+    result = arPattGetIDGlobalWithScratch( pattHandle, imageProcMode, pattDetectMode, image, xsize, ysize, pixelFormat, arParamLTf, markerInfo->vertex, pattRatio, 
+                 &markerInfo->idPatt, &markerInfo->dirPatt, &markerInfo->cfPatt,
+                 &markerInfo->idMatrix, &markerInfo->dirMatrix, &markerInfo->cfMatrix,
+                  matrixCodeType, &markerInfo->errorCorrected, &markerInfo->globalID, pattScratch );
+
+    if      (result == 0)  markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_NONE;
+    else if (result == -1) markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_GENERIC;
+    else if (result == -2) markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_CONTRAST;
+    else if (result == -3) markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_BARCODE_NOT_FOUND;
+    else if (result == -4) markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_MATCH_BARCODE_EDC_FAIL;
+    else if (result == -5) markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_HEURISTIC_TROUBLESOME_MATRIX_CODES;
+    else if (result == -6) markerInfo->cutoffPhase = AR_MARKER_INFO_CUTOFF_PHASE_PATTERN_EXTRACTION;
+
+    // If not mixing template matching and matrix code detection, then copy id, dir and cf
+    // from values in appropriate type.
+    if (pattDetectMode == AR_TEMPLATE_MATCHING_COLOR || pattDetectMode == AR_TEMPLATE_MATCHING_MONO) {
+        markerInfo->id  = markerInfo->idPatt;
+        markerInfo->dir = markerInfo->dirPatt;
+        markerInfo->cf  = markerInfo->cfPatt;
+    } else if( pattDetectMode == AR_MATRIX_CODE_DETECTION ) {
+        markerInfo->id  = markerInfo->idMatrix;
+        markerInfo->dir = markerInfo->dirMatrix;
+        markerInfo->cf  = markerInfo->cfMatrix;
+    }
+    markerInfo->matched = 0;
+
+    return 0;
+}
+
+ARMarkerInfoThreads *arMarkerInfoThreadsInit( int threadNum )
+{
+    ARMarkerInfoThreads *threads;
+    int                  i;
+
+    if (threadNum < 1 || threadNum > AR_MARKER_INFO_THREAD_MAX) {
+        ARLOGe("Error: marker info thread count must be between 1 and %d.\n", AR_MARKER_INFO_THREAD_MAX);
+        return (NULL);
+    }
+
+    arMallocClear(threads, ARMarkerInfoThreads, 1);
+    threads->threadNum = threadNum;
+    for (i = 0; i < threadNum; i++) {
+        threads->arg[i].threads = threads;
+        threads->arg[i].index = i;
+        threads->arg[i].pattScratch = arPattScratchCreate(0); // Sized on first use.
+    }
+    for (i = 1; i < threadNum; i++) { // Worker 0 runs on the calling thread.
+        threads->threadHandle[i] = threadInit(i, &(threads->arg[i]), arMarkerInfoThreadsWorker);
+        if (!threads->threadHandle[i]) {
+            ARLOGe("Error: unable to start marker info thread %d.\n", i);
+            threads->threadNum = i;
+            arMarkerInfoThreadsFinal(&threads);
+            return (NULL);
         }
-        markerInfo[j].matched = 0;
+    }
+
+    return (threads);
+}
+
+int arMarkerInfoThreadsFinal( ARMarkerInfoThreads **threads_p )
+{
+    int i;
 
+    if (!threads_p || !*threads_p) return (-1);
+
+    for (i = 1; i < (*threads_p)->threadNum; i++) {
+        threadWaitQuit((*threads_p)->threadHandle[i]);
+        threadFree(&((*threads_p)->threadHandle[i]));
+    }
+    for (i = 0; i < AR_MARKER_INFO_THREAD_MAX; i++) {
+        if ((*threads_p)->arg[i].pattScratch) arPattScratchDelete(&((*threads_p)->arg[i].pattScratch));
+    }
+    free(*threads_p);
+    *threads_p = NULL;
+
+    return (0);
+}
+
+int arGetMarkerInfoParallel( ARUint8 *image, int xsize, int ysize, int pixelFormat, ARMarkerInfo2 *markerInfo2, int marker2_num,
+                             ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
+                             ARMarkerInfo *markerInfo, int *marker_num,
+                             const AR_MATRIX_CODE_TYPE matrixCodeType, ARMarkerInfoThreads *threads )
+{
+    int            i, j;
+
+    if (!threads) {
+        return (arGetMarkerInfo(image, xsize, ysize, pixelFormat, markerInfo2, marker2_num, pattHandle, imageProcMode, pattDetectMode, arParamLTf, pattRatio,
+                                markerInfo, marker_num, matrixCodeType));
+    }
+    if (threads->threadNum < 2 || marker2_num < 2) {
+        return (getMarkerInfoSerial(image, xsize, ysize, pixelFormat, markerInfo2, marker2_num, pattHandle, imageProcMode, pattDetectMode, arParamLTf, pattRatio,
+                                    markerInfo, marker_num, matrixCodeType, threads->arg[0].pattScratch));
+    }
+    if (marker2_num > AR_SQUARE_MAX) marker2_num = AR_SQUARE_MAX;
+
+    threads->job = AR_MARKER_INFO_THREADS_JOB_DECODE;
+    threads->workerNum = (marker2_num < threads->threadNum ? marker2_num : threads->threadNum);
+    threads->image = image;
+    threads->xsize = xsize;
+    threads->ysize = ysize;
+    threads->pixelFormat = pixelFormat;
+    threads->markerInfo2 = markerInfo2;
+    threads->marker2_num = marker2_num;
+    threads->pattHandle = pattHandle;
+    threads->imageProcMode = imageProcMode;
+    threads->pattDetectMode = pattDetectMode;
+    threads->arParamLTf = arParamLTf;
+    threads->pattRatio = pattRatio;
+    threads->matrixCodeType = matrixCodeType;
+
+    for (i = 1; i < threads->workerNum; i++) threadStartSignal(threads->threadHandle[i]);
+    arMarkerInfoThreadsProcess(&(threads->arg[0]));
+    for (i = 1; i < threads->workerNum; i++) threadEndWait(threads->threadHandle[i]);
+
+    // Compact in candidate order, as arGetMarkerInfo() does.
+    for( i = j = 0; i < marker2_num; i++ ) {
+        if (!threads->valid[i]) continue;
+        markerInfo[j] = threads->markerInfo[i];
         j++;
     }
     *marker_num = j;
 
     return 0;
 }
+
+int arRefineCornersParallel(ARMarkerInfo *markerInfo, int marker_num, const unsigned char *buff, int width, int height, ARParamLTf *arParamLTf, ARMarkerInfoThreads *threads)
+{
+    int i, refineNum;
+
+    if (!markerInfo || !buff || !arParamLTf) return (-1);
+
+    for (i = refineNum = 0; i < marker_num; i++) {
+        if (markerInfo[i].cutoffPhase == AR_MARKER_INFO_CUTOFF_PHASE_NONE) refineNum++;
+    }
+    if (!threads || threads->threadNum < 2 || refineNum < 2) {
+        for (i = 0; i < marker_num; i++) {
+            if (markerInfo[i].cutoffPhase == AR_MARKER_INFO_CUTOFF_PHASE_NONE) arRefineCornersMarker(&markerInfo[i], buff, width, height, arParamLTf);
+        }
+        return (0);
+    }
+
+    threads->job = AR_MARKER_INFO_THREADS_JOB_REFINE_CORNERS;
+    threads->workerNum = (refineNum < threads->threadNum ? refineNum : threads->threadNum);
+    threads->xsize = width;
+    threads->ysize = height;
+    threads->arParamLTf = arParamLTf;
+    threads->refineMarkerInfo = markerInfo;
+    threads->refineMarkerNum = marker_num;
+    threads->refineImage = buff;
+
+    for (i = 1; i < threads->workerNum; i++) threadStartSignal(threads->threadHandle[i]);
+    arMarkerInfoThreadsProcess(&(threads->arg[0]));
+    for (i = 1; i < threads->workerNum; i++) threadEndWait(threads->threadHandle[i]);
+
+    return (0);
+}
+
+static void *arMarkerInfoThreadsWorker(THREAD_HANDLE_T *threadHandle)
+{
+    ARMarkerInfoThreadArg *arg = (ARMarkerInfoThreadArg *)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0) {
+        arMarkerInfoThreadsProcess(arg);
+        threadEndSignal(threadHandle);
+    }
+    return (NULL);
+}
+
+static void arMarkerInfoThreadsProcess(ARMarkerInfoThreadArg *arg)
+{
+    ARMarkerInfoThreads *th = arg->threads;
+    int                  i;
+
+    if (th->job == AR_MARKER_INFO_THREADS_JOB_REFINE_CORNERS) {
+        for (i = arg->index; i < th->refineMarkerNum; i += th->workerNum) {
+            if (th->refineMarkerInfo[i].cutoffPhase == AR_MARKER_INFO_CUTOFF_PHASE_NONE) {
+                arRefineCornersMarker(&(th->refineMarkerInfo[i]), th->refineImage, th->xsize, th->ysize, th->arParamLTf);
+            }
+        }
+        return;
+    }
+
+    // Interleave candidates across workers, so that large (expensive) candidates, which tend to be
+    // found together, are spread out.
+    for (i = arg->index; i < th->marker2_num; i += th->workerNum) {
+        th->valid[i] = (getMarkerInfo1(th->image, th->xsize, th->ysize, th->pixelFormat, &(th->markerInfo2[i]), th->pattHandle, th->imageProcMode, th->pattDetectMode,
+                                       th->arParamLTf, th->pattRatio, &(th->markerInfo[i]), th->matrixCodeType, arg->pattScratch) == 0);
+    }
+}
@@ -40,6 +40,16 @@
 #include <ARX/AR/arImageProc.h>
 #if AR_IMAGEPROC_USE_VIMAGE
 #  include <Accelerate/Accelerate.h>
+#else
+#  if HAVE_ARM_NEON || HAVE_ARM64_NEON
+#    include <arm_neon.h>
+#  elif HAVE_INTEL_SIMD
+#    include <emmintrin.h> // SSE2.
+#  endif
+#endif
+
+#if !AR_IMAGEPROC_USE_VIMAGE
+static void boxFilterColumnSumsUpdate(unsigned int *__restrict colSums, const ARUint8 *__restrict rowIn, const ARUint8 *__restrict rowOut, const int n);
 #endif
 
 ARImageProcInfo *arImageProcInit(const int xsize, const int ysize)
@@ -51,6 +61,8 @@ ARImageProcInfo *arImageProcInit(const int xsize, const int ysize)
         ipi->imageY = ysize;
 #if AR_IMAGEPROC_USE_VIMAGE
         ipi->tempBuffer = NULL;
+#else
+        ipi->boxFilterSums = NULL;
 #endif
     }
     return (ipi);
@@ -62,6 +74,8 @@ void arImageProcFinal(ARImageProcInfo *ipi)
     if (ipi->image2) free (ipi->image2);
 #if AR_IMAGEPROC_USE_VIMAGE
     if (ipi->tempBuffer) free (ipi->tempBuffer);
+#else
+    if (ipi->boxFilterSums) free (ipi->boxFilterSums);
 #endif
     free (ipi);
 }
@@ -203,7 +217,11 @@ int arImageProcLumaHistAndBoxFilterWithBias(ARImageProcInfo *ipi, const ARUint8
 {
     int ret, i;
 #if !AR_IMAGEPROC_USE_VIMAGE
-    int j, kernelSizeHalf;
+    int j, kernelSizeHalf, xsize, ysize;
+    int rowFirst, rowLast, rowCount, colFirst, colLast, colCount;
+    unsigned int *colSums, *rowSums;
+    unsigned long long recip;
+    unsigned char *__restrict out;
 #endif
     
     ret = arImageProcLumaHist(ipi, dataPtr);
@@ -227,30 +245,119 @@ int arImageProcLumaHistAndBoxFilterWithBias(ARImageProcInfo *ipi, const ARUint8
         ARLOGe("Error %ld in vImageBoxConvolve_Planar8().\n", err);
         return (-1);
     }
+    if (bias) for (i = 0; i < ipi->imageX*ipi->imageY; i++) ipi->image2[i] += bias;
 #else
+    xsize = ipi->imageX;
+    ysize = ipi->imageY;
     kernelSizeHalf = boxSize >> 1;
-    for (j = 0; j < ipi->imageY; j++) {
-        for (i = 0; i < ipi->imageX; i++) {
-            int val, count, kernel_i, kernel_j, ii, jj;
-            val = count = 0;
-            for (kernel_j = -kernelSizeHalf; kernel_j <= kernelSizeHalf; kernel_j++) {
-                jj = j + kernel_j;
-                if (jj < 0 || jj >= ipi->imageY) continue;
-                for (kernel_i = -kernelSizeHalf; kernel_i <= kernelSizeHalf; kernel_i++) {
-                    ii = i + kernel_i;
-                    if (ii < 0 || ii >= ipi->imageX) continue;
-                    val += dataPtr[ii + jj*(ipi->imageX)];
-                    count++;
-                }
+    if (!ipi->boxFilterSums) {
+        // xsize column sums followed by xsize + 1 row prefix sums.
+        ipi->boxFilterSums = (unsigned int *)malloc((2*xsize + 1) * sizeof(unsigned int));
+        if (!ipi->boxFilterSums) return (-1);
+    }
+    colSums = ipi->boxFilterSums;
+    rowSums = ipi->boxFilterSums + xsize;
+
+    // Prime the column sums with the rows above and including the first kernel centre row.
+    memset(colSums, 0, xsize * sizeof(unsigned int));
+    rowLast = (kernelSizeHalf < ysize ? kernelSizeHalf : ysize - 1);
+    for (j = 0; j <= rowLast; j++) {
+        const ARUint8 *__restrict row = dataPtr + j*xsize;
+        for (i = 0; i < xsize; i++) colSums[i] += row[i];
+    }
+
+    // Sums are at most 255 * boxSize^2, so for kernels up to 256 pixels square, a 40-bit
+    // fixed-point reciprocal gives exactly the same quotient as integer division.
+    recip = (boxSize > 0 && boxSize <= 256 ? ((1ULL << 40) + (kernelSizeHalf*2 + 1)*(kernelSizeHalf*2 + 1) - 1) / ((kernelSizeHalf*2 + 1)*(kernelSizeHalf*2 + 1)) : 0);
+
+    for (j = 0; j < ysize; j++) {
+        rowFirst = (j - kernelSizeHalf > 0 ? j - kernelSizeHalf : 0);
+        rowLast = (j + kernelSizeHalf < ysize ? j + kernelSizeHalf : ysize - 1);
+        rowCount = rowLast - rowFirst + 1;
+        out = ipi->image2 + j*xsize;
+
+        // Prefix sums along the row of column sums. Unsigned wraparound is harmless as only differences are used.
+        rowSums[0] = 0;
+        for (i = 0; i < xsize; i++) rowSums[i + 1] = rowSums[i] + colSums[i];
+
+        // Kernel centred at column i spans [i - kernelSizeHalf, i + kernelSizeHalf], clipped to the image.
+        for (i = 0; i < xsize; i++) {
+            colFirst = (i - kernelSizeHalf > 0 ? i - kernelSizeHalf : 0);
+            colLast = (i + kernelSizeHalf < xsize ? i + kernelSizeHalf : xsize - 1);
+            if (colFirst > 0 && colLast < xsize - 1) break;
+            colCount = colLast - colFirst + 1;
+            out[i] = (unsigned char)((rowSums[colLast + 1] - rowSums[colFirst]) / (rowCount*colCount) + bias);
+        }
+        if (rowCount == kernelSizeHalf*2 + 1 && recip) {
+            for (; i < xsize - kernelSizeHalf; i++) {
+                out[i] = (unsigned char)((int)(((unsigned long long)(rowSums[i + kernelSizeHalf + 1] - rowSums[i - kernelSizeHalf]) * recip) >> 40) + bias);
+            }
+        } else {
+            colCount = kernelSizeHalf*2 + 1;
+            for (; i < xsize - kernelSizeHalf; i++) {
+                out[i] = (unsigned char)((rowSums[i + kernelSizeHalf + 1] - rowSums[i - kernelSizeHalf]) / (rowCount*colCount) + bias);
+            }
+        }
+        for (; i < xsize; i++) {
+            colFirst = (i - kernelSizeHalf > 0 ? i - kernelSizeHalf : 0);
+            colLast = xsize - 1;
+            colCount = colLast - colFirst + 1;
+            out[i] = (unsigned char)((rowSums[colLast + 1] - rowSums[colFirst]) / (rowCount*colCount) + bias);
+        }
+
+        // Slide the column sums down one row.
+        if (j + kernelSizeHalf + 1 < ysize) {
+            if (j - kernelSizeHalf >= 0) {
+                boxFilterColumnSumsUpdate(colSums, dataPtr + (j + kernelSizeHalf + 1)*xsize, dataPtr + (j - kernelSizeHalf)*xsize, xsize);
+            } else {
+                const ARUint8 *__restrict row = dataPtr + (j + kernelSizeHalf + 1)*xsize;
+                for (i = 0; i < xsize; i++) colSums[i] += row[i];
             }
-            ipi->image2[i + j*(ipi->imageX)] = val / count;
+        } else if (j - kernelSizeHalf >= 0) {
+            const ARUint8 *__restrict row = dataPtr + (j - kernelSizeHalf)*xsize;
+            for (i = 0; i < xsize; i++) colSums[i] -= row[i];
         }
     }
 #endif
-    if (bias) for (i = 0; i < ipi->imageX*ipi->imageY; i++) ipi->image2[i] += bias;
     return (0);
 }
 
+#if !AR_IMAGEPROC_USE_VIMAGE
+// colSums[i] += rowIn[i] - rowOut[i], for i in [0, n).
+static void boxFilterColumnSumsUpdate(unsigned int *__restrict colSums, const ARUint8 *__restrict rowIn, const ARUint8 *__restrict rowOut, const int n)
+{
+    int i = 0;
+#if HAVE_ARM_NEON || HAVE_ARM64_NEON
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t vIn = vld1q_u8(rowIn + i);
+        uint8x16_t vOut = vld1q_u8(rowOut + i);
+        int16x8_t dLo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(vIn), vget_low_u8(vOut)));
+        int16x8_t dHi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(vIn), vget_high_u8(vOut)));
+        uint32_t *c = colSums + i;
+        vst1q_u32(c,      vreinterpretq_u32_s32(vaddw_s16(vreinterpretq_s32_u32(vld1q_u32(c)),      vget_low_s16(dLo))));
+        vst1q_u32(c + 4,  vreinterpretq_u32_s32(vaddw_s16(vreinterpretq_s32_u32(vld1q_u32(c + 4)),  vget_high_s16(dLo))));
+        vst1q_u32(c + 8,  vreinterpretq_u32_s32(vaddw_s16(vreinterpretq_s32_u32(vld1q_u32(c + 8)),  vget_low_s16(dHi))));
+        vst1q_u32(c + 12, vreinterpretq_u32_s32(vaddw_s16(vreinterpretq_s32_u32(vld1q_u32(c + 12)), vget_high_s16(dHi))));
+    }
+#elif HAVE_INTEL_SIMD
+    const __m128i zero = _mm_setzero_si128();
+    for (; i <= n - 16; i += 16) {
+        __m128i vIn = _mm_loadu_si128((const __m128i *)(rowIn + i));
+        __m128i vOut = _mm_loadu_si128((const __m128i *)(rowOut + i));
+        __m128i dLo = _mm_sub_epi16(_mm_unpacklo_epi8(vIn, zero), _mm_unpacklo_epi8(vOut, zero));
+        __m128i dHi = _mm_sub_epi16(_mm_unpackhi_epi8(vIn, zero), _mm_unpackhi_epi8(vOut, zero));
+        __m128i *c = (__m128i *)(colSums + i);
+        // Sign-extend the 16-bit differences to 32 bits by interleaving with themselves and arithmetic shifting.
+        _mm_storeu_si128(c,     _mm_add_epi32(_mm_loadu_si128(c),     _mm_srai_epi32(_mm_unpacklo_epi16(dLo, dLo), 16)));
+        _mm_storeu_si128(c + 1, _mm_add_epi32(_mm_loadu_si128(c + 1), _mm_srai_epi32(_mm_unpackhi_epi16(dLo, dLo), 16)));
+        _mm_storeu_si128(c + 2, _mm_add_epi32(_mm_loadu_si128(c + 2), _mm_srai_epi32(_mm_unpacklo_epi16(dHi, dHi), 16)));
+        _mm_storeu_si128(c + 3, _mm_add_epi32(_mm_loadu_si128(c + 3), _mm_srai_epi32(_mm_unpackhi_epi16(dHi, dHi), 16)));
+    }
+#endif
+    for (; i < n; i++) colSums[i] += (unsigned int)rowIn[i] - (unsigned int)rowOut[i];
+}
+#endif // !AR_IMAGEPROC_USE_VIMAGE
+
 int arImageProcLumaHistAndCDFAndLevels(ARImageProcInfo *ipi, const ARUint8 *__restrict dataPtr)
 {
 	unsigned char l;
@@ -269,3 +376,100 @@ int arImageProcLumaHistAndCDFAndLevels(ARImageProcInfo *ipi, const ARUint8 *__re
     
     return (0);
 }
+
+int arImageProcLumaDecimate(const ARUint8 *__restrict dataPtr, const int xsize, const int ysize, const int factor, ARUint8 *__restrict dstPtr)
+{
+    const int dxsize = xsize / factor;
+    const int dysize = ysize / factor;
+    const int half = factor*factor / 2;
+    const ARUint8 *__restrict p0;
+    const ARUint8 *__restrict p1;
+    ARUint8 *__restrict q;
+    unsigned int sum;
+    int i, j, k, l;
+
+    if (!dataPtr || !dstPtr || factor < 1) return (-1);
+
+    for (j = 0; j < dysize; j++) {
+        q = dstPtr + j*dxsize;
+        i = 0;
+        if (factor == 2) {
+            p0 = dataPtr + (j*2)*xsize;
+            p1 = p0 + xsize;
+#if !AR_IMAGEPROC_USE_VIMAGE && (HAVE_ARM_NEON || HAVE_ARM64_NEON)
+            for (; i <= dxsize - 8; i += 8) {
+                uint16x8_t s = vaddq_u16(vpaddlq_u8(vld1q_u8(p0 + i*2)), vpaddlq_u8(vld1q_u8(p1 + i*2)));
+                vst1_u8(q + i, vrshrn_n_u16(s, 2));
+            }
+#elif !AR_IMAGEPROC_USE_VIMAGE && HAVE_INTEL_SIMD
+            {
+                const __m128i lo = _mm_set1_epi16(0x00ff);
+                const __m128i two = _mm_set1_epi16(2);
+                for (; i <= dxsize - 16; i += 16) {
+                    __m128i a0 = _mm_loadu_si128((const __m128i *)(p0 + i*2)), a1 = _mm_loadu_si128((const __m128i *)(p0 + i*2 + 16));
+                    __m128i b0 = _mm_loadu_si128((const __m128i *)(p1 + i*2)), b1 = _mm_loadu_si128((const __m128i *)(p1 + i*2 + 16));
+                    // Sum even and odd bytes of each 16-bit lane, for both rows.
+                    __m128i s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, lo), _mm_srli_epi16(a0, 8)), _mm_add_epi16(_mm_and_si128(b0, lo), _mm_srli_epi16(b0, 8)));
+                    __m128i s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, lo), _mm_srli_epi16(a1, 8)), _mm_add_epi16(_mm_and_si128(b1, lo), _mm_srli_epi16(b1, 8)));
+                    s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+                    s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+                    _mm_storeu_si128((__m128i *)(q + i), _mm_packus_epi16(s0, s1));
+                }
+            }
+#endif
+            for (; i < dxsize; i++) q[i] = (ARUint8)((p0[i*2] + p0[i*2 + 1] + p1[i*2] + p1[i*2 + 1] + 2) >> 2);
+        } else if (factor == 4) {
+            const ARUint8 *__restrict p2;
+            const ARUint8 *__restrict p3;
+            p0 = dataPtr + (j*4)*xsize;
+            p1 = p0 + xsize;
+            p2 = p1 + xsize;
+            p3 = p2 + xsize;
+#if !AR_IMAGEPROC_USE_VIMAGE && (HAVE_ARM_NEON || HAVE_ARM64_NEON)
+            for (; i <= dxsize - 8; i += 8) {
+                uint16x8_t s0 = vaddq_u16(vaddq_u16(vpaddlq_u8(vld1q_u8(p0 + i*4)), vpaddlq_u8(vld1q_u8(p1 + i*4))),
+                                          vaddq_u16(vpaddlq_u8(vld1q_u8(p2 + i*4)), vpaddlq_u8(vld1q_u8(p3 + i*4))));
+                uint16x8_t s1 = vaddq_u16(vaddq_u16(vpaddlq_u8(vld1q_u8(p0 + i*4 + 16)), vpaddlq_u8(vld1q_u8(p1 + i*4 + 16))),
+                                          vaddq_u16(vpaddlq_u8(vld1q_u8(p2 + i*4 + 16)), vpaddlq_u8(vld1q_u8(p3 + i*4 + 16))));
+                uint16x8_t s = vcombine_u16(vrshrn_n_u32(vpaddlq_u16(s0), 4), vrshrn_n_u32(vpaddlq_u16(s1), 4));
+                vst1_u8(q + i, vmovn_u16(s));
+            }
+#elif !AR_IMAGEPROC_USE_VIMAGE && HAVE_INTEL_SIMD
+            {
+                const __m128i lo = _mm_set1_epi16(0x00ff);
+                const __m128i one = _mm_set1_epi16(1);
+                const __m128i eight = _mm_set1_epi32(8);
+                __m128i s[4];
+                for (; i <= dxsize - 16; i += 16) {
+                    for (k = 0; k < 4; k++) {
+                        __m128i a = _mm_loadu_si128((const __m128i *)(p0 + i*4 + k*16));
+                        __m128i b = _mm_loadu_si128((const __m128i *)(p1 + i*4 + k*16));
+                        __m128i c = _mm_loadu_si128((const __m128i *)(p2 + i*4 + k*16));
+                        __m128i d = _mm_loadu_si128((const __m128i *)(p3 + i*4 + k*16));
+                        // Sum even and odd bytes of each 16-bit lane over the four rows, then adjacent lanes.
+                        __m128i e = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, lo), _mm_and_si128(b, lo)), _mm_add_epi16(_mm_and_si128(c, lo), _mm_and_si128(d, lo)));
+                        __m128i o = _mm_add_epi16(_mm_add_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)), _mm_add_epi16(_mm_srli_epi16(c, 8), _mm_srli_epi16(d, 8)));
+                        s[k] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_add_epi16(e, o), one), eight), 4);
+                    }
+                    _mm_storeu_si128((__m128i *)(q + i), _mm_packus_epi16(_mm_packs_epi32(s[0], s[1]), _mm_packs_epi32(s[2], s[3])));
+                }
+            }
+#endif
+            for (; i < dxsize; i++) {
+                sum = p0[i*4] + p0[i*4 + 1] + p0[i*4 + 2] + p0[i*4 + 3] + p1[i*4] + p1[i*4 + 1] + p1[i*4 + 2] + p1[i*4 + 3]
+                    + p2[i*4] + p2[i*4 + 1] + p2[i*4 + 2] + p2[i*4 + 3] + p3[i*4] + p3[i*4 + 1] + p3[i*4 + 2] + p3[i*4 + 3];
+                q[i] = (ARUint8)((sum + 8) >> 4);
+            }
+        }
+        for (; i < dxsize; i++) {
+            sum = half;
+            for (l = 0; l < factor; l++) {
+                p0 = dataPtr + (j*factor + l)*xsize + i*factor;
+                for (k = 0; k < factor; k++) sum += p0[k];
+            }
+            q[i] = (ARUint8)(sum / (factor*factor));
+        }
+    }
+
+    return (0);
+}
@@ -48,10 +48,48 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h> // memset(), memcpy()
 #include <ARX/AR/ar.h>
 #include <ARX/AR/config.h>
+#include <ARX/ARUtil/thread_sub.h>
 #include "arLabelingSub/arLabelingPrivate.h"
 
+typedef struct {
+    ARLabelingBandsInfo    *bandsInfo;
+    int                     rowStart;       ///< First label image row in this band.
+    int                     rowEnd;         ///< One past the last label image row in this band.
+    AR_LABELING_LABEL_TYPE *labelAbove;     ///< Row seen above rowStart by the labeler.
+    int                    *work;           ///< Band-local equivalence table.
+    int                    *work2;          ///< Band-local area, pos[2], clip[4].
+    int                     wk_max;         ///< Number of band-local labels.
+    int                     offset;         ///< Band-local labels map to global labels by adding this.
+    int                     ret;
+} ARLabelingBand;
+
+struct _ARLabelingBandsInfo {
+    int                     threadNum;
+    THREAD_HANDLE_T        *threadHandle[AR_LABELING_THREAD_MAX];
+    ARLabelingBand          band[AR_LABELING_THREAD_MAX];
+    AR_LABELING_LABEL_TYPE *zeroRow;
+    int                     zeroRowSize;
+    // Parameters of the current call to arLabelingBands().
+    int                     pass;           ///< 0 = label bands, 1 = offset labels into global space.
+    ARUint8                *image;
+    int                     xsize;
+    int                     ysize;
+    int                     lxsize;
+    int                     debugMode;
+    int                     labelingMode;
+    int                     labelingThresh;
+    int                     imageProcMode;
+    ARLabelInfo            *labelInfo;
+    ARUint8                *image_thresh;
+};
+
+static void *arLabelingBandsWorker(THREAD_HANDLE_T *threadHandle);
+static void arLabelingBandsProcess(ARLabelingBand *band);
+static int arLabelingBandsFindRoot(const int *work, int label);
+
 int arLabeling( ARUint8 *imageLuma, int xsize, int ysize,
                 int debugMode, int labelingMode, int labelingThresh, int imageProcMode,
                 ARLabelInfo *labelInfo, ARUint8 *image_thresh )
@@ -94,3 +132,331 @@ int arLabeling( ARUint8 *imageLuma, int xsize, int ysize,
     }
 #endif
 }
+
+int arLabelingMulti( ARUint8 *imageLuma, int xsize, int ysize,
+                     int labelingMode, const int *labelingThresh, int threshNum, int imageProcMode,
+                     ARLabelInfo **labelInfo )
+{
+    if (labelingMode == AR_LABELING_BLACK_REGION) {
+        if (imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) {
+            return arLabelingSubDBRCMulti(imageLuma, xsize, ysize, labelingThresh, labelInfo, threshNum);
+        } else /* imageProcMode == AR_IMAGE_PROC_FIELD_IMAGE */ {
+            return arLabelingSubDBICMulti(imageLuma, xsize, ysize, labelingThresh, labelInfo, threshNum);
+        }
+    } else /* labelingMode == AR_LABELING_WHITE_REGION */ {
+        if (imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) {
+            return arLabelingSubDWRCMulti(imageLuma, xsize, ysize, labelingThresh, labelInfo, threshNum);
+        } else /* imageProcMode == AR_IMAGE_PROC_FIELD_IMAGE */ {
+            return arLabelingSubDWICMulti(imageLuma, xsize, ysize, labelingThresh, labelInfo, threshNum);
+        }
+    }
+}
+
+void arLabelingSubClearBorder( ARLabelInfo *labelInfo, int lxsize, int lysize )
+{
+    AR_LABELING_LABEL_TYPE *pnt1, *pnt2;
+    int i;
+
+	// Set top and bottom rows of labelImage to 0.
+    pnt1 = &(labelInfo->labelImage[0]); // Leftmost pixel of top row of image.
+    pnt2 = &(labelInfo->labelImage[(lysize - 1)*lxsize]); // Leftmost pixel of bottom row of image.
+    for(i = 0; i < lxsize; i++) {
+        *(pnt1++) = *(pnt2++) = 0;
+    }
+
+	// Set leftmost and rightmost columns of labelImage to 0.
+    pnt1 = &(labelInfo->labelImage[0]); // Leftmost pixel of top row of image.
+    pnt2 = &(labelInfo->labelImage[lxsize - 1]); // Rightmost pixel of top row of image.
+    for(i = 0; i < lysize; i++) {
+        *pnt1 = *pnt2 = 0;
+        pnt1 += lxsize;
+        pnt2 += lxsize;
+    }
+}
+
+int arLabelingSubCollect( ARLabelInfo *labelInfo, int lxsize, int lysize, int wk_max )
+{
+    int      *work, *work2;
+    int       i,j;                      /*  for loop            */
+    int       *wk;                      /*  pointer for work    */
+    int       *label_num;
+    int       *area;
+    int       *clip;
+    ARdouble  *pos;
+
+    work = labelInfo->work;
+    work2 = labelInfo->work2;
+    label_num = &(labelInfo->label_num);
+    area = &(labelInfo->area[0]);
+    clip = &(labelInfo->clip[0][0]);
+    pos  = &(labelInfo->pos[0][0]);
+    j = 1;
+    wk = &(work[0]);
+    for(i = 1; i <= wk_max; i++, wk++) {
+        *wk = (*wk==i)? j++: work[(*wk)-1];
+    }
+    *label_num = j - 1;
+    if( *label_num == 0 ) {
+        return 0;
+    }
+
+    memset( (ARUint8 *)area, 0, *label_num *     sizeof(int) );
+    memset( (ARUint8 *)pos,  0, *label_num * 2 * sizeof(ARdouble) );
+    for(i = 0; i < *label_num; i++) {
+        clip[i*4+0] = lxsize;
+        clip[i*4+1] = 0;
+        clip[i*4+2] = lysize;
+        clip[i*4+3] = 0;
+    }
+    for(i = 0; i < wk_max; i++) {
+        j = work[i] - 1;
+        area[j]    += work2[i*7+0];
+        pos[j*2+0] += work2[i*7+1];
+        pos[j*2+1] += work2[i*7+2];
+        if( clip[j*4+0] > work2[i*7+3] ) clip[j*4+0] = work2[i*7+3];
+        if( clip[j*4+1] < work2[i*7+4] ) clip[j*4+1] = work2[i*7+4];
+        if( clip[j*4+2] > work2[i*7+5] ) clip[j*4+2] = work2[i*7+5];
+        if( clip[j*4+3] < work2[i*7+6] ) clip[j*4+3] = work2[i*7+6];
+    }
+
+    for( i = 0; i < *label_num; i++ ) {
+        pos[i*2+0] /= area[i];
+        pos[i*2+1] /= area[i];
+    }
+
+    return 0;
+}
+
+ARLabelingBandsInfo *arLabelingBandsInit( int threadNum )
+{
+    ARLabelingBandsInfo *bandsInfo;
+    int                  i;
+
+    if (threadNum < 2 || threadNum > AR_LABELING_THREAD_MAX) {
+        ARLOGe("Error: labeling thread count must be between 2 and %d.\n", AR_LABELING_THREAD_MAX);
+        return (NULL);
+    }
+
+    arMallocClear(bandsInfo, ARLabelingBandsInfo, 1);
+    bandsInfo->threadNum = threadNum;
+    for (i = 0; i < threadNum; i++) {
+        bandsInfo->band[i].bandsInfo = bandsInfo;
+        if (i == 0) continue; // Band 0 is labeled on the calling thread, into labelInfo's own tables.
+        arMalloc(bandsInfo->band[i].work, int, AR_LABELING_WORK_SIZE);
+        arMalloc(bandsInfo->band[i].work2, int, AR_LABELING_WORK_SIZE*7);
+        bandsInfo->threadHandle[i] = threadInit(i, &(bandsInfo->band[i]), arLabelingBandsWorker);
+        if (!bandsInfo->threadHandle[i]) {
+            ARLOGe("Error: unable to start labeling thread %d.\n", i);
+            bandsInfo->threadNum = i + 1;
+            arLabelingBandsFinal(&bandsInfo);
+            return (NULL);
+        }
+    }
+
+    return (bandsInfo);
+}
+
+int arLabelingBandsFinal( ARLabelingBandsInfo **bandsInfo_p )
+{
+    ARLabelingBandsInfo *bandsInfo;
+    int                  i;
+
+    if (!bandsInfo_p || !*bandsInfo_p) return (-1);
+    bandsInfo = *bandsInfo_p;
+
+    for (i = 1; i < bandsInfo->threadNum; i++) {
+        if (bandsInfo->threadHandle[i]) {
+            threadWaitQuit(bandsInfo->threadHandle[i]);
+            threadFree(&(bandsInfo->threadHandle[i]));
+        }
+        free(bandsInfo->band[i].work);
+        free(bandsInfo->band[i].work2);
+    }
+    free(bandsInfo->zeroRow);
+    free(bandsInfo);
+    *bandsInfo_p = NULL;
+
+    return (0);
+}
+
+int arLabelingBandsGetThreadNum( const ARLabelingBandsInfo *bandsInfo )
+{
+    if (!bandsInfo) return (1);
+
+    return (bandsInfo->threadNum);
+}
+
+int arLabelingBands( ARUint8 *imageLuma, int xsize, int ysize,
+                     int debugMode, int labelingMode, int labelingThresh, int imageProcMode,
+                     ARLabelInfo *labelInfo, ARUint8 *image_thresh, ARLabelingBandsInfo *bandsInfo )
+{
+    ARLabelingBand         *band;
+    AR_LABELING_LABEL_TYPE *pnt1, *pnt2;
+    int                    *work;
+    int                     lxsize, lysize;
+    int                     bandNum;
+    int                     wk_max;
+    int                     i, k, t;
+    int                     a, b;
+
+    if (!bandsInfo) {
+        return (arLabeling(imageLuma, xsize, ysize, debugMode, labelingMode, labelingThresh, imageProcMode, labelInfo, image_thresh));
+    }
+
+    if (image_thresh || imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) {
+        lxsize = xsize;
+        lysize = ysize;
+    } else {
+        lxsize = xsize / 2;
+        lysize = ysize / 2;
+    }
+
+    // Bands narrower than AR_LABELING_BAND_ROWS_MIN aren't worth the cost of a thread.
+    bandNum = (lysize - 2) / AR_LABELING_BAND_ROWS_MIN;
+    if (bandNum > bandsInfo->threadNum) bandNum = bandsInfo->threadNum;
+    if (bandNum < 2) {
+        return (arLabeling(imageLuma, xsize, ysize, debugMode, labelingMode, labelingThresh, imageProcMode, labelInfo, image_thresh));
+    }
+
+    if (bandsInfo->zeroRowSize < lxsize) {
+        free(bandsInfo->zeroRow);
+        arMallocClear(bandsInfo->zeroRow, AR_LABELING_LABEL_TYPE, lxsize);
+        bandsInfo->zeroRowSize = lxsize;
+    }
+
+    bandsInfo->image = imageLuma;
+    bandsInfo->xsize = xsize;
+    bandsInfo->ysize = ysize;
+    bandsInfo->lxsize = lxsize;
+    bandsInfo->debugMode = debugMode;
+    bandsInfo->labelingMode = labelingMode;
+    bandsInfo->labelingThresh = labelingThresh;
+    bandsInfo->imageProcMode = imageProcMode;
+    bandsInfo->labelInfo = labelInfo;
+    bandsInfo->image_thresh = image_thresh;
+
+    // Pass 0. Each band is labeled independently. The first band works directly in labelInfo's
+    // tables, while later bands see a blank row above them and use their own tables.
+    arLabelingSubClearBorder(labelInfo, lxsize, lysize);
+    band = bandsInfo->band;
+    for (t = 0; t < bandNum; t++) {
+        band[t].rowStart = 1 + (int)((long)(lysize - 2) * t / bandNum);
+        band[t].rowEnd   = 1 + (int)((long)(lysize - 2) * (t + 1) / bandNum);
+        band[t].offset   = 0;
+    }
+    band[0].labelAbove = labelInfo->labelImage;
+    band[0].work = labelInfo->work;
+    band[0].work2 = labelInfo->work2;
+    for (t = 1; t < bandNum; t++) band[t].labelAbove = bandsInfo->zeroRow;
+
+    bandsInfo->pass = 0;
+    for (t = 1; t < bandNum; t++) threadStartSignal(bandsInfo->threadHandle[t]);
+    arLabelingBandsProcess(&band[0]);
+    for (t = 1; t < bandNum; t++) threadEndWait(bandsInfo->threadHandle[t]);
+
+    // Concatenate the band tables. If the bands together used more labels than there is room
+    // for (each band's first row starts fresh labels), fall back to the serial labeler.
+    wk_max = 0;
+    for (t = 0; t < bandNum; t++) {
+        if (band[t].ret < 0) break;
+        band[t].offset = wk_max;
+        wk_max += band[t].wk_max;
+    }
+    if (t < bandNum || wk_max > AR_LABELING_WORK_SIZE) {
+        return (arLabeling(imageLuma, xsize, ysize, debugMode, labelingMode, labelingThresh, imageProcMode, labelInfo, image_thresh));
+    }
+    work = labelInfo->work;
+    for (t = 1; t < bandNum; t++) {
+        for (k = 0; k < band[t].wk_max; k++) work[band[t].offset + k] = band[t].work[k] + band[t].offset;
+        memcpy(&(labelInfo->work2[band[t].offset*7]), band[t].work2, band[t].wk_max*7*sizeof(int));
+    }
+
+    // Merge labels across band seams, using the same 8-connectivity as the labeler.
+    // Roots are always the smallest label in their class, as in the serial labeler.
+    for (t = 1; t < bandNum; t++) {
+        pnt2 = &(labelInfo->labelImage[band[t].rowStart*lxsize]);
+        pnt1 = pnt2 - lxsize;
+        for (i = 1; i < lxsize - 1; i++) {
+            if (pnt2[i] <= 0) continue;
+            for (k = -1; k <= 1; k++) {
+                if (pnt1[i + k] <= 0) continue;
+                a = arLabelingBandsFindRoot(work, pnt2[i] + band[t].offset);
+                b = arLabelingBandsFindRoot(work, pnt1[i + k] + band[t - 1].offset);
+                if (a < b) work[b - 1] = a;
+                else if (b < a) work[a - 1] = b;
+            }
+        }
+    }
+    for (k = 1; k <= wk_max; k++) {
+        if (work[k - 1] != k) work[k - 1] = work[work[k - 1] - 1]; // Parent is always smaller, so is already resolved.
+    }
+
+    // Pass 1. Offset band-local labels in the label image.
+    bandsInfo->pass = 1;
+    for (t = 1; t < bandNum; t++) threadStartSignal(bandsInfo->threadHandle[t]);
+    for (t = 1; t < bandNum; t++) threadEndWait(bandsInfo->threadHandle[t]);
+
+    return (arLabelingSubCollect(labelInfo, lxsize, lysize, wk_max));
+}
+
+static int arLabelingBandsFindRoot(const int *work, int label)
+{
+    while (work[label - 1] != label) label = work[label - 1];
+    return (label);
+}
+
+static void *arLabelingBandsWorker(THREAD_HANDLE_T *threadHandle)
+{
+    ARLabelingBand *band = (ARLabelingBand *)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0) {
+        arLabelingBandsProcess(band);
+        threadEndSignal(threadHandle);
+    }
+    return (NULL);
+}
+
+static void arLabelingBandsProcess(ARLabelingBand *band)
+{
+    ARLabelingBandsInfo    *bi = band->bandsInfo;
+    AR_LABELING_LABEL_TYPE *pnt;
+    AR_LABELING_LABEL_TYPE  offset;
+    int                     i, j;
+
+    if (bi->pass == 1) {
+        offset = (AR_LABELING_LABEL_TYPE)band->offset;
+        for (j = band->rowStart; j < band->rowEnd; j++) {
+            pnt = &(bi->labelInfo->labelImage[j*bi->lxsize + 1]);
+            for (i = 1; i < bi->lxsize - 1; i++, pnt++) {
+                if (*pnt) *pnt += offset;
+            }
+        }
+        return;
+    }
+
+#if !AR_DISABLE_LABELING_DEBUG_MODE
+    if (bi->debugMode == AR_DEBUG_DISABLE) {
+#endif
+        if (bi->labelingMode == AR_LABELING_BLACK_REGION) {
+            if (bi->image_thresh) band->ret = arLabelingSubDBZBand(bi->image, bi->xsize, bi->ysize, bi->image_thresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else if (bi->imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) band->ret = arLabelingSubDBRCBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else /* imageProcMode == AR_IMAGE_PROC_FIELD_IMAGE */ band->ret = arLabelingSubDBICBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+        } else /* labelingMode == AR_LABELING_WHITE_REGION */ {
+            if (bi->image_thresh) band->ret = arLabelingSubDWZBand(bi->image, bi->xsize, bi->ysize, bi->image_thresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else if (bi->imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) band->ret = arLabelingSubDWRCBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else /* imageProcMode == AR_IMAGE_PROC_FIELD_IMAGE */ band->ret = arLabelingSubDWICBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+        }
+#if !AR_DISABLE_LABELING_DEBUG_MODE
+    } else /* debugMode == AR_DEBUG_ENABLE */ {
+        if (bi->labelingMode == AR_LABELING_BLACK_REGION) {
+            if (bi->image_thresh) band->ret = arLabelingSubEBZBand(bi->image, bi->xsize, bi->ysize, bi->image_thresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else if (bi->imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) band->ret = arLabelingSubEBRCBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else /* imageProcMode == AR_IMAGE_PROC_FIELD_IMAGE */ band->ret = arLabelingSubEBICBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+        } else /* labelingMode == AR_LABELING_WHITE_REGION */ {
+            if (bi->image_thresh) band->ret = arLabelingSubEWZBand(bi->image, bi->xsize, bi->ysize, bi->image_thresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else if (bi->imageProcMode == AR_IMAGE_PROC_FRAME_IMAGE) band->ret = arLabelingSubEWRCBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+            else /* imageProcMode == AR_IMAGE_PROC_FIELD_IMAGE */ band->ret = arLabelingSubEWICBand(bi->image, bi->xsize, bi->ysize, bi->labelingThresh, bi->labelInfo, band->rowStart, band->rowEnd, band->labelAbove, band->work, band->work2, &(band->wk_max));
+        }
+    }
+#endif
+}
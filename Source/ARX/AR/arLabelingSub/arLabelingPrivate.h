@@ -71,6 +71,39 @@ int arLabelingSubDWZ( ARUint8 *image, const int xsize, const int ysize, ARUint8*
 int arLabelingSubEBZ( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo );
 int arLabelingSubEWZ( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo );
 
+/*  Band labeling, used by the serial labelers above and by arLabelingBands(). */
+
+int arLabelingSubDBICBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubDBRCBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubDWICBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubDWRCBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+#if !AR_DISABLE_LABELING_DEBUG_MODE
+int arLabelingSubEBICBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubEBRCBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubEWICBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubEWRCBand( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+#endif
+int arLabelingSubDBZBand( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubDWZBand( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubEBZBand( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+int arLabelingSubEWZBand( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo, int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p );
+
+/*  Single-pass labeling at several thresholds, used by arLabelingMulti(). */
+
+int arLabelingSubDBICMulti( ARUint8 *image, int xsize, int ysize, const int *labelingThresh, ARLabelInfo **labelInfo, int threshNum );
+int arLabelingSubDBRCMulti( ARUint8 *image, int xsize, int ysize, const int *labelingThresh, ARLabelInfo **labelInfo, int threshNum );
+int arLabelingSubDWICMulti( ARUint8 *image, int xsize, int ysize, const int *labelingThresh, ARLabelInfo **labelInfo, int threshNum );
+int arLabelingSubDWRCMulti( ARUint8 *image, int xsize, int ysize, const int *labelingThresh, ARLabelInfo **labelInfo, int threshNum );
+
+/*  Common to all labelers (arLabeling.c). */
+
+// Zero the outermost rows and columns of labelInfo->labelImage.
+void arLabelingSubClearBorder( ARLabelInfo *labelInfo, int lxsize, int lysize );
+
+// Resolve the wk_max provisional labels in labelInfo->work and accumulate labelInfo->work2
+// into label_num, area, pos and clip.
+int arLabelingSubCollect( ARLabelInfo *labelInfo, int lxsize, int lysize, int wk_max );
+
 #ifdef __cplusplus
 }
 #endif
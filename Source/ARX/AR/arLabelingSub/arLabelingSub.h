@@ -54,313 +54,437 @@
 
 #define AR_PIXEL_SIZE     1
 
+#if !AR_LABELING_32_BIT
+#  if HAVE_ARM_NEON || HAVE_ARM64_NEON
+#    include <arm_neon.h>
+#    define AR_LABELING_SUB_NEON
+#    define AR_LABELING_SUB_NEON_ALL_ZERO(u64x2) ((vgetq_lane_u64((u64x2), 0) | vgetq_lane_u64((u64x2), 1)) == 0)
+#  elif HAVE_INTEL_SIMD
+#    include <emmintrin.h> // SSE2.
+#    define AR_LABELING_SUB_SSE2
+#  endif
+#endif
+
 #ifndef AR_LABELING_ADAPTIVE
 #  ifndef AR_LABELING_DEBUG_ENABLE_F
 #    ifndef AR_LABELING_WHITE_REGION_F
 #      ifndef AR_LABELING_FRAME_IMAGE_F
-int arLabelingSubDBIC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubDBIC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubDBICBand
+#        define AR_LABELING_SUB_MULTI_FUNC arLabelingSubDBICMulti
 #      else
-int arLabelingSubDBRC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubDBRC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubDBRCBand
+#        define AR_LABELING_SUB_MULTI_FUNC arLabelingSubDBRCMulti
 #      endif // !AR_LABELING_FRAME_IMAGE_F
 #    else
 #      ifndef AR_LABELING_FRAME_IMAGE_F
-int arLabelingSubDWIC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubDWIC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubDWICBand
+#        define AR_LABELING_SUB_MULTI_FUNC arLabelingSubDWICMulti
 #      else
-int arLabelingSubDWRC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubDWRC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubDWRCBand
+#        define AR_LABELING_SUB_MULTI_FUNC arLabelingSubDWRCMulti
 #      endif // !AR_LABELING_FRAME_IMAGE_F
 #    endif // !AR_LABELING_WHITE_REGION_F
 #  else
 #    ifndef AR_LABELING_WHITE_REGION_F
 #      ifndef AR_LABELING_FRAME_IMAGE_F
-int arLabelingSubEBIC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubEBIC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubEBICBand
 #      else
-int arLabelingSubEBRC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubEBRC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubEBRCBand
 #      endif // !AR_LABELING_FRAME_IMAGE_F
 #    else
 #      ifndef AR_LABELING_FRAME_IMAGE_F
-int arLabelingSubEWIC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubEWIC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubEWICBand
 #      else
-int arLabelingSubEWRC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#        define AR_LABELING_SUB_FUNC      arLabelingSubEWRC
+#        define AR_LABELING_SUB_BAND_FUNC arLabelingSubEWRCBand
 #      endif // !AR_LABELING_FRAME_IMAGE_F
 #    endif // !AR_LABELING_WHITE_REGION_F
 #  endif // !AR_LABELING_DEBUG_ENABLE_F
 #else
 #  ifndef AR_LABELING_DEBUG_ENABLE_F
 #    ifndef AR_LABELING_WHITE_REGION_F
-int arLabelingSubDBZ( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo )
+#      define AR_LABELING_SUB_FUNC      arLabelingSubDBZ
+#      define AR_LABELING_SUB_BAND_FUNC arLabelingSubDBZBand
 #    else
-int arLabelingSubDWZ( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo )
+#      define AR_LABELING_SUB_FUNC      arLabelingSubDWZ
+#      define AR_LABELING_SUB_BAND_FUNC arLabelingSubDWZBand
 #    endif // !AR_LABELING_WHITE_REGION_F
 #  else
 #    ifndef AR_LABELING_WHITE_REGION_F
-int arLabelingSubEBZ( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo )
+#      define AR_LABELING_SUB_FUNC      arLabelingSubEBZ
+#      define AR_LABELING_SUB_BAND_FUNC arLabelingSubEBZBand
 #    else
-int arLabelingSubEWZ( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo )
+#      define AR_LABELING_SUB_FUNC      arLabelingSubEWZ
+#      define AR_LABELING_SUB_BAND_FUNC arLabelingSubEWZBand
 #    endif // !AR_LABELING_WHITE_REGION_F
 #  endif // !AR_LABELING_DEBUG_ENABLE_F
 #endif
 
-{
-    int       lxsize, lysize;
-    ARUint8  *pnt;                     /*  image pointer into source image  */
-#ifdef AR_LABELING_ADAPTIVE
-    ARUint8  *pnt_thresh;
+// Thresholds one row of the source image into the corresponding label image row pnt2, giving -1
+// for pixels in region and 0 otherwise. pnt points to the 2nd pixel of the row in the source image.
+#ifndef AR_LABELING_ADAPTIVE
+static inline void arLabelingSubThreshRow( const ARUint8 *pnt, int labelingThresh,
+#else
+static inline void arLabelingSubThreshRow( const ARUint8 *pnt, const ARUint8 *pnt_thresh,
 #endif
-    AR_LABELING_LABEL_TYPE  *pnt1, *pnt2;             /*  image pointer into destination (label) image  */
 #ifdef AR_LABELING_DEBUG_ENABLE_F
-    ARUint8   *dpnt;
+                                           ARUint8 *dpnt,
 #endif
-    int      *work, *work2;
-    int       wk_max;                   /*  work                */
-    int       i,j,k,l;                  /*  for loop            */
-    int       *wk;                      /*  pointer for work    */
-    int       m,n;                      /*  work                */
-    int       *label_num;
-    int       *area;
-    int       *clip;
-    ARdouble  *pos;
-
-#ifdef AR_LABELING_FRAME_IMAGE_F
-    lxsize = xsize;
-    lysize = ysize;
-#else
-    lxsize = xsize / 2;
-    lysize = ysize / 2;
+                                           AR_LABELING_LABEL_TYPE *pnt2, int lxsize )
+{
+    int       i;
+    int       m,n;
+#if defined(AR_LABELING_SUB_SSE2) || defined(AR_LABELING_SUB_NEON)
+    int       simd;
+#  ifdef AR_LABELING_SUB_SSE2
+    __m128i   v, t;
+#    ifndef AR_LABELING_FRAME_IMAGE_F
+    const __m128i evenMask = _mm_set1_epi16(0x00FF);
+#    endif
+#  else
+    uint8x16_t v, t;
+#  endif
 #endif
 
-#ifdef AR_LABELING_DEBUG_ENABLE_F
-    //memset( labelInfo->bwImage, 0, lxsize*lysize );
+#if defined(AR_LABELING_SUB_SSE2) || defined(AR_LABELING_SUB_NEON)
+#  ifndef AR_LABELING_ADAPTIVE
+    simd = (labelingThresh >= 0 && labelingThresh <= 255);
+#    ifdef AR_LABELING_SUB_SSE2
+    t = _mm_set1_epi8((char)labelingThresh);
+#    else
+    t = vdupq_n_u8((uint8_t)labelingThresh);
+#    endif
+#  else
+    simd = 1;
+#  endif
 #endif
 
-	// Set top and bottom rows of labelImage to 0.
-    pnt1 = &(labelInfo->labelImage[0]); // Leftmost pixel of top row of image.
-    pnt2 = &(labelInfo->labelImage[(lysize - 1)*lxsize]); // Leftmost pixel of bottom row of image.
-    for(i = 0; i < lxsize; i++) {
-        *(pnt1++) = *(pnt2++) = 0;
-    }
-
-	// Set leftmost and rightmost columns of labelImage to 0.
-    pnt1 = &(labelInfo->labelImage[0]); // Leftmost pixel of top row of image.
-    pnt2 = &(labelInfo->labelImage[lxsize - 1]); // Rightmost pixel of top row of image.
-    for(i = 0; i < lysize; i++) {
-        *pnt1 = *pnt2 = 0;
-        pnt1 += lxsize;
-        pnt2 += lxsize;
-    }
-
-    wk_max = 0;
-    work = labelInfo->work;
-    work2 = labelInfo->work2;
-    pnt2 = &(labelInfo->labelImage[lxsize + 1]); // Start on 2nd pixel of 2nd row.
-#ifdef AR_LABELING_DEBUG_ENABLE_F
-    dpnt = &(labelInfo->bwImage[lxsize + 1]);
-#  ifdef AR_LABELING_FRAME_IMAGE_F
-    pnt = &(image[(xsize + 1)*AR_PIXEL_SIZE]); // Start on 2nd pixel of 2nd row.
+    i = 1;
+#if defined(AR_LABELING_SUB_SSE2) || defined(AR_LABELING_SUB_NEON)
+    if (simd) {
+        for (; i + 16 < lxsize; i += 16) {
+#  ifdef AR_LABELING_SUB_SSE2
+#    ifdef AR_LABELING_FRAME_IMAGE_F
+            v = _mm_loadu_si128((const __m128i *)(pnt + (i - 1)*AR_PIXEL_SIZE));
+#    else
+            v = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i *)(pnt + (i - 1)*AR_PIXEL_SIZE*2)), evenMask),
+                                 _mm_and_si128(_mm_loadu_si128((const __m128i *)(pnt + (i - 1)*AR_PIXEL_SIZE*2 + 16)), evenMask));
+#    endif
 #    ifdef AR_LABELING_ADAPTIVE
-    pnt_thresh = &(image_thresh[(xsize + 1)*AR_PIXEL_SIZE]);
-    for(j = 1; j < lysize - 1; j++, pnt += AR_PIXEL_SIZE*2, pnt_thresh += AR_PIXEL_SIZE*2, pnt2 += 2, dpnt += 2) { // Process rows. At end of each row, skips last pixel of row and first pixel of next row.
-        for(i = 1; i < lxsize - 1; i++, pnt += AR_PIXEL_SIZE, pnt_thresh += AR_PIXEL_SIZE, pnt2++, dpnt++) { // Process columns.
+            t = _mm_loadu_si128((const __m128i *)(pnt_thresh + (i - 1)*AR_PIXEL_SIZE));
+#    endif
+            v = _mm_cmpeq_epi8(_mm_min_epu8(v, t), v); // v <= t
+#    ifdef AR_LABELING_WHITE_REGION_F
+            v = _mm_xor_si128(v, _mm_set1_epi8(-1)); // v > t
+#    endif
+#    ifdef AR_LABELING_DEBUG_ENABLE_F
+            _mm_storeu_si128((__m128i *)(dpnt + i), v);
+#    endif
+            _mm_storeu_si128((__m128i *)(pnt2 + i), _mm_unpacklo_epi8(v, v));
+            _mm_storeu_si128((__m128i *)(pnt2 + i + 8), _mm_unpackhi_epi8(v, v));
+#  else // AR_LABELING_SUB_NEON
+#    ifdef AR_LABELING_FRAME_IMAGE_F
+            v = vld1q_u8(pnt + (i - 1)*AR_PIXEL_SIZE);
 #    else
-    for(j = 1; j < lysize - 1; j++, pnt += AR_PIXEL_SIZE*2, pnt2 += 2, dpnt += 2) { // Process rows. At end of each row, skips last pixel of row and first pixel of next row.
-        for(i = 1; i < lxsize - 1; i++, pnt += AR_PIXEL_SIZE, pnt2++, dpnt++) { // Process columns.
+            v = vld2q_u8(pnt + (i - 1)*AR_PIXEL_SIZE*2).val[0];
 #    endif
-#  else
-    pnt = &(image[(xsize*2 + 2)*AR_PIXEL_SIZE]);
-    for(j = 1; j < lysize - 1; j++, pnt += AR_PIXEL_SIZE*4, pnt2 += 2, dpnt += 2) {
-        for(i = 1; i < lxsize - 1; i++, pnt += AR_PIXEL_SIZE*2, pnt2++, dpnt++) {
-#  endif
-#else
-#  ifdef AR_LABELING_FRAME_IMAGE_F
-    pnt = &(image[(xsize + 1)*AR_PIXEL_SIZE]); // Start on 2nd pixel of 2nd row.
 #    ifdef AR_LABELING_ADAPTIVE
-    pnt_thresh = &(image_thresh[(xsize + 1)*AR_PIXEL_SIZE]);
-    for(j = 1; j < lysize - 1; j++, pnt += AR_PIXEL_SIZE*2, pnt_thresh += AR_PIXEL_SIZE*2, pnt2 += 2) { // Process rows. At end of each row, skips last pixel of row and first pixel of next row.
-        for(i = 1; i < lxsize - 1; i++, pnt += AR_PIXEL_SIZE, pnt_thresh += AR_PIXEL_SIZE, pnt2++) { // Process columns.
+            t = vld1q_u8(pnt_thresh + (i - 1)*AR_PIXEL_SIZE);
+#    endif
+#    ifndef AR_LABELING_WHITE_REGION_F
+            v = vcleq_u8(v, t);
 #    else
-    for(j = 1; j < lysize - 1; j++, pnt += AR_PIXEL_SIZE*2, pnt2 += 2) { // Process rows. At end of each row, skips last pixel of row and first pixel of next row.
-        for(i = 1; i < lxsize - 1; i++, pnt += AR_PIXEL_SIZE, pnt2++) { // Process columns.
+            v = vcgtq_u8(v, t);
 #    endif
-#  else
-    pnt = &(image[(xsize*2 + 2)*AR_PIXEL_SIZE]);
-    for(j = 1; j < lysize - 1; j++, pnt += AR_PIXEL_SIZE*4, pnt2 += 2) {
-        for(i = 1; i < lxsize - 1; i++, pnt += AR_PIXEL_SIZE*2, pnt2++) {
+#    ifdef AR_LABELING_DEBUG_ENABLE_F
+            vst1q_u8(dpnt + i, v);
+#    endif
+            vst1q_s16(pnt2 + i, vmovl_s8(vreinterpret_s8_u8(vget_low_u8(v))));
+            vst1q_s16(pnt2 + i + 8, vmovl_s8(vreinterpret_s8_u8(vget_high_u8(v))));
 #  endif
-#endif // AR_LABELING_DEBUG_ENABLE_F
-
+        }
+    }
+#endif
+    for (; i < lxsize - 1; i++) {
+#ifdef AR_LABELING_FRAME_IMAGE_F
+        m = pnt[(i - 1)*AR_PIXEL_SIZE];
+#else
+        m = pnt[(i - 1)*AR_PIXEL_SIZE*2];
+#endif
 #ifndef AR_LABELING_WHITE_REGION_F
 // Black region.
 #  ifndef AR_LABELING_ADAPTIVE
-            if( *pnt <= labelingThresh ) {
+        n = (m <= labelingThresh);
 #  else
-            if( *pnt <= *pnt_thresh ) {
+        n = (m <= pnt_thresh[(i - 1)*AR_PIXEL_SIZE]);
 #  endif
 #else
 // White region.
 #  ifndef AR_LABELING_ADAPTIVE
-            if( *pnt > labelingThresh ) {
+        n = (m > labelingThresh);
 #  else
-            if( *pnt > *pnt_thresh ) {
+        n = (m > pnt_thresh[(i - 1)*AR_PIXEL_SIZE]);
 #  endif
 #endif // !AR_LABELING_WHITE_REGION_F
-                // pnt is in region.
-#  ifdef AR_LABELING_DEBUG_ENABLE_F
-                *dpnt = 255;
-#  endif
-                pnt1 = &(pnt2[-lxsize]);
-                if( *pnt1 > 0 ) {
-                    *pnt2 = *pnt1;
-                    l = ((*pnt2) - 1) * 7;
-                    work2[l+0] ++; // area
-                    work2[l+1] += i; // pos[0]
-                    work2[l+2] += j; // pos[1]
-                    work2[l+6]  = j; // clip[3]
-                }
-                else if( *(pnt1+1) > 0 ) {
-                    if( *(pnt1-1) > 0 ) {
-                        m = work[*(pnt1+1)-1];
-                        n = work[*(pnt1-1)-1];
-                        if( m > n ) {
-                            *pnt2 = n;
-                            wk = &(work[0]);
-                            for(k = 0; k < wk_max; k++) {
-                                if( *wk == m ) *wk = n;
-                                wk++;
-                            }
-                        }
-                        else if( m < n ) {
-                            *pnt2 = m;
-                            wk = &(work[0]);
-                            for(k = 0; k < wk_max; k++) {
-                                if( *wk == n ) *wk = m;
-                                wk++;
-                            }
-                        }
-                        else *pnt2 = m;
-                        l = ((*pnt2)-1)*7;
-                        work2[l+0]  ++; // area.
-                        work2[l+1] += i; // pos[0]
-                        work2[l+2] += j; // pos[1]
-                        work2[l+6]  = j; // clip[3]
-                    }
-                    else if( *(pnt2-1) > 0 ) {
-                        m = work[*(pnt1+1)-1];
-                        n = work[*(pnt2-1)-1];
-                        if( m > n ) {
-                            *pnt2 = n;
-                            wk = &(work[0]);
-                            for(k = 0; k < wk_max; k++) {
-                                if( *wk == m ) *wk = n;
-                                wk++;
-                            }
-                        }
-                        else if( m < n ) {
-                            *pnt2 = m;
-                            wk = &(work[0]);
-                            for(k = 0; k < wk_max; k++) {
-                                if( *wk == n ) *wk = m;
-                                wk++;
-                            }
-                        }
-                        else *pnt2 = m;
-                        l = ((*pnt2)-1)*7;
-                        work2[l+0] ++; // area
-                        work2[l+1] += i; // pos[0]
-                        work2[l+2] += j; // pos[1]
-                    }
-                    else {
-                        *pnt2 = *(pnt1+1);
-                        l = ((*pnt2)-1)*7;
-                        work2[l+0] ++; // area
-                        work2[l+1] += i; // pos[0]
-                        work2[l+2] += j; // pos[1]
-                        if( work2[l+3] > i ) work2[l+3] = i; // clip[0]
-                        work2[l+6] = j; // clip [3]
-                    }
-                }
-                else if( *(pnt1-1) > 0 ) {
-                    *pnt2 = *(pnt1-1);
-                    l = ((*pnt2)-1)*7;
-                    work2[l+0] ++; // area
-                    work2[l+1] += i; // pos[0]
-                    work2[l+2] += j; // pos[1]
-                    if( work2[l+4] < i ) work2[l+4] = i; // clip[1]
-                    work2[l+6] = j; // clip[3]
-                }
-                else if( *(pnt2-1) > 0) {
-                    *pnt2 = *(pnt2-1);
-                    l = ((*pnt2)-1)*7;
-                    work2[l+0] ++; // area
-                    work2[l+1] += i; // pos[0]
-                    work2[l+2] += j; // pos[1]
-                    if( work2[l+4] < i ) work2[l+4] = i; // clip[1]
-                }
-                else {
-                    wk_max++;
-                    if( wk_max > AR_LABELING_WORK_SIZE ) {
-                        ARLOGe("Error: labeling work overflow.\n");
-                        return(-1);
-                    }
-                    work[wk_max-1] = *pnt2 = wk_max;
-                    l = (wk_max-1)*7;
-                    work2[l+0] = 1; // area
-                    work2[l+1] = i; // pos[0]
-                    work2[l+2] = j; // pos[1]
-                    work2[l+3] = i; // clip[0]
-                    work2[l+4] = i; // clip[1]
-                    work2[l+5] = j; // clip[2]
-                    work2[l+6] = j; // clip[3]
-                }
-            }
-            else {
-                // pnt is NOT in region.
-                *pnt2 = 0;
+        pnt2[i] = -n;
 #ifdef AR_LABELING_DEBUG_ENABLE_F
-				*dpnt = 0;
+        dpnt[i] = (n ? 255 : 0);
+#endif
+    }
+}
+
+// Labels each run of pixels in region in label image row pnt2 (row j), which has been thresholded by
+// arLabelingSubThreshRow(). A run joins every label in the row above, pnt0, that it touches (8-connected),
+// or else starts a new label. work holds a forest in which each label's parent is a smaller label, so the
+// smallest label is always the root of its class.
+// Returns -1 if more than AR_LABELING_WORK_SIZE provisional labels are needed.
+static inline int arLabelingSubLabelRow( const AR_LABELING_LABEL_TYPE *pnt0, AR_LABELING_LABEL_TYPE *pnt2, int lxsize, int j,
+                                         int *work, int *work2, int *wk_max_p )
+{
+    int       wk_max = *wk_max_p;
+    int       i,k,l;
+    int       m,n;
+    int       s,e;                      /*  run is [s, e)       */
+    int       label, prev;
+
+    for (i = 1; i < lxsize - 1; ) {
+        if (!pnt2[i]) {
+#if defined(AR_LABELING_SUB_SSE2)
+            while (i + 8 < lxsize && _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(pnt2 + i)), _mm_setzero_si128())) == 0xFFFF) i += 8;
+#elif defined(AR_LABELING_SUB_NEON)
+            while (i + 8 < lxsize && AR_LABELING_SUB_NEON_ALL_ZERO(vreinterpretq_u64_s16(vld1q_s16(pnt2 + i)))) i += 8;
+#endif
+            while (i < lxsize - 1 && !pnt2[i]) i++;
+            continue;
+        }
+        s = i;
+#if defined(AR_LABELING_SUB_SSE2)
+        while (i + 8 < lxsize && _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(pnt2 + i)), _mm_setzero_si128())) == 0) i += 8;
+#elif defined(AR_LABELING_SUB_NEON)
+        while (i + 8 < lxsize && AR_LABELING_SUB_NEON_ALL_ZERO(vreinterpretq_u64_u16(vceqq_s16(vld1q_s16(pnt2 + i), vdupq_n_s16(0))))) i += 8;
 #endif
+        while (i < lxsize - 1 && pnt2[i]) i++;
+        e = i;
+
+        label = prev = 0;
+        for (k = s - 1; k <= e; k++) {
+            m = pnt0[k];
+            if (m <= 0 || m == prev) continue;
+            prev = m;
+            while (work[m-1] != m) {
+                work[m-1] = work[work[m-1]-1];
+                m = work[m-1];
+            }
+            if (label == 0) label = m;
+            else if (m < label) {
+                work[label-1] = m;
+                label = m;
+            }
+            else if (m > label) work[m-1] = label;
+        }
+
+        n = e - s;
+        if (label == 0) {
+            wk_max++;
+            if( wk_max > AR_LABELING_WORK_SIZE ) {
+                return(-1);
             }
+            work[wk_max-1] = label = wk_max;
+            l = (wk_max-1)*7;
+            work2[l+0] = n; // area
+            work2[l+1] = (s + e - 1)*n/2; // pos[0]
+            work2[l+2] = j*n; // pos[1]
+            work2[l+3] = s; // clip[0]
+            work2[l+4] = e - 1; // clip[1]
+            work2[l+5] = j; // clip[2]
+            work2[l+6] = j; // clip[3]
+        } else {
+            l = (label-1)*7;
+            work2[l+0] += n; // area
+            work2[l+1] += (s + e - 1)*n/2; // pos[0]
+            work2[l+2] += j*n; // pos[1]
+            if( work2[l+3] > s ) work2[l+3] = s; // clip[0]
+            if( work2[l+4] < e - 1 ) work2[l+4] = e - 1; // clip[1]
+            work2[l+6] = j; // clip[3]
         }
-#ifndef AR_LABELING_FRAME_IMAGE_F
+        for (k = s; k < e; k++) pnt2[k] = label;
+    }
+
+    *wk_max_p = wk_max;
+    return 0;
+}
+
+// Labels rows [rowStart, rowEnd) of the label image, using provisional labels 1..*wk_max_p
+// held in work and work2. labelAbove points to the leftmost pixel of the label row above rowStart.
+// Bands processed concurrently must each be given their own work, work2 and labelAbove row.
+// Returns -1 if more than AR_LABELING_WORK_SIZE provisional labels are needed.
+#ifndef AR_LABELING_ADAPTIVE
+int AR_LABELING_SUB_BAND_FUNC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo,
+                               int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p )
+#else
+int AR_LABELING_SUB_BAND_FUNC( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo,
+                               int rowStart, int rowEnd, AR_LABELING_LABEL_TYPE *labelAbove, int *work, int *work2, int *wk_max_p )
+#endif
+{
+    int       lxsize;
+    ARUint8  *pnt;                     /*  image pointer to 2nd pixel of current row in source image  */
+#ifdef AR_LABELING_ADAPTIVE
+    ARUint8  *pnt_thresh;
+#endif
+    AR_LABELING_LABEL_TYPE  *pnt0, *pnt2;             /*  pointers to label image rows above and current  */
+#ifdef AR_LABELING_DEBUG_ENABLE_F
+    ARUint8   *dpnt;
+#endif
+    int       wk_max;                   /*  work                */
+    int       j;                        /*  for loop            */
+
+#ifdef AR_LABELING_FRAME_IMAGE_F
+    lxsize = xsize;
+#else
+    lxsize = xsize / 2;
+#endif
+
+    wk_max = 0;
+    pnt0 = labelAbove;
+    pnt2 = &(labelInfo->labelImage[rowStart*lxsize]);
+#ifdef AR_LABELING_DEBUG_ENABLE_F
+    dpnt = &(labelInfo->bwImage[rowStart*lxsize]);
+#endif
+#ifdef AR_LABELING_FRAME_IMAGE_F
+    pnt = &(image[(rowStart*xsize + 1)*AR_PIXEL_SIZE]); // 2nd pixel of first row.
+#  ifdef AR_LABELING_ADAPTIVE
+    pnt_thresh = &(image_thresh[(rowStart*xsize + 1)*AR_PIXEL_SIZE]);
+#  endif
+#else
+    pnt = &(image[(xsize*2 + 2 + (rowStart - 1)*(lxsize*2 + xsize))*AR_PIXEL_SIZE]); // Same row stepping as below, also for odd xsize.
+#endif
+
+    for(j = rowStart; j < rowEnd; j++) {
+
+#ifndef AR_LABELING_ADAPTIVE
+        arLabelingSubThreshRow(pnt, labelingThresh,
+#else
+        arLabelingSubThreshRow(pnt, pnt_thresh,
+#endif
+#ifdef AR_LABELING_DEBUG_ENABLE_F
+                               dpnt,
+#endif
+                               pnt2, lxsize);
+        if (arLabelingSubLabelRow(pnt0, pnt2, lxsize, j, work, work2, &wk_max) < 0) return(-1);
+
+        pnt0 = pnt2;
+        pnt2 += lxsize;
+#ifdef AR_LABELING_DEBUG_ENABLE_F
+        dpnt += lxsize;
+#endif
+#ifdef AR_LABELING_FRAME_IMAGE_F
         pnt += xsize*AR_PIXEL_SIZE;
+#  ifdef AR_LABELING_ADAPTIVE
+        pnt_thresh += xsize*AR_PIXEL_SIZE;
+#  endif
+#else
+        pnt += (lxsize*2 + xsize)*AR_PIXEL_SIZE;
 #endif
     }
 
-    label_num = &(labelInfo->label_num);
-    area = &(labelInfo->area[0]);
-    clip = &(labelInfo->clip[0][0]);
-    pos  = &(labelInfo->pos[0][0]);
-    j = 1;
-    wk = &(work[0]);
-    for(i = 1; i <= wk_max; i++, wk++) {
-        *wk = (*wk==i)? j++: work[(*wk)-1];
-    }
-    *label_num = j - 1;
-    if( *label_num == 0 ) {
-        return 0;
-    }
+    *wk_max_p = wk_max;
+    return 0;
+}
+
+#ifdef AR_LABELING_SUB_MULTI_FUNC
+// Labels the image at each of threshNum thresholds into the corresponding labelInfo, in a single
+// sweep of the image: each source row is thresholded and labeled at every threshold in turn while
+// it is in cache.
+int AR_LABELING_SUB_MULTI_FUNC( ARUint8 *image, int xsize, int ysize, const int *labelingThresh, ARLabelInfo **labelInfo, int threshNum )
+{
+    int       lxsize, lysize;
+    ARUint8  *pnt;                     /*  image pointer to 2nd pixel of current row in source image  */
+    AR_LABELING_LABEL_TYPE  *pnt0[AR_LABELING_MULTI_THRESH_MAX], *pnt2[AR_LABELING_MULTI_THRESH_MAX];
+    int       wk_max[AR_LABELING_MULTI_THRESH_MAX];
+    int       j, k;
+
+    if (threshNum < 1 || threshNum > AR_LABELING_MULTI_THRESH_MAX) return (-1);
+
+#ifdef AR_LABELING_FRAME_IMAGE_F
+    lxsize = xsize;
+    lysize = ysize;
+    pnt = &(image[(xsize + 1)*AR_PIXEL_SIZE]); // 2nd pixel of row 1.
+#else
+    lxsize = xsize / 2;
+    lysize = ysize / 2;
+    pnt = &(image[(xsize*2 + 2)*AR_PIXEL_SIZE]);
+#endif
 
-    memset( (ARUint8 *)area, 0, *label_num *     sizeof(int) );
-    memset( (ARUint8 *)pos,  0, *label_num * 2 * sizeof(ARdouble) );
-    for(i = 0; i < *label_num; i++) {
-        clip[i*4+0] = lxsize;
-        clip[i*4+1] = 0;
-        clip[i*4+2] = lysize;
-        clip[i*4+3] = 0;
+    for (k = 0; k < threshNum; k++) {
+        arLabelingSubClearBorder(labelInfo[k], lxsize, lysize);
+        pnt0[k] = labelInfo[k]->labelImage;
+        pnt2[k] = &(labelInfo[k]->labelImage[lxsize]);
+        wk_max[k] = 0;
     }
-    for(i = 0; i < wk_max; i++) {
-        j = work[i] - 1;
-        area[j]    += work2[i*7+0];
-        pos[j*2+0] += work2[i*7+1];
-        pos[j*2+1] += work2[i*7+2];
-        if( clip[j*4+0] > work2[i*7+3] ) clip[j*4+0] = work2[i*7+3];
-        if( clip[j*4+1] < work2[i*7+4] ) clip[j*4+1] = work2[i*7+4];
-        if( clip[j*4+2] > work2[i*7+5] ) clip[j*4+2] = work2[i*7+5];
-        if( clip[j*4+3] < work2[i*7+6] ) clip[j*4+3] = work2[i*7+6];
+
+    for (j = 1; j < lysize - 1; j++) {
+        for (k = 0; k < threshNum; k++) {
+            arLabelingSubThreshRow(pnt, labelingThresh[k], pnt2[k], lxsize);
+            if (arLabelingSubLabelRow(pnt0[k], pnt2[k], lxsize, j, labelInfo[k]->work, labelInfo[k]->work2, &wk_max[k]) < 0) {
+                ARLOGe("Error: labeling work overflow.\n");
+                return(-1);
+            }
+            pnt0[k] = pnt2[k];
+            pnt2[k] += lxsize;
+        }
+#ifdef AR_LABELING_FRAME_IMAGE_F
+        pnt += xsize*AR_PIXEL_SIZE;
+#else
+        pnt += (lxsize*2 + xsize)*AR_PIXEL_SIZE;
+#endif
     }
 
-    for( i = 0; i < *label_num; i++ ) {
-        pos[i*2+0] /= area[i];
-        pos[i*2+1] /= area[i];
+    for (k = 0; k < threshNum; k++) {
+        if (arLabelingSubCollect(labelInfo[k], lxsize, lysize, wk_max[k]) < 0) return (-1);
     }
+    return (0);
+}
+#endif // AR_LABELING_SUB_MULTI_FUNC
 
-    return 0;
+#ifndef AR_LABELING_ADAPTIVE
+int AR_LABELING_SUB_FUNC( ARUint8 *image, int xsize, int ysize, int labelingThresh, ARLabelInfo *labelInfo )
+#else
+int AR_LABELING_SUB_FUNC( ARUint8 *image, const int xsize, const int ysize, ARUint8* image_thresh, ARLabelInfo *labelInfo )
+#endif
+{
+    int       lxsize, lysize;
+    int       wk_max;
+
+#ifdef AR_LABELING_FRAME_IMAGE_F
+    lxsize = xsize;
+    lysize = ysize;
+#else
+    lxsize = xsize / 2;
+    lysize = ysize / 2;
+#endif
+
+    arLabelingSubClearBorder(labelInfo, lxsize, lysize);
+#ifndef AR_LABELING_ADAPTIVE
+    if (AR_LABELING_SUB_BAND_FUNC(image, xsize, ysize, labelingThresh, labelInfo, 1, lysize - 1, labelInfo->labelImage, labelInfo->work, labelInfo->work2, &wk_max) < 0) {
+        ARLOGe("Error: labeling work overflow.\n");
+        return(-1);
+    }
+#else
+    if (AR_LABELING_SUB_BAND_FUNC(image, xsize, ysize, image_thresh, labelInfo, 1, lysize - 1, labelInfo->labelImage, labelInfo->work, labelInfo->work2, &wk_max) < 0) {
+        ARLOGe("Error: labeling work overflow.\n");
+        return(-1);
+    }
+#endif
+    return (arLabelingSubCollect(labelInfo, lxsize, lysize, wk_max));
 }
+
+#undef AR_LABELING_SUB_FUNC
+#undef AR_LABELING_SUB_BAND_FUNC
+#undef AR_LABELING_SUB_MULTI_FUNC
@@ -0,0 +1,351 @@
+/*
+ *  arMatrixCodeDictionary.c
+ *  artoolkitX
+ *
+ *  This file is part of artoolkitX.
+ *
+ *  artoolkitX is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  artoolkitX is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with artoolkitX.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2023 Philip Lamb
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+#include <ARX/AR/ar.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <ARX/ARUtil/file_utils.h>
+
+struct _ARMatrixCodeDictionary {
+    int       size;         // Number of rows/columns in each codeword.
+    int       codeNum;      // Number of codewords.
+    uint64_t *codes;        // codeNum codewords, as supplied.
+    uint64_t *rotations;    // 4*codeNum entries. Entry id*4 + dir is codeword id as read from a marker facing in direction dir.
+    int       minDistance;  // Minimum Hamming distance between any two entries of rotations.
+    int       maxErrors;    // Maximum Hamming distance accepted by a lookup.
+    int       hashBits;     // log2 of the number of slots in the hash table.
+    uint64_t *hashKeys;     // Open-addressed hash table of all entries of rotations.
+    int32_t  *hashValues;   // Index into rotations of the entry in each slot, or -1 if slot is empty.
+};
+
+static inline int popcount64(uint64_t x)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__POPCNT__) || defined(__aarch64__))
+    return __builtin_popcountll(x);
+#else // Without a popcount instruction, the builtin is a library call, slower than this.
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (int)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+static inline uint32_t hashSlot(const uint64_t key, const int hashBits)
+{
+    return (uint32_t)((key * 0x9e3779b97f4a7c15ull) >> (64 - hashBits));
+}
+
+uint64_t arMatrixCodeRotate(const uint64_t code, const int size, const int dir)
+{
+    uint64_t out = 0;
+    const int last = size*size - 1;
+    int i, j, r, c;
+
+    // Cell (j, i) as seen in the image holds cell (r, c) of the marker. Matches the reading orders in arPattGetID.c.
+    for (j = 0; j < size; j++) {
+        for (i = 0; i < size; i++) {
+            switch (dir & 3) {
+                case 0: r = j;          c = i;          break;
+                case 1: r = i;          c = size-1 - j; break;
+                case 2: r = size-1 - j; c = size-1 - i; break;
+                default: r = size-1 - i; c = j;         break;
+            }
+            if ((code >> (last - (r*size + c))) & 1) out |= 1ull << (last - (j*size + i));
+        }
+    }
+    return (out);
+}
+
+ARMatrixCodeDictionary *arMatrixCodeDictionaryCreate(const int size, const uint64_t *codes, const int codeNum)
+{
+    ARMatrixCodeDictionary *dict;
+    int i, j, k, d;
+    uint32_t slot, mask;
+
+    if (size < AR_MATRIX_CODE_DICTIONARY_SIZE_MIN || size > AR_MATRIX_CODE_DICTIONARY_SIZE_MAX) {
+        ARLOGe("Error: matrix code dictionary size %d unsupported.\n", size);
+        return (NULL);
+    }
+    if (!codes || codeNum < 1) {
+        ARLOGe("Error: empty matrix code dictionary.\n");
+        return (NULL);
+    }
+    if (codeNum > AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX) {
+        ARLOGe("Error: matrix code dictionary has %d codewords, more than the maximum %d.\n", codeNum, AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX);
+        return (NULL);
+    }
+    for (i = 0; i < codeNum; i++) {
+        if (codes[i] >> (size*size)) {
+            ARLOGe("Error: matrix code dictionary codeword %d (0x%" PRIx64 ") has more than %d bits.\n", i, codes[i], size*size);
+            return (NULL);
+        }
+    }
+
+    arMallocClear(dict, ARMatrixCodeDictionary, 1);
+    dict->size = size;
+    dict->codeNum = codeNum;
+    arMalloc(dict->codes, uint64_t, codeNum);
+    memcpy(dict->codes, codes, codeNum*sizeof(uint64_t));
+    arMalloc(dict->rotations, uint64_t, codeNum*4);
+    for (i = 0; i < codeNum; i++) {
+        for (k = 0; k < 4; k++) dict->rotations[i*4 + k] = arMatrixCodeRotate(codes[i], size, k);
+    }
+
+    // Rotation preserves Hamming distance, so comparing each codeword against the
+    // rotations of itself and of later codewords covers every pair of rotations.
+    dict->minDistance = size*size;
+    for (i = 0; i < codeNum; i++) {
+        for (j = i; j < codeNum; j++) {
+            for (k = (j == i ? 1 : 0); k < 4; k++) {
+                d = popcount64(codes[i] ^ dict->rotations[j*4 + k]);
+                if (d == 0) {
+                    if (j == i) ARLOGe("Error: matrix code dictionary codeword %d is rotationally symmetric.\n", i);
+                    else ARLOGe("Error: matrix code dictionary codewords %d and %d are rotations of each other.\n", i, j);
+                    arMatrixCodeDictionaryDelete(&dict);
+                    return (NULL);
+                }
+                if (d < dict->minDistance) dict->minDistance = d;
+            }
+        }
+    }
+    dict->maxErrors = (dict->minDistance - 1)/2;
+
+    // Hash table with at least twice as many slots as rotations.
+    dict->hashBits = 4;
+    while (((uint64_t)1 << dict->hashBits) < (uint64_t)codeNum*8) dict->hashBits++;
+    mask = (1u << dict->hashBits) - 1;
+    arMalloc(dict->hashKeys, uint64_t, mask + 1);
+    arMalloc(dict->hashValues, int32_t, mask + 1);
+    for (slot = 0; slot <= mask; slot++) dict->hashValues[slot] = -1;
+    for (i = 0; i < codeNum*4; i++) {
+        slot = hashSlot(dict->rotations[i], dict->hashBits);
+        while (dict->hashValues[slot] >= 0) slot = (slot + 1) & mask;
+        dict->hashKeys[slot] = dict->rotations[i];
+        dict->hashValues[slot] = i;
+    }
+
+    return (dict);
+}
+
+// Returns a pointer to the next token in the buffer, skipping whitespace and comments, or NULL at the end of the buffer.
+static const char *nextToken(const char *p)
+{
+    while (*p) {
+        if (*p == '#') {
+            while (*p && *p != '\n') p++;
+        } else if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            p++;
+        } else {
+            return (p);
+        }
+    }
+    return (NULL);
+}
+
+ARMatrixCodeDictionary *arMatrixCodeDictionaryLoadFromBuffer(const char *buffer)
+{
+    ARMatrixCodeDictionary *dict;
+    const char *p;
+    char *end;
+    long size, codeNum;
+    uint64_t *codes;
+    int i;
+
+    if (!buffer) {
+        ARLOGe("Error: can't load matrix code dictionary from NULL buffer.\n");
+        return (NULL);
+    }
+
+    if (!(p = nextToken(buffer)) || (size = strtol(p, &end, 10), end == p)
+        || !(p = nextToken(end)) || (codeNum = strtol(p, &end, 10), end == p)) {
+        ARLOGe("Error: matrix code dictionary header missing.\n");
+        return (NULL);
+    }
+    if (size < AR_MATRIX_CODE_DICTIONARY_SIZE_MIN || size > AR_MATRIX_CODE_DICTIONARY_SIZE_MAX || codeNum < 1 || codeNum > AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX) {
+        ARLOGe("Error: matrix code dictionary header invalid (size %ld, %ld codewords).\n", size, codeNum);
+        return (NULL);
+    }
+
+    arMalloc(codes, uint64_t, codeNum);
+    for (i = 0; i < codeNum; i++) {
+        if (!(p = nextToken(end)) || (codes[i] = strtoull(p, &end, 16), end == p)) {
+            ARLOGe("Error: matrix code dictionary has %d of %ld codewords.\n", i, codeNum);
+            free(codes);
+            return (NULL);
+        }
+    }
+
+    dict = arMatrixCodeDictionaryCreate((int)size, codes, (int)codeNum);
+    free(codes);
+    return (dict);
+}
+
+ARMatrixCodeDictionary *arMatrixCodeDictionaryLoad(const char *filename)
+{
+    ARMatrixCodeDictionary *dict = NULL;
+    char *bytes;
+
+    bytes = cat(filename, NULL);
+    if (!bytes) {
+        ARLOGe("Error reading matrix code dictionary file '%s'.\n", filename);
+        ARLOGperror(NULL);
+    } else {
+        dict = arMatrixCodeDictionaryLoadFromBuffer(bytes);
+        free(bytes);
+    }
+    return (dict);
+}
+
+int arMatrixCodeDictionarySave(const ARMatrixCodeDictionary *dict, const char *filename)
+{
+    FILE *fp;
+    int i;
+    const int digits = (dict ? (dict->size*dict->size + 3)/4 : 0);
+
+    if (!dict || !filename) return (-1);
+
+    if (!(fp = fopen(filename, "w"))) {
+        ARLOGe("Error opening matrix code dictionary file '%s' for writing.\n", filename);
+        ARLOGperror(NULL);
+        return (-1);
+    }
+    fprintf(fp, "# artoolkitX matrix code dictionary.\n");
+    fprintf(fp, "# Minimum Hamming distance %d, corrects up to %d errors.\n", dict->minDistance, (dict->minDistance - 1)/2);
+    fprintf(fp, "%d %d\n", dict->size, dict->codeNum);
+    for (i = 0; i < dict->codeNum; i++) {
+        fprintf(fp, "%0*" PRIx64 "\n", digits, dict->codes[i]);
+    }
+    if (fclose(fp) != 0) {
+        ARLOGe("Error writing matrix code dictionary file '%s'.\n", filename);
+        ARLOGperror(NULL);
+        return (-1);
+    }
+    return (0);
+}
+
+void arMatrixCodeDictionaryDelete(ARMatrixCodeDictionary **dict_p)
+{
+    if (!dict_p || !*dict_p) return;
+    free((*dict_p)->codes);
+    free((*dict_p)->rotations);
+    free((*dict_p)->hashKeys);
+    free((*dict_p)->hashValues);
+    free(*dict_p);
+    *dict_p = NULL;
+}
+
+int arMatrixCodeDictionaryGetSize(const ARMatrixCodeDictionary *dict)
+{
+    if (!dict) return (-1);
+    return (dict->size);
+}
+
+int arMatrixCodeDictionaryGetCodeNum(const ARMatrixCodeDictionary *dict)
+{
+    if (!dict) return (-1);
+    return (dict->codeNum);
+}
+
+int arMatrixCodeDictionaryGetCode(const ARMatrixCodeDictionary *dict, const int id, uint64_t *code_p)
+{
+    if (!dict || !code_p || id < 0 || id >= dict->codeNum) return (-1);
+    *code_p = dict->codes[id];
+    return (0);
+}
+
+int arMatrixCodeDictionaryGetMinDistance(const ARMatrixCodeDictionary *dict)
+{
+    if (!dict) return (-1);
+    return (dict->minDistance);
+}
+
+int arMatrixCodeDictionarySetMaxErrors(ARMatrixCodeDictionary *dict, const int maxErrors)
+{
+    if (!dict || maxErrors < 0) return (-1);
+    dict->maxErrors = maxErrors;
+    return (0);
+}
+
+int arMatrixCodeDictionaryGetMaxErrors(const ARMatrixCodeDictionary *dict)
+{
+    if (!dict) return (-1);
+    return (dict->maxErrors);
+}
+
+int arMatrixCodeDictionaryLookup(const ARMatrixCodeDictionary *dict, const uint64_t codeRaw, int *id_p, int *dir_p, int *errors_p)
+{
+    uint32_t slot, mask;
+    int i, d, best, bestDistance, bestCount;
+
+    if (!dict || !id_p || !dir_p) return (-1);
+
+    // Exact match.
+    mask = (1u << dict->hashBits) - 1;
+    slot = hashSlot(codeRaw, dict->hashBits);
+    while ((i = dict->hashValues[slot]) >= 0) {
+        if (dict->hashKeys[slot] == codeRaw) {
+            *id_p = i / 4;
+            *dir_p = i % 4;
+            if (errors_p) *errors_p = 0;
+            return (0);
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (dict->maxErrors == 0) return (-1);
+
+    // Nearest rotation, which must be unique.
+    best = -1;
+    bestDistance = dict->maxErrors + 1;
+    bestCount = 0;
+    for (i = 0; i < dict->codeNum*4; i++) {
+        d = popcount64(codeRaw ^ dict->rotations[i]);
+        if (d < bestDistance) {
+            best = i;
+            bestDistance = d;
+            bestCount = 1;
+        } else if (d == bestDistance) {
+            bestCount++;
+        }
+    }
+    if (best < 0 || bestCount != 1) return (-1);
+
+    *id_p = best / 4;
+    *dir_p = best % 4;
+    if (errors_p) *errors_p = bestDistance;
+    return (0);
+}
@@ -84,8 +84,8 @@ static ARdouble  arGetTransMatMultiSquare2(AR3DHandle *handle, ARMarkerInfo *mar
         k = -1;
         if( config->marker[i].patt_type == AR_MULTI_PATTERN_TYPE_TEMPLATE ) {
             for( j = 0; j < marker_num; j++ ) {
-                if (marker_info[j].matched) continue;
                 if( marker_info[j].idPatt != config->marker[i].patt_id ) continue;
+                if (marker_info[j].matched) continue; // Checked after the ID, so that only markers this config could claim are read.
                 if( marker_info[j].cfPatt < config->cfPattCutoff ) continue;
                 if( k == -1 ) k = j;
                 else if( marker_info[k].cfPatt < marker_info[j].cfPatt ) k = j;
@@ -95,13 +95,13 @@ static ARdouble  arGetTransMatMultiSquare2(AR3DHandle *handle, ARMarkerInfo *mar
         }
         else { // config->marker[i].patt_type == AR_MULTI_PATTERN_TYPE_MATRIX
             for( j = 0; j < marker_num; j++ ) {
-                if (marker_info[j].matched) continue;
                 // Check if we need to examine the globalID rather than patt_id.
                 if (marker_info[j].idMatrix == 0 && marker_info[j].globalID != 0ULL) {
                     if( marker_info[j].globalID != config->marker[i].globalID ) continue;
                 } else {
                     if( marker_info[j].idMatrix != config->marker[i].patt_id ) continue;
                 }
+                if (marker_info[j].matched) continue;
                 if( marker_info[j].cfMatrix < config->cfMatrixCutoff ) continue;
                 if( k == -1 ) k = j;
                 else if( marker_info[k].cfMatrix < marker_info[j].cfMatrix ) k = j;
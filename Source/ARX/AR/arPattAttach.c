@@ -47,6 +47,7 @@
  *******************************************************/
 
 #include <ARX/AR/ar.h>
+#include "matrixCode.h"
 
 int arPattAttach( ARHandle *arHandle, ARPattHandle *arPattHandle )
 {
@@ -54,6 +55,7 @@ int arPattAttach( ARHandle *arHandle, ARPattHandle *arPattHandle )
     if (arHandle->pattHandle) return (-1);
 
     arHandle->pattHandle = arPattHandle;
+    bchTableEnsure(arPattHandle, arHandle->matrixCodeType);
 
     return (0);
 }
@@ -66,4 +68,24 @@ int arPattDetach(ARHandle *arHandle)
     arHandle->pattHandle = NULL;
 	
     return (0);
-}
\ No newline at end of file
+}
+
+int arPattAttachMatrixCodeDictionary(ARPattHandle *pattHandle, ARMatrixCodeDictionary *dict)
+{
+    if (!pattHandle || !dict) return (-1);
+    if (pattHandle->matrixCodeDictionary) return (-1);
+
+    pattHandle->matrixCodeDictionary = dict;
+
+    return (0);
+}
+
+int arPattDetachMatrixCodeDictionary(ARPattHandle *pattHandle)
+{
+    if (!pattHandle) return (-1);
+    if (!pattHandle->matrixCodeDictionary) return (-1);
+
+    pattHandle->matrixCodeDictionary = NULL;
+
+    return (0);
+}
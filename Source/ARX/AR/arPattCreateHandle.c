@@ -49,6 +49,7 @@
 #include <ARX/AR/ar.h>
 #include <stdio.h>
 #include <math.h>
+#include "matrixCode.h"
 
 ARPattHandle *arPattCreateHandle(void)
 {
@@ -58,29 +59,21 @@ ARPattHandle *arPattCreateHandle(void)
 ARPattHandle *arPattCreateHandle2(const int pattSize, const int patternCountMax)
 {
     ARPattHandle  *pattHandle;
-    int            i, j;
     
     if (pattSize < 16 || pattSize > AR_PATT_SIZE1_MAX || patternCountMax <= 0) return NULL;
 
-    arMalloc( pattHandle, ARPattHandle, 1 );
+    // Pattern storage is allocated as patterns are loaded. See arPattLoadFromBuffer().
+    arMallocClear( pattHandle, ARPattHandle, 1 );
 
     pattHandle->patt_num = 0;
     pattHandle->patt_num_max = patternCountMax;
     //pattHandle->pattRatio = AR_PATT_RATIO;
     pattHandle->pattSize = pattSize;
-    
-    arMalloc(pattHandle->pattf, int, patternCountMax);
-    arMalloc(pattHandle->patt, int *, patternCountMax*4)
-    arMalloc(pattHandle->pattBW, int *, patternCountMax*4)
-    arMalloc(pattHandle->pattpow, ARdouble, patternCountMax*4)
-    arMalloc(pattHandle->pattpowBW, ARdouble, patternCountMax*4)
-    for (i = 0; i < patternCountMax; i++) {
-        pattHandle->pattf[i] = 0;
-        for (j = 0; j < 4; j++) {
-            arMalloc(pattHandle->patt[i*4 + j], int, pattSize*pattSize*3);
-            arMalloc(pattHandle->pattBW[i*4 + j], int, pattSize*pattSize);
-        }
-    }
+    pattHandle->pattBankStride = (pattSize*pattSize*3 + 7) & ~7;
+    pattHandle->pattBankStrideBW = (pattSize*pattSize + 7) & ~7;
+    pattHandle->prefilter = 1;
+
+    // BCH lookup tables are built when a matrix code type which uses one is selected. See bchTableEnsure().
 
     return pattHandle;
 }
@@ -91,7 +84,7 @@ int arPattDeleteHandle(ARPattHandle *pattHandle)
 	
 	if (pattHandle == NULL) return (-1);
 	
-    	for (i = 0; i < pattHandle->patt_num_max; i++) {
+    	for (i = 0; i < pattHandle->pattCapacity; i++) {
 		if (pattHandle->pattf[i] != 0) arPattFree(pattHandle, i);
         	for (j = 0; j < 4; j++) {
             		free(pattHandle->patt[i*4 + j]);
@@ -104,6 +97,16 @@ int arPattDeleteHandle(ARPattHandle *pattHandle)
 	free(pattHandle->pattf);
 	free(pattHandle->pattpow);
 	free(pattHandle->pattpowBW);
+	free(pattHandle->pattBank);
+	free(pattHandle->pattBankBW);
+	free(pattHandle->pattCoarse);
+	free(pattHandle->pattCoarseBW);
+	free(pattHandle->pattResidual);
+	free(pattHandle->pattResidualBW);
+	free(pattHandle->pattActive);
+	free(pattHandle->pattActiveIndex);
+	free(pattHandle->pattFree);
+	for (i = 0; i < AR_MATRIX_CODE_BCH_TABLE_NUM; i++) bchTableFree(&pattHandle->bchTables[i]);
 	
 	free(pattHandle);
 	pattHandle = NULL;
@@ -51,6 +51,12 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "matrixCode.h"
+#if HAVE_ARM_NEON || HAVE_ARM64_NEON
+#  include <arm_neon.h>
+#elif HAVE_INTEL_SIMD
+#  include <emmintrin.h> // SSE2.
+#endif
 #if DEBUG_PATT_GETID
 #  ifndef __APPLE__
 #    include <GL/gl.h>
@@ -95,14 +101,24 @@ int  cnt = 1;
 #define AR_GLOBAL_ID_OUTER_SIZE 14
 #define AR_GLOBAL_ID_INNER_SIZE 3
 
-//#define DEBUG_BCH
+struct _ARPattScratch {
+    int       size;     ///< Largest pattern size (rows and columns) the buffers can hold.
+    ARInt16  *input;    ///< size*size*3 rounded up to a multiple of 8, normalised pattern for pattern_match().
+    ARUint32 *extPatt2; ///< size*size*3, sample accumulator for arPattGetImage2().
+    int       boundNum; ///< Number of elements in bound.
+    ARdouble *bound;    ///< Prefilter upper bound on the confidence of each pattern orientation.
+};
 
 static void   get_cpara( ARdouble world[4][2], ARdouble vertex[4][2],
                          ARdouble para[3][3] );
+static int    pattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int sample_size,
+                             ARUint8 *image, int xsize, int ysize, AR_PIXEL_FORMAT pixelFormat, ARParamLTf *paramLTf,
+                             ARdouble vertex[4][2], ARdouble pattRatio, ARUint8 *ext_patt, ARPattScratch *scratch );
 static int    pattern_match( ARPattHandle *pattHandle, int mode, ARUint8 *data, int size,
-                             int *code, int *dir, ARdouble *cf );
-static int    decode_bch(const AR_MATRIX_CODE_TYPE matrixCodeType, const uint64_t in, uint8_t recd127[127], uint64_t *out_p);
-static int    get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir, ARdouble *cf, const AR_MATRIX_CODE_TYPE matrixCodeType, int *errorCorrected );
+                             int *code, int *dir, ARdouble *cf, ARPattScratch *scratch );
+static int    pattern_dot( const ARInt16 *a, const ARInt16 *b, int n );
+static int    get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir, ARdouble *cf, const AR_MATRIX_CODE_TYPE matrixCodeType, const ARPattHandle *pattHandle, int *errorCorrected );
+static int    get_matrix_code_dictionary( ARUint8 *data, int size, int *code_out_p, int *dir, ARdouble *cf, const ARMatrixCodeDictionary *dict, int *errorCorrected );
 static int    get_global_id_code( ARUint8 *data, uint64_t *code_out_p, int *dir, ARdouble *cf, int *errorCorrected );
 
 #if !AR_DISABLE_NON_CORE_FNS
@@ -113,6 +129,7 @@ int arPattGetID( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode
 {
     ARUint8 ext_patt1[AR_PATT_SIZE1_MAX*AR_PATT_SIZE1_MAX*3]; // Holds unwarped pattern extracted from image for template matching.
     ARUint8 ext_patt2[AR_PATT_SIZE2_MAX*AR_PATT_SIZE2_MAX]; // Holds unwarped pattern extracted from image for matrix-code matching.
+    ARPattScratch *scratch;
     int errorCodeMtx, errorCodePatt;
 
     // Matrix code detection pass.
@@ -128,7 +145,7 @@ int arPattGetID( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode
         glPixelZoom( 1.0f, 1.0f);
         cnt++;
 #endif
-        errorCodeMtx = get_matrix_code(ext_patt2, matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK, code, dir, cf, matrixCodeType, NULL);
+        errorCodeMtx = get_matrix_code(ext_patt2, matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK, code, dir, cf, matrixCodeType, pattHandle, NULL);
     } else errorCodeMtx = 1;
 
     // Template matching pass.
@@ -142,15 +159,17 @@ int arPattGetID( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode
             *cf   = -_1_0;
             errorCodePatt = -1;
         } else {
+            scratch = arPattScratchCreate(pattHandle->pattSize);
             if (pattDetectMode == AR_TEMPLATE_MATCHING_COLOR || pattDetectMode == AR_TEMPLATE_MATCHING_COLOR_AND_MATRIX) {
                 arPattGetImage(imageProcMode, AR_TEMPLATE_MATCHING_COLOR, pattHandle->pattSize, pattHandle->pattSize*AR_PATT_SAMPLE_FACTOR1,
                                image, xsize, ysize, pixelFormat, x_coord, y_coord, vertex, pattRatio, ext_patt1);
-                errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_COLOR, ext_patt1, pattHandle->pattSize, code, dir, cf);
+                errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_COLOR, ext_patt1, pattHandle->pattSize, code, dir, cf, scratch);
             } else {
                 arPattGetImage(imageProcMode, AR_TEMPLATE_MATCHING_MONO, pattHandle->pattSize, pattHandle->pattSize*AR_PATT_SAMPLE_FACTOR1,
                                image, xsize, ysize, pixelFormat, x_coord, y_coord, vertex, pattRatio, ext_patt1);
-                errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_MONO, ext_patt1, pattHandle->pattSize, code, dir, cf);
+                errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_MONO, ext_patt1, pattHandle->pattSize, code, dir, cf, scratch);
             }
+            arPattScratchDelete(&scratch);
 #if DEBUG_PATT_GETID
             glPixelZoom( 4.0f, -4.0f);
             glRasterPos3f( 0.0f, pattHandle->pattSize*4.0f*cnt, 1.0f );
@@ -181,10 +200,64 @@ int arPattGetID2( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMod
 }
 #endif // !AR_DISABLE_NON_CORE_FNS
 
+ARPattScratch *arPattScratchCreate( int pattSize )
+{
+    ARPattScratch *scratch;
+
+    arMallocClear(scratch, ARPattScratch, 1);
+    if (pattSize > 0) {
+        arMallocClear(scratch->input, ARInt16, (pattSize*pattSize*3 + 7) & ~7);
+        arMalloc(scratch->extPatt2, ARUint32, pattSize*pattSize*3);
+        scratch->size = pattSize;
+    }
+    return (scratch);
+}
+
+int arPattScratchDelete( ARPattScratch **scratch_p )
+{
+    if (!scratch_p || !*scratch_p) return (-1);
+
+    free((*scratch_p)->input);
+    free((*scratch_p)->extPatt2);
+    free((*scratch_p)->bound);
+    free(*scratch_p);
+    *scratch_p = NULL;
+
+    return (0);
+}
+
+// Grows the scratch buffers if a larger pattern size than any seen before is requested.
+static void pattScratchReserve( ARPattScratch *scratch, int pattSize )
+{
+    if (pattSize <= scratch->size) return;
+
+    free(scratch->input);
+    free(scratch->extPatt2);
+    arMallocClear(scratch->input, ARInt16, (pattSize*pattSize*3 + 7) & ~7);
+    arMalloc(scratch->extPatt2, ARUint32, pattSize*pattSize*3);
+    scratch->size = pattSize;
+}
+
 int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode,
                       ARUint8 *image, int xsize, int ysize, AR_PIXEL_FORMAT pixelFormat, ARParamLTf *paramLTf, ARdouble vertex[4][2], ARdouble pattRatio,
                       int *codePatt, int *dirPatt, ARdouble *cfPatt, int *codeMatrix, int *dirMatrix, ARdouble *cfMatrix,
                       const AR_MATRIX_CODE_TYPE matrixCodeType, int *errorCorrected, uint64_t *codeGlobalID_p )
+{
+    ARPattScratch *scratch;
+    int            ret;
+
+    scratch = arPattScratchCreate(pattHandle ? pattHandle->pattSize : 0);
+    ret = arPattGetIDGlobalWithScratch(pattHandle, imageProcMode, pattDetectMode, image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio,
+                                       codePatt, dirPatt, cfPatt, codeMatrix, dirMatrix, cfMatrix,
+                                       matrixCodeType, errorCorrected, codeGlobalID_p, scratch);
+    arPattScratchDelete(&scratch);
+    return (ret);
+}
+
+int arPattGetIDGlobalWithScratch( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode,
+                      ARUint8 *image, int xsize, int ysize, AR_PIXEL_FORMAT pixelFormat, ARParamLTf *paramLTf, ARdouble vertex[4][2], ARdouble pattRatio,
+                      int *codePatt, int *dirPatt, ARdouble *cfPatt, int *codeMatrix, int *dirMatrix, ARdouble *cfMatrix,
+                      const AR_MATRIX_CODE_TYPE matrixCodeType, int *errorCorrected, uint64_t *codeGlobalID_p, ARPattScratch *scratch )
 {
     ARUint8 ext_patt[MAX(AR_PATT_SIZE1_MAX,AR_PATT_SIZE2_MAX)*MAX(AR_PATT_SIZE1_MAX,AR_PATT_SIZE2_MAX)*3]; // Holds unwarped pattern extracted from image.
     int errorCodeMtx, errorCodePatt;
@@ -195,8 +268,8 @@ int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, int pattDete
        || pattDetectMode == AR_TEMPLATE_MATCHING_COLOR_AND_MATRIX
        || pattDetectMode == AR_TEMPLATE_MATCHING_MONO_AND_MATRIX ) {
         if (matrixCodeType == AR_MATRIX_CODE_GLOBAL_ID) {
-            if (arPattGetImage2(imageProcMode, AR_MATRIX_CODE_DETECTION, AR_GLOBAL_ID_OUTER_SIZE, AR_GLOBAL_ID_OUTER_SIZE * AR_PATT_SAMPLE_FACTOR2,
-                                image, xsize, ysize, pixelFormat, paramLTf, vertex, (((ARdouble)AR_GLOBAL_ID_OUTER_SIZE)/((ARdouble)(AR_GLOBAL_ID_OUTER_SIZE + 2))), ext_patt) < 0) {
+            if (pattGetImage2(imageProcMode, AR_MATRIX_CODE_DETECTION, AR_GLOBAL_ID_OUTER_SIZE, AR_GLOBAL_ID_OUTER_SIZE * AR_PATT_SAMPLE_FACTOR2,
+                                image, xsize, ysize, pixelFormat, paramLTf, vertex, (((ARdouble)AR_GLOBAL_ID_OUTER_SIZE)/((ARdouble)(AR_GLOBAL_ID_OUTER_SIZE + 2))), ext_patt, scratch) < 0) {
                 errorCodeMtx = -6;
                 *codeMatrix = -1;
             } else {
@@ -214,8 +287,8 @@ int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, int pattDete
                 }
             }
         } else {
-            if (arPattGetImage2(imageProcMode, AR_MATRIX_CODE_DETECTION, matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK, (matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK) * AR_PATT_SAMPLE_FACTOR2,
-                                image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio, ext_patt) < 0) {
+            if (pattGetImage2(imageProcMode, AR_MATRIX_CODE_DETECTION, matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK, (matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK) * AR_PATT_SAMPLE_FACTOR2,
+                                image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio, ext_patt, scratch) < 0) {
                 errorCodeMtx = -6;
                 *codeMatrix = -1;
             } else {
@@ -226,7 +299,7 @@ int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, int pattDete
                 glPixelZoom( 1.0f, 1.0f);
                 cnt++;
 #endif
-                errorCodeMtx = get_matrix_code(ext_patt, matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK, codeMatrix, dirMatrix, cfMatrix, matrixCodeType, errorCorrected);
+                errorCodeMtx = get_matrix_code(ext_patt, matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK, codeMatrix, dirMatrix, cfMatrix, matrixCodeType, pattHandle, errorCorrected);
                 if (codeGlobalID_p) *codeGlobalID_p = 0ULL;
             }
         }
@@ -242,12 +315,12 @@ int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, int pattDete
             *codePatt = -1;
         } else {
             if (pattDetectMode == AR_TEMPLATE_MATCHING_COLOR || pattDetectMode == AR_TEMPLATE_MATCHING_COLOR_AND_MATRIX) {
-                if (arPattGetImage2(imageProcMode, AR_TEMPLATE_MATCHING_COLOR, pattHandle->pattSize, pattHandle->pattSize*AR_PATT_SAMPLE_FACTOR1,
-                                    image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio, ext_patt) < 0) {
+                if (pattGetImage2(imageProcMode, AR_TEMPLATE_MATCHING_COLOR, pattHandle->pattSize, pattHandle->pattSize*AR_PATT_SAMPLE_FACTOR1,
+                                    image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio, ext_patt, scratch) < 0) {
                     errorCodePatt = -6;
                     *codePatt = -1;
                 } else {
-                    errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_COLOR, ext_patt, pattHandle->pattSize, codePatt, dirPatt, cfPatt);
+                    errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_COLOR, ext_patt, pattHandle->pattSize, codePatt, dirPatt, cfPatt, scratch);
 #if DEBUG_PATT_GETID
                     glPixelZoom( 4.0f, -4.0f);
                     glRasterPos3f( 0.0f, pattHandle->pattSize*4.0f*cnt, 1.0f );
@@ -257,12 +330,12 @@ int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, int pattDete
 #endif
                 }
             } else {
-                if (arPattGetImage2(imageProcMode, AR_TEMPLATE_MATCHING_MONO, pattHandle->pattSize, pattHandle->pattSize*AR_PATT_SAMPLE_FACTOR1,
-                                    image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio, ext_patt) < 0) {
+                if (pattGetImage2(imageProcMode, AR_TEMPLATE_MATCHING_MONO, pattHandle->pattSize, pattHandle->pattSize*AR_PATT_SAMPLE_FACTOR1,
+                                    image, xsize, ysize, pixelFormat, paramLTf, vertex, pattRatio, ext_patt, scratch) < 0) {
                     errorCodePatt = -6;
                     *codePatt = -1;
                 } else {
-                    errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_MONO, ext_patt, pattHandle->pattSize, codePatt, dirPatt, cfPatt);
+                    errorCodePatt = pattern_match(pattHandle, AR_TEMPLATE_MATCHING_MONO, ext_patt, pattHandle->pattSize, codePatt, dirPatt, cfPatt, scratch);
 #if DEBUG_PATT_GETID
                     glPixelZoom( 4.0f, -4.0f);
                     glRasterPos3f( 0.0f, pattHandle->pattSize*4.0f*cnt, 1.0f );
@@ -841,6 +914,20 @@ bail:
 int arPattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int sample_size,
                      ARUint8 *image, int xsize, int ysize, AR_PIXEL_FORMAT pixelFormat, ARParamLTf *paramLTf,
                      ARdouble vertex[4][2], ARdouble pattRatio, ARUint8 *ext_patt)
+{
+    ARPattScratch *scratch;
+    int            ret;
+
+    scratch = arPattScratchCreate(patt_size);
+    ret = pattGetImage2(imageProcMode, pattDetectMode, patt_size, sample_size, image, xsize, ysize, pixelFormat, paramLTf,
+                        vertex, pattRatio, ext_patt, scratch);
+    arPattScratchDelete(&scratch);
+    return (ret);
+}
+
+static int pattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int sample_size,
+                          ARUint8 *image, int xsize, int ysize, AR_PIXEL_FORMAT pixelFormat, ARParamLTf *paramLTf,
+                          ARdouble vertex[4][2], ARdouble pattRatio, ARUint8 *ext_patt, ARPattScratch *scratch )
 {
     ARUint32 *ext_patt2;
     ARdouble  world[4][2];
@@ -855,6 +942,9 @@ int arPattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int s
     int       lx1, lx2, ly1, ly2, lxPatt, lyPatt;
     int       i, j;
 
+    pattScratchReserve(scratch, patt_size);
+    ext_patt2 = scratch->extPatt2;
+
     world[0][0] = _100_0;
     world[0][1] = _100_0;
     world[1][0] = _100_0 + _10_0;
@@ -907,7 +997,7 @@ int arPattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int s
     pattRatio2 = pattRatio * _10_0;
 
     if( pattDetectMode == AR_TEMPLATE_MATCHING_COLOR ) {
-        arMallocClear( ext_patt2, ARUint32, patt_size*patt_size*3 );
+        memset( ext_patt2, 0, patt_size*patt_size*3*sizeof(ARUint32) );
 
         if( pixelFormat == AR_PIXEL_FORMAT_RGB ) {
             for( j = 0; j < ydiv2; j++ ) {
@@ -1256,11 +1346,9 @@ int arPattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int s
         for( i = 0; i < patt_size*patt_size*3; i++ ) {
             ext_patt[i] = ext_patt2[i] / (xdiv*ydiv);
         }
-
-        free( ext_patt2 );
     }
     else { // !AR_TEMPLATE_MATCHING_COLOR
-        arMallocClear( ext_patt2, ARUint32, patt_size*patt_size );
+        memset( ext_patt2, 0, patt_size*patt_size*sizeof(ARUint32) );
 
         if( pixelFormat == AR_PIXEL_FORMAT_RGB || pixelFormat == AR_PIXEL_FORMAT_BGR ) {
             for( j = 0; j < ydiv2; j++ ) {
@@ -1513,14 +1601,11 @@ int arPattGetImage2( int imageProcMode, int pattDetectMode, int patt_size, int s
         for( i = 0; i < patt_size*patt_size; i++ ) {
             ext_patt[i] = ext_patt2[i] / (xdiv*ydiv);
         }
-
-        free( ext_patt2 );
     }
 
     return 0;
     
 bail:
-    free(ext_patt2);
     return -1;
 }
 
@@ -1648,12 +1733,11 @@ int arPattGetImage3( ARHandle *arHandle, int markerNo, ARUint8 *image, ARPattRec
 static void get_cpara( ARdouble world[4][2], ARdouble vertex[4][2],
                        ARdouble para[3][3] )
 {
-    ARMat   *a, *b, *c;
+    ARdouble am[8*8], bm[8], cm[8];
+    ARMat    a_ = {am, 8, 8}, b_ = {bm, 8, 1}, c_ = {cm, 8, 1}; // On the stack; this runs once per extracted pattern.
+    ARMat   *a = &a_, *b = &b_, *c = &c_;
     int     i;
 
-    a = arMatrixAlloc( 8, 8 );
-    b = arMatrixAlloc( 8, 1 );
-    c = arMatrixAlloc( 8, 1 );
     for( i = 0; i < 4; i++ ) {
         a->m[i*16+0]  = world[i][0];
         a->m[i*16+1]  = world[i][1];
@@ -1684,19 +1768,25 @@ static void get_cpara( ARdouble world[4][2], ARdouble vertex[4][2],
     para[2][0] = c->m[2*3+0];
     para[2][1] = c->m[2*3+1];
     para[2][2] = _1_0;
-    arMatrixFree( a );
-    arMatrixFree( b );
-    arMatrixFree( c );
 }
 
-static int pattern_match( ARPattHandle *pattHandle, int mode, ARUint8 *data, int size, int *code, int *dir, ARdouble *cf )
+static int pattern_match( ARPattHandle *pattHandle, int mode, ARUint8 *data, int size, int *code, int *dir, ARdouble *cf, ARPattScratch *scratch )
 {
-    int   *input = NULL;
+    const int       grid = AR_PATT_PREFILTER_GRID;
+    ARInt16        *input;
+    const ARInt16  *bank;
+    const ARdouble *pattpow;
+    const ARInt32  *pattCoarse;
+    const double   *pattResidual;
+    ARInt32         coarse[AR_PATT_PREFILTER_GRID*AR_PATT_PREFILTER_GRID*3];
+    int64_t         coarseSum;
+    double          residual, bound;
+    int             n, stride, channels, prefilter, seed;
     int    sum, ave;
     int    res1, res2;
     int    i, j, k, l;
     ARdouble datapow;
-    ARdouble sum2, max;
+    ARdouble sum2, max, thresh;
 
     if ( pattHandle == NULL || 0 >= size ) {
         *code = 0;
@@ -1706,347 +1796,149 @@ static int pattern_match( ARPattHandle *pattHandle, int mode, ARUint8 *data, int
     }
 
     if ( mode == AR_TEMPLATE_MATCHING_COLOR ) {
-        const int SIZE_SQD_X3 = size*size*3;
-        
-        arMalloc( input, int, SIZE_SQD_X3 );
-        if ( NULL == input ) {
-            return -1;
-        }
-
-        sum = ave = 0;
-        for (i=0; i < SIZE_SQD_X3; i++) {
-            ave += (255-data[i]);
-        }
-        ave /= (SIZE_SQD_X3);
-
-        for (i=0; i < SIZE_SQD_X3; i++) {
-            input[i] = (255-data[i]) - ave;
-            sum += input[i]*input[i];
-        }
-
-        datapow = SQRT( (ARdouble)sum );
-        //if( datapow == 0.0 ) {
-        if ( datapow/(size*SQRT_3_0) < AR_PATT_CONTRAST_THRESH1 ) {
-            *code = 0;
-            *dir  = 0;
-            *cf   = -_1_0;
-            free( input );
-            return -2; // Insufficient contrast.
-        }
+        channels     = 3;
+        stride       = pattHandle->pattBankStride;
+        bank         = pattHandle->pattBank;
+        pattpow      = pattHandle->pattpow;
+        pattCoarse   = pattHandle->pattCoarse;
+        pattResidual = pattHandle->pattResidual;
+    }
+    else if ( mode == AR_TEMPLATE_MATCHING_MONO ) {
+        channels     = 1;
+        stride       = pattHandle->pattBankStrideBW;
+        bank         = pattHandle->pattBankBW;
+        pattpow      = pattHandle->pattpowBW;
+        pattCoarse   = pattHandle->pattCoarseBW;
+        pattResidual = pattHandle->pattResidualBW;
+    }
+    else {
+        return -1;
+    }
+    n = size*size*channels;
 
-        res1 = res2 = -1;
-        k = -1; // Best match in search space.
-        max = _0_0;
-        for ( l = 0; l < pattHandle->patt_num; l++ ) { // Consider the whole search space.
-            k++;
-            while( pattHandle->pattf[k] == 0 ) k++; // No pattern at this slot.
-            if( pattHandle->pattf[k] == 2 ) continue; // Pattern at this slot is deactivated.
-            for( j = 0; j < 4; j++ ) { // The 4 rotated variants of the pattern.
-                sum = 0;
-                for(i=0; i < SIZE_SQD_X3; i++)
-                    sum += input[i] * pattHandle->patt[k * 4 + j][i]; // Correlation operation.
-                sum2 = sum / pattHandle->pattpow[k*4 + j] / datapow;
-                if( sum2 > max ) { max = sum2; res1 = j; res2 = k; }
-            }
-        }
-        *dir  = res1;
-        *code = res2;
-        *cf   = max;
+    pattScratchReserve(scratch, size);
+    input = scratch->input;
 
-        free( input );
-        return 0;
+    sum = ave = 0;
+    for (i=0; i < n; i++) {
+        ave += (255-data[i]);
     }
-    else if ( mode == AR_TEMPLATE_MATCHING_MONO ) {
-        const int SIZE_SQD = size*size;
+    ave /= n;
 
-        arMalloc( input, int, SIZE_SQD );
-        if ( NULL == input ) {
-            return -1;
-        }
-        
-        sum = ave = 0;
-        for ( i=0; i < SIZE_SQD; i++ ) {
-            ave += (255-data[i]);
-        }
-        ave /= (SIZE_SQD);
+    for (i=0; i < n; i++) {
+        input[i] = (ARInt16)((255-data[i]) - ave);
+        sum += input[i]*input[i];
+    }
+    for ( ; i < stride; i++) input[i] = 0;
 
-        for ( i=0; i < SIZE_SQD; i++ ) {
-            input[i] = (255-data[i]) - ave;
-            sum += input[i] * input[i];
-        }
+    datapow = SQRT( (ARdouble)sum );
+    //if( datapow == 0.0 ) {
+    if ( (channels == 3 ? datapow/(size*SQRT_3_0) : datapow/size) < AR_PATT_CONTRAST_THRESH1 ) {
+        *code = 0;
+        *dir  = 0;
+        *cf   = -_1_0;
+        return -2; // Insufficient contrast.
+    }
 
-        datapow = SQRT( (ARdouble)sum );
-        //if( datapow == 0.0 ) {
-        if ( datapow/size < AR_PATT_CONTRAST_THRESH1 ) {
-            *code = 0;
-            *dir  = 0;
-            *cf   = -_1_0;
-            free( input );
-            return -2; // Insufficient contrast.
+    // Prefilter. Splitting each vector into its block means plus a residual, the correlation
+    // input.patt = sum(S_input*S_patt)/A + residual_input.residual_patt, where S are block sums
+    // and A is the block area. Bounding the second term by Cauchy-Schwarz gives an upper bound on
+    // the correlation for each pattern orientation. The orientation with the highest bound is
+    // correlated first, and any orientation whose bound is below that result can't be the best
+    // match, so is skipped. The bound is rounded up by 1.0 (the correlation is an integer) so
+    // floating-point error can't cause a false rejection. Results are therefore unchanged.
+    prefilter = (pattHandle->prefilter && size % grid == 0 && pattHandle->pattActiveNum >= AR_PATT_PREFILTER_PATT_NUM_MIN);
+    thresh = _0_0;
+    if (prefilter) {
+        const int blockSize = size / grid;
+        const int coarseNum = grid*grid*channels;
+        int64_t   coarse2;
+        int       bi, bj, c;
+
+        if (scratch->boundNum < pattHandle->pattCapacity*4) {
+            free(scratch->bound);
+            arMalloc(scratch->bound, ARdouble, pattHandle->pattCapacity*4);
+            scratch->boundNum = pattHandle->pattCapacity*4;
+        }
+        memset(coarse, 0, coarseNum*sizeof(ARInt32));
+        for (j = 0; j < size; j++) {
+            bj = j / blockSize;
+            for (i = 0; i < size; i++) {
+                bi = i / blockSize;
+                for (c = 0; c < channels; c++) coarse[(bj*grid + bi)*channels + c] += input[(j*size + i)*channels + c];
+            }
         }
+        coarse2 = 0;
+        for (i = 0; i < coarseNum; i++) coarse2 += (int64_t)coarse[i]*coarse[i];
+        residual = sqrt((double)((int64_t)sum*blockSize*blockSize - coarse2));
 
-        res1 = res2 = -1;
-        k = -1;
+        seed = -1;
         max = _0_0;
-        for ( l = 0; l < pattHandle->patt_num; l++ ) {
-            k++;
-            while ( pattHandle->pattf[k] == 0 ) k++;
-            if ( pattHandle->pattf[k] == 2 ) continue;
-            for ( j = 0; j < 4; j++ ) {
-                sum = 0;
-                for ( i=0; i < SIZE_SQD; i++ )
-                    sum += input[i] * (pattHandle->pattBW[k * 4 + j][i]);
-                sum2 = sum / pattHandle->pattpowBW[k * 4 + j] / datapow;
-                if ( sum2 > max ) { max = sum2; res1 = j; res2 = k; }
+        for ( l = 0; l < pattHandle->pattActiveNum; l++ ) {
+            k = pattHandle->pattActive[l];
+            for( j = 0; j < 4; j++ ) {
+                const ARInt32 *pc = &pattCoarse[(k*4 + j)*coarseNum];
+                coarseSum = 0;
+                for (i = 0; i < coarseNum; i++) coarseSum += (int64_t)coarse[i]*pc[i];
+                bound = ((double)coarseSum + residual*pattResidual[k*4 + j]) / (blockSize*blockSize) + 1.0;
+                scratch->bound[k*4 + j] = (ARdouble)bound / pattpow[k*4 + j] / datapow;
+                if (seed < 0 || scratch->bound[k*4 + j] > max) { max = scratch->bound[k*4 + j]; seed = k*4 + j; }
             }
         }
-        *dir  = res1;
-        *code = res2;
-        *cf   = max;
-
-        free( input );
-        return 0;
+        if (seed >= 0) {
+            sum = pattern_dot(input, &bank[seed*stride], stride);
+            sum2 = sum / pattpow[seed] / datapow;
+            if (sum2 > thresh) thresh = sum2;
+        }
     }
-    else {
-        return -1;
+
+    res1 = res2 = -1;
+    max = _0_0;
+    for ( l = 0; l < pattHandle->pattActiveNum; l++ ) { // Consider the whole search space (activated patterns only).
+        k = pattHandle->pattActive[l];
+        for( j = 0; j < 4; j++ ) { // The 4 rotated variants of the pattern.
+            if (prefilter && scratch->bound[k*4 + j] < thresh) continue; // Can't beat the seed.
+            sum = pattern_dot(input, &bank[(k*4 + j)*stride], stride); // Correlation operation.
+            sum2 = sum / pattpow[k*4 + j] / datapow;
+            // The active list isn't in slot order, so ties go to the lowest slot, as they did when slots were scanned in order.
+            if( sum2 > max || (sum2 == max && res2 >= 0 && k*4 + j < res2*4 + res1) ) { max = sum2; res1 = j; res2 = k; }
+        }
     }
+    *dir  = res1;
+    *code = res2;
+    *cf   = max;
+
+    return 0;
 }
 
-static int decode_bch(const AR_MATRIX_CODE_TYPE matrixCodeType, const uint64_t in, uint8_t recd127[127], uint64_t *out_p)
+// Dot product of two int16 vectors. n must be a multiple of 8.
+static int pattern_dot( const ARInt16 *a, const ARInt16 *b, int n )
 {
-    uint64_t in_bitwise;
-    uint8_t *recd;
-    uint64_t out_bit;
-    int t, n, length, k;
-    uint8_t recd64[64];
-    const int *alpha_to, *index_of;
-    const int bch_15_alpha_to[15] = {1, 2, 4, 8, 3, 6, 12, 11, 5, 10, 7, 14, 15, 13, 9};
-    const int bch_15_index_of[16] = {-1, 0, 1, 4, 2, 8, 5, 10, 3, 14, 9, 7, 6, 13, 11, 12};
-    const int bch_31_alpha_to[31] = {1, 2, 4, 8, 16, 5, 10, 20, 13, 26, 17, 7, 14, 28, 29, 31, 27, 19, 3, 6, 12, 24, 21, 15, 30, 25, 23, 11, 22, 9, 18};
-    const int bch_31_index_of[32] = {-1, 0, 1, 18, 2, 5, 19, 11, 3, 29, 6, 27, 20, 8, 12, 23, 4, 10, 30, 17, 7, 22, 28, 26, 21, 25, 9, 16, 13, 14, 24, 15};
-    const int bch_127_alpha_to[127] = {1, 2, 4, 8, 16, 32, 64, 3, 6, 12, 24, 48, 96, 67, 5, 10, 20, 40, 80, 35, 70, 15, 30, 60, 120, 115, 101, 73, 17, 34, 68, 11, 22, 44, 88, 51, 102, 79, 29, 58, 116, 107, 85, 41, 82, 39, 78, 31, 62, 124, 123, 117, 105, 81, 33, 66, 7, 14, 28, 56, 112, 99, 69, 9, 18, 36, 72, 19, 38, 76, 27, 54, 108, 91, 53, 106, 87, 45, 90, 55, 110, 95, 61, 122, 119, 109, 89, 49, 98, 71, 13, 26, 52, 104, 83, 37, 74, 23, 46, 92, 59, 118, 111, 93, 57, 114, 103, 77, 25, 50, 100, 75, 21, 42, 84, 43, 86, 47, 94, 63, 126, 127, 125, 121, 113, 97, 65};
-    const int bch_127_index_of[128] = {-1, 0, 1, 7, 2, 14, 8, 56, 3, 63, 15, 31, 9, 90, 57, 21, 4, 28, 64, 67, 16, 112, 32, 97, 10, 108, 91, 70, 58, 38, 22, 47, 5, 54, 29, 19, 65, 95, 68, 45, 17, 43, 113, 115, 33, 77, 98, 117, 11, 87, 109, 35, 92, 74, 71, 79, 59, 104, 39, 100, 23, 82, 48, 119, 6, 126, 55, 13, 30, 62, 20, 89, 66, 27, 96, 111, 69, 107, 46, 37, 18, 53, 44, 94, 114, 42, 116, 76, 34, 86, 78, 73, 99, 103, 118, 81, 12, 125, 88, 61, 110, 26, 36, 106, 93, 52, 75, 41, 72, 85, 80, 102, 60, 124, 105, 25, 40, 51, 101, 84, 24, 123, 83, 50, 49, 122, 120, 121};
-    int i, j, u, q, t2, count = 0, syn_error = 0;
-	int elp[20][18], d[20], l[20], u_lu[20], s[19], loc[127], reg[10]; // int elp[t2 + 2, t2], d[t2 + 2], l[t2 + 2], u_lu[t2 + 2], s[t2 + 1], loc[n], reg[t + 1].
-    
-    if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3 || matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7) {
-        if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3 || matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5) {
-            if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3) {
-                t = 1; k = 9;
-            } else { // matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5
-                t = 2; k = 5;
-            }
-            n = 15;
-            length = 13;
-            alpha_to = bch_15_alpha_to;
-            index_of = bch_15_index_of;
-        } else { // matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7
-            if (matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5) {
-                t = 2; k = 12;
-            } else { // matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7
-                t = 3; k = 7;
-            }
-            n = 31;
-            length = 22;
-            alpha_to = bch_31_alpha_to;
-            index_of = bch_31_index_of;
-        }
-        // Unpack input into recd64[]. recd64[0] is least significant bit.
-        in_bitwise = in;
-        for (i = 0; i < length; i++) {
-            recd64[i] = (uint8_t)(in_bitwise & 1);
-            in_bitwise = in_bitwise >> 1;
-        }
-        recd = recd64;
-    } else if (matrixCodeType == AR_MATRIX_CODE_GLOBAL_ID) {
-        t = 9; k = 64;
-        n = 127;
-        length = 120;
-        alpha_to = bch_127_alpha_to;
-        index_of = bch_127_index_of;
-        recd = recd127;
-    } else {
-#ifdef DEBUG_BCH
-        ARLOGe("Error: unsupported BCH code.\n");
-#endif
-        return (-1); // Unsupported code.
+    int i;
+#if HAVE_ARM_NEON || HAVE_ARM64_NEON
+    int32x4_t acc = vdupq_n_s32(0);
+    int64x2_t acc2;
+    for (i = 0; i < n; i += 8) {
+        int16x8_t va = vld1q_s16(a + i);
+        int16x8_t vb = vld1q_s16(b + i);
+        acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+        acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
     }
-    
-    
-    /*
-     * Simon Rockliff's implementation of Berlekamp's algorithm.
-     * Copyright (c) 1994-7,  Robert Morelos-Zaragoza. All rights reserved.
-     *
-     * Assume we have received bits in recd[i], i=0..(n-1).
-     *
-     * Compute the 2*t syndromes by substituting alpha^i into rec(X) and
-     * evaluating, storing the syndromes in s[i], i=1..2t (leave s[0] zero) .
-     * Then we use the Berlekamp algorithm to find the error location polynomial
-     * elp[i].
-     *
-     * If the degree of the elp is >t, then we cannot correct all the errors, and
-     * we have detected an uncorrectable error pattern. We output the information
-     * bits uncorrected.
-     *
-     * If the degree of elp is <=t, we substitute alpha^i , i=1..n into the elp
-     * to get the roots, hence the inverse roots, the error location numbers.
-     * This step is usually called "Chien's search".
-     *
-     * If the number of errors located is not equal the degree of the elp, then
-     * the decoder assumes that there are more than t errors and cannot correct
-     * them, only detect them. We output the information bits uncorrected.
-     *
-     * t = error correcting capability (max. no. of errors the code corrects)
-     * length = length of the BCH code
-     * n = 2**m - 1 = size of the multiplicative group of GF(2**m)
-     * alpha_to [] = log table of GF(2**m) 
-     * index_of[] = antilog table of GF(2**m)
-     * recd[] = coefficients of the received polynomial 
-     */
-	t2 = 2 * t;
-    
-	/* first form the syndromes */
-	for (i = 1; i <= t2; i++) {
-		s[i] = 0;
-		for (j = 0; j < length; j++) {
-			if (recd[j] != 0) s[i] ^= alpha_to[(i * j) % n];
-        }
-		if (s[i] != 0) syn_error = 1; /* set error flag if non-zero syndrome */
-		s[i] = index_of[s[i]]; /* convert syndrome from polynomial form to index form  */
-	}
-    
-	if (syn_error) {	/* if there are errors, try to correct them */
-		/*
-		 * Compute the error location polynomial via the Berlekamp
-		 * iterative algorithm. Following the terminology of Lin and
-		 * Costello's book :   d[u] is the 'mu'th discrepancy, where
-		 * u='mu'+1 and 'mu' (the Greek letter!) is the step number
-		 * ranging from -1 to 2*t (see L&C),  l[u] is the degree of
-		 * the elp at that step, and u_l[u] is the difference between
-		 * the step number and the degree of the elp. 
-		 */
-		/* initialise table entries */
-		d[0] = 0;			/* index form */
-		d[1] = s[1];		/* index form */
-		elp[0][0] = 0;		/* index form */
-		elp[1][0] = 1;		/* polynomial form */
-		for (i = 1; i < t2; i++) {
-			elp[0][i] = -1;	/* index form */
-			elp[1][i] = 0;	/* polynomial form */
-		}
-		l[0] = 0;
-		l[1] = 0;
-		u_lu[0] = -1;
-		u_lu[1] = 0;
-		u = 0;
-        
-		do {
-			u++;
-			if (d[u] == -1) {
-				l[u + 1] = l[u];
-				for (i = 0; i <= l[u]; i++) {
-					elp[u + 1][i] = elp[u][i];
-					elp[u][i] = index_of[elp[u][i]]; /* put elp into index form  */
-				}
-			} else {
-                /*
-                 * search for words with greatest u_lu[q] for
-                 * which d[q]!=0 
-                 */
-				q = u - 1;
-				while ((d[q] == -1) && (q > 0)) q--;
-				/* have found first non-zero d[q]  */
-				if (q > 0) {
-                    j = q;
-                    do {
-                        j--;
-                        if ((d[j] != -1) && (u_lu[q] < u_lu[j]))
-                            q = j;
-                    } while (j > 0);
-				}
-                
-				/*
-				 * have now found q such that d[u]!=0 and
-				 * u_lu[q] is maximum 
-				 */
-				/* store degree of new elp polynomial */
-				if (l[u] > l[q] + u - q) l[u + 1] = l[u];
-				else l[u + 1] = l[q] + u - q;
-                
-				/* form new elp(x) */
-				for (i = 0; i < t2; i++) elp[u + 1][i] = 0;
-				for (i = 0; i <= l[q]; i++) {
-					if (elp[q][i] != -1) elp[u + 1][i + u - q] = alpha_to[(d[u] + n - d[q] + elp[q][i]) % n];
-                }
-				for (i = 0; i <= l[u]; i++) {
-					elp[u + 1][i] ^= elp[u][i];
-					elp[u][i] = index_of[elp[u][i]]; /* put elp into index form  */
-				}
-			}
-			u_lu[u + 1] = u - l[u + 1];
-            
-			/* form (u+1)th discrepancy */
-			if (u < t2) {	
-                /* no discrepancy computed on last iteration */
-                if (s[u + 1] != -1) d[u + 1] = alpha_to[s[u + 1]];
-                else d[u + 1] = 0;
-			    for (i = 1; i <= l[u + 1]; i++) {
-                    if ((s[u + 1 - i] != -1) && (elp[u + 1][i] != 0)) d[u + 1] ^= alpha_to[(s[u + 1 - i] + index_of[elp[u + 1][i]]) % n];
-                }
-                d[u + 1] = index_of[d[u + 1]]; /* put d[u+1] into index form */
-			}
-		} while ((u < t2) && (l[u + 1] <= t));
-        
-		u++;
-		if (l[u] <= t) { /* Can correct errors */
-			for (i = 0; i <= l[u]; i++) elp[u][i] = index_of[elp[u][i]]; /* put elp into index form */
-            
-			/* Chien search: find roots of the error location polynomial */
-			for (i = 1; i <= l[u]; i++) reg[i] = elp[u][i];
-			count = 0;
-			for (i = 1; i <= n; i++) {
-				q = 1;
-				for (j = 1; j <= l[u]; j++) {
- 					if (reg[j] != -1) {
-						reg[j] = (reg[j] + j) % n;
-						q ^= alpha_to[reg[j]];
-					}
-                }
-				if (!q) {	/* store root and error
-                             * location number indices */
-					loc[count] = n - i; /* root[count] = i; */
-					count++;
-				}
-			}
-
-			if (count == l[u]){
-                /* no. roots = degree of elp hence <= t errors */
-				for (i = 0; i < l[u]; i++) recd[loc[i]] ^= 1;
-            } else	{
-                /* elp has degree >t hence cannot solve */
-#ifdef DEBUG_BCH
-                ARLOGe("count != l[u].\n");
-#endif
-                return (-1);
-            }
-		} else {
-#ifdef DEBUG_BCH
-            ARLOGe("l[u] > t.\n");
-#endif
-            return (-1);
-        }
-	} // End syn_error.
-    
-    // Pack the result into *out_p. Data bits begin with LSB at recd[length - k] through to MSB at recd[length - 1];
-    *out_p = 0LL;
-    out_bit = 1LL;
-    for (i = length - k; i < length; i++) {
-        *out_p += (uint64_t)recd[i] * out_bit;
-        out_bit <<= 1;
+    acc2 = vpaddlq_s32(acc);
+    return ((int)(vgetq_lane_s64(acc2, 0) + vgetq_lane_s64(acc2, 1)));
+#elif HAVE_INTEL_SIMD
+    __m128i acc = _mm_setzero_si128();
+    for (i = 0; i < n; i += 8) {
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
     }
-    
-    if (syn_error) return (l[u]);
-    else return (0);
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (_mm_cvtsi128_si32(acc));
+#else
+    int sum = 0;
+    for (i = 0; i < n; i++) sum += a[i]*b[i];
+    return (sum);
+#endif
 }
 
 //const signed char hamming63EncoderTable[8] = {0, 7, 25, 30, 42, 45, 51, 52};
@@ -2084,7 +1976,7 @@ const signed char parity65DecoderTable[64] = {
            ---
            0--
 ---------------------------*/
-static int get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir, ARdouble *cf, const AR_MATRIX_CODE_TYPE matrixCodeType, int *errorCorrected )
+static int get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir, ARdouble *cf, const AR_MATRIX_CODE_TYPE matrixCodeType, const ARPattHandle *pattHandle, int *errorCorrected )
 {
     ARUint8  max, min, thresh;
     ARUint8  dirCode[4];
@@ -2100,6 +1992,10 @@ static int get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir,
         return -1;
     }
 
+    if ((matrixCodeType & AR_MATRIX_CODE_TYPE_ECC_MASK) == AR_MATRIX_CODE_TYPE_ECC_DICTIONARY) {
+        return get_matrix_code_dictionary(data, size, code_out_p, dir, cf, pattHandle ? pattHandle->matrixCodeDictionary : NULL, errorCorrected);
+    }
+
 	// Look at corners of unwarped marker pattern space to work out threshhold.
     corner[0] = 0;
     corner[1] = (size - 1)*size;
@@ -2260,7 +2156,10 @@ static int get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir,
         }
     } else if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3 || matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5
                || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7) {
-        ret = decode_bch(matrixCodeType, codeRaw, NULL, &code);
+        // Use the pattern handle's lookup table if one has been built.
+        i = bchTableIndex(matrixCodeType);
+        if (pattHandle && pattHandle->bchTables[i]) ret = decode_bch_table(pattHandle->bchTables[i], codeRaw, &code);
+        else ret = decode_bch(matrixCodeType, codeRaw, NULL, &code);
         if (ret < 0) {
             *code_out_p = -1;
             *cf = -_1_0;
@@ -2276,6 +2175,58 @@ static int get_matrix_code( ARUint8 *data, int size, int *code_out_p, int *dir,
     return 0;
 }
 
+// Dictionary codewords have no locator corners, so the threshhold comes from all
+// cells, and the direction from whichever rotation of a codeword matches.
+static int get_matrix_code_dictionary( ARUint8 *data, int size, int *code_out_p, int *dir, ARdouble *cf, const ARMatrixCodeDictionary *dict, int *errorCorrected )
+{
+    ARUint8  max, min, thresh;
+    int      contrast, contrastMin;
+    int      i, errors;
+    uint64_t codeRaw;
+
+    if( !dict || arMatrixCodeDictionaryGetSize(dict) != size ) {
+        *code_out_p = -1;
+        *dir  = 0;
+        *cf   = -_1_0;
+        return -1;
+    }
+
+    max = 0;
+    min = 255;
+    for( i = 0; i < size*size; i++ ) {
+        if( data[i] > max ) max = data[i];
+        if( data[i] < min ) min = data[i];
+    }
+    if( max - min < AR_PATT_CONTRAST_THRESH2 ) {
+        *code_out_p = -1;
+        *dir  = 0;
+        *cf   = -_1_0;
+        return -2; // Insufficient contrast.
+    }
+    thresh = (max + min)/2;
+
+    contrastMin = 255;
+    codeRaw = 0LL;
+    for( i = 0; i < size*size; i++ ) {
+        contrast = data[i] - thresh;
+        if( contrast < 0 ) contrast = -contrast;
+        if( contrast < contrastMin ) contrastMin = contrast;
+        codeRaw <<= 1;
+        if( data[i] < thresh ) codeRaw++;
+    }
+    *cf = (contrastMin > 30)? _1_0: (ARdouble)contrastMin/_30_0;
+
+    if( arMatrixCodeDictionaryLookup(dict, codeRaw, code_out_p, dir, &errors) < 0 ) {
+        *code_out_p = -1;
+        *dir  = 0;
+        *cf   = -_1_0;
+        return (-4); // EDC fail.
+    }
+    if (errorCorrected && errors > 0) *errorCorrected = errors;
+
+    return 0;
+}
+
 static int get_global_id_code( ARUint8 *data, uint64_t *code_out_p, int *dir_p, ARdouble *cf, int *errorCorrected )
 {
     ARUint8  max, min, thresh;
@@ -52,6 +52,11 @@
 #include <string.h>
 #include <ARX/ARUtil/file_utils.h>
 
+static int pattSlotReserve(ARPattHandle *pattHandle);
+static void pattFreePush(ARPattHandle *pattHandle, int patno);
+static void pattFreePop(ARPattHandle *pattHandle);
+static void pattBankSet(ARPattHandle *pattHandle, int patno);
+
 int arPattLoadFromBuffer(ARPattHandle *pattHandle, const char *buffer) {
     
 	char   *bufCopy;
@@ -70,11 +75,8 @@ int arPattLoadFromBuffer(ARPattHandle *pattHandle, const char *buffer) {
         return (-1);
     }
 
-    for( i = 0; i < pattHandle->patt_num_max; i++ ) {
-        if(pattHandle->pattf[i] == 0) break;
-    }
-    if( i == pattHandle->patt_num_max ) return -1;
-    patno = i;
+    // The slot stays on the free list until the pattern has been read successfully.
+    if ((patno = pattSlotReserve(pattHandle)) < 0) return -1;
 
     if (!(bufCopy = strdup(buffer))) { // Make a mutable copy.
         ARLOGe("Error: out of memory.\n");
@@ -135,8 +137,12 @@ int arPattLoadFromBuffer(ARPattHandle *pattHandle, const char *buffer) {
 
     free(bufCopy);
 
+    pattBankSet(pattHandle, patno);
+    pattFreePop(pattHandle);
     pattHandle->pattf[patno] = 1;
     pattHandle->patt_num++;
+    pattHandle->pattActiveIndex[patno] = pattHandle->pattActiveNum;
+    pattHandle->pattActive[pattHandle->pattActiveNum++] = patno;
 
     return( patno );
 }
@@ -157,20 +163,41 @@ int arPattLoad(ARPattHandle *pattHandle, const char *filename)
     return (patno);
 }
 
+// Removes patno from the list of active patterns in O(1), by moving the last entry into its place.
+static void pattActiveRemove(ARPattHandle *pattHandle, int patno)
+{
+    int idx = pattHandle->pattActiveIndex[patno];
+    int last;
+
+    if (idx < 0) return;
+    last = pattHandle->pattActive[--pattHandle->pattActiveNum];
+    pattHandle->pattActive[idx] = last;
+    pattHandle->pattActiveIndex[last] = idx;
+    pattHandle->pattActiveIndex[patno] = -1;
+}
+
 int arPattFree( ARPattHandle *pattHandle, int patno )
 {
+    if( patno < 0 || patno >= pattHandle->pattCapacity ) return -1;
     if( pattHandle->pattf[patno] == 0 ) return -1;
 
+    pattActiveRemove(pattHandle, patno);
     pattHandle->pattf[patno] = 0;
     pattHandle->patt_num--;
+    pattFreePush(pattHandle, patno);
 
     return 1;
 }
 
 int arPattActivate( ARPattHandle *pattHandle, int patno )
 {
+    if( patno < 0 || patno >= pattHandle->pattCapacity ) return -1;
     if( pattHandle->pattf[patno] == 0 ) return -1;
 
+    if( pattHandle->pattActiveIndex[patno] < 0 ) {
+        pattHandle->pattActiveIndex[patno] = pattHandle->pattActiveNum;
+        pattHandle->pattActive[pattHandle->pattActiveNum++] = patno;
+    }
     pattHandle->pattf[patno] = 1;
 
     return 1;
@@ -178,9 +205,160 @@ int arPattActivate( ARPattHandle *pattHandle, int patno )
 
 int arPattDeactivate( ARPattHandle *pattHandle, int patno )
 {
+    if( patno < 0 || patno >= pattHandle->pattCapacity ) return -1;
     if( pattHandle->pattf[patno] == 0 ) return -1;
 
+    pattActiveRemove(pattHandle, patno);
     pattHandle->pattf[patno] = 2;
 
     return 1;
 }
+
+int arPattSetPrefilter( ARPattHandle *pattHandle, int enable )
+{
+    if (!pattHandle) return -1;
+
+    pattHandle->prefilter = enable;
+
+    return 0;
+}
+
+// The free list is a binary min-heap, so that (as when slots were scanned in order) a loaded pattern
+// always takes the lowest free slot, and pattern numbers don't depend on the order of earlier frees.
+static void pattFreePush(ARPattHandle *pattHandle, int patno)
+{
+    int *heap = pattHandle->pattFree;
+    int  i, parent;
+
+    for (i = pattHandle->pattFreeNum++; i > 0; i = parent) {
+        parent = (i - 1)/2;
+        if (heap[parent] <= patno) break;
+        heap[i] = heap[parent];
+    }
+    heap[i] = patno;
+}
+
+// Removes the lowest free slot from the free list.
+static void pattFreePop(ARPattHandle *pattHandle)
+{
+    int *heap = pattHandle->pattFree;
+    int  n, last, i, child;
+
+    n = --pattHandle->pattFreeNum;
+    if (n == 0) return;
+    last = heap[n];
+    for (i = 0; (child = 2*i + 1) < n; i = child) {
+        if (child + 1 < n && heap[child + 1] < heap[child]) child++;
+        if (last <= heap[child]) break;
+        heap[i] = heap[child];
+    }
+    heap[i] = last;
+}
+
+// Returns the slot the next loaded pattern will occupy (the lowest free slot), growing storage
+// geometrically up to patt_num_max when no free slot remains. Returns -1 if the store is full.
+static int pattSlotReserve(ARPattHandle *pattHandle)
+{
+    const int coarseNum = AR_PATT_PREFILTER_GRID*AR_PATT_PREFILTER_GRID;
+    const int size = pattHandle->pattSize;
+    int       capacity, oldCapacity;
+    int       i;
+
+    if (pattHandle->pattFreeNum == 0) {
+        oldCapacity = pattHandle->pattCapacity;
+        if (oldCapacity >= pattHandle->patt_num_max) return -1;
+        capacity = (oldCapacity < 8 ? 8 : oldCapacity*2);
+        if (capacity > pattHandle->patt_num_max) capacity = pattHandle->patt_num_max;
+
+#define PATT_REALLOC(field, type, count) \
+        { type *p = (type *)realloc(pattHandle->field, (count)*sizeof(type)); if (!p) goto bail; pattHandle->field = p; }
+        PATT_REALLOC(pattf, int, capacity);
+        PATT_REALLOC(patt, int *, capacity*4);
+        PATT_REALLOC(pattBW, int *, capacity*4);
+        PATT_REALLOC(pattpow, ARdouble, capacity*4);
+        PATT_REALLOC(pattpowBW, ARdouble, capacity*4);
+        PATT_REALLOC(pattBank, ARInt16, capacity*4*pattHandle->pattBankStride);
+        PATT_REALLOC(pattBankBW, ARInt16, capacity*4*pattHandle->pattBankStrideBW);
+        PATT_REALLOC(pattCoarse, ARInt32, capacity*4*coarseNum*3);
+        PATT_REALLOC(pattCoarseBW, ARInt32, capacity*4*coarseNum);
+        PATT_REALLOC(pattResidual, double, capacity*4);
+        PATT_REALLOC(pattResidualBW, double, capacity*4);
+        PATT_REALLOC(pattActive, int, capacity);
+        PATT_REALLOC(pattActiveIndex, int, capacity);
+        PATT_REALLOC(pattFree, int, capacity);
+#undef PATT_REALLOC
+
+        // Padding at the end of each bank entry must be zero, as the matcher reads whole vectors.
+        memset(&(pattHandle->pattBank[oldCapacity*4*pattHandle->pattBankStride]), 0, (capacity - oldCapacity)*4*pattHandle->pattBankStride*sizeof(ARInt16));
+        memset(&(pattHandle->pattBankBW[oldCapacity*4*pattHandle->pattBankStrideBW]), 0, (capacity - oldCapacity)*4*pattHandle->pattBankStrideBW*sizeof(ARInt16));
+        for (i = oldCapacity; i < capacity; i++) {
+            pattHandle->pattf[i] = 0;
+            pattHandle->patt[i*4] = pattHandle->patt[i*4 + 1] = pattHandle->patt[i*4 + 2] = pattHandle->patt[i*4 + 3] = NULL;
+            pattHandle->pattBW[i*4] = pattHandle->pattBW[i*4 + 1] = pattHandle->pattBW[i*4 + 2] = pattHandle->pattBW[i*4 + 3] = NULL;
+            pattHandle->pattActiveIndex[i] = -1;
+        }
+        // The free list is empty here, and ascending order is already a valid heap.
+        for (i = oldCapacity; i < capacity; i++) pattHandle->pattFree[pattHandle->pattFreeNum++] = i;
+        pattHandle->pattCapacity = capacity;
+    }
+
+    i = pattHandle->pattFree[0];
+    if (!pattHandle->patt[i*4]) {
+        int h;
+        for (h = 0; h < 4; h++) {
+            arMalloc(pattHandle->patt[i*4 + h], int, size*size*3);
+            arMalloc(pattHandle->pattBW[i*4 + h], int, size*size);
+        }
+    }
+    return (i);
+
+bail:
+    ARLOGe("Error: out of memory.\n");
+    return (-1);
+}
+
+// Computes block sums and residual norms of one orientation of a pattern, for the matching prefilter.
+// With block area n, block sums S_b and squared norm P, the residual n*P - sum(S_b^2) is exact in integers.
+static double pattCoarseSet(const int *patt, int size, int channels, ARInt32 *coarse)
+{
+    const int grid = AR_PATT_PREFILTER_GRID;
+    const int blockSize = size / grid;
+    int64_t   norm2, coarse2;
+    int       bi, bj, c, i, j, v;
+
+    memset(coarse, 0, grid*grid*channels*sizeof(ARInt32));
+    norm2 = 0;
+    for (j = 0; j < size; j++) {
+        bj = j / blockSize;
+        for (i = 0; i < size; i++) {
+            bi = i / blockSize;
+            for (c = 0; c < channels; c++) {
+                v = patt[(j*size + i)*channels + c];
+                coarse[(bj*grid + bi)*channels + c] += v;
+                norm2 += v*v;
+            }
+        }
+    }
+    coarse2 = 0;
+    for (i = 0; i < grid*grid*channels; i++) coarse2 += (int64_t)coarse[i]*coarse[i];
+
+    return (sqrt((double)(norm2*blockSize*blockSize - coarse2)));
+}
+
+// Copies the just-loaded pattern patno into the contiguous int16 bank, and computes its prefilter data.
+static void pattBankSet(ARPattHandle *pattHandle, int patno)
+{
+    const int size = pattHandle->pattSize;
+    const int coarseNum = AR_PATT_PREFILTER_GRID*AR_PATT_PREFILTER_GRID;
+    int       h, i, o;
+
+    for (h = 0; h < 4; h++) {
+        o = patno*4 + h;
+        for (i = 0; i < size*size*3; i++) pattHandle->pattBank[o*pattHandle->pattBankStride + i] = (ARInt16)pattHandle->patt[o][i];
+        for (i = 0; i < size*size; i++) pattHandle->pattBankBW[o*pattHandle->pattBankStrideBW + i] = (ARInt16)pattHandle->pattBW[o][i];
+        if (size % AR_PATT_PREFILTER_GRID == 0) {
+            pattHandle->pattResidual[o] = pattCoarseSet(pattHandle->patt[o], size, 3, &(pattHandle->pattCoarse[o*coarseNum*3]));
+            pattHandle->pattResidualBW[o] = pattCoarseSet(pattHandle->pattBW[o], size, 1, &(pattHandle->pattCoarseBW[o*coarseNum]));
+        }
+    }
+}
@@ -0,0 +1,273 @@
+/*
+ *  arRefineCorners.c
+ *  artoolkitX
+ *
+ *  This file is part of artoolkitX.
+ *
+ *  artoolkitX is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  artoolkitX is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with artoolkitX.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2018 Dan Bell & Philip Lamb.
+ *
+ *  Author(s): Dan Bell, Philip Lamb.
+ *
+ */
+
+#include "arRefineCorners.h"
+#include <math.h>
+#include <float.h>
+#if HAVE_ARM_NEON || HAVE_ARM64_NEON
+#  include <arm_neon.h>
+#elif HAVE_INTEL_SIMD
+#  include <emmintrin.h> // SSE2.
+#endif
+
+//#define DEBUG_REFINECORNERS
+
+// Iterative gradient-based refinement, as per OpenCV's cv::cornerSubPix() with winSize (5, 5),
+// no zero zone, and termination after 40 iterations or a step of less than 0.001 pixels.
+// Within the window, the image gradient at each pixel is orthogonal to the vector from the
+// corner to that pixel, so the corner is found as the least-squares solution of these constraints.
+#define REFINE_WIN          5                       // Half-size of the search window.
+#define REFINE_WIN_SIZE     (REFINE_WIN*2 + 1)      // Width and height of the search window.
+#define REFINE_PATCH_SIZE   (REFINE_WIN_SIZE + 2)   // Width and height of the sampled patch, which includes a border for gradients.
+#define REFINE_PATCH_STRIDE 16                      // Row stride of the sampled patch, so that 12 columns of gradients can be computed 4 at a time.
+#define REFINE_ITER_MAX     40
+#define REFINE_EPS          0.001f
+
+// Gaussian weights exp(-x*x/(REFINE_WIN*REFINE_WIN)) for x = -REFINE_WIN..REFINE_WIN, padded with 0 to 12 columns.
+static const float refineWeight[12] = {0.367879441f, 0.527292424f, 0.697676326f, 0.852143789f, 0.960789439f, 1.000000000f, 0.960789439f, 0.852143789f, 0.697676326f, 0.527292424f, 0.367879441f, 0.0f};
+static const float refineOffset[12] = {-5.0f, -4.0f, -3.0f, -2.0f, -1.0f, 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+
+// Fills patch with the bilinearly-interpolated image, with top-left sample at (x, y), replicating the image border.
+static void refineSamplePatch(float patch[REFINE_PATCH_SIZE][REFINE_PATCH_STRIDE], const unsigned char *buff, int width, int height, float x, float y)
+{
+    const int   ix = (int)floorf(x);
+    const int   iy = (int)floorf(y);
+    const float fx = x - (float)ix;
+    const float fy = y - (float)iy;
+    const float w00 = (1.0f - fx)*(1.0f - fy), w01 = fx*(1.0f - fy), w10 = (1.0f - fx)*fy, w11 = fx*fy;
+    const unsigned char *p0, *p1;
+    int   i, j, x0, x1, y0, y1;
+
+    if (ix >= 0 && iy >= 0 && ix + REFINE_PATCH_SIZE < width && iy + REFINE_PATCH_SIZE < height) {
+        for (i = 0; i < REFINE_PATCH_SIZE; i++) {
+            p0 = buff + (iy + i)*width + ix;
+            p1 = p0 + width;
+            for (j = 0; j < REFINE_PATCH_SIZE; j++) {
+                patch[i][j] = w00*p0[j] + w01*p0[j + 1] + w10*p1[j] + w11*p1[j + 1];
+            }
+        }
+    } else {
+        for (i = 0; i < REFINE_PATCH_SIZE; i++) {
+            y0 = iy + i;
+            y1 = y0 + 1;
+            if (y0 < 0) y0 = 0; else if (y0 >= height) y0 = height - 1;
+            if (y1 < 0) y1 = 0; else if (y1 >= height) y1 = height - 1;
+            p0 = buff + y0*width;
+            p1 = buff + y1*width;
+            for (j = 0; j < REFINE_PATCH_SIZE; j++) {
+                x0 = ix + j;
+                x1 = x0 + 1;
+                if (x0 < 0) x0 = 0; else if (x0 >= width) x0 = width - 1;
+                if (x1 < 0) x1 = 0; else if (x1 >= width) x1 = width - 1;
+                patch[i][j] = w00*p0[x0] + w01*p0[x1] + w10*p1[x0] + w11*p1[x1];
+            }
+        }
+    }
+}
+
+// Accumulates the normal equations of the corner constraints over the window, relative to the window centre.
+static void refineAccumulate(float patch[REFINE_PATCH_SIZE][REFINE_PATCH_STRIDE], double *a, double *b, double *c, double *bb1, double *bb2)
+{
+    int i;
+#if HAVE_ARM_NEON || HAVE_ARM64_NEON
+    float32x4_t va = vdupq_n_f32(0.0f), vb = va, vc = va, vbb1 = va, vbb2 = va;
+    float       s[5][4];
+    int         k;
+
+    for (i = 0; i < REFINE_WIN_SIZE; i++) {
+        const float32x4_t py = vdupq_n_f32((float)(i - REFINE_WIN));
+        for (k = 0; k < 12; k += 4) {
+            float32x4_t gx = vsubq_f32(vld1q_f32(&patch[i + 1][k + 2]), vld1q_f32(&patch[i + 1][k]));
+            float32x4_t gy = vsubq_f32(vld1q_f32(&patch[i + 2][k + 1]), vld1q_f32(&patch[i][k + 1]));
+            float32x4_t m = vmulq_n_f32(vld1q_f32(&refineWeight[k]), refineWeight[i]);
+            float32x4_t px = vld1q_f32(&refineOffset[k]);
+            float32x4_t gxx = vmulq_f32(vmulq_f32(gx, gx), m);
+            float32x4_t gxy = vmulq_f32(vmulq_f32(gx, gy), m);
+            float32x4_t gyy = vmulq_f32(vmulq_f32(gy, gy), m);
+            va = vaddq_f32(va, gxx);
+            vb = vaddq_f32(vb, gxy);
+            vc = vaddq_f32(vc, gyy);
+            vbb1 = vmlaq_f32(vmlaq_f32(vbb1, gxx, px), gxy, py);
+            vbb2 = vmlaq_f32(vmlaq_f32(vbb2, gxy, px), gyy, py);
+        }
+    }
+    vst1q_f32(s[0], va); vst1q_f32(s[1], vb); vst1q_f32(s[2], vc); vst1q_f32(s[3], vbb1); vst1q_f32(s[4], vbb2);
+    *a   = (double)s[0][0] + s[0][1] + s[0][2] + s[0][3];
+    *b   = (double)s[1][0] + s[1][1] + s[1][2] + s[1][3];
+    *c   = (double)s[2][0] + s[2][1] + s[2][2] + s[2][3];
+    *bb1 = (double)s[3][0] + s[3][1] + s[3][2] + s[3][3];
+    *bb2 = (double)s[4][0] + s[4][1] + s[4][2] + s[4][3];
+#elif HAVE_INTEL_SIMD
+    __m128 va = _mm_setzero_ps(), vb = va, vc = va, vbb1 = va, vbb2 = va;
+    float  s[5][4];
+    int    k;
+
+    for (i = 0; i < REFINE_WIN_SIZE; i++) {
+        const __m128 py = _mm_set1_ps((float)(i - REFINE_WIN));
+        const __m128 wy = _mm_set1_ps(refineWeight[i]);
+        for (k = 0; k < 12; k += 4) {
+            __m128 gx = _mm_sub_ps(_mm_loadu_ps(&patch[i + 1][k + 2]), _mm_loadu_ps(&patch[i + 1][k]));
+            __m128 gy = _mm_sub_ps(_mm_loadu_ps(&patch[i + 2][k + 1]), _mm_loadu_ps(&patch[i][k + 1]));
+            __m128 m = _mm_mul_ps(_mm_loadu_ps(&refineWeight[k]), wy);
+            __m128 px = _mm_loadu_ps(&refineOffset[k]);
+            __m128 gxx = _mm_mul_ps(_mm_mul_ps(gx, gx), m);
+            __m128 gxy = _mm_mul_ps(_mm_mul_ps(gx, gy), m);
+            __m128 gyy = _mm_mul_ps(_mm_mul_ps(gy, gy), m);
+            va = _mm_add_ps(va, gxx);
+            vb = _mm_add_ps(vb, gxy);
+            vc = _mm_add_ps(vc, gyy);
+            vbb1 = _mm_add_ps(vbb1, _mm_add_ps(_mm_mul_ps(gxx, px), _mm_mul_ps(gxy, py)));
+            vbb2 = _mm_add_ps(vbb2, _mm_add_ps(_mm_mul_ps(gxy, px), _mm_mul_ps(gyy, py)));
+        }
+    }
+    _mm_storeu_ps(s[0], va); _mm_storeu_ps(s[1], vb); _mm_storeu_ps(s[2], vc); _mm_storeu_ps(s[3], vbb1); _mm_storeu_ps(s[4], vbb2);
+    *a   = (double)s[0][0] + s[0][1] + s[0][2] + s[0][3];
+    *b   = (double)s[1][0] + s[1][1] + s[1][2] + s[1][3];
+    *c   = (double)s[2][0] + s[2][1] + s[2][2] + s[2][3];
+    *bb1 = (double)s[3][0] + s[3][1] + s[3][2] + s[3][3];
+    *bb2 = (double)s[4][0] + s[4][1] + s[4][2] + s[4][3];
+#else
+    float gx, gy, m, gxx, gxy, gyy, px, py;
+    int   j;
+
+    *a = *b = *c = *bb1 = *bb2 = 0.0;
+    for (i = 0; i < REFINE_WIN_SIZE; i++) {
+        py = (float)(i - REFINE_WIN);
+        for (j = 0; j < REFINE_WIN_SIZE; j++) {
+            px = refineOffset[j];
+            gx = patch[i + 1][j + 2] - patch[i + 1][j];
+            gy = patch[i + 2][j + 1] - patch[i][j + 1];
+            m = refineWeight[i]*refineWeight[j];
+            gxx = gx*gx*m;
+            gxy = gx*gy*m;
+            gyy = gy*gy*m;
+            *a += gxx;
+            *b += gxy;
+            *c += gyy;
+            *bb1 += gxx*px + gxy*py;
+            *bb2 += gxy*px + gyy*py;
+        }
+    }
+#endif
+}
+
+static void refineCorner(float *x, float *y, const unsigned char *buff, int width, int height)
+{
+    float  patch[REFINE_PATCH_SIZE][REFINE_PATCH_STRIDE];
+    float  cx = *x, cy = *y, nx, ny, err;
+    double a, b, c, bb1, bb2, det, scale;
+    int    i, j, iter;
+
+    // Columns beyond the patch are read (and weighted by 0) in the 12th gradient column.
+    for (i = 0; i < REFINE_PATCH_SIZE; i++) for (j = REFINE_PATCH_SIZE; j < REFINE_PATCH_STRIDE; j++) patch[i][j] = 0.0f;
+
+    for (iter = 0; iter < REFINE_ITER_MAX; iter++) {
+        refineSamplePatch(patch, buff, width, height, cx - (REFINE_WIN + 1), cy - (REFINE_WIN + 1));
+        refineAccumulate(patch, &a, &b, &c, &bb1, &bb2);
+        det = a*c - b*b;
+        if (fabs(det) <= DBL_EPSILON*DBL_EPSILON) break;
+        scale = 1.0/det;
+        nx = cx + (float)(c*scale*bb1 - b*scale*bb2);
+        ny = cy + (float)(a*scale*bb2 - b*scale*bb1);
+        err = (nx - cx)*(nx - cx) + (ny - cy)*(ny - cy);
+        cx = nx;
+        cy = ny;
+        if (cx < 0.0f || cx >= (float)width || cy < 0.0f || cy >= (float)height) break;
+        if (err <= REFINE_EPS*REFINE_EPS) break;
+    }
+
+    // Reject a corner which has wandered out of the window.
+    if (fabsf(cx - *x) > REFINE_WIN || fabsf(cy - *y) > REFINE_WIN) return;
+#ifdef DEBUG_REFINECORNERS
+    if ((fabsf(*x - cx) > 0.1f) || (fabsf(*y - cy) > 0.1f)) {
+        ARLOGd("arRefineCorners adjusted vertex from (%.1f, %.1f) to (%.1f, %.1f).\n", *x, *y, cx, cy);
+    }
+#endif
+    *x = cx;
+    *y = cy;
+}
+
+void arRefineCorners(float vertex[4][2], const unsigned char *buff, int width, int height)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (vertex[i][0] < 1.0f || vertex[i][0] >= (float)width || vertex[i][1] < 1.0f || vertex[i][1] >= (float)height) return;
+    }
+    for (i = 0; i < 4; i++) refineCorner(&vertex[i][0], &vertex[i][1], buff, width, height);
+}
+
+// As arParamObserv2IdealLTf() (if 'o2i' is set) or arParamIdeal2ObservLTf(), but interpolating bilinearly in the
+// lookup table rather than rounding to the nearest entry, so that subpixel positions survive.
+static int refineLTLookup(const ARParamLTf *paramLTf, int o2i, float x, float y, float *xOut, float *yOut)
+{
+    const float fx0 = floorf(x), fy0 = floorf(y);
+    const float fx = x - fx0, fy = y - fy0;
+    const int   px = (int)fx0 + paramLTf->xOff;
+    const int   py = (int)fy0 + paramLTf->yOff;
+    const float *lt, *p0, *p1;
+
+    // Compact tables interpolate already.
+    if (paramLTf->paramLTi) {
+        if (o2i) return arParamObserv2IdealLTf(paramLTf, x, y, xOut, yOut);
+        else     return arParamIdeal2ObservLTf(paramLTf, x, y, xOut, yOut);
+    }
+    if (px < 0 || px + 1 >= paramLTf->xsize || py < 0 || py + 1 >= paramLTf->ysize) return -1;
+
+    lt = o2i ? paramLTf->o2i : paramLTf->i2o;
+    p0 = lt + (py*paramLTf->xsize + px)*2;
+    p1 = p0 + paramLTf->xsize*2;
+    *xOut = (1.0f - fy)*((1.0f - fx)*p0[0] + fx*p0[2]) + fy*((1.0f - fx)*p1[0] + fx*p1[2]);
+    *yOut = (1.0f - fy)*((1.0f - fx)*p0[1] + fx*p0[3]) + fy*((1.0f - fx)*p1[1] + fx*p1[3]);
+    return 0;
+}
+
+void arRefineCornersMarker(ARMarkerInfo *markerInfo, const unsigned char *buff, int width, int height, ARParamLTf *arParamLTf)
+{
+    float obVertex[4][2];
+    float x, y;
+    int   i;
+
+    for (i = 0; i < 4; i++) {
+        if (refineLTLookup(arParamLTf, 0, (float)markerInfo->vertex[i][0], (float)markerInfo->vertex[i][1], &obVertex[i][0], &obVertex[i][1]) < 0) return;
+    }
+    arRefineCorners(obVertex, buff, width, height);
+    for (i = 0; i < 4; i++) {
+        if (refineLTLookup(arParamLTf, 1, obVertex[i][0], obVertex[i][1], &x, &y) < 0) continue;
+        markerInfo->vertex[i][0] = (ARdouble)x;
+        markerInfo->vertex[i][1] = (ARdouble)y;
+    }
+}
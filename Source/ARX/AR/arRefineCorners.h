@@ -47,6 +47,14 @@ extern "C" {
 // buff is a luma-only buffer of dimensions width x height.
 void arRefineCorners(float vertex[4][2], const unsigned char *buff, int width, int height);
 
+// As arRefineCorners(), for the vertices of markerInfo, which are in ideal coordinates.
+void arRefineCornersMarker(ARMarkerInfo *markerInfo, const unsigned char *buff, int width, int height, ARParamLTf *arParamLTf);
+
+// Refines the vertices of each marker in markerInfo which was not cut off during matching,
+// sharing the markers out between the threads of 'threads' (which may be NULL).
+// Implemented in arGetMarkerInfo.c, alongside the threads.
+int arRefineCornersParallel(ARMarkerInfo *markerInfo, int marker_num, const unsigned char *buff, int width, int height, ARParamLTf *arParamLTf, ARMarkerInfoThreads *threads);
+
 #ifdef __cplusplus
 }
 #endif
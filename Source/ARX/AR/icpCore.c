@@ -41,6 +41,15 @@
 #include <math.h>
 #include <ARX/AR/ar.h>
 #include <ARX/AR/icpCore.h>
+#ifndef ARDOUBLE_IS_FLOAT
+#  if HAVE_ARM64_NEON
+#    include <arm_neon.h>
+#    define ICP_SIMD_NEON
+#  elif HAVE_INTEL_SIMD
+#    include <emmintrin.h> // SSE2.
+#    define ICP_SIMD_SSE2
+#  endif
+#endif
 
 #ifdef ARDOUBLE_IS_FLOAT
 #  define SQRT sqrtf
@@ -198,6 +207,161 @@ int icpGetDeltaS( ARdouble S[6], ARdouble dU[], ARdouble J_U_S[][6], int n )
     return 0;
 }
 
+/*
+ *  Accumulates J^T J and J^T dU over num points, as icpGetJ_U_S() and icpGetDeltaS() would
+ *  from the 2*num x 6 Jacobian J of the projections of worldCoord[], but without forming J.
+ *  Each point's pair of Jacobian rows (and residuals dU[2*i], dU[2*i+1]) is scaled by W[i],
+ *  if W is non-NULL. Points with W[i] == 0 add nothing and are skipped.
+ *  Sums are accumulated in the same order as the matrix product, so the results agree to rounding;
+ *  they are identical only where the compiler does not contract multiply-adds into fused ones.
+ */
+int icpGetJtJ_JtU( ARdouble JtJ[6][6], ARdouble JtU[6], ARdouble matXc2U[3][4], ARdouble matXw2Xc[3][4],
+                   ICP3DCoordT worldCoord[], ARdouble dU[], ARdouble W[], int num )
+{
+    ARdouble   J[2][6];
+    ARdouble   J_Xc_S[3][6];
+    ARdouble   J_U_Xc[2][3];
+    ARdouble   Xw, Yw, Zw, Xc, Yc, Zc;
+    ARdouble   w1, w2, w3, w3_w3;
+    ARdouble   du[2];
+    int        p, i, j, k;
+#if defined(ICP_SIMD_SSE2)
+    __m128d    acc[6][3], accU[3], b;
+#elif defined(ICP_SIMD_NEON)
+    float64x2_t acc[6][3], accU[3], b;
+#endif
+
+#if defined(ICP_SIMD_SSE2)
+    for( i = 0; i < 6; i++ ) acc[i][0] = acc[i][1] = acc[i][2] = _mm_setzero_pd();
+    accU[0] = accU[1] = accU[2] = _mm_setzero_pd();
+#elif defined(ICP_SIMD_NEON)
+    for( i = 0; i < 6; i++ ) acc[i][0] = acc[i][1] = acc[i][2] = vdupq_n_f64(0.0);
+    accU[0] = accU[1] = accU[2] = vdupq_n_f64(0.0);
+#else
+    for( i = 0; i < 6; i++ ) {
+        for( j = i; j < 6; j++ ) JtJ[i][j] = 0.0;
+        JtU[i] = 0.0;
+    }
+#endif
+
+    for( p = 0; p < num; p++ ) {
+        if( W && W[p] == 0.0 ) continue;
+
+        // J_Xc_S, as the product in icpGetJ_Xc_S() with its non-zero terms only.
+        Xw = worldCoord[p].x;
+        Yw = worldCoord[p].y;
+        Zw = worldCoord[p].z;
+        Xc = matXw2Xc[0][0]*Xw + matXw2Xc[0][1]*Yw + matXw2Xc[0][2]*Zw + matXw2Xc[0][3];
+        Yc = matXw2Xc[1][0]*Xw + matXw2Xc[1][1]*Yw + matXw2Xc[1][2]*Zw + matXw2Xc[1][3];
+        Zc = matXw2Xc[2][0]*Xw + matXw2Xc[2][1]*Yw + matXw2Xc[2][2]*Zw + matXw2Xc[2][3];
+        for( j = 0; j < 3; j++ ) {
+            J_Xc_S[j][0] = -(matXw2Xc[j][1] * Zw) + matXw2Xc[j][2] * Yw;
+            J_Xc_S[j][1] =   matXw2Xc[j][0] * Zw  - matXw2Xc[j][2] * Xw;
+            J_Xc_S[j][2] = -(matXw2Xc[j][0] * Yw) + matXw2Xc[j][1] * Xw;
+            J_Xc_S[j][3] =   matXw2Xc[j][0];
+            J_Xc_S[j][4] =   matXw2Xc[j][1];
+            J_Xc_S[j][5] =   matXw2Xc[j][2];
+        }
+
+        // J_U_Xc, as icpGetJ_U_Xc().
+        w1 = matXc2U[0][0] * Xc + matXc2U[0][1] * Yc + matXc2U[0][2] * Zc + matXc2U[0][3];
+        w2 = matXc2U[1][0] * Xc + matXc2U[1][1] * Yc + matXc2U[1][2] * Zc + matXc2U[1][3];
+        w3 = matXc2U[2][0] * Xc + matXc2U[2][1] * Yc + matXc2U[2][2] * Zc + matXc2U[2][3];
+        if( w3 == 0.0 ) return -1;
+        w3_w3 = w3 * w3;
+        for( k = 0; k < 3; k++ ) {
+            J_U_Xc[0][k] = (matXc2U[0][k] * w3 - matXc2U[2][k] * w1) / w3_w3;
+            J_U_Xc[1][k] = (matXc2U[1][k] * w3 - matXc2U[2][k] * w2) / w3_w3;
+        }
+
+        for( j = 0; j < 2; j++ ) {
+            for( i = 0; i < 6; i++ ) {
+                J[j][i] = J_U_Xc[j][0] * J_Xc_S[0][i] + J_U_Xc[j][1] * J_Xc_S[1][i] + J_U_Xc[j][2] * J_Xc_S[2][i];
+            }
+            du[j] = dU[p*2+j];
+        }
+        if( W ) {
+            for( j = 0; j < 2; j++ ) {
+                for( i = 0; i < 6; i++ ) J[j][i] *= W[p];
+                du[j] *= W[p];
+            }
+        }
+
+        // Add the two rows' outer products, first row first.
+        for( j = 0; j < 2; j++ ) {
+#if defined(ICP_SIMD_SSE2)
+            for( k = 0; k < 3; k++ ) {
+                b = _mm_loadu_pd(&J[j][k*2]);
+                for( i = 0; i < 6; i++ ) acc[i][k] = _mm_add_pd(acc[i][k], _mm_mul_pd(_mm_set1_pd(J[j][i]), b));
+                accU[k] = _mm_add_pd(accU[k], _mm_mul_pd(b, _mm_set1_pd(du[j])));
+            }
+#elif defined(ICP_SIMD_NEON)
+            for( k = 0; k < 3; k++ ) {
+                b = vld1q_f64(&J[j][k*2]);
+                for( i = 0; i < 6; i++ ) acc[i][k] = vaddq_f64(acc[i][k], vmulq_f64(vdupq_n_f64(J[j][i]), b)); // Separate multiply and add, which may round differently to a contracted scalar product.
+                accU[k] = vaddq_f64(accU[k], vmulq_f64(b, vdupq_n_f64(du[j])));
+            }
+#else
+            for( i = 0; i < 6; i++ ) {
+                for( k = i; k < 6; k++ ) JtJ[i][k] += J[j][i] * J[j][k];
+                JtU[i] += J[j][i] * du[j];
+            }
+#endif
+        }
+    }
+
+#if defined(ICP_SIMD_SSE2) || defined(ICP_SIMD_NEON)
+    for( i = 0; i < 6; i++ ) {
+        for( k = 0; k < 3; k++ ) {
+#  if defined(ICP_SIMD_SSE2)
+            _mm_storeu_pd(&JtJ[i][k*2], acc[i][k]);
+#  else
+            vst1q_f64(&JtJ[i][k*2], acc[i][k]);
+#  endif
+        }
+    }
+    for( k = 0; k < 3; k++ ) {
+#  if defined(ICP_SIMD_SSE2)
+        _mm_storeu_pd(&JtU[k*2], accU[k]);
+#  else
+        vst1q_f64(&JtU[k*2], accU[k]);
+#  endif
+    }
+#else
+    for( i = 1; i < 6; i++ ) {
+        for( j = 0; j < i; j++ ) JtJ[i][j] = JtJ[j][i];
+    }
+#endif
+
+    return 0;
+}
+
+/*
+ *  Solves (J^T J) S = J^T dU for S, as icpGetDeltaS() does, from the sums accumulated by
+ *  icpGetJtJ_JtU(). JtJ is overwritten with its inverse.
+ */
+int icpGetDeltaS_from_JtJ( ARdouble S[6], ARdouble JtJ[6][6], ARdouble JtU[6] )
+{
+    ARMat   matS, matJtJ, matJtU;
+
+    matS.row = 6;
+    matS.clm = 1;
+    matS.m   = S;
+
+    matJtJ.row = 6;
+    matJtJ.clm = 6;
+    matJtJ.m   = &JtJ[0][0];
+
+    matJtU.row = 6;
+    matJtU.clm = 1;
+    matJtU.m   = JtU;
+
+    if( arMatrixSelfInv(&matJtJ) < 0 ) return -1;
+    arMatrixMul( &matS, &matJtJ, &matJtU );
+
+    return 0;
+}
+
 int icpUpdateMat( ARdouble matXw2Xc[3][4], ARdouble dS[6] )
 {
     ARdouble   q[7];
@@ -61,6 +61,8 @@ ICPHandleT  *icpCreateHandle( const ARdouble matXc2U[3][4] )
     handle->breakLoopErrorRatioThresh = ICP_BREAK_LOOP_ERROR_RATIO_THRESH;
     handle->breakLoopErrorThresh2     = ICP_BREAK_LOOP_ERROR_THRESH2;
     handle->inlierProb                = ICP_INLIER_PROBABILITY;
+    handle->work                      = NULL;
+    handle->pointNumMax               = 0;
 
     return handle;
 }
@@ -69,6 +71,7 @@ int icpDeleteHandle( ICPHandleT **handle )
 {
     if( *handle == NULL ) return -1;
 
+    free( (*handle)->work );
     free( *handle );
     *handle = NULL;
 
@@ -183,3 +186,25 @@ int icpGetInlierProbability( ICPHandleT *handle, ARdouble *inlierProb )
     *inlierProb = handle->inlierProb;
     return 0;
 }
+
+/*
+ *  Make room in the handle's scratch space for at least pointNumMax points, so that
+ *  icpPoint() and icpPointRobust() need not allocate. The space only ever grows, and
+ *  is also grown as needed by those functions.
+ */
+int icpSetPointNumMax( ICPHandleT *handle, int pointNumMax )
+{
+    ARdouble  *work;
+
+    if( handle == NULL || pointNumMax < 0 ) return -1;
+    if( pointNumMax <= handle->pointNumMax ) return 0;
+
+    work = (ARdouble *)realloc( handle->work, sizeof(ARdouble)*ICP_WORK_PER_POINT*pointNumMax );
+    if( work == NULL ) {
+        ARLOGe("Error: malloc\n");
+        return -1;
+    }
+    handle->work = work;
+    handle->pointNumMax = pointNumMax;
+    return 0;
+}
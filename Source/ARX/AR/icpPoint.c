@@ -44,8 +44,6 @@
 #include <ARX/AR/icp.h>
 
 
-static void   icpGetXw2XcCleanup( char *message, ARdouble *J_U_S, ARdouble *dU );
-
 int icpPoint( ICPHandleT   *handle,
               ICPDataT     *data,
               ARdouble        initMatXw2Xc[3][4],
@@ -53,24 +51,18 @@ int icpPoint( ICPHandleT   *handle,
               ARdouble       *err )
 {
     ICP2DCoordT   U;
-    ARdouble        *J_U_S;
     ARdouble        *dU, dx, dy;
     ARdouble         matXw2U[3][4];
+    ARdouble         JtJ[6][6], JtU[6];
     ARdouble         dS[6];
     ARdouble         err0, err1;
     int           i, j;
 
     if( data->num < 3 ) return -1;
 
-    if( (J_U_S = (ARdouble *)malloc( sizeof(ARdouble)*12*(data->num) )) == NULL ) {
-        ARLOGe("Error: malloc\n");
-        return -1;
-    }
-    if( (dU = (ARdouble *)malloc( sizeof(ARdouble)*2*(data->num) )) == NULL ) {
-        ARLOGe("Error: malloc\n");
-        free(J_U_S);
-        return -1;
-    }
+    if( icpSetPointNumMax( handle, data->num ) < 0 ) return -1;
+    dU = handle->work;
+
     for( j = 0; j < 3; j++ ) {
         for( i = 0; i < 4; i++ ) matXw2Xc[j][i] = initMatXw2Xc[j][i];
     }
@@ -84,7 +76,7 @@ int icpPoint( ICPHandleT   *handle,
         err1 = 0.0;
         for( j = 0; j < data->num; j++ ) {
             if( icpGetU_from_X_by_MatX2U( &U, matXw2U, &(data->worldCoord[j]) ) < 0 ) {
-                icpGetXw2XcCleanup("icpGetU_from_X_by_MatX2U", J_U_S, dU);
+                ARLOGd("Error: icpGetU_from_X_by_MatX2U\n");
                 return -1;
             }
             dx = data->screenCoord[j].x - U.x;
@@ -102,17 +94,15 @@ int icpPoint( ICPHandleT   *handle,
         if( i == handle->maxLoop ) break;
         err0 = err1;
 
-        for( j = 0; j < data->num; j++ ) {
-            if( icpGetJ_U_S( (ARdouble (*)[6])(&J_U_S[12*j]), handle->matXc2U, matXw2Xc, &(data->worldCoord[j]) ) < 0 ) {
-                icpGetXw2XcCleanup("icpGetJ_U_S", J_U_S, dU);
-                return -1;
-            }
+        if( icpGetJtJ_JtU( JtJ, JtU, handle->matXc2U, matXw2Xc, data->worldCoord, dU, NULL, data->num ) < 0 ) {
+            ARLOGd("Error: icpGetJtJ_JtU\n");
+            return -1;
+        }
 #if ICP_DEBUG
-            icpDispMat( "J_U_S", (ARdouble *)(&J_U_S[j*12]), 2, 6 );
+        icpDispMat( "JtJ", &(JtJ[0][0]), 6, 6 );
 #endif
-        }
-        if( icpGetDeltaS( dS, dU, (ARdouble (*)[6])J_U_S, (data->num)*2 ) < 0 ) {
-            icpGetXw2XcCleanup("icpGetDeltaS", J_U_S, dU);
+        if( icpGetDeltaS_from_JtJ( dS, JtJ, JtU ) < 0 ) {
+            ARLOGd("Error: icpGetDeltaS\n");
             return -1;
         }
 
@@ -125,15 +115,6 @@ int icpPoint( ICPHandleT   *handle,
 #endif
 
     *err = err1;
-    free(J_U_S);
-    free(dU);
 
     return 0;
 }
-
-static void icpGetXw2XcCleanup( char *message, ARdouble *J_U_S, ARdouble *dU )
-{
-    ARLOGd("Error: %s\n", message);
-    free(J_U_S);
-    free(dU);
-}
@@ -48,8 +48,7 @@
 #define     K2_FACTOR     4.0f
 #endif
 
-static void   icpGetXw2XcCleanup( char *message, ARdouble *J_U_S, ARdouble *dU, ARdouble *E, ARdouble *E2 );
-static int    compE(const void *a, const void *b );
+static ARdouble icpSelect( ARdouble *a, int n, int k );
 
 int icpPointRobust( ICPHandleT   *handle,
                     ICPDataT     *data,
@@ -58,10 +57,10 @@ int icpPointRobust( ICPHandleT   *handle,
                     ARdouble       *err )
 {
     ICP2DCoordT   U;
-    ARdouble       *J_U_S;
     ARdouble       *dU, dx, dy;
-    ARdouble       *E, *E2, K2, W;
+    ARdouble       *E, *E2, *W, K2;
     ARdouble        matXw2U[3][4];
+    ARdouble        JtJ[6][6], JtU[6];
     ARdouble        dS[6];
     ARdouble        err0, err1;
     int           inlierNum;
@@ -72,28 +71,12 @@ int icpPointRobust( ICPHandleT   *handle,
     inlierNum = (int)(data->num * handle->inlierProb) - 1;
     if( inlierNum < 3 ) inlierNum = 3;
 
-    if( (J_U_S = (ARdouble *)malloc( sizeof(ARdouble)*12*(data->num) )) == NULL ) {
-        ARLOGe("Error: malloc\n");
-        return -1;
-    }
-    if( (dU = (ARdouble *)malloc( sizeof(ARdouble)*2*(data->num) )) == NULL ) {
-        ARLOGe("Error: malloc\n");
-        free(J_U_S);
-        return -1;
-    }
-    if( (E = (ARdouble *)malloc( sizeof(ARdouble)*(data->num) )) == NULL ) {
-        ARLOGe("Error: malloc\n");
-        free(J_U_S);
-        free(dU);
-        return -1;
-    }
-    if( (E2 = (ARdouble *)malloc( sizeof(ARdouble)*(data->num) )) == NULL ) {
-        ARLOGe("Error: malloc\n");
-        free(J_U_S);
-        free(dU);
-        free(E);
-        return -1;
-    }
+    if( icpSetPointNumMax( handle, data->num ) < 0 ) return -1;
+    dU    = handle->work;
+    E     = &(handle->work[2*(data->num)]);
+    E2    = &(handle->work[3*(data->num)]);
+    W     = E2; // Reused once K2 is known.
+
     for( j = 0; j < 3; j++ ) {
         for( i = 0; i < 4; i++ ) matXw2Xc[j][i] = initMatXw2Xc[j][i];
     }
@@ -107,7 +90,7 @@ int icpPointRobust( ICPHandleT   *handle,
 
         for( j = 0; j < data->num; j++ ) {
             if( icpGetU_from_X_by_MatX2U( &U, matXw2U, &(data->worldCoord[j]) ) < 0 ) {
-                icpGetXw2XcCleanup("icpGetU_from_X_by_MatX2U",J_U_S,dU,E,E2);
+                ARLOGd("Error: icpGetU_from_X_by_MatX2U\n");
                 return -1;
             }
             dx = data->screenCoord[j].x - U.x;
@@ -116,14 +99,13 @@ int icpPointRobust( ICPHandleT   *handle,
             dU[j*2+1] = dy;
             E[j] = E2[j] = dx*dx + dy*dy;
         }
-        qsort(E2, data->num, sizeof(ARdouble), compE);
-        K2 = E2[inlierNum] * K2_FACTOR;
+        K2 = icpSelect(E2, data->num, inlierNum) * K2_FACTOR;
         if( K2 < 16.0 ) K2 = 16.0;
 
         err1 = 0.0;
         for( j = 0; j < data->num; j++ ) {
-            if( E2[j] > K2 ) err1 += K2/6.0;
-            else err1 += K2/6.0 * (1.0 - (1.0-E2[j]/K2)*(1.0-E2[j]/K2)*(1.0-E2[j]/K2));
+            if( E[j] > K2 ) err1 += K2/6.0;
+            else err1 += K2/6.0 * (1.0 - (1.0-E[j]/K2)*(1.0-E[j]/K2)*(1.0-E[j]/K2));
         }
         err1 /= data->num;
 #if ICP_DEBUG
@@ -139,39 +121,27 @@ int icpPointRobust( ICPHandleT   *handle,
         k = 0;
         for( j = 0; j < data->num; j++ ) {
             if( E[j] <= K2 ) {
-                if( icpGetJ_U_S( (ARdouble (*)[6])(&J_U_S[6*k]), handle->matXc2U, matXw2Xc, &(data->worldCoord[j]) ) < 0 ) {
-                    icpGetXw2XcCleanup("icpGetJ_U_S", J_U_S, dU, E, E2);
-                    return -1;
-                }
-#if ICP_DEBUG
-                icpDispMat( "J_U_S", (ARdouble *)(&J_U_S[6*k]), 2, 6 );
-#endif
-                W = (1.0 - E[j]/K2)*(1.0 - E[j]/K2);
-                J_U_S[k*6+0] *= W;
-                J_U_S[k*6+1] *= W;
-                J_U_S[k*6+2] *= W;
-                J_U_S[k*6+3] *= W;
-                J_U_S[k*6+4] *= W;
-                J_U_S[k*6+5] *= W;
-                J_U_S[k*6+6] *= W;
-                J_U_S[k*6+7] *= W;
-                J_U_S[k*6+8] *= W;
-                J_U_S[k*6+9] *= W;
-                J_U_S[k*6+10] *= W;
-                J_U_S[k*6+11] *= W;
-                dU[k+0] = dU[j*2+0] * W;
-                dU[k+1] = dU[j*2+1] * W;
+                W[j] = (1.0 - E[j]/K2)*(1.0 - E[j]/K2);
                 k+=2;
+            } else {
+                W[j] = 0.0;
             }
         }
 
         if( k < 6 ) {
-            icpGetXw2XcCleanup("icpPointRobust: k < 6",J_U_S,dU,E,E2);
+            ARLOGd("Error: icpPointRobust: k < 6\n");
             return -1;
         }
 
-        if( icpGetDeltaS( dS, dU, (ARdouble (*)[6])J_U_S, k ) < 0 ) {
-            icpGetXw2XcCleanup("icpGetDeltaS",J_U_S,dU,E,E2);
+        if( icpGetJtJ_JtU( JtJ, JtU, handle->matXc2U, matXw2Xc, data->worldCoord, dU, W, data->num ) < 0 ) {
+            ARLOGd("Error: icpGetJtJ_JtU\n");
+            return -1;
+        }
+#if ICP_DEBUG
+        icpDispMat( "JtJ", &(JtJ[0][0]), 6, 6 );
+#endif
+        if( icpGetDeltaS_from_JtJ( dS, JtJ, JtU ) < 0 ) {
+            ARLOGd("Error: icpGetDeltaS\n");
             return -1;
         }
 
@@ -184,28 +154,44 @@ int icpPointRobust( ICPHandleT   *handle,
 #endif
 
     *err = err1;
-    free(J_U_S);
-    free(dU);
-    free(E);
-    free(E2);
 
     return 0;
 }
 
-static void icpGetXw2XcCleanup( char *message, ARdouble *J_U_S, ARdouble *dU, ARdouble *E, ARdouble *E2 )
-{
-    ARLOGd("Error: %s\n", message);
-    free(J_U_S);
-    free(dU);
-    free(E);
-    free(E2);
-}
-
-static int compE( const void *a, const void *b )
+/*
+ *  Returns the k-th smallest of the n values in a (counting from 0), i.e. the value
+ *  a[k] would have were a sorted, in O(n) time. The order of a is not preserved.
+ */
+static ARdouble icpSelect( ARdouble *a, int n, int k )
 {
-    ARdouble  c;
-    c = *(ARdouble *)a - *(ARdouble *)b;
-    if( c < 0.0 ) return -1;
-    if( c > 0.0 ) return  1;
-    return 0;
+    ARdouble  pivot, t;
+    int       l, r, i, j;
+
+    l = 0;
+    r = n - 1;
+    while( r > l ) {
+        // Median of three as pivot, leaving a[l] <= a[(l+r)/2] <= a[r].
+        i = (l + r) / 2;
+        if( a[i] < a[l] ) { t = a[i]; a[i] = a[l]; a[l] = t; }
+        if( a[r] < a[l] ) { t = a[r]; a[r] = a[l]; a[l] = t; }
+        if( a[r] < a[i] ) { t = a[r]; a[r] = a[i]; a[i] = t; }
+        pivot = a[i];
+
+        i = l;
+        j = r;
+        while( i <= j ) {
+            while( a[i] < pivot ) i++;
+            while( pivot < a[j] ) j--;
+            if( i <= j ) {
+                t = a[i]; a[i] = a[j]; a[j] = t;
+                i++;
+                j--;
+            }
+        }
+        // Now a[l..j] <= pivot <= a[i..r], and any of a[j+1..i-1] equal pivot.
+        if( k <= j ) r = j;
+        else if( k >= i ) l = i;
+        else break;
+    }
+    return a[k];
 }
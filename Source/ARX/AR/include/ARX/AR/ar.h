@@ -196,10 +196,11 @@ typedef enum {
     AR_MARKER_INFO_CUTOFF_PHASE_MATCH_CONFIDENCE,       ///< Matching confidence cutoff value not reached.
     AR_MARKER_INFO_CUTOFF_PHASE_POSE_ERROR,             ///< Maximum allowable pose error exceeded.
     AR_MARKER_INFO_CUTOFF_PHASE_POSE_ERROR_MULTI,       ///< Multi-marker pose error value exceeded.
-    AR_MARKER_INFO_CUTOFF_PHASE_HEURISTIC_TROUBLESOME_MATRIX_CODES ///< Heuristic-based rejection of troublesome matrix code which is often generated in error.
+    AR_MARKER_INFO_CUTOFF_PHASE_HEURISTIC_TROUBLESOME_MATRIX_CODES, ///< Heuristic-based rejection of troublesome matrix code which is often generated in error.
+    AR_MARKER_INFO_CUTOFF_PHASE_STEREO_MISMATCH         ///< Identity differs from that of the marker in the other stereo camera whose epipolar band was searched.
 } AR_MARKER_INFO_CUTOFF_PHASE;
 
-#define AR_MARKER_INFO_CUTOFF_PHASE_DESCRIPTION_COUNT 10
+#define AR_MARKER_INFO_CUTOFF_PHASE_DESCRIPTION_COUNT 11
 AR_EXTERN extern const char *arMarkerInfoCutoffPhaseDescriptions[AR_MARKER_INFO_CUTOFF_PHASE_DESCRIPTION_COUNT];
 
 /*!
@@ -257,8 +258,51 @@ typedef struct {
     int             work2[AR_LABELING_WORK_SIZE*7]; ///< area, pos[2], clip[4].
 } ARLabelInfo;
 
+/*!
+    @brief   Opaque structure holding the worker threads and per-band state for band-parallel labeling.
+    @see arLabelingBandsInit
+    @see arLabelingBands
+ */
+typedef struct _ARLabelingBandsInfo ARLabelingBandsInfo;
+
+/*!
+    @brief   Opaque structure holding the worker threads and per-candidate results for parallel marker decoding.
+    @see arMarkerInfoThreadsInit
+    @see arGetMarkerInfoParallel
+ */
+typedef struct _ARMarkerInfoThreads ARMarkerInfoThreads;
+
+/*!
+    @brief   Opaque structure holding the worker threads and per-pass buffers for concurrent auto-threshold bracketing.
+    @see arBracketingThreadsInit
+    @see arSetLabelingThreshAutoBracketingMode
+ */
+typedef struct _ARBracketingThreads ARBracketingThreads;
+
 /* --------------------------------------------------*/
 
+/*!
+    @brief   Opaque structure holding a lookup table for decoding one of the BCH matrix code types.
+    @see arPattCreateHandle2
+*/
+typedef struct _ARMatrixCodeBCHTable ARMatrixCodeBCHTable;
+
+#define AR_MATRIX_CODE_BCH_TABLE_NUM 4 ///< Number of matrix code types (the 4x4 and 5x5 BCH codes) decoded by lookup table.
+
+/*!
+    @brief   Opaque structure holding a user-supplied dictionary of matrix codewords.
+    @see arMatrixCodeDictionaryLoad
+    @see arPattAttachMatrixCodeDictionary
+*/
+typedef struct _ARMatrixCodeDictionary ARMatrixCodeDictionary;
+
+#define AR_MATRIX_CODE_DICTIONARY_SIZE_MIN 4            ///< Smallest codeword size of a matrix code dictionary, as for AR_MATRIX_CODE_4x4_DICTIONARY.
+#define AR_MATRIX_CODE_DICTIONARY_SIZE_MAX 7            ///< Largest codeword size of a matrix code dictionary, as for AR_MATRIX_CODE_7x7_DICTIONARY.
+// Creating a dictionary compares every pair of codewords, and a marker that does not exactly match a codeword
+// is compared with every rotation of every codeword, so the maximum is kept to the scale of ArUco-style
+// dictionaries. At the maximum, creation takes about 0.1 seconds on a desktop CPU.
+#define AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX 4096     ///< Maximum number of codewords in a matrix code dictionary.
+
 /*!
     @brief   A structure which holds descriptions of trained patterns for template matching.
     @details Template (picture)-based pattern matching requires details of the pattern
@@ -268,6 +312,7 @@ typedef struct {
 typedef struct {
     int             patt_num;       ///< Number of valid patterns in the structure.
     int             patt_num_max;   ///< Maximum number of patterns that may be loaded in this structure.
+    int             pattCapacity;   ///< Number of pattern slots currently allocated. Grows on demand, up to patt_num_max. All per-slot arrays below have this many slots.
     int            *pattf;          ///< 0 = no pattern loaded at this position. 1 = pattern loaded and activated. 2 = pattern loaded but deactivated.
     int           **patt;           ///< Array of 4 different orientations of each pattern's colour values, in 1-byte per component BGR order.
     ARdouble       *pattpow;        ///< Root-mean-square of the pattern intensities.
@@ -275,8 +320,32 @@ typedef struct {
     ARdouble       *pattpowBW;      ///< Root-mean-square of the pattern intensities.
     //ARdouble        pattRatio;      ///< 
     int             pattSize;       ///< Number of rows/columns in the pattern.
+    ARInt16        *pattBank;       ///< Contiguous int16 copy of patt used for matching. Orientation i starts at element i*pattBankStride.
+    ARInt16        *pattBankBW;     ///< Contiguous int16 copy of pattBW used for matching. Orientation i starts at element i*pattBankStrideBW.
+    int             pattBankStride; ///< pattSize*pattSize*3, rounded up to a multiple of 8 elements (16 bytes). Padding is zero.
+    int             pattBankStrideBW; ///< pattSize*pattSize, rounded up to a multiple of 8 elements (16 bytes). Padding is zero.
+    int             prefilter;      ///< If non-zero, matching first bounds each correlation from block sums, and skips patterns which cannot win. See arPattSetPrefilter().
+    ARInt32        *pattCoarse;     ///< Block sums of each orientation of patt, AR_PATT_PREFILTER_GRID^2 * 3 per orientation.
+    ARInt32        *pattCoarseBW;   ///< Block sums of each orientation of pattBW, AR_PATT_PREFILTER_GRID^2 per orientation.
+    double         *pattResidual;   ///< For each orientation of patt, sqrt of (block area * squared norm of patt less its block means).
+    double         *pattResidualBW; ///< As pattResidual, for pattBW.
+    int            *pattActive;     ///< Slot numbers of the activated patterns, in no particular order. Matching iterates only these.
+    int             pattActiveNum;  ///< Number of entries in pattActive.
+    int            *pattActiveIndex; ///< For each slot, its position in pattActive, or -1 if no activated pattern is at that slot.
+    int            *pattFree;       ///< Free slots, as a binary min-heap, so that the lowest (pattFree[0]) is used next.
+    int             pattFreeNum;    ///< Number of entries in pattFree.
+    ARMatrixCodeBCHTable *bchTables[AR_MATRIX_CODE_BCH_TABLE_NUM]; ///< Syndrome lookup tables for decoding the BCH matrix code types, or NULL until a handle it is attached to uses that type.
+    ARMatrixCodeDictionary *matrixCodeDictionary; ///< Dictionary used to decode the AR_MATRIX_CODE_*_DICTIONARY matrix code types, or NULL if none. Not owned by the pattern handle. See arPattAttachMatrixCodeDictionary().
 } ARPattHandle;
 
+/*!
+    @brief   Opaque structure holding working buffers for pattern extraction and matching.
+    @details Passing one of these to arPattGetIDGlobalWithScratch avoids a heap allocation
+        per marker candidate. A scratch structure may only be used by one thread at a time.
+    @see arPattScratchCreate
+*/
+typedef struct _ARPattScratch ARPattScratch;
+
 /*!
     @brief Defines a pattern rectangle as a sub-portion of a marker image.
     @details A complete marker image has coordinates {0.0f, 0.0f, 1.0f, 1.0f}.
@@ -313,6 +382,8 @@ extern "C" {
 #define AR_MATRIX_CODE_TYPE_ECC_BCH___9 0x00000600 ///< BCH code with Hamming distance of 9.
 #define AR_MATRIX_CODE_TYPE_ECC_BCH___11 0x00000700 ///< BCH code with Hamming distance of 11.
 #define AR_MATRIX_CODE_TYPE_ECC_BCH___19 0x00000b00 ///< BCH code with Hamming distance of 19.
+#define AR_MATRIX_CODE_TYPE_ECC_DICTIONARY 0x00000f00 ///< Codewords looked up in a user-supplied dictionary.
+#define AR_MATRIX_CODE_TYPE_ECC_MASK 0x0000ff00   ///< Mask value, bitwise-OR with matrix code type to find ECC algorithm.
 
 /*!
     @brief Values specifying the type of matrix code in use.
@@ -328,7 +399,11 @@ typedef enum {
     AR_MATRIX_CODE_5x5_BCH_22_7_7 = 0x05 | AR_MATRIX_CODE_TYPE_ECC_BCH___7,     ///< Matrix code in range 0-127.
     AR_MATRIX_CODE_5x5 = 0x05,                                                  ///< Matrix code in range 0-4194303.
     AR_MATRIX_CODE_6x6 = 0x06,                                                  ///< Matrix code in range 0-8589934591.
-    AR_MATRIX_CODE_GLOBAL_ID = 0x0e | AR_MATRIX_CODE_TYPE_ECC_BCH___19
+    AR_MATRIX_CODE_GLOBAL_ID = 0x0e | AR_MATRIX_CODE_TYPE_ECC_BCH___19,
+    AR_MATRIX_CODE_4x4_DICTIONARY = 0x04 | AR_MATRIX_CODE_TYPE_ECC_DICTIONARY,  ///< Matrix code in range 0 to (number of codewords in the attached dictionary - 1).
+    AR_MATRIX_CODE_5x5_DICTIONARY = 0x05 | AR_MATRIX_CODE_TYPE_ECC_DICTIONARY,  ///< Matrix code in range 0 to (number of codewords in the attached dictionary - 1).
+    AR_MATRIX_CODE_6x6_DICTIONARY = 0x06 | AR_MATRIX_CODE_TYPE_ECC_DICTIONARY,  ///< Matrix code in range 0 to (number of codewords in the attached dictionary - 1).
+    AR_MATRIX_CODE_7x7_DICTIONARY = 0x07 | AR_MATRIX_CODE_TYPE_ECC_DICTIONARY   ///< Matrix code in range 0 to (number of codewords in the attached dictionary - 1).
 } AR_MATRIX_CODE_TYPE;
 
 /*!
@@ -373,6 +448,22 @@ typedef struct {
     ARdouble           areaMax;
     ARdouble           areaMin;
     ARdouble           squareFitThresh;
+    int                arLabelingThreadCount;
+    ARLabelingBandsInfo *arLabelingBandsInfo;               ///< Non-NULL when arLabelingThreadCount > 1.
+    int                arMarkerInfoThreadCount;
+    ARMarkerInfoThreads *arMarkerInfoThreads;               ///< Decoding threads and pattern scratch buffers.
+    int                arROITrackingMode;                   ///< To query this value, call arGetROITrackingMode(). To set this value, call arSetROITrackingMode().
+    int                arROITrackingFullScanInterval;       ///< To query this value, call arGetROITrackingFullScanInterval(). To set this value, call arSetROITrackingFullScanInterval().
+    int                arROITrackingFullScanTTL;            ///< Number of frames remaining before the next full-frame scan.
+    int                arROINum;                            ///< Number of windows to be searched in the next frame.
+    int                arROI[AR_SQUARE_MAX][4];             ///< Windows to be searched in the next frame, as {x0, y0, x1, y1} in observed image coordinates, x1 and y1 exclusive. Windows do not overlap.
+    int                arROIMarkerNum;                      ///< Number of identified markers from which the windows were derived.
+    ARUint8           *arWindowImage;                       ///< Working buffer into which each window's luma is copied for labeling. Non-NULL when arROITrackingMode is AR_ROI_TRACKING_ENABLE or arImageProcMode is a pyramid mode.
+    ARUint8           *arPyramidImage;                      ///< Decimated luma image. Non-NULL when arImageProcMode is a pyramid mode.
+    ARdouble           pyramidAreaMax;                      ///< To query this value, call arGetPyramidAreaMax(). To set this value, call arSetPyramidAreaMax().
+    ARdouble           pyramidAreaMin;                      ///< To query this value, call arGetPyramidAreaMin(). To set this value, call arSetPyramidAreaMin().
+    int                arLabelingThreshAutoBracketingMode;  ///< To query this value, call arGetLabelingThreshAutoBracketingMode(). To set this value, call arSetLabelingThreshAutoBracketingMode().
+    ARBracketingThreads *arBracketingThreads;               ///< Non-NULL when arLabelingThreshMode is AR_LABELING_THRESH_MODE_AUTO_BRACKETING and arLabelingThreshAutoBracketingMode is not AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL.
 } ARHandle;
 
 
@@ -506,6 +597,61 @@ AR_EXTERN void arSetLabelingMode(ARHandle *handle, int mode);
 */
 AR_EXTERN int arGetLabelingMode(ARHandle *handle);
 
+/*!
+    @brief   Set the number of threads used for labeling.
+    @details
+        With a thread count greater than 1, the labeling stage of arDetectMarker
+        splits the image into horizontal bands, labels each band on its own thread,
+        and then merges labels across the seams between bands. The resulting regions
+        (area, centroid and clip rectangle) are identical to those of the serial labeler.
+        This is worthwhile for large images on machines with several cores; for small
+        images, the cost of synchronising the threads outweighs the gain.
+    @param      handle An ARHandle referring to the current AR tracker
+		to have its labeling thread count set.
+    @param      threadCount Number of threads to use, between 1 and AR_LABELING_THREAD_MAX,
+        or AR_LABELING_THREAD_COUNT_AUTO to use one thread per online CPU.
+        The default is AR_LABELING_THREAD_COUNT_DEFAULT (1, serial labeling).
+    @see arGetLabelingThreadCount
+ */
+AR_EXTERN void arSetLabelingThreadCount(ARHandle *handle, int threadCount);
+
+/*!
+    @brief   Get the number of threads used for labeling.
+    @details See discussion for arSetLabelingThreadCount.
+    @param      handle An ARHandle referring to the current AR tracker
+		to be queried for its labeling thread count.
+    @result     The number of threads in use, 1 if labeling is serial.
+    @see arSetLabelingThreadCount
+*/
+AR_EXTERN int arGetLabelingThreadCount(ARHandle *handle);
+
+/*!
+    @brief   Set the number of threads used to decode marker candidates.
+    @details
+        With a thread count greater than 1, arDetectMarker unwarps and matches
+        (or decodes) the candidate squares found in each frame on a pool of threads.
+        Results are identical to, and in the same order as, those of serial decoding.
+        This is worthwhile when many markers are visible at once, particularly
+        with large pattern sets or matrix code types needing error correction.
+    @param      handle An ARHandle referring to the current AR tracker
+		to have its marker decoding thread count set.
+    @param      threadCount Number of threads to use, between 1 and AR_MARKER_INFO_THREAD_MAX,
+        or AR_MARKER_INFO_THREAD_COUNT_AUTO to use one thread per online CPU.
+        The default is AR_MARKER_INFO_THREAD_COUNT_DEFAULT (1, serial decoding).
+    @see arGetMarkerInfoThreadCount
+ */
+AR_EXTERN void arSetMarkerInfoThreadCount(ARHandle *handle, int threadCount);
+
+/*!
+    @brief   Get the number of threads used to decode marker candidates.
+    @details See discussion for arSetMarkerInfoThreadCount.
+    @param      handle An ARHandle referring to the current AR tracker
+		to be queried for its marker decoding thread count.
+    @result     The number of threads in use, 1 if decoding is serial.
+    @see arSetMarkerInfoThreadCount
+*/
+AR_EXTERN int arGetMarkerInfoThreadCount(ARHandle *handle);
+
 /*!
     @brief   Set the labeling threshhold.
     @details
@@ -614,6 +760,37 @@ AR_EXTERN void arSetLabelingThreshModeAutoInterval(ARHandle *handle, const int i
  */
 AR_EXTERN int arGetLabelingThreshModeAutoInterval(const ARHandle *handle);
 
+/*!
+    @brief   Set how the three passes of auto-threshold bracketing are run.
+    @details
+        In AR_LABELING_THRESH_MODE_AUTO_BRACKETING, each bracketing frame is searched
+        for markers at three thresholds: above, below, and at the current threshold.
+        With AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL (the default), the passes run one
+        after another. With AR_LABELING_THRESH_AUTO_BRACKETING_THREADED, the passes above
+        and below the current threshold run on two worker threads, each with its own
+        labeling and decoding buffers, while the calling thread runs the pass at the current
+        threshold. AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS additionally labels the
+        image at all three thresholds in one sweep (see arLabelingMulti()) before the passes
+        extract and decode squares concurrently.
+        The resulting thresholds and detected markers are the same in all modes.
+        In debug mode, and in the pyramid image processing modes, passes run serially.
+    @param      handle An ARHandle referring to the current AR tracker.
+    @param      mode One of AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL,
+        AR_LABELING_THRESH_AUTO_BRACKETING_THREADED or AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS.
+    @see arGetLabelingThreshAutoBracketingMode
+ */
+AR_EXTERN void arSetLabelingThreshAutoBracketingMode(ARHandle *handle, int mode);
+
+/*!
+    @brief   Get how the three passes of auto-threshold bracketing are run.
+    @details See arSetLabelingThreshAutoBracketingMode() for more info.
+    @param      handle An ARHandle referring to the current AR tracker.
+    @result     One of AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL,
+        AR_LABELING_THRESH_AUTO_BRACKETING_THREADED or AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS.
+    @see arSetLabelingThreshAutoBracketingMode
+ */
+AR_EXTERN int arGetLabelingThreshAutoBracketingMode(ARHandle *handle);
+
 AR_EXTERN void arSetLabelingThreshAutoAdaptiveKernelSize(ARHandle *handle, const int labelingThreshAutoAdaptiveKernelSize);
 
 AR_EXTERN int arGetLabelingThreshAutoAdaptiveKernelSize(ARHandle *handle);
@@ -636,12 +813,26 @@ AR_EXTERN int arGetLabelingThreshAutoAdaptiveBias(ARHandle *handle);
         The effective reduction by 75% in the pixels processed also
         has utility in accelerating tracking by effectively reducing
         the image size to one quarter size, at the cost of pose accuraccy.
+
+        When the mode is AR_IMAGE_PROC_PYRAMID_2X or AR_IMAGE_PROC_PYRAMID_4X,
+        labeling and contour extraction first run on a copy of the image
+        reduced 2x or 4x in each dimension, to find regions which may be
+        markers. Only these regions are then labeled at full resolution, so
+        the resulting contours, and the marker edges fitted to them, have
+        full-resolution accuracy. This suits large images in which markers
+        occupy many pixels. Markers must be large enough to survive the
+        reduction: the area limits of the reduced-image search are set
+        separately, with arSetPyramidAreaMin() and arSetPyramidAreaMax().
+        In debug mode, pyramid modes label the whole image at full
+        resolution.
 	@param      handle An ARHandle referring to the current AR tracker
 		to have its mode set.
     @param      mode
 		Options for this field are:
 		AR_IMAGE_PROC_FRAME_IMAGE
 		AR_IMAGE_PROC_FIELD_IMAGE
+		AR_IMAGE_PROC_PYRAMID_2X
+		AR_IMAGE_PROC_PYRAMID_4X
 		The default mode is AR_IMAGE_PROC_FRAME_IMAGE.
     @see arGetImageProcMode
  */
@@ -713,7 +904,15 @@ AR_EXTERN int arGetPatternDetectionMode(ARHandle *handle);
         AR_MATRIX_CODE_4x4_BCH_13_5_5
         AR_MATRIX_CODE_5x5_BCH_22_12_5
         AR_MATRIX_CODE_5x5_BCH_22_7_7
+        AR_MATRIX_CODE_4x4_DICTIONARY
+        AR_MATRIX_CODE_5x5_DICTIONARY
+        AR_MATRIX_CODE_6x6_DICTIONARY
+        AR_MATRIX_CODE_7x7_DICTIONARY
         The default mode is AR_MATRIX_CODE_3x3.
+        The AR_MATRIX_CODE_*_DICTIONARY types decode nothing until a dictionary of the
+        same size is attached to the ARPattHandle, see arPattAttachMatrixCodeDictionary().
+        Selecting one of the BCH types builds the attached ARPattHandle's lookup table for it,
+        if not already built, so this should not be called while markers are being detected.
     @see arSetPatternDetectionMode
     @see arGetMatrixCodeType
  */
@@ -841,15 +1040,39 @@ AR_EXTERN void arSetSquareFitThresh(ARHandle *handle, const ARdouble squareFitTh
 
 AR_EXTERN ARdouble arGetSquareFitThresh(ARHandle *handle);
 
+/*!
+    @brief   Set the maximum area of candidate regions in the reduced image in pyramid modes.
+    @details See arSetImageProcMode() for more info. The area is in full-resolution pixels.
+        The default is AR_PYRAMID_AREA_MAX. arSetAreaMax() still applies to the
+        full-resolution regions.
+    @see arGetPyramidAreaMax
+ */
+AR_EXTERN void arSetPyramidAreaMax(ARHandle *handle, const ARdouble areaMax);
+
+AR_EXTERN ARdouble arGetPyramidAreaMax(ARHandle *handle);
+
+/*!
+    @brief   Set the minimum area of candidate regions in the reduced image in pyramid modes.
+    @details See arSetImageProcMode() for more info. The area is in full-resolution pixels.
+        The default is AR_PYRAMID_AREA_MIN. arSetAreaMin() still applies to the
+        full-resolution regions.
+    @see arGetPyramidAreaMin
+ */
+AR_EXTERN void arSetPyramidAreaMin(ARHandle *handle, const ARdouble areaMin);
+
+AR_EXTERN ARdouble arGetPyramidAreaMin(ARHandle *handle);
+
 /*!
     @brief   Enable or disable square tracking subpixel corner refinement.
-    @details If compiled with OpenCV available, the square tracker allows
-        marker corner locations to be subpixel-refined.
+    @details When enabled, the corner locations of every marker found by
+        arDetectMarker() are subpixel-refined by fitting to the image gradients
+        around each corner. Markers are refined on the marker info threads
+        (see arSetMarkerInfoThreadCount()).
     @param      handle Handle to settings structure in which to enable or disable subpixel corner refinement.
 	@param      mode
 		Options for this field are:
 		AR_CORNER_REFINEMENT_DISABLE
-		AR_CORNER_REFINEMENT_ENSABLE
+		AR_CORNER_REFINEMENT_ENABLE
 		The default mode is AR_CORNER_REFINEMENT_DISABLE.
     @see arGetCornerRefinementMode
 */
@@ -865,6 +1088,65 @@ AR_EXTERN void arSetCornerRefinementMode(ARHandle *handle, int mode);
 */
 AR_EXTERN int arGetCornerRefinementMode(ARHandle *handle);
 
+/*!
+    @brief   Enable or disable region-of-interest tracking.
+    @details When enabled, once markers have been identified, arDetectMarker()
+        labels and searches only windows around the markers identified in the
+        previous frame, rather than the whole frame. Each window is the marker's
+        bounding box, extended on each side by AR_ROI_TRACKING_MARGIN times the
+        box's larger side (and by at least AR_ROI_TRACKING_MARGIN_MIN pixels).
+        Overlapping windows are merged.
+
+        The whole frame is still scanned when no marker was identified in the
+        previous frame, when a window search identifies fewer markers than the
+        previous frame did (in which case the same frame is rescanned), and at
+        least every arGetROITrackingFullScanInterval() + 1 frames, so that new
+        markers are found.
+
+        Window searches use the current labeling threshold. Automatic
+        thresholds (median and Otsu modes) are recalculated only on full-frame
+        scans. Windows are not used in debug mode or in the adaptive and
+        bracketing threshold modes, where every frame is scanned in full.
+    @param      handle Handle to settings structure in which to enable or disable region-of-interest tracking.
+    @param      mode
+		Options for this field are:
+		AR_ROI_TRACKING_DISABLE
+		AR_ROI_TRACKING_ENABLE
+		The default mode is AR_ROI_TRACKING_DISABLE.
+    @see arGetROITrackingMode
+    @see arSetROITrackingFullScanInterval
+*/
+AR_EXTERN void arSetROITrackingMode(ARHandle *handle, int mode);
+
+/*!
+    @brief   Find out whether region-of-interest tracking is enabled.
+    @details See arSetROITrackingMode() for more info.
+    @param      handle An ARHandle referring to the current AR tracker
+		to be queried for its mode.
+    @result Value representing the mode.
+    @see arSetROITrackingMode
+*/
+AR_EXTERN int arGetROITrackingMode(ARHandle *handle);
+
+/*!
+    @brief   Set the maximum number of consecutive frames searched by window only.
+    @details See arSetROITrackingMode() for more info.
+    @param      handle Handle to settings structure.
+    @param      interval Number of frames, >= 0. With 0, every frame is
+        scanned in full. The default is AR_ROI_TRACKING_FULL_SCAN_INTERVAL_DEFAULT.
+    @see arGetROITrackingFullScanInterval
+*/
+AR_EXTERN void arSetROITrackingFullScanInterval(ARHandle *handle, int interval);
+
+/*!
+    @brief   Get the maximum number of consecutive frames searched by window only.
+    @details See arSetROITrackingMode() for more info.
+    @param      handle Handle to settings structure.
+    @result The interval.
+    @see arSetROITrackingFullScanInterval
+*/
+AR_EXTERN int arGetROITrackingFullScanInterval(ARHandle *handle);
+
 
 /*!
     @brief   Detect markers in a video frame.
@@ -894,6 +1176,31 @@ AR_EXTERN int arGetCornerRefinementMode(ARHandle *handle);
  */
 AR_EXTERN int arDetectMarker(ARHandle *arHandle, AR2VideoBufferT *frame);
 
+/*!
+    @brief   Detect markers in windows of a video frame only.
+    @details
+        As arDetectMarker(), but only the given windows of the frame are labeled, at full
+        resolution and at the current labeling threshold (arGetLabelingThresh()). Tracking
+        history and ROI tracking are applied and updated as by arDetectMarker(). This is intended for
+        guided searches, such as of the epipolar bands of markers found in the other camera of
+        a stereo pair (see arGetStereoEpipolarWindow()).
+
+        If 'expected' is non-NULL, each window has a marker which is expected to be found in
+        it, and markers found are only accepted as identified if their identity (pattern
+        and/or matrix ID) matches that of the expected marker of a window containing their
+        centre. Others are rejected with cutoffPhase AR_MARKER_INFO_CUTOFF_PHASE_STEREO_MISMATCH.
+    @param      arHandle Handle to initialised settings. See arDetectMarker().
+    @param      frame Pointer to the video frame. See arDetectMarker().
+    @param      win Windows to search, as {x0, y0, x1, y1} in observed image coordinates, x1 and y1
+        exclusive. Windows may overlap; overlapping windows are merged before searching.
+    @param      expected If non-NULL, an array of winNum pointers to the marker expected in each window.
+    @param      winNum Number of windows, up to AR_SQUARE_MAX.
+    @result     0 if the function proceeded without error, or a value less than 0 in case of error.
+    @see arDetectMarker
+    @see arGetStereoEpipolarWindow
+ */
+AR_EXTERN int arDetectMarkerInWindows(ARHandle *arHandle, AR2VideoBufferT *frame, int win[][4], const ARMarkerInfo *expected[], int winNum);
+
 /*!
     @brief   Get the number of markers detected in a video frame.
     @result     The number of detected markers in the most recent image passed to arDetectMarker.
@@ -923,9 +1230,78 @@ AR_EXTERN ARMarkerInfo  *arGetMarker( ARHandle *arHandle );
 AR_EXTERN int            arLabeling( ARUint8 *imageLuma, int xsize, int ysize,
                            int debugMode, int labelingMode, int labelingThresh, int imageProcMode,
                            ARLabelInfo *labelInfo, ARUint8 *image_thresh );
+
+/*!
+    @brief   Label an image at several thresholds in a single pass.
+    @details
+        Produces in each labelInfo[i] the same result as arLabeling with debugMode
+        AR_DEBUG_DISABLE and labelingThresh[i], but reads each row of the image once only.
+    @param      labelingThresh Array of threshNum thresholds.
+    @param      threshNum Number of thresholds, between 1 and AR_LABELING_MULTI_THRESH_MAX.
+    @param      labelInfo Array of threshNum ARLabelInfo, each with a labelImage of the required size.
+    @result     0 if successful, -1 in case of error.
+    @see arLabeling
+ */
+AR_EXTERN int            arLabelingMulti( ARUint8 *imageLuma, int xsize, int ysize,
+                           int labelingMode, const int *labelingThresh, int threshNum, int imageProcMode,
+                           ARLabelInfo **labelInfo );
+
+/*!
+    @brief   Create the worker threads for band-parallel labeling.
+    @param      threadNum Number of bands (and threads, including the calling thread) to label with,
+        between 2 and AR_LABELING_THREAD_MAX.
+    @result     A new ARLabelingBandsInfo, or NULL in case of error.
+    @see arLabelingBands
+    @see arLabelingBandsFinal
+ */
+AR_EXTERN ARLabelingBandsInfo *arLabelingBandsInit( int threadNum );
+
+/*!
+    @brief   Stop the worker threads and free an ARLabelingBandsInfo.
+    @param      bandsInfo_p Location of the pointer returned by arLabelingBandsInit. Set to NULL on return.
+    @result     0 if successful, -1 in case of error.
+ */
+AR_EXTERN int            arLabelingBandsFinal( ARLabelingBandsInfo **bandsInfo_p );
+
+/*!
+    @brief   Get the number of threads of an ARLabelingBandsInfo.
+    @result     The number of threads, or 1 if bandsInfo is NULL.
+ */
+AR_EXTERN int            arLabelingBandsGetThreadNum( const ARLabelingBandsInfo *bandsInfo );
+
+/*!
+    @brief   Label an image in horizontal bands on parallel threads.
+    @details
+        Takes the same parameters as arLabeling, and produces identical label_num,
+        area, pos and clip results in labelInfo. Provisional labels in labelInfo->labelImage
+        may differ, but map through labelInfo->work to the same final labels.
+        Falls back to arLabeling if bandsInfo is NULL, if the image is too small to be
+        worth splitting, or if the bands together run out of provisional labels.
+    @param      bandsInfo Handle returned by arLabelingBandsInit, or NULL.
+    @result     0 if successful, -1 in case of error.
+    @see arLabeling
+ */
+AR_EXTERN int            arLabelingBands( ARUint8 *imageLuma, int xsize, int ysize,
+                           int debugMode, int labelingMode, int labelingThresh, int imageProcMode,
+                           ARLabelInfo *labelInfo, ARUint8 *image_thresh, ARLabelingBandsInfo *bandsInfo );
 AR_EXTERN int            arDetectMarker2( int xsize, int ysize, ARLabelInfo *labelInfo, int imageProcMode,
                                 int areaMax, int areaMin, ARdouble squareFitThresh,
                                 ARMarkerInfo2 *markerInfo2, int *marker2_num );
+
+/*!
+    @brief   Extract candidate squares from the labeling of a window of a larger image.
+    @details
+        As arDetectMarker2, where xsize and ysize are the dimensions of the window which
+        was labeled, and (x0, y0) is the position of the window's top-left corner in the
+        full image. Resulting coordinates are offset by (x0, y0), so are in full-image
+        coordinates. In AR_IMAGE_PROC_FIELD_IMAGE mode, x0 and y0 should be even.
+    @param      marker2_max Maximum number of candidates to write to markerInfo2.
+    @result     0 if successful, -1 in case of error.
+    @see arDetectMarker2
+ */
+AR_EXTERN int            arDetectMarker2Window( int xsize, int ysize, int x0, int y0, ARLabelInfo *labelInfo, int imageProcMode,
+                                int areaMax, int areaMin, ARdouble squareFitThresh,
+                                ARMarkerInfo2 *markerInfo2, int marker2_max, int *marker2_num );
 /*!
     @brief   Examine a set of detected squares for match with known markers.
     @details
@@ -955,11 +1331,78 @@ AR_EXTERN int            arGetMarkerInfo( ARUint8 *image, int xsize, int ysize,
                                 ARMarkerInfo *markerInfo, int *marker_num,
                                 const AR_MATRIX_CODE_TYPE matrixCodeType );
 
+/*!
+    @brief   Create the worker threads and working buffers for marker decoding.
+    @param      threadNum Number of threads (including the calling thread) to decode with,
+        between 1 and AR_MARKER_INFO_THREAD_MAX. With 1, no threads are started, but
+        arGetMarkerInfoParallel still decodes without per-candidate heap allocations.
+    @result     A new ARMarkerInfoThreads, or NULL in case of error.
+    @see arGetMarkerInfoParallel
+    @see arMarkerInfoThreadsFinal
+ */
+AR_EXTERN ARMarkerInfoThreads *arMarkerInfoThreadsInit( int threadNum );
+
+/*!
+    @brief   Stop the worker threads and free an ARMarkerInfoThreads.
+    @param      threads_p Location of the pointer returned by arMarkerInfoThreadsInit. Set to NULL on return.
+    @result     0 if successful, -1 in case of error.
+ */
+AR_EXTERN int            arMarkerInfoThreadsFinal( ARMarkerInfoThreads **threads_p );
+
+/*!
+    @brief   Examine a set of detected squares for match with known markers, on parallel threads.
+    @details
+        Takes the same parameters as arGetMarkerInfo, and produces identical results, in the same
+        order. Candidates are shared out between the threads, and the results compacted
+        into markerInfo once all threads have finished.
+        pattHandle must not be modified while this function runs.
+    @param      threads Handle returned by arMarkerInfoThreadsInit. If NULL, arGetMarkerInfo is called instead.
+    @result     0 in case of no error, or -1 otherwise.
+    @see arGetMarkerInfo
+ */
+AR_EXTERN int            arGetMarkerInfoParallel( ARUint8 *image, int xsize, int ysize, int pixelFormat,
+                                ARMarkerInfo2 *markerInfo2, int marker2_num,
+                                ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode, ARParamLTf *arParamLTf, ARdouble pattRatio,
+                                ARMarkerInfo *markerInfo, int *marker_num,
+                                const AR_MATRIX_CODE_TYPE matrixCodeType, ARMarkerInfoThreads *threads );
+
+/*!
+    @brief   Create the worker threads and per-pass buffers for concurrent auto-threshold bracketing.
+    @param      xsize Width of the images to be processed.
+    @param      ysize Height of the images to be processed.
+    @result     A new ARBracketingThreads, or NULL in case of error.
+    @see arSetLabelingThreshAutoBracketingMode
+    @see arBracketingThreadsFinal
+ */
+AR_EXTERN ARBracketingThreads *arBracketingThreadsInit( int xsize, int ysize );
+
+/*!
+    @brief   Stop the worker threads and free an ARBracketingThreads.
+    @param      threads_p Location of the pointer returned by arBracketingThreadsInit. Set to NULL on return.
+    @result     0 if successful, -1 in case of error.
+ */
+AR_EXTERN int            arBracketingThreadsFinal( ARBracketingThreads **threads_p );
+
 AR_EXTERN int            arGetContour( AR_LABELING_LABEL_TYPE *lImage, int xsize, int ysize, int *label_ref, int label,
                              int clip[4], ARMarkerInfo2 *marker_info2 );
 AR_EXTERN int            arGetLine( int x_coord[], int y_coord[], int coord_num, int vertex[], ARParamLTf *paramLTf,
                           ARdouble line[4][3], ARdouble v[4][2] );
 
+/*!
+    @brief   Fit a line to a run of contour points, without allocating.
+    @details
+        The points x_coord[st..ed], y_coord[st..ed] (inclusive) are undistorted through
+        paramLTf, and the line fitted through their mean along their principal direction,
+        found from the closed-form eigen solution of their 2x2 covariance. arGetLine()
+        calls this for each of a marker's four edges.
+    @param      line Receives the line a*x + b*y + c = 0 as {a, b, c}, with a*a + b*b = 1,
+        or {0, 0, 0} if all the points coincide.
+    @result     0 if successful, or -1 if fewer than 2 points were given or a point lies
+        outside the lookup table.
+    @see arGetLine
+ */
+AR_EXTERN int            arGetLineFit( int x_coord[], int y_coord[], int st, int ed, ARParamLTf *paramLTf, ARdouble line[3] );
+
 
 /***********************************/
 /*                                 */
@@ -993,13 +1436,18 @@ AR_EXTERN ARPattHandle *arPattCreateHandle(void);
 		freed by calling arPattDeleteHandle().
 
         Note that a pattern handle is NOT required when using only matrix-
-        code (2D barcode) markers.
+        code (2D barcode) markers. However, if one is attached, the 4x4 and 5x5
+        BCH matrix code types are decoded using lookup tables rather than
+        algebraically, with identical results. Each table is built when it is
+        first needed, by arSetMatrixCodeType() or arPattAttach().
     @param pattSize For any square template (pattern) markers, the number of rows and
         columns in the template. May not be less than 16 or more than AR_PATT_SIZE1_MAX.
 
         Pass AR_PATT_SIZE1 for the same behaviour as arPattCreateHandle().
     @param patternCountMax For any square template (pattern) markers, the maximum number of
         markers that may be loaded for a single matching pass. Must be > 0.
+        Storage for patterns is allocated as they are loaded, so a large value
+        costs nothing until it is used.
 
         Pass AR_PATT_NUM_MAX for the same behaviour as arPattCreateHandle().
     @see    arPattLoad
@@ -1024,8 +1472,9 @@ AR_EXTERN int arPattDeleteHandle(ARPattHandle *pattHandle);
         This function loads a pattern template from a file on disk, and attaches
         it to the given ARPattHandle so making it available for future pattern-matching.
         Additional patterns can be loaded by calling again with the same
-        ARPattHandle (however no more than AR_PATT_NUM_MAX patterns can be attached
-        to a single ARPattHandle). Patterns are initially loaded
+        ARPattHandle (however no more than the patternCountMax passed to
+        arPattCreateHandle2(), or AR_PATT_NUM_MAX for a handle created by
+        arPattCreateHandle(), can be attached to a single ARPattHandle). Patterns are initially loaded
 		in an active state.
 
         Note that matrix-code (2D barcode) markers do not have any associated
@@ -1041,9 +1490,9 @@ AR_EXTERN int arPattDeleteHandle(ARPattHandle *pattHandle);
     @see arPattDeactivate
     @see arPattFree
     @result     Returns the index number of the loaded pattern, in the range
-		[0, AR_PATT_NUM_MAX - 1], or -1 if the pattern could not be loaded
-		because the maximum number of patterns (AR_PATT_NUM_MAX) has already been
-		loaded already into this handle.
+		[0, patternCountMax - 1], or -1 if the pattern could not be loaded,
+		e.g. because the maximum number of patterns has already been
+		loaded into this handle. The index of a freed pattern is reused.
 */
 AR_EXTERN int arPattLoad( ARPattHandle *pattHandle, const char *filename );
 
@@ -1113,6 +1562,23 @@ AR_EXTERN int arPattActivate( ARPattHandle *pattHandle, int patno );
 */
 AR_EXTERN int arPattDeactivate(ARPattHandle *pattHandle, int patno);
 
+/*!
+    @brief   Enable or disable the template matching prefilter.
+    @details Before correlating a candidate against every pattern, the prefilter
+        computes a cheap upper bound on each correlation from AR_PATT_PREFILTER_GRID x AR_PATT_PREFILTER_GRID
+        block sums, correlates the pattern with the highest bound first, and then
+        skips any pattern whose bound is lower than the correlation already found.
+        The bound is conservative, so matching results (pattern, direction and
+        confidence) are identical with or without the prefilter. It is most worthwhile
+        with large pattern sets.
+        The prefilter is enabled by default, but is not used if pattSize is not a multiple
+        of AR_PATT_PREFILTER_GRID, or if fewer than AR_PATT_PREFILTER_PATT_NUM_MIN patterns are loaded.
+    @param      pattHandle The pattern handle.
+    @param      enable 1 to enable the prefilter, 0 to disable it.
+    @result     0 on success, or -1 in case of error.
+*/
+AR_EXTERN int arPattSetPrefilter(ARPattHandle *pattHandle, int enable);
+
 /*!
     @brief	Associate a set of patterns with an ARHandle.
     @details Associating a set of patterns with an ARHandle makes
@@ -1137,6 +1603,163 @@ AR_EXTERN int arPattAttach(ARHandle *arHandle, ARPattHandle *pattHandle);
 */
 AR_EXTERN int arPattDetach(ARHandle *arHandle);
 
+/*!
+    @brief   Create a matrix code dictionary from a set of codewords.
+    @details A dictionary holds an arbitrary set of size x size codewords. Unlike the
+        built-in matrix code types, a dictionary codeword has no locator corners; all
+        size*size cells carry data, and the marker's direction is found by matching
+        each of the 4 rotations of each codeword. A codeword's ID is its index in the set.
+        Exact matches are found via a hash of all rotations. Otherwise, the codeword
+        rotation at the smallest Hamming distance is accepted if that distance is unique
+        and no greater than the dictionary's maximum error-correction distance
+        (see arMatrixCodeDictionarySetMaxErrors()).
+        Codewords are packed in row-major order, first (top-left) cell in bit
+        size*size - 1, with a black cell represented by 1.
+    @param      size Number of rows/columns in the codewords, in range AR_MATRIX_CODE_DICTIONARY_SIZE_MIN
+        to AR_MATRIX_CODE_DICTIONARY_SIZE_MAX inclusive, i.e. one of the sizes of the
+        AR_MATRIX_CODE_*_DICTIONARY types.
+    @param      codes Array of codeNum codewords.
+    @param      codeNum Number of codewords, at most AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX.
+    @result     The dictionary, or NULL in case of error, including if any codeword
+        is identical to any rotation of itself or of another codeword.
+    @see    arMatrixCodeDictionaryLoad
+    @see    arMatrixCodeDictionaryDelete
+*/
+AR_EXTERN ARMatrixCodeDictionary *arMatrixCodeDictionaryCreate(const int size, const uint64_t *codes, const int codeNum);
+
+/*!
+    @brief   Load a matrix code dictionary from a buffer.
+    @details The buffer holds text. Anything from a '#' to the end of the line is a comment.
+        The first two values are the codeword size and number of codewords, followed
+        by the codewords as hexadecimal numbers, in the bit order described for
+        arMatrixCodeDictionaryCreate().
+    @param      buffer The nul-terminated text to parse.
+    @result     The dictionary, or NULL in case of error.
+    @see    arMatrixCodeDictionaryLoad
+*/
+AR_EXTERN ARMatrixCodeDictionary *arMatrixCodeDictionaryLoadFromBuffer(const char *buffer);
+
+/*!
+    @brief   Load a matrix code dictionary from a file.
+    @details See arMatrixCodeDictionaryLoadFromBuffer() for the file format.
+        Dictionaries can be generated with the genMatrixCodeDictionary utility.
+    @param      filename Path to the file.
+    @result     The dictionary, or NULL in case of error.
+    @see    arMatrixCodeDictionarySave
+*/
+AR_EXTERN ARMatrixCodeDictionary *arMatrixCodeDictionaryLoad(const char *filename);
+
+/*!
+    @brief   Save a matrix code dictionary to a file.
+    @param      dict The dictionary.
+    @param      filename Path to the file.
+    @result     0 on success, or -1 in case of error.
+    @see    arMatrixCodeDictionaryLoad
+*/
+AR_EXTERN int arMatrixCodeDictionarySave(const ARMatrixCodeDictionary *dict, const char *filename);
+
+/*!
+    @brief   Dispose of a matrix code dictionary.
+    @details The dictionary must first be detached from any ARPattHandle it is attached to.
+    @param      dict_p Pointer to the dictionary, which will be set to NULL.
+*/
+AR_EXTERN void arMatrixCodeDictionaryDelete(ARMatrixCodeDictionary **dict_p);
+
+/*!
+    @brief   Get the number of rows/columns in a dictionary's codewords.
+    @param      dict The dictionary.
+    @result     The size, or -1 if dict is NULL.
+*/
+AR_EXTERN int arMatrixCodeDictionaryGetSize(const ARMatrixCodeDictionary *dict);
+
+/*!
+    @brief   Get the number of codewords in a dictionary.
+    @param      dict The dictionary.
+    @result     The number of codewords, or -1 if dict is NULL.
+*/
+AR_EXTERN int arMatrixCodeDictionaryGetCodeNum(const ARMatrixCodeDictionary *dict);
+
+/*!
+    @brief   Get a codeword from a dictionary.
+    @param      dict The dictionary.
+    @param      id Index of the codeword.
+    @param      code_p Location to store the codeword.
+    @result     0 on success, or -1 in case of error.
+*/
+AR_EXTERN int arMatrixCodeDictionaryGetCode(const ARMatrixCodeDictionary *dict, const int id, uint64_t *code_p);
+
+/*!
+    @brief   Get the minimum Hamming distance between the codewords of a dictionary.
+    @details The minimum is taken over all rotations of all codewords, including
+        between the rotations of a single codeword. A dictionary with minimum distance d
+        can correct up to (d - 1)/2 erroneous cells unambiguously.
+    @param      dict The dictionary.
+    @result     The minimum distance, or -1 if dict is NULL.
+*/
+AR_EXTERN int arMatrixCodeDictionaryGetMinDistance(const ARMatrixCodeDictionary *dict);
+
+/*!
+    @brief   Set the maximum number of erroneous cells a dictionary lookup will correct.
+    @details The default is (d - 1)/2, where d is the dictionary's minimum distance.
+        Larger values trade more false positives for more detections. Whatever the
+        value, a lookup fails if two codeword rotations are at the same smallest distance.
+    @param      dict The dictionary.
+    @param      maxErrors The maximum error-correction distance, 0 to accept only exact matches.
+    @result     0 on success, or -1 in case of error.
+*/
+AR_EXTERN int arMatrixCodeDictionarySetMaxErrors(ARMatrixCodeDictionary *dict, const int maxErrors);
+
+/*!
+    @brief   Get the maximum number of erroneous cells a dictionary lookup will correct.
+    @param      dict The dictionary.
+    @result     The maximum error-correction distance, or -1 if dict is NULL.
+*/
+AR_EXTERN int arMatrixCodeDictionaryGetMaxErrors(const ARMatrixCodeDictionary *dict);
+
+/*!
+    @brief   Look up a matrix code in a dictionary.
+    @param      dict The dictionary.
+    @param      codeRaw The cells of the matrix code as read from the image, in the bit
+        order described for arMatrixCodeDictionaryCreate().
+    @param      id_p Location to store the ID of the matched codeword.
+    @param      dir_p Location to store the direction (0-3) in which the codeword was matched.
+    @param      errors_p If non-NULL, location to store the number of cells corrected.
+    @result     0 if a codeword was matched, or -1 otherwise.
+*/
+AR_EXTERN int arMatrixCodeDictionaryLookup(const ARMatrixCodeDictionary *dict, const uint64_t codeRaw, int *id_p, int *dir_p, int *errors_p);
+
+/*!
+    @brief   Rotate a matrix code.
+    @details Returns the code as it would be read from the image of a marker facing in direction dir.
+    @param      code The matrix code, in the bit order described for arMatrixCodeDictionaryCreate().
+    @param      size Number of rows/columns in the matrix code.
+    @param      dir The direction, 0-3.
+    @result     The rotated code.
+*/
+AR_EXTERN uint64_t arMatrixCodeRotate(const uint64_t code, const int size, const int dir);
+
+/*!
+    @brief   Associate a matrix code dictionary with a set of patterns.
+    @details The dictionary is used to decode markers when the ARHandle's matrix code
+        type is one of the AR_MATRIX_CODE_*_DICTIONARY types of the same size. The
+        pattern handle does not take ownership of the dictionary.
+    @param      pattHandle The pattern handle.
+    @param      dict The dictionary.
+    @see    arPattDetachMatrixCodeDictionary
+    @result     Returns 0 in the case of success, or -1 if the pattern handle already
+        has a dictionary attached, or if either parameter is NULL.
+*/
+AR_EXTERN int arPattAttachMatrixCodeDictionary(ARPattHandle *pattHandle, ARMatrixCodeDictionary *dict);
+
+/*!
+    @brief   Remove a matrix code dictionary from a set of patterns.
+    @param      pattHandle The pattern handle.
+    @see    arPattAttachMatrixCodeDictionary
+    @result     Returns 0 in the case of success, or -1 if the pattern handle has no
+        dictionary attached, or if pattHandle is NULL.
+*/
+AR_EXTERN int arPattDetachMatrixCodeDictionary(ARPattHandle *pattHandle);
+
 //int arPattGetPattRatio( ARPattHandle *pattHandle, float *ratio );
 //int arPattSetPattRatio( ARPattHandle *pattHandle, float  ratio );
 
@@ -1209,6 +1832,34 @@ AR_EXTERN int arPattGetIDGlobal( ARPattHandle *pattHandle, int imageProcMode, in
               int *codePatt, int *dirPatt, ARdouble *cfPatt, int *codeMatrix, int *dirMatrix, ARdouble *cfMatrix,
               const AR_MATRIX_CODE_TYPE matrixCodeType, int *errorCorrected, uint64_t *codeGlobalID_p );
 
+/*!
+    @brief   Create working buffers for pattern extraction and matching.
+    @param      pattSize The largest pattern size (rows and columns) expected. The buffers
+        grow if a larger size is later needed, so 0 may be passed to defer allocation to first use.
+    @result     A new ARPattScratch. Free it with arPattScratchDelete.
+    @see    arPattGetIDGlobalWithScratch
+ */
+AR_EXTERN ARPattScratch *arPattScratchCreate( int pattSize );
+
+/*!
+    @brief   Free working buffers created by arPattScratchCreate.
+    @param      scratch_p Location of the pointer to the ARPattScratch. Set to NULL on return.
+    @result     0 if successful, -1 in case of error.
+ */
+AR_EXTERN int arPattScratchDelete( ARPattScratch **scratch_p );
+
+/*!
+    @brief   Match the interior of a detected square against known patterns, using caller-supplied working buffers.
+    @details Identical to arPattGetIDGlobal, except that working buffers are taken from scratch
+        rather than being allocated on each call.
+    @param      scratch Working buffers, as returned by arPattScratchCreate. Must not be in use by another thread.
+    @see    arPattGetIDGlobal
+ */
+AR_EXTERN int arPattGetIDGlobalWithScratch( ARPattHandle *pattHandle, int imageProcMode, int pattDetectMode,
+              ARUint8 *image, int xsize, int ysize, AR_PIXEL_FORMAT pixelFormat, ARParamLTf *arParamLTf, ARdouble vertex[4][2], ARdouble pattRatio,
+              int *codePatt, int *dirPatt, ARdouble *cfPatt, int *codeMatrix, int *dirMatrix, ARdouble *cfMatrix,
+              const AR_MATRIX_CODE_TYPE matrixCodeType, int *errorCorrected, uint64_t *codeGlobalID_p, ARPattScratch *scratch );
+
 /*!
     @brief   Extract the image (i.e. locate and unwarp) of the pattern-space portion of a detected square.
     @param      imageProcMode See discussion of arSetImageProcMode().
@@ -1430,6 +2081,30 @@ AR_EXTERN ARdouble             arGetStereoMatchingError( AR3DStereoHandle *handl
 AR_EXTERN int                  arGetStereoMatching( AR3DStereoHandle *handle,
                                           ARdouble pos2dL[2], ARdouble pos2dR[2], ARdouble pos3d[3] );
 
+/*!
+    @brief   Find the window of the right camera's image in which a marker seen by the left camera must lie.
+    @details
+        Each corner of the marker lies on its epipolar line in the right image. If the marker's
+        width is known, its distance from the left camera can be estimated from its size in the
+        left image, and only the segment of each line corresponding to distances between
+        1/AR_STEREO_EPIPOLAR_DEPTH_RANGE and AR_STEREO_EPIPOLAR_DEPTH_RANGE times that estimate
+        need be searched. The result is the bounding box of those segments (allowing for lens
+        distortion), extended by a margin as for ROI tracking (AR_ROI_TRACKING_MARGIN).
+    @param      handle The stereo pose estimator, holding both cameras' projections and their relative pose.
+    @param      paramLTfR Lookup table of the right camera, used to convert to observed coordinates.
+    @param      xsizeR Width of the right camera's image.
+    @param      ysizeR Height of the right camera's image.
+    @param      marker_infoL The marker in the left camera's image.
+    @param      width Width of the marker, in the units of the stereo transform, or 0 if unknown, in
+        which case the whole of each epipolar line in front of the cameras is searched.
+    @param      win On return, the window, as {x0, y0, x1, y1} in the right camera's observed image
+        coordinates, x1 and y1 exclusive, and x0 and y0 even.
+    @result     0 if the window lies at least partly inside the image, or -1 otherwise.
+    @see arDetectMarkerInWindows
+ */
+AR_EXTERN int                  arGetStereoEpipolarWindow( AR3DStereoHandle *handle, const ARParamLTf *paramLTfR, int xsizeR, int ysizeR,
+                                                ARMarkerInfo *marker_infoL, ARdouble width, int win[4] );
+
 
 
 /***********************************/
@@ -56,6 +56,8 @@
 /* for arImageProcMode */
 #define  AR_IMAGE_PROC_FRAME_IMAGE            0
 #define  AR_IMAGE_PROC_FIELD_IMAGE            1
+#define  AR_IMAGE_PROC_PYRAMID_2X             2
+#define  AR_IMAGE_PROC_PYRAMID_4X             3
 #define  AR_DEFAULT_IMAGE_PROC_MODE           AR_IMAGE_PROC_FRAME_IMAGE
 
 /* for arPatternDetectionMode */
@@ -77,6 +79,17 @@
 #define  AR_CORNER_REFINEMENT_ENABLE          1
 #define  AR_DEFAULT_CORNER_REFINEMENT_MODE    AR_CORNER_REFINEMENT_DISABLE
 
+/* for arROITrackingMode */
+#define  AR_ROI_TRACKING_DISABLE              0
+#define  AR_ROI_TRACKING_ENABLE               1
+#define  AR_DEFAULT_ROI_TRACKING_MODE         AR_ROI_TRACKING_DISABLE
+
+/* for arLabelingThreshAutoBracketingMode */
+#define  AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL      0
+#define  AR_LABELING_THRESH_AUTO_BRACKETING_THREADED    1
+#define  AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS 2
+#define  AR_DEFAULT_LABELING_THRESH_AUTO_BRACKETING_MODE AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL
+
 /* for arGetTransMat */
 #define  AR_MAX_LOOP_COUNT                    5
 #define  AR_LOOP_BREAK_THRESH                 0.5
@@ -94,12 +107,16 @@
 #define   AR_PATT_SAMPLE_FACTOR2              3     // Maximum number of samples per pattern pixel row / column when detection mode is AR_MATRIX_CODE_DETECTION.
 #define   AR_PATT_CONTRAST_THRESH1           15.0	// Required contrast over pattern space when pattern detection mode is AR_TEMPLATE_MATCHING_MONO or AR_TEMPLATE_MATCHING_COLOR.
 #define   AR_PATT_CONTRAST_THRESH2           30.0	// Required contrast between black and white barcode segments when pattern detection mode is AR_MATRIX_CODE_DETECTION.
+#define   AR_PATT_PREFILTER_GRID              4     // Number of blocks per row and column of the pattern used by the template matching prefilter.
+#define   AR_PATT_PREFILTER_PATT_NUM_MIN     16     // Minimum number of loaded patterns for the template matching prefilter to be used.
 #define   AR_PATT_RATIO                       0.5   // Default value for percentage of marker width or height considered to be pattern space. Equal to 1.0 - 2*borderSize. Must be 0.5 in order to be compatible with ARToolKit versions 1.0 to 4.4.
 
 
 
 #define   AR_AREA_MAX                   1000000		// Maximum area (in pixels) of connected regions considered valid candidate for marker detection.
 #define   AR_AREA_MIN                        70		// Minimum area (in pixels) of connected regions considered valid candidate for marker detection.
+#define   AR_PYRAMID_AREA_MAX          16000000     // Maximum area (in full-resolution pixels) of connected regions in the reduced image considered valid candidate for marker detection in pyramid modes.
+#define   AR_PYRAMID_AREA_MIN              1024     // Minimum area (in full-resolution pixels) of connected regions in the reduced image considered valid candidate for marker detection in pyramid modes.
 #define   AR_SQUARE_FIT_THRESH                1.0   // Tolerance value for accepting connected region as square. Greater value = more tolerant.
 
 #define   AR_LABELING_32_BIT                  0     // 0 = 16 bits per label, 1 = 32 bits per label.
@@ -123,6 +140,28 @@
 #define   AR_LABELING_THRESH_ADAPTIVE_KERNEL_SIZE_DEFAULT 9
 #define   AR_LABELING_THRESH_ADAPTIVE_BIAS_DEFAULT (-7)
 
+#define   AR_LABELING_THREAD_MAX             32     // Maximum number of threads used for band-parallel labeling.
+#define   AR_LABELING_THREAD_COUNT_AUTO      -1     // Use one labeling thread per online CPU.
+#define   AR_LABELING_THREAD_COUNT_DEFAULT    1     // 1 = serial labeling.
+#define   AR_LABELING_BAND_ROWS_MIN          32     // Minimum number of rows in each band when labeling in parallel.
+
+#define   AR_LABELING_MULTI_THRESH_MAX        3     // Maximum number of thresholds labeled in a single pass by arLabelingMulti().
+
+#define   AR_MARKER_INFO_THREAD_MAX          32     // Maximum number of threads used to decode marker candidates in parallel.
+#define   AR_MARKER_INFO_THREAD_COUNT_AUTO   -1     // Use one decoding thread per online CPU.
+#define   AR_MARKER_INFO_THREAD_COUNT_DEFAULT 1     // 1 = decode candidates serially.
+
+#define   AR_POSE_THREAD_MAX                 32     // Maximum number of threads used to estimate trackable poses in parallel.
+#define   AR_POSE_THREAD_COUNT_AUTO          -1     // Use one pose estimation thread per online CPU.
+#define   AR_POSE_THREAD_COUNT_DEFAULT        1     // 1 = estimate poses serially.
+
+#define   AR_ROI_TRACKING_FULL_SCAN_INTERVAL_DEFAULT 15 // Maximum number of consecutive frames in which only the windows around previously found markers are searched.
+#define   AR_ROI_TRACKING_MARGIN              0.5   // Proportion of a marker's bounding box size by which its search window extends beyond the box on each side.
+#define   AR_ROI_TRACKING_MARGIN_MIN         16     // Minimum margin (in pixels) of a search window beyond its marker's bounding box.
+
+#define   AR_STEREO_EPIPOLAR_DEPTH_RANGE      2.0   // Factor either side of the distance estimated from a marker's size over which its epipolar band is searched.
+#define   AR_STEREO_EPIPOLAR_SAMPLES          8     // Number of intervals into which each epipolar segment is divided, to follow lens distortion.
+
 #define   AR_CONFIDENCE_CUTOFF_DEFAULT        0.5
 #define   AR_MATRIX_CODE_TYPE_DEFAULT         AR_MATRIX_CODE_3x3
 
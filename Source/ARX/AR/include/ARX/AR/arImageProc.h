@@ -75,6 +75,8 @@ struct _ARImageProcInfo {
     unsigned char max;                  ///< Maximum luminance.
 #if AR_IMAGEPROC_USE_VIMAGE
     void *tempBuffer;                   ///< Extra buffer when using macOS/iOS vImage framework.
+#else
+    unsigned int *boxFilterSums;        ///< Running column sums and row prefix sums for the box filter, allocated as required.
 #endif
 };
 typedef struct _ARImageProcInfo ARImageProcInfo;
@@ -182,6 +184,10 @@ int arImageProcLumaHistAndOtsu(ARImageProcInfo *ipi, const ARUint8 *__restrict d
     @details 
         See https://developer.apple.com/library/ios/documentation/Performance/Reference/vImage_convolution/
         On macOS and iOS, the calculation is accelerated using the Accelerate framework.
+        On other platforms, the filter is computed from running column sums and row prefix
+        sums, so the cost per pixel is independent of boxSize. The column sums are updated
+        using SSE2 or NEON where available. Pixels near the image edge are averaged over the
+        portion of the kernel which lies inside the image.
     @param ipi ARImageProcInfo structure describing the format of the image
         to be processed, as created by arImageProcInit.
     @result 0 in case of success, or a value less than 0 in case of error.
@@ -196,6 +202,19 @@ int arImageProcLumaHistAndBoxFilterWithBias(ARImageProcInfo *ipi, const ARUint8
  */
 int arImageProcLumaHistAndCDFAndLevels(ARImageProcInfo *ipi, const ARUint8 *__restrict dataPtr);
 
+/*!
+    @brief Reduce a luminance image in size by an integer factor.
+    @details
+        Each output pixel is the rounded mean of a factor x factor block of input pixels.
+        Any rows or columns beyond the last whole block are ignored. For a factor of 2,
+        the calculation uses SSE2 or NEON where available.
+    @param dataPtr Input image, xsize x ysize pixels.
+    @param factor Reduction factor, >= 1.
+    @param dstPtr Output image, (xsize/factor) x (ysize/factor) pixels.
+    @result 0 in case of success, or a value less than 0 in case of error.
+ */
+int arImageProcLumaDecimate(const ARUint8 *__restrict dataPtr, const int xsize, const int ysize, const int factor, ARUint8 *__restrict dstPtr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,7 @@ extern "C" {
 #endif
 
 #define   ICP_TRANS_MAT_IDENTITY        NULL
+#define   ICP_WORK_PER_POINT            4       // dU (2), E and E2.
 
 
 /*
@@ -79,6 +80,8 @@ typedef struct {
     ARdouble     breakLoopErrorRatioThresh;
     ARdouble     breakLoopErrorThresh2;
     ARdouble     inlierProb;
+    ARdouble    *work;          ///< Scratch space for icpPoint() and icpPointRobust(), ICP_WORK_PER_POINT values per point.
+    int          pointNumMax;   ///< Number of points for which work has room.
 } ICPHandleT;
 
 typedef struct {
@@ -115,6 +118,7 @@ int                icpSetBreakLoopErrorThresh2     ( ICPHandleT *handle, ARdoubl
 int                icpGetBreakLoopErrorThresh2     ( ICPHandleT *handle, ARdouble *breakLoopErrorThresh2 );
 int                icpSetInlierProbability         ( ICPHandleT *handle, ARdouble  inlierProbability );
 ICP_EXTERN int                icpGetInlierProbability         ( ICPHandleT *handle, ARdouble *inlierProbability );
+int                icpSetPointNumMax               ( ICPHandleT *handle, int  pointNumMax );
 int                icpPoint                        ( ICPHandleT *handle, ICPDataT *data, ARdouble initMatXw2Xc[3][4], ARdouble matXw2Xc[3][4], ARdouble *err );
 int                icpPointRobust                  ( ICPHandleT *handle, ICPDataT *data, ARdouble initMatXw2Xc[3][4], ARdouble matXw2Xc[3][4], ARdouble *err );
 
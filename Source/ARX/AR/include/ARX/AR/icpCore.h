@@ -100,6 +100,9 @@ int        icpGetXc_from_Xw_by_MatXw2Xc( ICP3DCoordT *Xc, ARdouble matXw2Xc[3][4
 int        icpGetU_from_X_by_MatX2U( ICP2DCoordT *u, ARdouble matX2U[3][4], ICP3DCoordT *coord3d );
 int        icpGetJ_U_S( ARdouble J_U_S[2][6], ARdouble matXc2U[3][4], ARdouble matXw2Xc[3][4], ICP3DCoordT *worldCoord );
 int        icpGetDeltaS( ARdouble S[6], ARdouble dU[], ARdouble J_U_S[][6], int n );
+int        icpGetJtJ_JtU( ARdouble JtJ[6][6], ARdouble JtU[6], ARdouble matXc2U[3][4], ARdouble matXw2Xc[3][4],
+                          ICP3DCoordT worldCoord[], ARdouble dU[], ARdouble W[], int num );
+int        icpGetDeltaS_from_JtJ( ARdouble S[6], ARdouble JtJ[6][6], ARdouble JtU[6] );
 int        icpUpdateMat( ARdouble matXw2Xc[3][4], ARdouble dS[6] );
 
 #if ICP_DEBUG
@@ -83,6 +83,17 @@ extern "C" {
 */
 #define   AR_PARAM_LT_DEFAULT_OFFSET  15
 
+/*!
+    @brief   Types of lookup table which may be requested from arParamLTCreate2().
+ */
+#define   AR_PARAM_LT_TYPE_FLOAT      0     ///< One floating point entry per pixel, as created by arParamLTCreate().
+#define   AR_PARAM_LT_TYPE_COMPACT    1     ///< Fixed-point entries every AR_PARAM_LTI_STEP pixels, interpolated bilinearly. See ARParamLTi.
+
+/*!
+    @brief   Spacing in pixels of the entries in a compact (AR_PARAM_LT_TYPE_COMPACT) lookup table.
+ */
+#define   AR_PARAM_LTI_STEP            4
+
 /*!
     @brief   Structure holding camera parameters, including image size, projection matrix and lens distortion parameters.
     @details
@@ -113,8 +124,30 @@ typedef struct {
  */
 extern const arParamVersionInfo_t arParamVersionInfo[AR_DIST_FUNCTION_VERSION_MAX];
 
+/*!
+    @brief   Structure holding camera parameters, in lookup table form; compact fixed-point version.
+    @details
+        Rather than a location for every pixel, this holds the displacement of the mapped
+        location from the input location at every AR_PARAM_LTI_STEP pixels, as a signed
+        16-bit fixed-point value. Lookups interpolate bilinearly between the four surrounding
+        entries, so the table is around 1/32 the size of the floating point one.
+    @see ARParamLTf
+ */
+typedef struct {
+    short   *i2o;       ///< Ideal-to-observed; (x, y) displacement of the observed location from the idealised location at each entry.
+    short   *o2i;       ///< Observed-to-ideal; (x, y) displacement of the idealised location from the observed location at each entry.
+    int      xsize;     ///< The number of entries in the array's x dimension.
+    int      ysize;     ///< The number of entries in the array's y dimension.
+    int      step;      ///< The number of pixels between entries, AR_PARAM_LTI_STEP.
+    int      shift;     ///< Displacements are in units of 1/(1 << shift) pixels, the finest that fits all of them in 16 bits.
+} ARParamLTi;
+
 /*!
     @brief   Structure holding camera parameters, in lookup table form; floating point version.
+    @details
+        When the lookup table is compact (see arParamLTCreate2()), i2o and o2i are NULL, and
+        lookups should be made via arParamIdeal2ObservLTf() and arParamObserv2IdealLTf(),
+        which interpolate in *paramLTi instead.
     @see ARParamLT
  */
 typedef struct {
@@ -124,16 +157,8 @@ typedef struct {
     int      ysize;     ///< The number of pixels in the array's x dimension, including the offset areas on the top and bottom.xsize, i.e. ARParam.ysize + yOff*2.
     int      xOff;      ///< The number of pixels from the left edge of the array to column zero of the input.
     int      yOff;      ///< The number of pixels from the top edge of the array to row zero of the input.
+    ARParamLTi *paramLTi; ///< If non-NULL, the compact table in which lookups are made, in place of i2o and o2i.
 } ARParamLTf;
-    
-//typedef struct {
-//    short   *i2o;
-//    short   *o2i;
-//    int      xsize;
-//    int      ysize;
-//    int      xOff;
-//    int      yOff;
-//} ARParamLTi;
 
 /*!
     @brief   Structure holding camera parameters, in lookup table form.
@@ -151,7 +176,9 @@ typedef struct {
 typedef struct {
     ARParam      param;         ///< A copy of original ARParam from which the lookup table was calculated.
     ARParamLTf   paramLTf;      ///< The lookup table.
-    //ARParamLTi   paramLTi;
+    ARParamLTi   paramLTi;      ///< The compact lookup table, when paramLTf.paramLTi points to it.
+    void        *cacheMap;      ///< If non-NULL, the mapping of the cache file holding the tables, rather than separately allocated memory.
+    size_t       cacheMapSize;
 } ARParamLT;
 
 AR_EXTERN int    arParamDisp( const ARParam *param );
@@ -406,7 +433,24 @@ AR_EXTERN int arParamLoadOptical(const char *filename, ARdouble *fovy_p, ARdoubl
 AR_EXTERN int arParamLoadOpticalFromBuffer(const void *buffer, size_t bufsize, ARdouble *fovy_p, ARdouble *aspect_p, ARdouble m[16]);
 AR_EXTERN int arParamDispOptical(const ARdouble fovy, const ARdouble aspect, const ARdouble m[16]);
 
+/*!
+    @brief Save a lookup-table camera parameter to the file "filename.ext".
+    @details
+        The file has a versioned header describing the tables, in the same format as the cache files
+        written by arParamLTCreate2. It is specific to the size of ARdouble.
+    @result 0 if successful, or -1 if an error occured.
+    @see arParamLTLoad
+ */
 AR_EXTERN int         arParamLTSave( char *filename, char *ext, ARParamLT *paramLT );
+
+/*!
+    @brief Load a lookup-table camera parameter saved by arParamLTSave.
+    @details
+        Files written by earlier versions, without a header, are also read, provided they were saved on the
+        same platform. Files whose header or size does not match the tables are rejected.
+    @result The lookup-table camera parameter, to be freed with arParamLTFree, or NULL if an error occured.
+    @see arParamLTSave
+ */
 AR_EXTERN ARParamLT  *arParamLTLoad( char *filename, char *ext );
 
 /*!
@@ -431,6 +475,27 @@ AR_EXTERN ARParamLT  *arParamLTLoad( char *filename, char *ext );
  */
 AR_EXTERN ARParamLT  *arParamLTCreate( ARParam *param, int offset );
 
+/*!
+    @brief Allocate a lookup-table camera parameter of a given type, optionally backed by a cache file.
+    @details
+        As arParamLTCreate(), but a compact fixed-point table (see ARParamLTi) may be requested,
+        and the tables may be kept in a cache file, which is memory-mapped rather than recalculated
+        and copied when the same parameters are next used. Cache files are named by a hash of the
+        camera parameters, offset and table type, and their headers are checked against those
+        values before use. If a cache file is missing, stale or unusable, the table is calculated
+        and the file (re)written; failure to write it is not an error.
+    @param param A pointer to an ARParam structure from which the lookup table will be generated.
+    @param offset Padding around the camera parameters size. See arParamLTCreate().
+    @param type AR_PARAM_LT_TYPE_FLOAT or AR_PARAM_LT_TYPE_COMPACT.
+    @param cacheDir Path of a writable directory in which to keep cache files, or NULL to not use a cache.
+    @result A pointer to a newly-allocated ARParamLT structure, or NULL if an error
+        occurred. Once the ARParamLT is no longer needed, it should be disposed
+        of by calling arParamLTFree() on it.
+    @see arParamLTCreate
+    @see arParamLTFree
+ */
+AR_EXTERN ARParamLT  *arParamLTCreate2( ARParam *param, int offset, int type, const char *cacheDir );
+
 /*!
     @brief Dispose of a memory allocated to a lookup-table camera parameter.
     @param paramLT_p Pointer to a pointer to the paramLT structure to be disposed of.
@@ -504,9 +569,6 @@ AR_EXTERN int         arParamIdeal2ObservLTf( const ARParamLTf *paramLTf, const
 */
 AR_EXTERN int         arParamObserv2IdealLTf( const ARParamLTf *paramLTf, const float  ox, const float  oy, float  *ix, float  *iy);
 
-//int         arParamIdeal2ObservLTi( const ARParamLTi *paramLTi, const int    ix, const int    iy, int    *ox, int    *oy);
-
-//int         arParamObserv2IdealLTi( const ARParamLTi *paramLTi, const int    ox, const int    oy, int    *ix, int    *iy);
 
 #ifdef __cplusplus
 }
@@ -40,6 +40,14 @@
 #include "matrixCode.h"
 #include <stdbool.h>
 
+//#define DEBUG_BCH
+
+// Generator polynomials of the BCH codes, lowest-order coefficient first.
+static const int bch_13_9_3_Galois[5] = {1, 1, 0, 0, 1};
+static const int bch_13_5_5_Galois[9] = {1, 0, 0, 0, 1, 0, 1, 1, 1};
+static const int bch_22_12_5_Galois[11] = {1, 0, 0, 1, 0, 1, 1, 0, 1, 1, 1};
+static const int bch_22_7_7_Galois[16] = {1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1};
+
 static inline int unpack_number(uint64_t number, int length, uint8_t *bits)
 {
     for (int i = 0; i < length; i++) {
@@ -83,10 +91,6 @@ int encodeMatrixCode(const AR_MATRIX_CODE_TYPE matrixCodeType, uint64_t in, uint
 
     const signed char hamming63EncoderTable[8] = {0, 7, 25, 30, 42, 45, 51, 52};
     const signed char parity65EncoderTable[32] = {0, 33, 34, 3, 36, 5, 6, 39, 40, 9, 10, 43, 12, 45, 46, 15, 48, 17, 18, 51, 20, 53, 54, 23, 24, 57, 58, 27, 60, 29, 30, 63};
-    const int bch_13_9_3_Galois[5] = {1, 1, 0, 0, 1};
-    const int bch_13_5_5_Galois[9] = {1, 0, 0, 0, 1, 0, 1, 1, 1};
-    const int bch_22_12_5_Galois[11] = {1, 0, 0, 1, 0, 1, 1, 0, 1, 1, 1};
-    const int bch_22_7_7_Galois[16] = {1, 1, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 0, 1};
 
     if (matrixCodeType == AR_MATRIX_CODE_3x3_HAMMING63) {
         if (in >= 8u) return 0;
@@ -110,6 +114,8 @@ int encodeMatrixCode(const AR_MATRIX_CODE_TYPE matrixCodeType, uint64_t in, uint
         return (encode_bch(22, 7, bch_22_7_7_Galois, in, out_bits_p));
     } else if (matrixCodeType == AR_MATRIX_CODE_GLOBAL_ID) {
         return 0; // Encoding unsupported.
+    } else if ((matrixCodeType & AR_MATRIX_CODE_TYPE_ECC_MASK) == AR_MATRIX_CODE_TYPE_ECC_DICTIONARY) {
+        return 0; // Codewords come from the dictionary, and have no locator corners.
     } else {
         // Raw code.
         int barcode_dimensions = matrixCodeType & AR_MATRIX_CODE_TYPE_SIZE_MASK;
@@ -121,3 +127,322 @@ int encodeMatrixCode(const AR_MATRIX_CODE_TYPE matrixCodeType, uint64_t in, uint
         return (unpack_number(in, length, *out_bits_p));
     }
 }
+
+int decode_bch(const AR_MATRIX_CODE_TYPE matrixCodeType, const uint64_t in, uint8_t recd127[127], uint64_t *out_p)
+{
+    uint64_t in_bitwise;
+    uint8_t *recd;
+    uint64_t out_bit;
+    int t, n, length, k;
+    uint8_t recd64[64];
+    const int *alpha_to, *index_of;
+    const int bch_15_alpha_to[15] = {1, 2, 4, 8, 3, 6, 12, 11, 5, 10, 7, 14, 15, 13, 9};
+    const int bch_15_index_of[16] = {-1, 0, 1, 4, 2, 8, 5, 10, 3, 14, 9, 7, 6, 13, 11, 12};
+    const int bch_31_alpha_to[31] = {1, 2, 4, 8, 16, 5, 10, 20, 13, 26, 17, 7, 14, 28, 29, 31, 27, 19, 3, 6, 12, 24, 21, 15, 30, 25, 23, 11, 22, 9, 18};
+    const int bch_31_index_of[32] = {-1, 0, 1, 18, 2, 5, 19, 11, 3, 29, 6, 27, 20, 8, 12, 23, 4, 10, 30, 17, 7, 22, 28, 26, 21, 25, 9, 16, 13, 14, 24, 15};
+    const int bch_127_alpha_to[127] = {1, 2, 4, 8, 16, 32, 64, 3, 6, 12, 24, 48, 96, 67, 5, 10, 20, 40, 80, 35, 70, 15, 30, 60, 120, 115, 101, 73, 17, 34, 68, 11, 22, 44, 88, 51, 102, 79, 29, 58, 116, 107, 85, 41, 82, 39, 78, 31, 62, 124, 123, 117, 105, 81, 33, 66, 7, 14, 28, 56, 112, 99, 69, 9, 18, 36, 72, 19, 38, 76, 27, 54, 108, 91, 53, 106, 87, 45, 90, 55, 110, 95, 61, 122, 119, 109, 89, 49, 98, 71, 13, 26, 52, 104, 83, 37, 74, 23, 46, 92, 59, 118, 111, 93, 57, 114, 103, 77, 25, 50, 100, 75, 21, 42, 84, 43, 86, 47, 94, 63, 126, 127, 125, 121, 113, 97, 65};
+    const int bch_127_index_of[128] = {-1, 0, 1, 7, 2, 14, 8, 56, 3, 63, 15, 31, 9, 90, 57, 21, 4, 28, 64, 67, 16, 112, 32, 97, 10, 108, 91, 70, 58, 38, 22, 47, 5, 54, 29, 19, 65, 95, 68, 45, 17, 43, 113, 115, 33, 77, 98, 117, 11, 87, 109, 35, 92, 74, 71, 79, 59, 104, 39, 100, 23, 82, 48, 119, 6, 126, 55, 13, 30, 62, 20, 89, 66, 27, 96, 111, 69, 107, 46, 37, 18, 53, 44, 94, 114, 42, 116, 76, 34, 86, 78, 73, 99, 103, 118, 81, 12, 125, 88, 61, 110, 26, 36, 106, 93, 52, 75, 41, 72, 85, 80, 102, 60, 124, 105, 25, 40, 51, 101, 84, 24, 123, 83, 50, 49, 122, 120, 121};
+    int i, j, u, q, t2, count = 0, syn_error = 0;
+	int elp[20][18], d[20], l[20], u_lu[20], s[19], loc[127], reg[10]; // int elp[t2 + 2, t2], d[t2 + 2], l[t2 + 2], u_lu[t2 + 2], s[t2 + 1], loc[n], reg[t + 1].
+    
+    if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3 || matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7) {
+        if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3 || matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5) {
+            if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3) {
+                t = 1; k = 9;
+            } else { // matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5
+                t = 2; k = 5;
+            }
+            n = 15;
+            length = 13;
+            alpha_to = bch_15_alpha_to;
+            index_of = bch_15_index_of;
+        } else { // matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5 || matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7
+            if (matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5) {
+                t = 2; k = 12;
+            } else { // matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7
+                t = 3; k = 7;
+            }
+            n = 31;
+            length = 22;
+            alpha_to = bch_31_alpha_to;
+            index_of = bch_31_index_of;
+        }
+        // Unpack input into recd64[]. recd64[0] is least significant bit.
+        in_bitwise = in;
+        for (i = 0; i < length; i++) {
+            recd64[i] = (uint8_t)(in_bitwise & 1);
+            in_bitwise = in_bitwise >> 1;
+        }
+        recd = recd64;
+    } else if (matrixCodeType == AR_MATRIX_CODE_GLOBAL_ID) {
+        t = 9; k = 64;
+        n = 127;
+        length = 120;
+        alpha_to = bch_127_alpha_to;
+        index_of = bch_127_index_of;
+        recd = recd127;
+    } else {
+#ifdef DEBUG_BCH
+        ARLOGe("Error: unsupported BCH code.\n");
+#endif
+        return (-1); // Unsupported code.
+    }
+    
+    
+    /*
+     * Simon Rockliff's implementation of Berlekamp's algorithm.
+     * Copyright (c) 1994-7,  Robert Morelos-Zaragoza. All rights reserved.
+     *
+     * Assume we have received bits in recd[i], i=0..(n-1).
+     *
+     * Compute the 2*t syndromes by substituting alpha^i into rec(X) and
+     * evaluating, storing the syndromes in s[i], i=1..2t (leave s[0] zero) .
+     * Then we use the Berlekamp algorithm to find the error location polynomial
+     * elp[i].
+     *
+     * If the degree of the elp is >t, then we cannot correct all the errors, and
+     * we have detected an uncorrectable error pattern. We output the information
+     * bits uncorrected.
+     *
+     * If the degree of elp is <=t, we substitute alpha^i , i=1..n into the elp
+     * to get the roots, hence the inverse roots, the error location numbers.
+     * This step is usually called "Chien's search".
+     *
+     * If the number of errors located is not equal the degree of the elp, then
+     * the decoder assumes that there are more than t errors and cannot correct
+     * them, only detect them. We output the information bits uncorrected.
+     *
+     * t = error correcting capability (max. no. of errors the code corrects)
+     * length = length of the BCH code
+     * n = 2**m - 1 = size of the multiplicative group of GF(2**m)
+     * alpha_to [] = log table of GF(2**m) 
+     * index_of[] = antilog table of GF(2**m)
+     * recd[] = coefficients of the received polynomial 
+     */
+	t2 = 2 * t;
+    
+	/* first form the syndromes */
+	for (i = 1; i <= t2; i++) {
+		s[i] = 0;
+		for (j = 0; j < length; j++) {
+			if (recd[j] != 0) s[i] ^= alpha_to[(i * j) % n];
+        }
+		if (s[i] != 0) syn_error = 1; /* set error flag if non-zero syndrome */
+		s[i] = index_of[s[i]]; /* convert syndrome from polynomial form to index form  */
+	}
+    
+	if (syn_error) {	/* if there are errors, try to correct them */
+		/*
+		 * Compute the error location polynomial via the Berlekamp
+		 * iterative algorithm. Following the terminology of Lin and
+		 * Costello's book :   d[u] is the 'mu'th discrepancy, where
+		 * u='mu'+1 and 'mu' (the Greek letter!) is the step number
+		 * ranging from -1 to 2*t (see L&C),  l[u] is the degree of
+		 * the elp at that step, and u_l[u] is the difference between
+		 * the step number and the degree of the elp. 
+		 */
+		/* initialise table entries */
+		d[0] = 0;			/* index form */
+		d[1] = s[1];		/* index form */
+		elp[0][0] = 0;		/* index form */
+		elp[1][0] = 1;		/* polynomial form */
+		for (i = 1; i < t2; i++) {
+			elp[0][i] = -1;	/* index form */
+			elp[1][i] = 0;	/* polynomial form */
+		}
+		l[0] = 0;
+		l[1] = 0;
+		u_lu[0] = -1;
+		u_lu[1] = 0;
+		u = 0;
+        
+		do {
+			u++;
+			if (d[u] == -1) {
+				l[u + 1] = l[u];
+				for (i = 0; i <= l[u]; i++) {
+					elp[u + 1][i] = elp[u][i];
+					elp[u][i] = index_of[elp[u][i]]; /* put elp into index form  */
+				}
+			} else {
+                /*
+                 * search for words with greatest u_lu[q] for
+                 * which d[q]!=0 
+                 */
+				q = u - 1;
+				while ((d[q] == -1) && (q > 0)) q--;
+				/* have found first non-zero d[q]  */
+				if (q > 0) {
+                    j = q;
+                    do {
+                        j--;
+                        if ((d[j] != -1) && (u_lu[q] < u_lu[j]))
+                            q = j;
+                    } while (j > 0);
+				}
+                
+				/*
+				 * have now found q such that d[u]!=0 and
+				 * u_lu[q] is maximum 
+				 */
+				/* store degree of new elp polynomial */
+				if (l[u] > l[q] + u - q) l[u + 1] = l[u];
+				else l[u + 1] = l[q] + u - q;
+                
+				/* form new elp(x) */
+				for (i = 0; i < t2; i++) elp[u + 1][i] = 0;
+				for (i = 0; i <= l[q]; i++) {
+					if (elp[q][i] != -1) elp[u + 1][i + u - q] = alpha_to[(d[u] + n - d[q] + elp[q][i]) % n];
+                }
+				for (i = 0; i <= l[u]; i++) {
+					elp[u + 1][i] ^= elp[u][i];
+					elp[u][i] = index_of[elp[u][i]]; /* put elp into index form  */
+				}
+			}
+			u_lu[u + 1] = u - l[u + 1];
+            
+			/* form (u+1)th discrepancy */
+			if (u < t2) {	
+                /* no discrepancy computed on last iteration */
+                if (s[u + 1] != -1) d[u + 1] = alpha_to[s[u + 1]];
+                else d[u + 1] = 0;
+			    for (i = 1; i <= l[u + 1]; i++) {
+                    if ((s[u + 1 - i] != -1) && (elp[u + 1][i] != 0)) d[u + 1] ^= alpha_to[(s[u + 1 - i] + index_of[elp[u + 1][i]]) % n];
+                }
+                d[u + 1] = index_of[d[u + 1]]; /* put d[u+1] into index form */
+			}
+		} while ((u < t2) && (l[u + 1] <= t));
+        
+		u++;
+		if (l[u] <= t) { /* Can correct errors */
+			for (i = 0; i <= l[u]; i++) elp[u][i] = index_of[elp[u][i]]; /* put elp into index form */
+            
+			/* Chien search: find roots of the error location polynomial */
+			for (i = 1; i <= l[u]; i++) reg[i] = elp[u][i];
+			count = 0;
+			for (i = 1; i <= n; i++) {
+				q = 1;
+				for (j = 1; j <= l[u]; j++) {
+ 					if (reg[j] != -1) {
+						reg[j] = (reg[j] + j) % n;
+						q ^= alpha_to[reg[j]];
+					}
+                }
+				if (!q) {	/* store root and error
+                             * location number indices */
+					loc[count] = n - i; /* root[count] = i; */
+					count++;
+				}
+			}
+
+			if (count == l[u]){
+                /* no. roots = degree of elp hence <= t errors */
+				for (i = 0; i < l[u]; i++) recd[loc[i]] ^= 1;
+            } else	{
+                /* elp has degree >t hence cannot solve */
+#ifdef DEBUG_BCH
+                ARLOGe("count != l[u].\n");
+#endif
+                return (-1);
+            }
+		} else {
+#ifdef DEBUG_BCH
+            ARLOGe("l[u] > t.\n");
+#endif
+            return (-1);
+        }
+	} // End syn_error.
+    
+    // Pack the result into *out_p. Data bits begin with LSB at recd[length - k] through to MSB at recd[length - 1];
+    *out_p = 0LL;
+    out_bit = 1LL;
+    for (i = length - k; i < length; i++) {
+        *out_p += (uint64_t)recd[i] * out_bit;
+        out_bit <<= 1;
+    }
+    
+    if (syn_error) return (l[u]);
+    else return (0);
+}
+
+const AR_MATRIX_CODE_TYPE bchTableTypes[AR_MATRIX_CODE_BCH_TABLE_NUM] = {
+    AR_MATRIX_CODE_4x4_BCH_13_9_3,
+    AR_MATRIX_CODE_4x4_BCH_13_5_5,
+    AR_MATRIX_CODE_5x5_BCH_22_12_5,
+    AR_MATRIX_CODE_5x5_BCH_22_7_7
+};
+
+int bchTableIndex(const AR_MATRIX_CODE_TYPE matrixCodeType)
+{
+    for (int i = 0; i < AR_MATRIX_CODE_BCH_TABLE_NUM; i++) {
+        if (bchTableTypes[i] == matrixCodeType) return (i);
+    }
+    return (-1);
+}
+
+ARMatrixCodeBCHTable *bchTableCreate(const AR_MATRIX_CODE_TYPE matrixCodeType)
+{
+    ARMatrixCodeBCHTable *table;
+    const int *g;
+    int length, k;
+
+    if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_9_3) {
+        length = 13; k = 9; g = bch_13_9_3_Galois;
+    } else if (matrixCodeType == AR_MATRIX_CODE_4x4_BCH_13_5_5) {
+        length = 13; k = 5; g = bch_13_5_5_Galois;
+    } else if (matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_12_5) {
+        length = 22; k = 12; g = bch_22_12_5_Galois;
+    } else if (matrixCodeType == AR_MATRIX_CODE_5x5_BCH_22_7_7) {
+        length = 22; k = 7; g = bch_22_7_7_Galois;
+    } else return NULL;
+
+    const int r = length - k; // Degree of g(x), and number of bits in a syndrome.
+    uint32_t gBits = 0;
+    for (int i = 0; i <= r; i++) if (g[i]) gBits |= 1u << i;
+
+    arMallocClear(table, ARMatrixCodeBCHTable, 1);
+    table->length = length;
+    table->k = k;
+
+    // Syndrome of each single bit, i.e. x^i mod g(x), then of each byte value by linearity.
+    uint32_t bitSyn[24];
+    uint32_t rem = 1u;
+    for (int i = 0; i < 24; i++) {
+        bitSyn[i] = rem;
+        rem <<= 1;
+        if (rem & (1u << r)) rem ^= gBits;
+    }
+    for (int b = 0; b < 3; b++) {
+        for (int v = 0; v < 256; v++) {
+            uint32_t s = 0;
+            for (int i = 0; i < 8; i++) if (v & (1 << i)) s ^= bitSyn[b*8 + i];
+            table->syn[b][v] = s;
+        }
+    }
+
+    // Words below 2^r have no data bits set, so the data decoded from each is the correction to the data bits.
+    arMalloc(table->entry, int32_t, 1 << r);
+    for (uint32_t s = 0; s < (1u << r); s++) {
+        uint64_t out;
+        int ret = decode_bch(matrixCodeType, s, NULL, &out);
+        table->entry[s] = (ret < 0 ? -1 : (int32_t)(((uint32_t)ret << 16) | (uint32_t)out));
+    }
+
+    return (table);
+}
+
+void bchTableEnsure(ARPattHandle *pattHandle, const AR_MATRIX_CODE_TYPE matrixCodeType)
+{
+    int i;
+
+    if (!pattHandle || (i = bchTableIndex(matrixCodeType)) < 0) return;
+    if (!pattHandle->bchTables[i]) pattHandle->bchTables[i] = bchTableCreate(matrixCodeType);
+}
+
+void bchTableFree(ARMatrixCodeBCHTable **table_p)
+{
+    if (!table_p || !*table_p) return;
+    free((*table_p)->entry);
+    free(*table_p);
+    *table_p = NULL;
+}
@@ -56,6 +56,48 @@ int encode_bch(int length, int k, const int *g, uint64_t number, uint8_t **out_b
 /// Returns length of *out_bits_p*
 int encodeMatrixCode(const AR_MATRIX_CODE_TYPE matrixCodeType, uint64_t in, uint8_t **out_bits_p);
 
+/// Decodes a BCH-coded matrix code using Berlekamp's algorithm.
+/// For AR_MATRIX_CODE_GLOBAL_ID, the received bits are passed in recd127[], otherwise in the low bits of in.
+/// Returns the number of errors corrected, or -1 if the errors could not be corrected.
+int decode_bch(const AR_MATRIX_CODE_TYPE matrixCodeType, const uint64_t in, uint8_t recd127[127], uint64_t *out_p);
+
+/// Syndrome lookup table for decoding one of the 4x4 and 5x5 BCH matrix code types.
+/// The syndrome used is the remainder of the received word on division by the code's
+/// generator polynomial g(x). Every word of degree less than that of g(x) is its own
+/// syndrome, so the table is filled by decoding each of those with decode_bch().
+struct _ARMatrixCodeBCHTable {
+    int       length;       ///< Number of bits in a codeword.
+    int       k;            ///< Number of data bits in a codeword, held in its top k bits.
+    uint32_t  syn[3][256];  ///< Syndrome of each value of each byte of a received word.
+    int32_t  *entry;        ///< For each syndrome, -1 if uncorrectable, or otherwise (errors corrected << 16) | (mask to XOR with the data bits).
+};
+
+/// The matrix code types decoded by lookup table, in the order of ARPattHandle.bchTables.
+extern const AR_MATRIX_CODE_TYPE bchTableTypes[AR_MATRIX_CODE_BCH_TABLE_NUM];
+
+/// Returns the index of the matrix code type in ARPattHandle.bchTables, or -1 if it is not decoded by lookup table.
+int bchTableIndex(const AR_MATRIX_CODE_TYPE matrixCodeType);
+
+/// Caller must free the result with bchTableFree().
+/// Returns NULL if the matrix code type is not decoded by lookup table.
+ARMatrixCodeBCHTable *bchTableCreate(const AR_MATRIX_CODE_TYPE matrixCodeType);
+
+/// Builds the pattern handle's lookup table for the matrix code type, if it is decoded by lookup
+/// table and the table has not been built. Not thread safe: the handle must not be in use for decoding.
+void bchTableEnsure(ARPattHandle *pattHandle, const AR_MATRIX_CODE_TYPE matrixCodeType);
+
+void bchTableFree(ARMatrixCodeBCHTable **table_p);
+
+/// As decode_bch(), with identical results, but using a lookup table.
+static inline int decode_bch_table(const ARMatrixCodeBCHTable *table, const uint64_t in, uint64_t *out_p)
+{
+    uint32_t s = table->syn[0][in & 0xff] ^ table->syn[1][(in >> 8) & 0xff] ^ table->syn[2][(in >> 16) & 0xff];
+    int32_t e = table->entry[s];
+    if (e < 0) return (-1);
+    *out_p = ((in >> (table->length - table->k)) & ((1u << table->k) - 1u)) ^ (uint64_t)(e & 0xffff);
+    return (e >> 16);
+}
+
 #ifdef __cplusplus
 }
 #endif
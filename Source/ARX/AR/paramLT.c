@@ -39,15 +39,354 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 #include <ARX/AR/ar.h>
 #include <ARX/AR/param.h>
+#ifdef _WIN32
+#  include <process.h> // _getpid()
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
 
+#define AR_PARAM_LT_CACHE_MAGIC     0x41524C54u // 'ARLT'
+#define AR_PARAM_LT_CACHE_VERSION   1
+#define AR_PARAM_LTI_SHIFT_MAX      8           // Finest fixed-point resolution of compact tables, 1/256 pixel.
+
+// Everything the tables depend on. Also the input to the hash which names the cache file.
+typedef struct {
+    uint32_t     magic;
+    uint32_t     version;
+    uint32_t     ardoubleSize;
+    int32_t      type;
+    int32_t      offset;
+    int32_t      xsize;
+    int32_t      ysize;
+    int32_t      dist_function_version;
+    ARdouble     mat[3][4];
+    ARdouble     dist_factor[AR_DIST_FACTOR_NUM_MAX];
+} ARParamLTCacheKey;
+
+typedef struct {
+    ARParamLTCacheKey key;
+    int32_t      ltiXsize;
+    int32_t      ltiYsize;
+    int32_t      ltiStep;
+    int32_t      ltiShift;
+    uint64_t     tablesSize;    // Bytes of i2o then o2i tables, following the header.
+} ARParamLTCacheHeader;
+
+// Tables start this many bytes into the cache file, keeping them aligned when mapped.
+#define AR_PARAM_LT_CACHE_HEADER_SIZE ((sizeof(ARParamLTCacheHeader) + 15) & ~((size_t)15))
+
+
+static void paramLTSetSize( ARParamLT *paramLT, int offset, int type )
+{
+    paramLT->paramLTf.xsize = paramLT->param.xsize + offset*2;
+    paramLT->paramLTf.ysize = paramLT->param.ysize + offset*2;
+    paramLT->paramLTf.xOff = offset;
+    paramLT->paramLTf.yOff = offset;
+    if( type == AR_PARAM_LT_TYPE_COMPACT ) {
+        // Enough entries that every location accepted by the lookup lies between four of them.
+        paramLT->paramLTi.step = AR_PARAM_LTI_STEP;
+        paramLT->paramLTi.xsize = (paramLT->paramLTf.xsize + AR_PARAM_LTI_STEP - 1)/AR_PARAM_LTI_STEP + 1;
+        paramLT->paramLTi.ysize = (paramLT->paramLTf.ysize + AR_PARAM_LTI_STEP - 1)/AR_PARAM_LTI_STEP + 1;
+        paramLT->paramLTf.paramLTi = &paramLT->paramLTi;
+    }
+}
+
+static void paramLTfFill( ARParamLT *paramLT, int offset )
+{
+    ARdouble    *dist_factor;
+    int          dist_function_version;
+    ARdouble     ix, iy;
+    ARdouble     ox, oy;
+    float       *i2of, *o2if;
+    int          i, j;
+    
+    arMalloc(paramLT->paramLTf.i2o, float, paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2);
+    arMalloc(paramLT->paramLTf.o2i, float, paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2);
+    
+    dist_factor = paramLT->param.dist_factor;
+    dist_function_version = paramLT->param.dist_function_version;
+    i2of = paramLT->paramLTf.i2o;
+    o2if = paramLT->paramLTf.o2i;
+    for( j = 0; j < paramLT->paramLTf.ysize; j++ ) {
+        for( i = 0; i < paramLT->paramLTf.xsize; i++ ) {
+            arParamIdeal2Observ( dist_factor, (float)(i-offset), (float)(j-offset), &ox, &oy, dist_function_version);
+            *(i2of++) = (float)ox;
+            *(i2of++) = (float)oy;
+            arParamObserv2Ideal( dist_factor, (float)(i-offset), (float)(j-offset), &ix, &iy, dist_function_version);
+            *(o2if++) = (float)ix;
+            *(o2if++) = (float)iy;
+        }
+    }
+}
+
+static short paramLTiQuantize( float v )
+{
+    v = floorf(v + 0.5f);
+    if( v != v ) return 0;
+    if( v >  32767.0f ) return  32767;
+    if( v < -32767.0f ) return -32767;
+    return (short)v;
+}
+
+static void paramLTiFill( ARParamLT *paramLT, int offset )
+{
+    ARParamLTi  *paramLTi = &paramLT->paramLTi;
+    ARdouble    *dist_factor;
+    int          dist_function_version;
+    ARdouble     ix, iy;
+    ARdouble     ox, oy;
+    float        x, y, d, dMax, scale;
+    float       *i2od, *o2id;
+    int          n, i, j, k;
+
+    n = paramLTi->xsize*paramLTi->ysize*2;
+    arMalloc(i2od, float, n);
+    arMalloc(o2id, float, n);
+
+    // Displacements at each entry, and the largest, which sets the resolution they can be stored at.
+    dist_factor = paramLT->param.dist_factor;
+    dist_function_version = paramLT->param.dist_function_version;
+    dMax = 0.0f;
+    k = 0;
+    for( j = 0; j < paramLTi->ysize; j++ ) {
+        y = (float)(j*paramLTi->step - offset);
+        for( i = 0; i < paramLTi->xsize; i++ ) {
+            x = (float)(i*paramLTi->step - offset);
+            arParamIdeal2Observ( dist_factor, x, y, &ox, &oy, dist_function_version);
+            arParamObserv2Ideal( dist_factor, x, y, &ix, &iy, dist_function_version);
+            i2od[k]   = (float)ox - x;
+            i2od[k+1] = (float)oy - y;
+            o2id[k]   = (float)ix - x;
+            o2id[k+1] = (float)iy - y;
+            if( (d = fabsf(i2od[k]))   > dMax ) dMax = d;
+            if( (d = fabsf(i2od[k+1])) > dMax ) dMax = d;
+            if( (d = fabsf(o2id[k]))   > dMax ) dMax = d;
+            if( (d = fabsf(o2id[k+1])) > dMax ) dMax = d;
+            k += 2;
+        }
+    }
+    paramLTi->shift = AR_PARAM_LTI_SHIFT_MAX;
+    while( paramLTi->shift > 0 && dMax*(float)(1 << paramLTi->shift) > 32767.0f ) paramLTi->shift--;
+
+    arMalloc(paramLTi->i2o, short, n);
+    arMalloc(paramLTi->o2i, short, n);
+    scale = (float)(1 << paramLTi->shift);
+    for( k = 0; k < n; k++ ) {
+        paramLTi->i2o[k] = paramLTiQuantize(i2od[k]*scale);
+        paramLTi->o2i[k] = paramLTiQuantize(o2id[k]*scale);
+    }
+    free(i2od);
+    free(o2id);
+}
+
+static size_t paramLTTablesSize( const ARParamLT *paramLT )
+{
+    if( paramLT->paramLTf.paramLTi ) return (size_t)paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2*sizeof(short)*2;
+    else                             return (size_t)paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2*sizeof(float)*2;
+}
+
+static void paramLTCacheHeaderInit( ARParamLTCacheHeader *header, const ARParamLT *paramLT, int offset, int type )
+{
+    // Cleared first so that padding, if any, compares and hashes equal.
+    memset(header, 0, sizeof(ARParamLTCacheHeader));
+    header->key.magic = AR_PARAM_LT_CACHE_MAGIC;
+    header->key.version = AR_PARAM_LT_CACHE_VERSION;
+    header->key.ardoubleSize = sizeof(ARdouble);
+    header->key.type = type;
+    header->key.offset = offset;
+    header->key.xsize = paramLT->param.xsize;
+    header->key.ysize = paramLT->param.ysize;
+    header->key.dist_function_version = paramLT->param.dist_function_version;
+    memcpy(header->key.mat, paramLT->param.mat, sizeof(header->key.mat));
+    memcpy(header->key.dist_factor, paramLT->param.dist_factor, sizeof(header->key.dist_factor));
+    header->ltiXsize = paramLT->paramLTi.xsize;
+    header->ltiYsize = paramLT->paramLTi.ysize;
+    header->ltiStep = paramLT->paramLTi.step;
+    header->tablesSize = paramLTTablesSize(paramLT);
+}
+
+// <cacheDir>/paramLT-<64-bit FNV-1a hash of the key>.lt
+static char *paramLTCachePath( const char *cacheDir, const ARParamLTCacheKey *key )
+{
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t             hash = 0xcbf29ce484222325ull;
+    char                *path;
+    size_t               len, i;
+
+    for( i = 0; i < sizeof(ARParamLTCacheKey); i++ ) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    len = strlen(cacheDir) + 30;
+    arMalloc(path, char, len);
+    snprintf(path, len, "%s/paramLT-%016llx.lt", cacheDir, (unsigned long long)hash);
+    return path;
+}
+
+// Points the tables of paramLT into the cache file, if it matches 'header'.
+static int paramLTCacheLoad( ARParamLT *paramLT, const char *path, const ARParamLTCacheHeader *header )
+{
+    const size_t                 size = AR_PARAM_LT_CACHE_HEADER_SIZE + (size_t)header->tablesSize;
+    const ARParamLTCacheHeader  *h;
+    void                        *map;
+    char                        *tables;
+#ifdef _WIN32
+    FILE                        *fp;
+
+    if( (fp = fopen(path, "rb")) == NULL ) return -1;
+    arMalloc(map, char, size);
+    if( fread(map, 1, size, fp) != size || fgetc(fp) != EOF ) {
+        fclose(fp);
+        free(map);
+        return -1;
+    }
+    fclose(fp);
+#else
+    struct stat                  st;
+    int                          fd;
+
+    if( (fd = open(path, O_RDONLY)) < 0 ) return -1;
+    if( fstat(fd, &st) < 0 || (size_t)st.st_size != size ) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if( map == MAP_FAILED ) return -1;
+#endif
+
+    h = (const ARParamLTCacheHeader *)map;
+    if( memcmp(&h->key, &header->key, sizeof(ARParamLTCacheKey)) != 0 ||
+        h->ltiXsize != header->ltiXsize || h->ltiYsize != header->ltiYsize || h->ltiStep != header->ltiStep ||
+        h->ltiShift < 0 || h->ltiShift > AR_PARAM_LTI_SHIFT_MAX || h->tablesSize != header->tablesSize ) {
+        ARLOGw("Ignoring stale lookup table cache file '%s'.\n", path);
+#ifdef _WIN32
+        free(map);
+#else
+        munmap(map, size);
+#endif
+        return -1;
+    }
+
+    tables = (char *)map + AR_PARAM_LT_CACHE_HEADER_SIZE;
+    if( paramLT->paramLTf.paramLTi ) {
+        paramLT->paramLTi.i2o = (short *)tables;
+        paramLT->paramLTi.o2i = (short *)(tables + header->tablesSize/2);
+        paramLT->paramLTi.shift = h->ltiShift;
+    } else {
+        paramLT->paramLTf.i2o = (float *)tables;
+        paramLT->paramLTf.o2i = (float *)(tables + header->tablesSize/2);
+    }
+    paramLT->cacheMap = map;
+    paramLT->cacheMapSize = size;
+    return 0;
+}
+
+// Writes 'header', completed with the shift of compact tables, followed by the tables.
+static int paramLTWrite( FILE *fp, const ARParamLT *paramLT, ARParamLTCacheHeader *header )
+{
+    unsigned char headerBuf[AR_PARAM_LT_CACHE_HEADER_SIZE];
+    const void   *i2o, *o2i;
+
+    if( paramLT->paramLTf.paramLTi ) {
+        header->ltiShift = paramLT->paramLTi.shift;
+        i2o = paramLT->paramLTi.i2o;
+        o2i = paramLT->paramLTi.o2i;
+    } else {
+        i2o = paramLT->paramLTf.i2o;
+        o2i = paramLT->paramLTf.o2i;
+    }
+    memset(headerBuf, 0, sizeof(headerBuf));
+    memcpy(headerBuf, header, sizeof(ARParamLTCacheHeader));
+    if( fwrite(headerBuf, sizeof(headerBuf), 1, fp) != 1 ||
+        fwrite(i2o, header->tablesSize/2, 1, fp) != 1 ||
+        fwrite(o2i, header->tablesSize/2, 1, fp) != 1 ) return -1;
+    return 0;
+}
+
+// Writes to a temporary file then renames it, so that a partially-written file is never read.
+static int paramLTCacheSave( const ARParamLT *paramLT, const char *path, ARParamLTCacheHeader *header )
+{
+    char         *tmpPath;
+    size_t        len;
+    FILE         *fp;
+    int           ok;
+
+    len = strlen(path) + 16;
+    arMalloc(tmpPath, char, len);
+    snprintf(tmpPath, len, "%s.%d.tmp", path, (int)getpid());
+    if( (fp = fopen(tmpPath, "wb")) == NULL ) {
+        ARLOGw("Unable to write lookup table cache file '%s'.\n", tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    ok = paramLTWrite( fp, paramLT, header ) == 0;
+    if( fclose(fp) != 0 ) ok = 0;
+#ifdef _WIN32
+    if( ok ) remove(path); // rename() will not replace an existing file.
+#endif
+    if( !ok || rename(tmpPath, path) != 0 ) {
+        ARLOGw("Unable to write lookup table cache file '%s'.\n", path);
+        remove(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    free(tmpPath);
+    return 0;
+}
+
+// Layout of the files written by arParamLTSave() before it wrote a header, which was the raw
+// ARParamLT of the time followed by the floating point tables. Only readable on the same platform.
+typedef struct {
+    ARParam      param;
+    float       *i2o;
+    float       *o2i;
+    int          xsize;
+    int          ysize;
+    int          xOff;
+    int          yOff;
+} ARParamLTLegacy;
+
+static ARParamLT *paramLTLoadLegacy( FILE *fp, long fileSize )
+{
+    ARParamLTLegacy  legacy;
+    ARParamLT       *paramLT;
+    size_t           n;
+
+    if( fileSize < (long)sizeof(ARParamLTLegacy) ) return NULL;
+    if( fseek(fp, 0, SEEK_SET) != 0 || fread(&legacy, sizeof(ARParamLTLegacy), 1, fp) != 1 ) return NULL;
+    if( legacy.param.xsize <= 0 || legacy.param.ysize <= 0 || legacy.xOff < 0 || legacy.xOff != legacy.yOff ||
+        legacy.xsize != legacy.param.xsize + legacy.xOff*2 || legacy.ysize != legacy.param.ysize + legacy.yOff*2 ) return NULL;
+    n = (size_t)legacy.xsize*legacy.ysize*2;
+    if( (uint64_t)fileSize != sizeof(ARParamLTLegacy) + (uint64_t)n*sizeof(float)*2 ) return NULL;
+
+    arMallocClear(paramLT, ARParamLT, 1);
+    paramLT->param = legacy.param;
+    paramLTSetSize( paramLT, legacy.xOff, AR_PARAM_LT_TYPE_FLOAT );
+    arMalloc(paramLT->paramLTf.i2o, float, n);
+    arMalloc(paramLT->paramLTf.o2i, float, n);
+    if( fread(paramLT->paramLTf.i2o, sizeof(float), n, fp) != n ||
+        fread(paramLT->paramLTf.o2i, sizeof(float), n, fp) != n ) {
+        arParamLTFree( &paramLT );
+        return NULL;
+    }
+    return paramLT;
+}
 
 int arParamLTSave( char *filename, char *ext, ARParamLT *paramLT )
 {
+    ARParamLTCacheHeader  header;
     FILE  *fp;
     char *buf;
     size_t len;
+    int    ok;
 
     len = strlen(filename) + strlen(ext) + 2;
     arMalloc(buf, char, len);
@@ -59,42 +398,23 @@ int arParamLTSave( char *filename, char *ext, ARParamLT *paramLT )
     }
     free(buf);
 
-    if( fwrite( paramLT, sizeof(ARParamLT), 1, fp ) != 1 ) {
-        fclose(fp);
-        return -1;
-    }
-    if( fwrite( paramLT->paramLTf.i2o, sizeof(float), paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2, fp )
-       != paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2 ) {
-        fclose(fp);
-        return -1;
-    }
-    if( fwrite( paramLT->paramLTf.o2i, sizeof(float), paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2, fp )
-       != paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2 ) {
-        fclose(fp);
-        return -1;
-    }
-    //if( fwrite( paramLT->paramLTi.i2o, sizeof(short), paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2, fp )
-    //   != paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2 ) {
-    //    fclose(fp);
-    //    return -1;
-    //}
-    //if( fwrite( paramLT->paramLTi.o2i, sizeof(short), paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2, fp )
-    //   != paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2 ) {
-    //    fclose(fp);
-    //    return -1;
-    //}
-
-    fclose(fp);
-    
-    return 0;
+    // Same format as the cache files of arParamLTCreate2().
+    paramLTCacheHeaderInit( &header, paramLT, paramLT->paramLTf.xOff,
+                            (paramLT->paramLTf.paramLTi ? AR_PARAM_LT_TYPE_COMPACT : AR_PARAM_LT_TYPE_FLOAT) );
+    ok = paramLTWrite( fp, paramLT, &header ) == 0;
+    if( fclose(fp) != 0 ) ok = 0;
+    return (ok ? 0 : -1);
 }
 
 ARParamLT *arParamLTLoad( char *filename, char *ext )
 {
-    FILE        *fp;
-    ARParamLT   *paramLT;
-    char *buf;
-    size_t len;
+    unsigned char         headerBuf[AR_PARAM_LT_CACHE_HEADER_SIZE];
+    ARParamLTCacheHeader  h, expected;
+    ARParamLT            *paramLT;
+    FILE                 *fp;
+    char                 *buf;
+    size_t                len;
+    long                  fileSize;
 
     len = strlen(filename) + strlen(ext) + 2;
     arMalloc(buf, char, len);
@@ -104,116 +424,109 @@ ARParamLT *arParamLTLoad( char *filename, char *ext )
         free(buf);
         return NULL;
     }
-    free(buf);
-    
-    arMalloc(paramLT, ARParamLT, 1);
-    
-    if( fread( paramLT, sizeof(ARParamLT), 1, fp ) != 1 ) {
-        fclose(fp);
-        free(paramLT);
-        return NULL;
+    if( fseek(fp, 0, SEEK_END) != 0 || (fileSize = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0 ) {
+        ARLOGe("Error: Unable to read file '%s'.\n", buf);
+        goto bail;
     }
 
-    arMalloc(paramLT->paramLTf.i2o, float, paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2);
-    arMalloc(paramLT->paramLTf.o2i, float, paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2);
-    //arMalloc(paramLT->paramLTi.i2o, short, paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2);
-    //arMalloc(paramLT->paramLTi.o2i, short, paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2);
-
-    if( fread( paramLT->paramLTf.i2o, sizeof(float), paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2, fp )
-       != paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2 ) {
-        free(paramLT->paramLTf.i2o);
-        free(paramLT->paramLTf.o2i);
-        //free(paramLT->paramLTi.i2o);
-        //free(paramLT->paramLTi.o2i);
-        free(paramLT);
+    memset(headerBuf, 0, sizeof(headerBuf));
+    if( fread(headerBuf, sizeof(headerBuf), 1, fp) != 1 ) clearerr(fp);
+    memcpy(&h, headerBuf, sizeof(h));
+    if( h.key.magic != AR_PARAM_LT_CACHE_MAGIC ) {
+        if( (paramLT = paramLTLoadLegacy( fp, fileSize )) == NULL ) {
+            ARLOGe("Error: '%s' is not a lookup table file.\n", buf);
+            goto bail;
+        }
         fclose(fp);
-        return NULL;
+        free(buf);
+        return paramLT;
+    }
+    if( h.key.version != AR_PARAM_LT_CACHE_VERSION || h.key.ardoubleSize != sizeof(ARdouble) ) {
+        ARLOGe("Error: Lookup table file '%s' is version %u with %u-byte ARdouble, expected version %d with %d-byte ARdouble.\n",
+               buf, (unsigned)h.key.version, (unsigned)h.key.ardoubleSize, AR_PARAM_LT_CACHE_VERSION, (int)sizeof(ARdouble));
+        goto bail;
+    }
+    if( (h.key.type != AR_PARAM_LT_TYPE_FLOAT && h.key.type != AR_PARAM_LT_TYPE_COMPACT) || h.key.offset < 0 ||
+        h.key.xsize <= 0 || h.key.ysize <= 0 || h.key.xsize > 65536 || h.key.ysize > 65536 || h.key.offset > 65536 ) {
+        ARLOGe("Error: Lookup table file '%s' is corrupt.\n", buf);
+        goto bail;
     }
-    if( fread( paramLT->paramLTf.o2i, sizeof(float), paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2, fp )
-       != paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2 ) {
-        free(paramLT->paramLTf.i2o);
-        free(paramLT->paramLTf.o2i);
-        //free(paramLT->paramLTi.i2o);
-        //free(paramLT->paramLTi.o2i);
+
+    arMallocClear(paramLT, ARParamLT, 1);
+    paramLT->param.xsize = h.key.xsize;
+    paramLT->param.ysize = h.key.ysize;
+    paramLT->param.dist_function_version = h.key.dist_function_version;
+    memcpy(paramLT->param.mat, h.key.mat, sizeof(h.key.mat));
+    memcpy(paramLT->param.dist_factor, h.key.dist_factor, sizeof(h.key.dist_factor));
+    paramLTSetSize( paramLT, h.key.offset, h.key.type );
+    paramLTCacheHeaderInit( &expected, paramLT, h.key.offset, h.key.type );
+    if( h.ltiXsize != expected.ltiXsize || h.ltiYsize != expected.ltiYsize || h.ltiStep != expected.ltiStep ||
+        h.ltiShift < 0 || h.ltiShift > AR_PARAM_LTI_SHIFT_MAX || h.tablesSize != expected.tablesSize ||
+        (uint64_t)fileSize != AR_PARAM_LT_CACHE_HEADER_SIZE + h.tablesSize ) {
+        ARLOGe("Error: Lookup table file '%s' is corrupt.\n", buf);
         free(paramLT);
-        fclose(fp);
-        return NULL;
+        goto bail;
+    }
+    len = (size_t)h.tablesSize/2;
+    if( paramLT->paramLTf.paramLTi ) {
+        paramLT->paramLTi.shift = h.ltiShift;
+        arMalloc(paramLT->paramLTi.i2o, short, len/sizeof(short));
+        arMalloc(paramLT->paramLTi.o2i, short, len/sizeof(short));
+        if( fread(paramLT->paramLTi.i2o, len, 1, fp) != 1 || fread(paramLT->paramLTi.o2i, len, 1, fp) != 1 ) goto bail1;
+    } else {
+        arMalloc(paramLT->paramLTf.i2o, float, len/sizeof(float));
+        arMalloc(paramLT->paramLTf.o2i, float, len/sizeof(float));
+        if( fread(paramLT->paramLTf.i2o, len, 1, fp) != 1 || fread(paramLT->paramLTf.o2i, len, 1, fp) != 1 ) goto bail1;
     }
-    //if( fread( paramLT->paramLTi.i2o, sizeof(short), paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2, fp )
-    //   != paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2 ) {
-    //    free(paramLT->paramLTf.i2o);
-    //    free(paramLT->paramLTf.o2i);
-    //    free(paramLT->paramLTi.i2o);
-    //    free(paramLT->paramLTi.o2i);
-    //    free(paramLT);
-    //    fclose(fp);
-    //    return NULL;
-    //}
-    //if( fread( paramLT->paramLTi.o2i, sizeof(short), paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2, fp )
-    //   != paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2 ) {
-    //    free(paramLT->paramLTf.i2o);
-    //    free(paramLT->paramLTf.o2i);
-    //    free(paramLT->paramLTi.i2o);
-    //    free(paramLT->paramLTi.o2i);
-    //    free(paramLT);
-    //    fclose(fp);
-    //    return NULL;
-    //}
-    
     fclose(fp);
-    
+    free(buf);
     return paramLT;
 
+bail1:
+    ARLOGe("Error: Unable to read file '%s'.\n", buf);
+    arParamLTFree( &paramLT );
+bail:
+    fclose(fp);
+    free(buf);
+    return NULL;
 }
 
 ARParamLT  *arParamLTCreate( ARParam *param, int offset )
 {
-    ARParamLT   *paramLT;
-    ARdouble    *dist_factor;
-    int          dist_function_version;
-    ARdouble     ix, iy;
-    ARdouble     ox, oy;
-    float       *i2of, *o2if;
-    //short       *i2oi, *o2ii;
-    int          i, j;
+    return arParamLTCreate2( param, offset, AR_PARAM_LT_TYPE_FLOAT, NULL );
+}
+
+ARParamLT  *arParamLTCreate2( ARParam *param, int offset, int type, const char *cacheDir )
+{
+    ARParamLT            *paramLT;
+    ARParamLTCacheHeader  header;
+    char                 *cachePath = NULL;
+
+    if( !param || offset < 0 || (type != AR_PARAM_LT_TYPE_FLOAT && type != AR_PARAM_LT_TYPE_COMPACT) ) {
+        ARLOGe("arParamLTCreate2(): invalid parameter.\n");
+        return NULL;
+    }
     
-    arMalloc(paramLT, ARParamLT, 1);
+    arMallocClear(paramLT, ARParamLT, 1);
     paramLT->param = *param;
-    
-    paramLT->paramLTf.xsize = param->xsize + offset*2;
-    paramLT->paramLTf.ysize = param->ysize + offset*2;
-    paramLT->paramLTf.xOff = offset;
-    paramLT->paramLTf.yOff = offset;
-    arMalloc(paramLT->paramLTf.i2o, float, paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2);
-    arMalloc(paramLT->paramLTf.o2i, float, paramLT->paramLTf.xsize*paramLT->paramLTf.ysize*2);
-    
-    //paramLT->paramLTi.xsize = param->xsize + offset*2;
-    //paramLT->paramLTi.ysize = param->ysize + offset*2;
-    //paramLT->paramLTi.xOff = offset;
-    //paramLT->paramLTi.yOff = offset;
-    //arMalloc(paramLT->paramLTi.i2o, short, paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2);
-    //arMalloc(paramLT->paramLTi.o2i, short, paramLT->paramLTi.xsize*paramLT->paramLTi.ysize*2);
-    
-    dist_factor = param->dist_factor;
-    dist_function_version = param->dist_function_version;
-    i2of = paramLT->paramLTf.i2o;
-    o2if = paramLT->paramLTf.o2i;
-    //i2oi = paramLT->paramLTi.i2o;
-    //o2ii = paramLT->paramLTi.o2i;
-    for( j = 0; j < paramLT->paramLTf.ysize; j++ ) {
-        for( i = 0; i < paramLT->paramLTf.xsize; i++ ) {
-            arParamIdeal2Observ( dist_factor, (float)(i-offset), (float)(j-offset), &ox, &oy, dist_function_version);
-            *(i2of++) = (float)ox;
-            //*(i2oi++) = (int)(ox+0.5F);
-            *(i2of++) = (float)oy;
-            //*(i2oi++) = (int)(oy+0.5F);
-            arParamObserv2Ideal( dist_factor, (float)(i-offset), (float)(j-offset), &ix, &iy, dist_function_version);
-            *(o2if++) = (float)ix;
-            //*(o2ii++) = (int)(ix+0.5F);
-            *(o2if++) = (float)iy;
-            //*(o2ii++) = (int)(iy+0.5F);
+    paramLTSetSize( paramLT, offset, type );
+
+    if( cacheDir ) {
+        paramLTCacheHeaderInit( &header, paramLT, offset, type );
+        cachePath = paramLTCachePath( cacheDir, &header.key );
+        if( paramLTCacheLoad( paramLT, cachePath, &header ) == 0 ) {
+            free(cachePath);
+            return paramLT;
         }
     }
+
+    if( type == AR_PARAM_LT_TYPE_COMPACT ) paramLTiFill( paramLT, offset );
+    else                                   paramLTfFill( paramLT, offset );
+
+    if( cachePath ) {
+        paramLTCacheSave( paramLT, cachePath, &header );
+        free(cachePath);
+    }
     
     return paramLT;
 }
@@ -222,38 +535,65 @@ int arParamLTFree( ARParamLT **paramLT_p )
 {
     if (!paramLT_p || !(*paramLT_p)) return (-1);
     
-    free((*paramLT_p)->paramLTf.i2o);
-    free((*paramLT_p)->paramLTf.o2i);
-    //free((*paramLT_p)->paramLTi.i2o);
-    //free((*paramLT_p)->paramLTi.o2i);
+    if ((*paramLT_p)->cacheMap) {
+#ifdef _WIN32
+        free((*paramLT_p)->cacheMap);
+#else
+        munmap((*paramLT_p)->cacheMap, (*paramLT_p)->cacheMapSize);
+#endif
+    } else {
+        free((*paramLT_p)->paramLTf.i2o);
+        free((*paramLT_p)->paramLTf.o2i);
+        free((*paramLT_p)->paramLTi.i2o);
+        free((*paramLT_p)->paramLTi.o2i);
+    }
     free(*paramLT_p);
     *paramLT_p = NULL;
     return 0;
 }
 
-/*
-int arParamIdeal2ObservLTi( const ARParamLTi *paramLTi, const int    ix, const int    iy, int    *ox, int    *oy)
+// Lookup in a compact table. The same locations are accepted as by the floating point table, but
+// rather than rounding to the nearest entry, the displacement is interpolated bilinearly.
+static int paramLTiLookup( const ARParamLTf *paramLTf, const short *lt, const float x, const float y, float *xOut, float *yOut )
 {
-    int      px, py;
-    short   *lt;
-    
-    px = ix + paramLTi->xOff;
-    py = iy + paramLTi->yOff;
-    if( px < 0 || px >= paramLTi->xsize ||
-        py < 0 || py >= paramLTi->ysize ) return -1;
-    
-    lt = paramLTi->i2o+ (py*paramLTi->xsize + px)*2;
-    *ox = *(lt++);
-    *oy = *lt;
+    const ARParamLTi *paramLTi = paramLTf->paramLTi;
+    const short      *p0, *p1;
+    float             gx, gy, fx, fy, dx, dy, scale;
+    int               px, py;
+
+    px = (int)(x+0.5F) + paramLTf->xOff;
+    py = (int)(y+0.5F) + paramLTf->yOff;
+    if( px < 0 || px >= paramLTf->xsize ||
+        py < 0 || py >= paramLTf->ysize ) return -1;
+
+    gx = (x + (float)paramLTf->xOff)/(float)paramLTi->step;
+    gy = (y + (float)paramLTf->yOff)/(float)paramLTi->step;
+    if( gx < 0.0f ) gx = 0.0f;
+    if( gy < 0.0f ) gy = 0.0f;
+    px = (int)gx;
+    py = (int)gy;
+    if( px > paramLTi->xsize - 2 ) px = paramLTi->xsize - 2;
+    if( py > paramLTi->ysize - 2 ) py = paramLTi->ysize - 2;
+    fx = gx - (float)px;
+    fy = gy - (float)py;
+
+    p0 = lt + (py*paramLTi->xsize + px)*2;
+    p1 = p0 + paramLTi->xsize*2;
+    dx = (1.0f - fy)*((1.0f - fx)*p0[0] + fx*p0[2]) + fy*((1.0f - fx)*p1[0] + fx*p1[2]);
+    dy = (1.0f - fy)*((1.0f - fx)*p0[1] + fx*p0[3]) + fy*((1.0f - fx)*p1[1] + fx*p1[3]);
+    scale = 1.0f/(float)(1 << paramLTi->shift);
+    *xOut = x + dx*scale;
+    *yOut = y + dy*scale;
     return 0;
 }
-*/
 
 int arParamIdeal2ObservLTf( const ARParamLTf *paramLTf, const float  ix, const float  iy, float  *ox, float  *oy)
 {
     int      px, py;
     float   *lt;
     
+    if( paramLTf->paramLTi ) return paramLTiLookup( paramLTf, paramLTf->paramLTi->i2o, ix, iy, ox, oy );
+
     px = (int)(ix+0.5F) + paramLTf->xOff;
     py = (int)(iy+0.5F) + paramLTf->yOff;
     if( px < 0 || px >= paramLTf->xsize ||
@@ -265,29 +605,13 @@ int arParamIdeal2ObservLTf( const ARParamLTf *paramLTf, const float  ix, const f
     return 0;
 }
 
-/*
-int arParamObserv2IdealLTi( const ARParamLTi *paramLTi, const int    ox, const int    oy, int    *ix, int    *iy)
-{
-    int      px, py;
-    short   *lt;
-    
-    px = ox + paramLTi->xOff;
-    py = oy + paramLTi->yOff;
-    if( px < 0 || px >= paramLTi->xsize ||
-        py < 0 || py >= paramLTi->ysize ) return -1;
-
-    lt = paramLTi->o2i+ (py*paramLTi->xsize + px)*2;
-    *ix = *(lt++);
-    *iy = *lt;
-    return 0;
-}
-*/
-
 int arParamObserv2IdealLTf( const ARParamLTf *paramLTf, const float  ox, const float  oy, float  *ix, float  *iy)
 {
     int      px, py;
     float   *lt;
     
+    if( paramLTf->paramLTi ) return paramLTiLookup( paramLTf, paramLTf->paramLTi->o2i, ox, oy, ix, iy );
+
     px = (int)(ox+0.5F) + paramLTf->xOff;
     py = (int)(oy+0.5F) + paramLTf->yOff;
     if( px < 0 || px >= paramLTf->xsize ||
@@ -298,4 +622,3 @@ int arParamObserv2IdealLTf( const ARParamLTf *paramLTf, const float  ox, const f
     *iy = *lt;
     return 0;
 }
-
@@ -88,6 +88,7 @@ static AR2HandleT *ar2CreateHandleSub( int pixFormat, int xsize, int ysize, int
     ar2Handle->blurLevel         = AR2_DEFAULT_BLUR_LEVEL;
 #endif
     ar2Handle->searchSize        = AR2_DEFAULT_SEARCH_SIZE;
+    ar2Handle->searchSizeMode    = AR2_DEFAULT_SEARCH_SIZE_MODE;
     ar2Handle->templateSize1     = AR2_DEFAULT_TS1;
     ar2Handle->templateSize2     = AR2_DEFAULT_TS2;
     ar2Handle->searchFeatureNum  = AR2_DEFAULT_SEARCH_FEATURE_NUM;
@@ -96,6 +97,7 @@ static AR2HandleT *ar2CreateHandleSub( int pixFormat, int xsize, int ysize, int
     }
     ar2Handle->simThresh         = AR2_DEFAULT_SIM_THRESH;
     ar2Handle->trackingThresh    = AR2_DEFAULT_TRACKING_THRESH;
+    ar2Handle->randSeed          = 1;
 
 
 
@@ -111,12 +113,16 @@ static AR2HandleT *ar2CreateHandleSub( int pixFormat, int xsize, int ysize, int
     ar2Handle->threadNum = threadNum;
     ARLOGi("Tracking thread = %d\n", threadNum);
     for( i = 0; i < ar2Handle->threadNum; i++ ) {
-        arMalloc( ar2Handle->arg[i].mfImage, ARUint8, xsize*ysize );
+        ar2Handle->arg[i].ar2Handle = ar2Handle;
+        ar2Handle->arg[i].worker = i;
+        ar2Handle->arg[i].mfImage = NULL; // Allocated on first use, as workers beyond the number of features searched per frame sit idle.
         ar2Handle->arg[i].templ = NULL;
+        ar2Handle->arg[i].subImage = NULL;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
         ar2Handle->arg[i].templ2 = NULL;
 #endif
-        ar2Handle->threadHandle[i] = threadInit(i, &(ar2Handle->arg[i]), ar2Tracking2d);
+        if( i == 0 ) ar2Handle->threadHandle[i] = NULL; // Worker 0 runs on the thread calling ar2Tracking().
+        else         ar2Handle->threadHandle[i] = threadInit(i, &(ar2Handle->arg[i]), ar2Tracking2d);
     }
 
     return ar2Handle;
@@ -129,10 +135,13 @@ int ar2DeleteHandle( AR2HandleT **ar2Handle )
     if( *ar2Handle == NULL ) return -1;
 
     for( i = 0; i < (*ar2Handle)->threadNum; i++ ) {
-        threadWaitQuit( (*ar2Handle)->threadHandle[i] );
-        threadFree( &((*ar2Handle)->threadHandle[i]) );
+        if( (*ar2Handle)->threadHandle[i] != NULL ) {
+            threadWaitQuit( (*ar2Handle)->threadHandle[i] );
+            threadFree( &((*ar2Handle)->threadHandle[i]) );
+        }
         if( (*ar2Handle)->arg[i].mfImage   != NULL )  free( (*ar2Handle)->arg[i].mfImage );
         if( (*ar2Handle)->arg[i].templ  != NULL ) ar2FreeTemplate( (*ar2Handle)->arg[i].templ );
+        if( (*ar2Handle)->arg[i].subImage != NULL ) free( (*ar2Handle)->arg[i].subImage );
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
         if( (*ar2Handle)->arg[i].templ2 != NULL ) ar2FreeTemplate ( (*ar2Handle)->arg[i].templ2 );
 #endif
@@ -233,6 +242,21 @@ int ar2GetSearchSize( AR2HandleT *ar2Handle, int *searchSize )
     return 0;
 }
 
+int ar2SetSearchSizeMode( AR2HandleT *ar2Handle, int searchSizeMode )
+{
+    if( ar2Handle == NULL ) return -1;
+    if( searchSizeMode != AR2_SEARCH_SIZE_FIXED && searchSizeMode != AR2_SEARCH_SIZE_ADAPTIVE ) return -1;
+    ar2Handle->searchSizeMode = searchSizeMode;
+    return 0;
+}
+
+int ar2GetSearchSizeMode( AR2HandleT *ar2Handle, int *searchSizeMode )
+{
+    if( ar2Handle == NULL ) return -1;
+    *searchSizeMode = ar2Handle->searchSizeMode;
+    return 0;
+}
+
 int ar2SetSearchFeatureNum( AR2HandleT *ar2Handle, int searchFeatureNum )
 {
     if( ar2Handle == NULL ) return -1;
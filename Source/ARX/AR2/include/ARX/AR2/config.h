@@ -106,10 +106,15 @@ extern "C" {
 #endif
 
 
-#define AR2_THREAD_MAX                              8
+#define AR2_THREAD_MAX                              64          // Feature searches of a frame are shared among at most this many workers.
 
 #define AR2_DEFAULT_SEARCH_SIZE	                    25          // Default radius of feature search window.
 
+#define AR2_SEARCH_SIZE_FIXED                       0           // Search every feature within the search size.
+#define AR2_SEARCH_SIZE_ADAPTIVE                    1           // Shrink each feature's search window to fit the recent accuracy of its predicted position.
+#define AR2_DEFAULT_SEARCH_SIZE_MODE                AR2_SEARCH_SIZE_FIXED
+#define AR2_ADAPTIVE_SEARCH_SIZE_MIN                4           // Radius of an adaptive search window when positions are predicted exactly.
+
 #define AR2_DEFAULT_SEARCH_FEATURE_NUM	            10          // May not be higher than AR2_SEARCH_FEATURE_MAX.
 
 #define AR2_DEFAULT_TS1                             11          // Template size 1. Multiplied by AR2_TEMP_SCALE to give number of pixels outside centre pixel in negative x/y axis.
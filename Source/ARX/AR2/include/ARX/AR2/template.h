@@ -110,6 +110,13 @@ AR_EXTERN int ar2GetBestMatching ( ARUint8 *img, ARUint8 *mfImage, int xsize, in
                          AR2TemplateT *mtemp, int rx, int ry,
                          int search[3][2], int *bx, int *by, float *val);
 
+// As ar2GetBestMatching(), but with caller-supplied working memory subImage, of ar2GetBestMatchingSubImageSize(mtemp)
+// elements, so that repeated calls with the same template need not allocate.
+AR_EXTERN int ar2GetBestMatchingWithSubImage ( ARUint8 *img, ARUint8 *mfImage, ARUint32 *subImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
+                         AR2TemplateT *mtemp, int rx, int ry,
+                         int search[3][2], int *bx, int *by, float *val);
+AR_EXTERN int ar2GetBestMatchingSubImageSize ( AR2TemplateT *mtemp );
+
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
 AR_EXTERN int ar2GetBestMatching2( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
                          AR2Template2T *mtemp, int rx, int ry,
@@ -126,6 +133,11 @@ AR_EXTERN int ar2GetResolution2( const ARParam *cparam, const float  trans[3][4]
 AR_EXTERN int ar2SelectTemplate( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *prevFeature, int num,
                        float  pos[4][2], int xsize, int ysize );
 
+// As ar2SelectTemplate(), but random selections are drawn from the generator state in *randSeed
+// rather than rand(), so that it may be called concurrently on different candidate sets.
+AR_EXTERN int ar2SelectTemplate2( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *prevFeature, int num,
+                       float  pos[4][2], int xsize, int ysize, unsigned int *randSeed );
+
 
 
 #ifdef __cplusplus
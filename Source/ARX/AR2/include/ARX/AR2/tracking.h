@@ -81,12 +81,14 @@ typedef struct {
     float                 trans3[3][4];
     int                   contNum;
     AR2TemplateCandidateT     prevFeature[AR2_SEARCH_FEATURE_MAX+1];
+    float                 searchResidual; // Smoothed distance of matched features from their predicted positions, in pixels, or < 0 if not known. Used by AR2_SEARCH_SIZE_ADAPTIVE.
 } AR2SurfaceSetT;
 
 typedef struct {
     float             sim;
     float             pos2d[2];
     float             pos3d[3];
+    float             residual;         // Distance (larger of x and y) of pos2d from the nearest predicted position of the feature.
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     int               blurLevel;
 #endif
@@ -96,19 +98,31 @@ typedef struct {
 typedef struct _AR2HandleT           AR2HandleT;
 typedef struct _AR2Tracking2DParamT  AR2Tracking2DParamT;
 
-// Structure to pass parameters to threads spawned to run ar2Tracking2d().
+// One feature search submitted to the tracking workers by ar2Tracking().
+typedef struct {
+    AR2TemplateCandidateT   *candidate;
+    AR2Tracking2DResultT     result;
+    int                      ret;
+} AR2Tracking2DTaskT;
+
+// Per-worker deque of task indices [head, tail), packed as head in the low and tail in the high 32 bits
+// so that the owner (taking from the head) and thieves (taking from the tail) can both claim a task with
+// a single compare-and-swap. Padded to keep each worker's deque on its own cache line.
+typedef struct {
+    volatile uint64_t        range;
+    char                     pad[64 - sizeof(uint64_t)];
+} AR2Tracking2DQueueT;
+
+// Per-worker state of the threads spawned to run ar2Tracking2d(). Worker 0 runs on the thread calling ar2Tracking().
 struct _AR2Tracking2DParamT {
     struct _AR2HandleT      *ar2Handle;  // Reference to parent AR2HandleT.
-    AR2SurfaceSetT          *surfaceSet;
-    AR2TemplateCandidateT   *candidate;
-    ARUint8                 *dataPtr;    // Input image.
-    ARUint8                 *mfImage;    // (Internally allocated buffer same size as input image).
+    int                      worker;     // Index of this worker, and of its deque.
+    ARUint8                 *mfImage;    // (Internally allocated on first use, buffer same size as input image).
     AR2TemplateT            *templ;
+    ARUint32                *subImage;   // (Internally allocated with templ, working memory for ar2GetBestMatchingWithSubImage()).
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     AR2Template2T           *templ2;
 #endif
-    AR2Tracking2DResultT     result;
-    int                      ret;
 };
 
 struct _AR2HandleT {
@@ -123,6 +137,7 @@ struct _AR2HandleT {
     int               blurLevel;
 #endif
     int               searchSize;
+    int               searchSizeMode;
     int               templateSize1;
     int               templateSize2;
     int               searchFeatureNum;
@@ -132,15 +147,24 @@ struct _AR2HandleT {
     float                     wtrans1[AR2_TRACKING_SURFACE_MAX][3][4];
     float                     wtrans2[AR2_TRACKING_SURFACE_MAX][3][4];
     float                     wtrans3[AR2_TRACKING_SURFACE_MAX][3][4];
-    float                     pos[AR2_SEARCH_FEATURE_MAX+AR2_THREAD_MAX][2];
+    float                     pos[AR2_SEARCH_FEATURE_MAX][2];
     float                     pos2d[AR2_SEARCH_FEATURE_MAX][2];
     float                     pos3d[AR2_SEARCH_FEATURE_MAX][3];
     AR2TemplateCandidateT     candidate[AR2_TRACKING_CANDIDATE_MAX+1];
     AR2TemplateCandidateT     candidate2[AR2_TRACKING_CANDIDATE_MAX+1];
     AR2TemplateCandidateT     usedFeature[AR2_SEARCH_FEATURE_MAX];
+    unsigned int              randSeed;  // State of random template selection, private to this handle.
     int                       threadNum;
     struct _AR2Tracking2DParamT       arg[AR2_THREAD_MAX];
-    THREAD_HANDLE_T          *threadHandle[AR2_THREAD_MAX];
+    THREAD_HANDLE_T          *threadHandle[AR2_THREAD_MAX]; // Entry 0 is unused, as worker 0 is the calling thread.
+    // Feature searches of the current call to ar2Tracking().
+    AR2SurfaceSetT           *surfaceSet;
+    ARUint8                  *dataPtr;
+    int                       searchRadius; // Search radius for features at rest, at most searchSize.
+    AR2Tracking2DTaskT        task[AR2_SEARCH_FEATURE_MAX];
+    int                       taskNum;
+    int                       workerNum;
+    AR2Tracking2DQueueT       queue[AR2_THREAD_MAX];
 };
 
 
@@ -170,6 +194,11 @@ struct _AR2HandleT {
 int             ar2Tracking              ( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet,
                                            ARUint8 *dataPtr, float  trans[3][4], float  *err );
 void           *ar2Tracking2d            ( THREAD_HANDLE_T *threadHandle );
+/*
+    Run the ar2Handle->taskNum feature searches in ar2Handle->task[] on the tracking workers,
+    with the calling thread as worker 0, and return once all have completed.
+ */
+void            ar2Tracking2dRun         ( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *dataPtr );
 /*
 int             ar2Tracking2d            ( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet,
                                            AR2TemplateCandidateT *candidate,
@@ -305,6 +334,37 @@ int             ar2SetSearchSize         ( AR2HandleT *ar2Handle, int  searchSiz
  */
 int             ar2GetSearchSize         ( AR2HandleT *ar2Handle, int *searchSize        );
 
+/*!
+    Set how the feature point search window size is chosen.
+        With AR2_SEARCH_SIZE_FIXED, every feature is searched for within the radius set by
+        ar2SetSearchSize().
+
+        With AR2_SEARCH_SIZE_ADAPTIVE, the radius follows how far matched features have recently
+        been from their positions predicted by the previous poses (smoothed across frames, growing
+        at once but shrinking gradually), and is widened for each feature by its own speed across
+        the image. It is never more than the radius set by ar2SetSearchSize(). A feature not
+        matched within a reduced window is searched for again within the full radius. When the
+        camera is nearly still, this cuts most of the search effort.
+
+        Default value is AR2_DEFAULT_SEARCH_SIZE_MODE, as defined in &lt;AR2/config.h&gt;
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchSizeMode AR2_SEARCH_SIZE_FIXED or AR2_SEARCH_SIZE_ADAPTIVE.
+    @result -1 in case of error, or 0 otherwise.
+    @see ar2GetSearchSizeMode ar2GetSearchSizeMode
+    @see ar2SetSearchSize ar2SetSearchSize
+ */
+int             ar2SetSearchSizeMode     ( AR2HandleT *ar2Handle, int  searchSizeMode    );
+
+/*!
+    Get how the feature point search window size is chosen.
+        See the discussion under ar2SetSearchSizeMode.
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchSizeMode Pointer to an int, which on return will be filled with the current mode.
+    @result -1 in case of error, or 0 otherwise.
+    @see ar2SetSearchSizeMode ar2SetSearchSizeMode
+ */
+int             ar2GetSearchSizeMode     ( AR2HandleT *ar2Handle, int *searchSizeMode    );
+
 /*!
     @brief
     @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
@@ -43,6 +43,11 @@
 #include <ARX/AR2/tracking.h>
 #include <ARX/AR2/config.h>
 #include <ARX/AR2/template.h>
+#if HAVE_ARM_NEON || HAVE_ARM64_NEON
+#  include <arm_neon.h>
+#elif HAVE_INTEL_SIMD
+#  include <emmintrin.h> // SSE2.
+#endif
 
 #define  USE_SEARCH1    1
 #define  USE_SEARCH2    1
@@ -60,11 +65,30 @@ static void updateCandidate            ( int x, int y, int wval,
 static int ar2GetBestMatchingSubFineOpt( ARUint8 *img, int xsize, int ysize, int sx1, int sy1, AR2TemplateT *mtemp,
                                          ARUint32 *subImage1, ARUint32 *subImage2, int sx2, int sy2, int *val);
 #endif
+static void ar2MatchingRowSums          ( const ARUint8 *p2, const ARUint16 *p1, int n, int *sum1, int *sum2, int *sum3 );
+static int  ar2MatchingRowDot           ( const ARUint8 *p2, const ARUint16 *p1, int n );
+
+// Size (in ARUint32) of each of the two integral images used to refine the best candidates for template mtemp.
+#define SUB_IMAGE_SIZE(mtemp)  (((mtemp)->xsize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2)) * (((mtemp)->ysize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2))
+
+int ar2GetBestMatchingSubImageSize( AR2TemplateT *mtemp )
+{
+    return 2*SUB_IMAGE_SIZE(mtemp);
+}
+
+int ar2GetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
+                        AR2TemplateT *mtemp, int rx, int ry,
+                         int search[3][2], int *bx, int *by, float *val)
+{
+    return ar2GetBestMatchingWithSubImage(img, mfImage, NULL, xsize, ysize, pixFormat, mtemp, rx, ry, search, bx, by, val);
+}
 
 /*!
     @brief Get best match for a candidate feature template.
     @param img Incoming image to match against.
     @param mfImage Buffer same size as img, to provide working memory for status of matched features.
+    @param subImage Buffer of ar2GetBestMatchingSubImageSize(mtemp) elements, to provide working memory for
+        refinement of the best candidates, or NULL to allocate it for the duration of the call.
     @param xsize Horizontal size of img and mfImage.
     @param ysize Vertical size of img and mfImage.
     @param pixFormat Pixel format of img.
@@ -78,9 +102,9 @@ static int ar2GetBestMatchingSubFineOpt( ARUint8 *img, int xsize, int ysize, int
     @result -1 in case of error or no match, or 0 otherwise.
  */
  
-int ar2GetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
-                        AR2TemplateT *mtemp, int rx, int ry,
-                         int search[3][2], int *bx, int *by, float *val)
+int ar2GetBestMatchingWithSubImage( ARUint8 *img, ARUint8 *mfImage, ARUint32 *subImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
+                                    AR2TemplateT *mtemp, int rx, int ry,
+                                    int search[3][2], int *bx, int *by, float *val)
 {
     int              search_flag[] = {USE_SEARCH1, USE_SEARCH2, USE_SEARCH3};
     int              px, py, sx, sy, ex, ey;
@@ -187,8 +211,9 @@ int ar2GetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR
         }
     }
 #else
-    arMalloc( subImage1, ARUint32, ( (mtemp->xsize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2)) * ((mtemp->ysize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2) ) );
-    arMalloc( subImage2, ARUint32, ( (mtemp->xsize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2)) * ((mtemp->ysize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2) ) );
+    if( subImage ) subImage1 = subImage;
+    else           arMalloc( subImage1, ARUint32, 2*SUB_IMAGE_SIZE(mtemp) );
+    subImage2 = subImage1 + SUB_IMAGE_SIZE(mtemp);
 
     for(l = 0; l < keep_num; l++) {
         if( mtemp->validNum != mtemp->xsize*mtemp->ysize
@@ -229,8 +254,10 @@ int ar2GetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR
                 *(p11++) = 0;
                 *(p21++) = 0;
             }
+            // The integral images' last row and column are never used by ar2GetBestMatchingSubFineOpt(), and the image
+            // pixels they would sum can lie past the end of the image, so they are left unfilled.
             p3 = p4 = &img[py2*xsize + px2];
-            for( j = 0; j < py1; j++ ) {
+            for( j = 0; j < py1 - 1; j++ ) {
                 for( i = 0; i < AR2_TEMP_SCALE; i++ ) {
                     *(p11++) = 0;
                     *(p21++) = 0;
@@ -239,13 +266,15 @@ int ar2GetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR
                 }
                 p12 += AR2_TEMP_SCALE;
                 p22 += AR2_TEMP_SCALE;
-                for( i = 0; i < px3; i++) {
+                for( i = 0; i < px3 - 1; i++) {
                     w1 = subImage11[i%AR2_TEMP_SCALE] += (*p3);
                     w2 = subImage21[i%AR2_TEMP_SCALE] += (*p3)*(*p3);
                     p3++;
                     *(p11++) = w1 + *(p12++);
                     *(p21++) = w2 + *(p22++);
                 }
+                p11++; p12++;
+                p21++; p22++;
                 p3 = p4 += xsize;
             }
             for( j = 0; j < SKIP_INTERVAL*2 + 1; j++ ) {
@@ -265,8 +294,7 @@ int ar2GetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR
             }
         }
     }
-    free(subImage1);
-    free(subImage2);
+    if( !subImage ) free(subImage1);
 #endif
 
     return ret;
@@ -305,18 +333,11 @@ static int ar2GetBestMatchingSubFine( ARUint8 *img, int xsize, int ysize, AR_PIX
         eex =   mtemp->xts2;
         ssy = -(mtemp->yts1);
         eey =   mtemp->yts2;
-        p2 = p3 = &img[((sy + ssy*AR2_TEMP_SCALE)*xsize + sx + ssx*AR2_TEMP_SCALE)];
+        p3 = &img[((sy + ssy*AR2_TEMP_SCALE)*xsize + sx + ssx*AR2_TEMP_SCALE)];
         for( j = ssy; j <= eey; j++ ) {
-            for( i = ssx; i <= eex; i++ ) {
-                if( *p1 != AR2_TEMPLATE_NULL_PIXEL ) {
-                    sum1 += (*p2);
-                    sum2 += (*p2) * (*p2);
-                    sum3 += (*p2) * (*p1);
-                }
-                p2 += AR2_TEMP_SCALE;
-                p1++;
-            }
-            p2 = p3 += AR2_TEMP_SCALE*xsize; // i.e. p3 += AR2_TEMP_SCALE*xsize; p2 = p3;
+            ar2MatchingRowSums(p3, p1, eex - ssx + 1, &sum1, &sum2, &sum3);
+            p1 += eex - ssx + 1;
+            p3 += AR2_TEMP_SCALE*xsize;
         }
 #endif
     }
@@ -409,21 +430,19 @@ static int ar2GetBestMatchingSubFineOpt( ARUint8 *img, int xsize, int ysize, int
                                          ARUint32 *subImage1, ARUint32 *subImage2, int sx2, int sy2, int *val)
 {
     ARUint16            *p1;
-    ARUint8             *p2, *p3;
+    ARUint8             *p3;
     int                  sum1, sum2, sum3;
     int                  vlen;
     int                  subImageXsize, px1, px2, py1, py2;
-    int                  i, j;
+    int                  j;
     
     p1 = mtemp->img1;
     sum3 = 0;
-    p2 = p3 = &img[sy1*xsize + sx1];
+    p3 = &img[sy1*xsize + sx1];
     for( j = 0; j < mtemp->ysize; j++ ) {
-        for( i = 0; i < mtemp->xsize; i++ ) {
-            sum3 += (*p2) * *(p1++);
-            p2 += AR2_TEMP_SCALE;
-        }
-        p2 = p3 += AR2_TEMP_SCALE*xsize;
+        sum3 += ar2MatchingRowDot(p3, p1, mtemp->xsize);
+        p1 += mtemp->xsize;
+        p3 += AR2_TEMP_SCALE*xsize;
     }
 
     subImageXsize = (mtemp->xsize + 1)*AR2_TEMP_SCALE + (SKIP_INTERVAL*2);
@@ -450,6 +469,153 @@ static int ar2GetBestMatchingSubFineOpt( ARUint8 *img, int xsize, int ysize, int
 }
 #endif
 
+// The vector kernels below gather every second image pixel, so are only used when AR2_TEMP_SCALE is 2.
+// Each handles 8 template pixels at a time, and for the last 1-8 pixels of a row reloads the final 8
+// (ending on the row's last sampled pixel, so as never to read past it) and discards the lanes already summed.
+// All arithmetic is exact integer arithmetic, so results are identical to the scalar loops.
+// Define AR2_MATCHING_SIMD to 0 (e.g. by configuring with -DAR2_MATCHING_SIMD=OFF) to use only the scalar loops.
+#ifndef AR2_MATCHING_SIMD
+#  if (HAVE_ARM_NEON || HAVE_ARM64_NEON || HAVE_INTEL_SIMD) && AR2_TEMP_SCALE == 2
+#    define AR2_MATCHING_SIMD 1
+#  else
+#    define AR2_MATCHING_SIMD 0
+#  endif
+#elif AR2_MATCHING_SIMD && !((HAVE_ARM_NEON || HAVE_ARM64_NEON || HAVE_INTEL_SIMD) && AR2_TEMP_SCALE == 2)
+#  undef AR2_MATCHING_SIMD
+#  define AR2_MATCHING_SIMD 0
+#endif
+
+#if AR2_MATCHING_SIMD && (HAVE_ARM_NEON || HAVE_ARM64_NEON)
+static const uint16_t ar2MatchingLane[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+static inline int ar2MatchingHsum( uint32x4_t v )
+{
+#  if defined(__aarch64__) || defined(_M_ARM64)
+    return (int)vaddvq_u32(v);
+#  else
+    uint32x2_t s = vadd_u32(vget_low_u32(v), vget_high_u32(v));
+    return (int)vget_lane_u32(vpadd_u32(s, s), 0);
+#  endif
+}
+#elif AR2_MATCHING_SIMD && HAVE_INTEL_SIMD
+static inline int ar2MatchingHsum( __m128i v )
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+#endif
+
+// Accumulates sum of image pixels, sum of their squares, and their dot product with the template,
+// over one template row of n pixels, skipping template pixels which are AR2_TEMPLATE_NULL_PIXEL.
+static void ar2MatchingRowSums( const ARUint8 *p2, const ARUint16 *p1, int n, int *sum1, int *sum2, int *sum3 )
+{
+    int     i;
+
+#if AR2_MATCHING_SIMD
+    if( n > 8 ) {
+#  if HAVE_ARM_NEON || HAVE_ARM64_NEON
+        const uint16x8_t nul = vdupq_n_u16(AR2_TEMPLATE_NULL_PIXEL);
+        uint32x4_t       s1 = vdupq_n_u32(0), s2 = s1, s3 = s1;
+        uint16x8_t       v, t;
+
+        for( i = 0; i + 8 < n; i += 8 ) {
+            v = vmovl_u8(vld2_u8(p2 + i*2).val[0]);
+            t = vld1q_u16(p1 + i);
+            v = vbicq_u16(v, vceqq_u16(t, nul));
+            s1 = vpadalq_u16(s1, v);
+            s2 = vmlal_u16(vmlal_u16(s2, vget_low_u16(v), vget_low_u16(v)), vget_high_u16(v), vget_high_u16(v));
+            s3 = vmlal_u16(vmlal_u16(s3, vget_low_u16(v), vget_low_u16(t)), vget_high_u16(v), vget_high_u16(t));
+        }
+        v = vmovl_u8(vld2_u8(p2 + n*2 - 17).val[1]);
+        t = vld1q_u16(p1 + n - 8);
+        v = vbicq_u16(v, vorrq_u16(vceqq_u16(t, nul), vcltq_u16(vld1q_u16(ar2MatchingLane), vdupq_n_u16((uint16_t)(8 - (n - i))))));
+        s1 = vpadalq_u16(s1, v);
+        s2 = vmlal_u16(vmlal_u16(s2, vget_low_u16(v), vget_low_u16(v)), vget_high_u16(v), vget_high_u16(v));
+        s3 = vmlal_u16(vmlal_u16(s3, vget_low_u16(v), vget_low_u16(t)), vget_high_u16(v), vget_high_u16(t));
+#  else
+        const __m128i lo = _mm_set1_epi16(0x00FF), one = _mm_set1_epi16(1), nul = _mm_set1_epi16(AR2_TEMPLATE_NULL_PIXEL);
+        __m128i       s1 = _mm_setzero_si128(), s2 = s1, s3 = s1;
+        __m128i       v, t;
+
+        for( i = 0; i + 8 < n; i += 8 ) {
+            v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(p2 + i*2)), lo);
+            t = _mm_loadu_si128((const __m128i *)(p1 + i));
+            v = _mm_andnot_si128(_mm_cmpeq_epi16(t, nul), v);
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(v, one));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(v, v));
+            s3 = _mm_add_epi32(s3, _mm_madd_epi16(v, t));
+        }
+        v = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(p2 + n*2 - 17)), 8);
+        t = _mm_loadu_si128((const __m128i *)(p1 + n - 8));
+        v = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(t, nul), _mm_cmplt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16((short)(8 - (n - i))))), v);
+        s1 = _mm_add_epi32(s1, _mm_madd_epi16(v, one));
+        s2 = _mm_add_epi32(s2, _mm_madd_epi16(v, v));
+        s3 = _mm_add_epi32(s3, _mm_madd_epi16(v, t));
+#  endif
+        *sum1 += ar2MatchingHsum(s1);
+        *sum2 += ar2MatchingHsum(s2);
+        *sum3 += ar2MatchingHsum(s3);
+        return;
+    }
+#endif
+    for( i = 0; i < n; i++ ) {
+        if( *p1 != AR2_TEMPLATE_NULL_PIXEL ) {
+            *sum1 += (*p2);
+            *sum2 += (*p2) * (*p2);
+            *sum3 += (*p2) * (*p1);
+        }
+        p2 += AR2_TEMP_SCALE;
+        p1++;
+    }
+}
+
+// Returns the dot product of the image with the template over one template row of n pixels.
+// The template must contain no AR2_TEMPLATE_NULL_PIXEL.
+static int ar2MatchingRowDot( const ARUint8 *p2, const ARUint16 *p1, int n )
+{
+    int     sum = 0;
+    int     i;
+
+#if AR2_MATCHING_SIMD
+    if( n > 8 ) {
+#  if HAVE_ARM_NEON || HAVE_ARM64_NEON
+        uint32x4_t       s = vdupq_n_u32(0);
+        uint16x8_t       v, t;
+
+        for( i = 0; i + 8 < n; i += 8 ) {
+            v = vmovl_u8(vld2_u8(p2 + i*2).val[0]);
+            t = vld1q_u16(p1 + i);
+            s = vmlal_u16(vmlal_u16(s, vget_low_u16(v), vget_low_u16(t)), vget_high_u16(v), vget_high_u16(t));
+        }
+        v = vmovl_u8(vld2_u8(p2 + n*2 - 17).val[1]);
+        t = vld1q_u16(p1 + n - 8);
+        v = vbicq_u16(v, vcltq_u16(vld1q_u16(ar2MatchingLane), vdupq_n_u16((uint16_t)(8 - (n - i)))));
+        s = vmlal_u16(vmlal_u16(s, vget_low_u16(v), vget_low_u16(t)), vget_high_u16(v), vget_high_u16(t));
+#  else
+        const __m128i lo = _mm_set1_epi16(0x00FF);
+        __m128i       s = _mm_setzero_si128();
+        __m128i       v;
+
+        for( i = 0; i + 8 < n; i += 8 ) {
+            v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(p2 + i*2)), lo);
+            s = _mm_add_epi32(s, _mm_madd_epi16(v, _mm_loadu_si128((const __m128i *)(p1 + i))));
+        }
+        v = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(p2 + n*2 - 17)), 8);
+        v = _mm_andnot_si128(_mm_cmplt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16((short)(8 - (n - i)))), v);
+        s = _mm_add_epi32(s, _mm_madd_epi16(v, _mm_loadu_si128((const __m128i *)(p1 + n - 8))));
+#  endif
+        return ar2MatchingHsum(s);
+    }
+#endif
+    for( i = 0; i < n; i++ ) {
+        sum += (*p2) * (*p1);
+        p2 += AR2_TEMP_SCALE;
+        p1++;
+    }
+    return sum;
+}
+
 static void updateCandidate( int x, int y, int wval,
                              int *keep_num, int cx[KEEP_NUM], int cy[KEEP_NUM], int cval[KEEP_NUM] )
 {
@@ -46,6 +46,8 @@
 static int    ar2GetVectorAngle( float  p1[2], float  p2[2], float  *psinf, float  *pcosf );
 static float  ar2GetTriangleArea( float  p1[2], float  p2[2], float  p3[2] );
 static float  ar2GetRegionArea( float  pos[4][2], int q1, int r1, int r2 );
+static int    ar2SelectTemplateSub( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *prevFeature, int num,
+                                    float  pos[4][2], int xsize, int ysize, unsigned int *randSeed );
 
 
 int ar2GetResolution( const ARParamLT *cparamLT, const float  trans[3][4], const float  pos[2], float  dpi[2] )
@@ -133,6 +135,19 @@ int ar2GetResolution2( const ARParam *cparam, const float  trans[3][4], const fl
 
 int ar2SelectTemplate( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *prevFeature, int num,
                        float  pos[4][2], int xsize, int ysize )
+{
+    return ar2SelectTemplateSub( candidate, prevFeature, num, pos, xsize, ysize, NULL );
+}
+
+int ar2SelectTemplate2( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *prevFeature, int num,
+                        float  pos[4][2], int xsize, int ysize, unsigned int *randSeed )
+{
+    if( randSeed == NULL ) return -1;
+    return ar2SelectTemplateSub( candidate, prevFeature, num, pos, xsize, ysize, randSeed );
+}
+
+static int ar2SelectTemplateSub( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *prevFeature, int num,
+                                 float  pos[4][2], int xsize, int ysize, unsigned int *randSeed )
 {
     if( num < 0 ) return -1;
 
@@ -268,16 +283,22 @@ int ar2SelectTemplate( AR2TemplateCandidateT *candidate, AR2TemplateCandidateT *
         }
         prevFeature[0].flag = -1;
 
-        if( s == 0 ) srand((unsigned int)time(NULL));
-        s++;
-        if( s == 128 ) s = 0;
-
         for( i = j = 0; candidate[i].flag != -1; i++ ) {
             if( candidate[i].flag == 0 ) j++;
         }
         if( j == 0 ) return -1;
 
-        k = (int)((float )j * (float)rand() / ((float)RAND_MAX + 1.0f));
+        if( randSeed == NULL ) {
+            if( s == 0 ) srand((unsigned int)time(NULL));
+            s++;
+            if( s == 128 ) s = 0;
+            k = (int)((float )j * (float)rand() / ((float)RAND_MAX + 1.0f));
+        }
+        else {
+            // Caller-owned linear congruential generator, so that concurrent callers neither share nor race on rand()'s state.
+            *randSeed = *randSeed * 1103515245u + 12345u;
+            k = (int)((float )j * (float)((*randSeed >> 16) & 0x7FFF) / 32768.0f);
+        }
         for( i = j = 0; candidate[i].flag != -1; i++ ) {
             if( candidate[i].flag != 0 ) continue;
             if( j == k ) {
@@ -96,6 +96,7 @@ AR2SurfaceSetT *ar2ReadSurfaceSet( const char *filename, const char *ext, ARPatt
         surfaceSet->num     = 1;
         surfaceSet->contNum = 0;
     }
+    surfaceSet->searchResidual = -1.0F;
     arMalloc(surfaceSet->surface, AR2SurfaceT, surfaceSet->num);
 
     for( i = 0; i < surfaceSet->num; i++ ) {
@@ -237,6 +238,7 @@ int ar2SetInitTrans( AR2SurfaceSetT *surfaceSet, float  trans[3][4] )
 
     if( surfaceSet == NULL ) return -1;
     surfaceSet->contNum = 1;
+    surfaceSet->searchResidual = -1.0F;
     for( j = 0; j < 3; j++ ) {
         for( i = 0; i < 4; i++ ) surfaceSet->trans1[j][i] = trans[j][i];
     }
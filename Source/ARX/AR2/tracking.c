@@ -63,15 +63,17 @@ static int    extractVisibleFeaturesHomography( int xsize, int ysize, float  tra
                                           AR2TemplateCandidateT candidate[],
                                           AR2TemplateCandidateT candidate2[] );
 static int    getDeltaS( float  H[8], float  dU[], float  J_U_H[][8], int n );
+static void   updateSearchResidual( AR2SurfaceSetT *surfaceSet, float residual[], int num );
 
 
 int ar2Tracking( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *dataPtr, float  trans[3][4], float  *err )
 {
     AR2TemplateCandidateT  *candidatePtr;
-    AR2TemplateCandidateT  *cp[AR2_THREAD_MAX];
+    AR2Tracking2DTaskT     *task;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     float                   aveBlur;
 #endif
+    float                   residual[AR2_SEARCH_FEATURE_MAX];
     int                     num, num2;
     int                     i, j, k;
 
@@ -97,79 +99,78 @@ int ar2Tracking( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *dat
         extractVisibleFeaturesHomography(ar2Handle->xsize, ar2Handle->ysize, ar2Handle->wtrans1, surfaceSet, ar2Handle->candidate, ar2Handle->candidate2);
     }
 
+    // Select all the features to search for up front, and submit them to the tracking workers at once.
+    // Template selection is sequential (each choice depends on the previous ones) but cheap relative to the searches.
     candidatePtr = ar2Handle->candidate;
-#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-    aveBlur = 0.0F;
-#endif
-    i = 0; // Counts up to searchFeatureNum.
-    num = 0;
-    while( i < ar2Handle->searchFeatureNum ) {
-        num2 = num;
-        for( j = 0; j < ar2Handle->threadNum; j++ ) {
-            if( i == ar2Handle->searchFeatureNum ) break;
-
-            k = ar2SelectTemplate( candidatePtr, surfaceSet->prevFeature, num2, ar2Handle->pos, ar2Handle->xsize, ar2Handle->ysize );
-            if( k < 0 ) {
-                if( candidatePtr == ar2Handle->candidate ) {
-                    candidatePtr = ar2Handle->candidate2;
-                    k = ar2SelectTemplate( candidatePtr, surfaceSet->prevFeature, num2, ar2Handle->pos, ar2Handle->xsize, ar2Handle->ysize );
-                    if( k < 0 ) break; // PRL 2012-05-15: Give up if we can't select template from alternate candidate either.
-                }
-                else break;
+    num2 = 0;
+    for( i = 0; i < ar2Handle->searchFeatureNum; i++ ) {
+        k = ar2SelectTemplate2( candidatePtr, surfaceSet->prevFeature, num2, ar2Handle->pos, ar2Handle->xsize, ar2Handle->ysize, &(ar2Handle->randSeed) );
+        if( k < 0 ) {
+            if( candidatePtr == ar2Handle->candidate ) {
+                candidatePtr = ar2Handle->candidate2;
+                k = ar2SelectTemplate2( candidatePtr, surfaceSet->prevFeature, num2, ar2Handle->pos, ar2Handle->xsize, ar2Handle->ysize, &(ar2Handle->randSeed) );
+                if( k < 0 ) break; // PRL 2012-05-15: Give up if we can't select template from alternate candidate either.
             }
-
-            cp[j] = &(candidatePtr[k]);
-            ar2Handle->pos[num2][0] = candidatePtr[k].sx;
-            ar2Handle->pos[num2][1] = candidatePtr[k].sy;
-            ar2Handle->arg[j].ar2Handle  = ar2Handle;
-            ar2Handle->arg[j].surfaceSet = surfaceSet;
-            ar2Handle->arg[j].candidate  = &(candidatePtr[k]);
-            ar2Handle->arg[j].dataPtr    = dataPtr;
-
-            threadStartSignal( ar2Handle->threadHandle[j] );
-            num2++;
-            if( num2 == 5 ) num2 = num;
-            i++;
+            else break;
         }
-        k = j;
-        if( k == 0 ) break;
 
-        for( j = 0; j < k; j++ ) {
-            threadEndWait( ar2Handle->threadHandle[j] );
+        ar2Handle->task[i].candidate = &(candidatePtr[k]);
+        ar2Handle->pos[num2][0] = candidatePtr[k].sx;
+        ar2Handle->pos[num2][1] = candidatePtr[k].sy;
+        // Picks 0-3 spread the first features across the image. Every later pick (num2 4) prefers
+        // features tracked in the previous frame, then takes the rest at random.
+        if( num2 < 4 ) num2++;
+    }
+    ar2Handle->taskNum = i;
 
-            if( ar2Handle->arg[j].ret == 0 && ar2Handle->arg[j].result.sim > ar2Handle->simThresh ) {
-                if( ar2Handle->trackingMode == AR2_TRACKING_6DOF ) {
+    // In adaptive mode, search for features at rest only as far as positions have recently been mispredicted.
+    ar2Handle->searchRadius = ar2Handle->searchSize;
+    if( ar2Handle->searchSizeMode == AR2_SEARCH_SIZE_ADAPTIVE && surfaceSet->searchResidual >= 0.0F ) {
+        k = AR2_ADAPTIVE_SEARCH_SIZE_MIN + (int)ceilf(1.5F*surfaceSet->searchResidual);
+        if( k < ar2Handle->searchRadius ) ar2Handle->searchRadius = k;
+    }
+
+    ar2Tracking2dRun( ar2Handle, surfaceSet, dataPtr );
+
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+    aveBlur = 0.0F;
+#endif
+    num = 0;
+    for( j = 0; j < ar2Handle->taskNum; j++ ) {
+        task = &(ar2Handle->task[j]);
+        if( task->ret == 0 && task->result.sim > ar2Handle->simThresh ) {
+            if( ar2Handle->trackingMode == AR2_TRACKING_6DOF ) {
 #ifdef ARDOUBLE_IS_FLOAT
-                    arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
-                                        ar2Handle->arg[j].result.pos2d[0], ar2Handle->arg[j].result.pos2d[1],
-                                        &ar2Handle->pos2d[num][0], &ar2Handle->pos2d[num][1], ar2Handle->cparamLT->param.dist_function_version);
+                arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
+                                    task->result.pos2d[0], task->result.pos2d[1],
+                                    &ar2Handle->pos2d[num][0], &ar2Handle->pos2d[num][1], ar2Handle->cparamLT->param.dist_function_version);
 #else
-                    ARdouble pos2d0, pos2d1;
-                    arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,                    
-                                        (ARdouble)(ar2Handle->arg[j].result.pos2d[0]), (ARdouble)(ar2Handle->arg[j].result.pos2d[1]),
-                                        &pos2d0, &pos2d1, ar2Handle->cparamLT->param.dist_function_version);
-                    ar2Handle->pos2d[num][0] = (float)pos2d0;
-                    ar2Handle->pos2d[num][1] = (float)pos2d1;
+                ARdouble pos2d0, pos2d1;
+                arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
+                                    (ARdouble)(task->result.pos2d[0]), (ARdouble)(task->result.pos2d[1]),
+                                    &pos2d0, &pos2d1, ar2Handle->cparamLT->param.dist_function_version);
+                ar2Handle->pos2d[num][0] = (float)pos2d0;
+                ar2Handle->pos2d[num][1] = (float)pos2d1;
 #endif
-                }
-                else {
-                    ar2Handle->pos2d[num][0] = ar2Handle->arg[j].result.pos2d[0];
-                    ar2Handle->pos2d[num][1] = ar2Handle->arg[j].result.pos2d[1];
-                }
-                ar2Handle->pos3d[num][0] = ar2Handle->arg[j].result.pos3d[0];
-                ar2Handle->pos3d[num][1] = ar2Handle->arg[j].result.pos3d[1];
-                ar2Handle->pos3d[num][2] = ar2Handle->arg[j].result.pos3d[2];
-                ar2Handle->pos[num][0] = cp[j]->sx;
-                ar2Handle->pos[num][1] = cp[j]->sy;
-                ar2Handle->usedFeature[num].snum  = cp[j]->snum;
-                ar2Handle->usedFeature[num].level = cp[j]->level;
-                ar2Handle->usedFeature[num].num   = cp[j]->num;
-                ar2Handle->usedFeature[num].flag  = 0;
+            }
+            else {
+                ar2Handle->pos2d[num][0] = task->result.pos2d[0];
+                ar2Handle->pos2d[num][1] = task->result.pos2d[1];
+            }
+            ar2Handle->pos3d[num][0] = task->result.pos3d[0];
+            ar2Handle->pos3d[num][1] = task->result.pos3d[1];
+            ar2Handle->pos3d[num][2] = task->result.pos3d[2];
+            ar2Handle->pos[num][0] = task->candidate->sx;
+            ar2Handle->pos[num][1] = task->candidate->sy;
+            ar2Handle->usedFeature[num].snum  = task->candidate->snum;
+            ar2Handle->usedFeature[num].level = task->candidate->level;
+            ar2Handle->usedFeature[num].num   = task->candidate->num;
+            ar2Handle->usedFeature[num].flag  = 0;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-                aveBlur += ar2Handle->arg[j].result.blurLevel;
+            aveBlur += task->result.blurLevel;
 #endif
-                num++;
-            }
+            residual[num] = task->result.residual;
+            num++;
         }
     }
     for( i = 0; i < num; i++ ) {
@@ -254,6 +255,8 @@ int ar2Tracking( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *dat
     }
 #endif
 
+    updateSearchResidual( surfaceSet, residual, num );
+
     surfaceSet->contNum++;
     for( j = 0; j < 3; j++ ) {
         for( i = 0; i < 4; i++ ) surfaceSet->trans3[j][i] = surfaceSet->trans2[j][i];
@@ -827,3 +830,25 @@ bail1:
 bail:
     return (ret);
 }
+
+// Fold the distances of this frame's matches from their predicted positions into the surface set's
+// search residual. Use the median, so that false matches (which land anywhere in the search window)
+// do not widen the search, and follow increases at once (motion can start suddenly) but decreases
+// only gradually.
+static void updateSearchResidual( AR2SurfaceSetT *surfaceSet, float residual[], int num )
+{
+    float   q, w;
+    int     i, j;
+
+    if( num <= 0 ) return;
+    for( i = 1; i < num; i++ ) {
+        w = residual[i];
+        for( j = i; j > 0 && residual[j-1] > w; j-- ) residual[j] = residual[j-1];
+        residual[j] = w;
+    }
+    q = residual[num/2];
+    if( q < 0.0F ) return;
+
+    if( surfaceSet->searchResidual < 0.0F || q > surfaceSet->searchResidual ) surfaceSet->searchResidual = q;
+    else surfaceSet->searchResidual += 0.25F*(q - surfaceSet->searchResidual);
+}
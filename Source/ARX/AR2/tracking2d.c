@@ -40,6 +40,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#ifdef _WIN32
+#  include <windows.h>
+#endif
 #include <ARX/AR2/config.h>
 #include <ARX/AR2/featureSet.h>
 #include <ARX/AR2/template.h>
@@ -48,13 +51,20 @@
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
 static int ar2Tracking2dSub ( AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                              ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+                              ARUint8 *dataPtr, ARUint8 *mfImage, ARUint32 *subImage, AR2TemplateT **templ,
                               AR2Template2T **templ2, AR2Tracking2DResultT *result );
 #else
 static int ar2Tracking2dSub ( AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                              ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+                              ARUint8 *dataPtr, ARUint8 *mfImage, ARUint32 *subImage, AR2TemplateT **templ,
                               AR2Tracking2DResultT *result );
 #endif
+static void     ar2Tracking2dProcess ( AR2Tracking2DParamT *arg );
+static int      ar2Tracking2dSearchRadius( AR2HandleT *handle, int search[3][2] );
+static uint64_t queueRange           ( int head, int tail );
+static uint64_t queueLoad            ( volatile uint64_t *p );
+static int      queueCAS             ( volatile uint64_t *p, uint64_t expected, uint64_t desired );
+static int      queueTakeHead        ( AR2Tracking2DQueueT *queue );
+static int      queueStealTail       ( AR2Tracking2DQueueT *queue );
 
 void *ar2Tracking2d( THREAD_HANDLE_T *threadHandle )
 {
@@ -67,29 +77,148 @@ void *ar2Tracking2d( THREAD_HANDLE_T *threadHandle )
     ARLOGi("Start tracking_thread #%d.\n", ID);
     for(;;) {
         if( threadStartWait(threadHandle) < 0 ) break;
+        ar2Tracking2dProcess( arg );
+        threadEndSignal(threadHandle);
+    }
+    ARLOGi("End tracking_thread #%d.\n", ID);
+
+    return NULL;
+}
+
+void ar2Tracking2dRun( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *dataPtr )
+{
+    int     taskNum, workerNum;
+    int     i;
+
+    taskNum = ar2Handle->taskNum;
+    if( taskNum <= 0 ) return;
+    workerNum = (taskNum < ar2Handle->threadNum ? taskNum : ar2Handle->threadNum);
+
+    ar2Handle->surfaceSet = surfaceSet;
+    ar2Handle->dataPtr    = dataPtr;
+    ar2Handle->workerNum  = workerNum;
+
+    // Deal the tasks out in contiguous blocks. Workers finishing early steal from the others,
+    // so all tasks of the frame need only a single start and join per worker.
+    for( i = 0; i < workerNum; i++ ) {
+        ar2Handle->queue[i].range = queueRange( i*taskNum/workerNum, (i + 1)*taskNum/workerNum );
+    }
+
+    for( i = 1; i < workerNum; i++ ) threadStartSignal( ar2Handle->threadHandle[i] );
+    ar2Tracking2dProcess( &(ar2Handle->arg[0]) );
+    for( i = 1; i < workerNum; i++ ) threadEndWait( ar2Handle->threadHandle[i] );
+}
 
+static void ar2Tracking2dProcess( AR2Tracking2DParamT *arg )
+{
+    AR2HandleT           *handle;
+    AR2Tracking2DTaskT   *task;
+    int                   t, v;
+
+    handle = arg->ar2Handle;
+    if( arg->mfImage == NULL ) arMalloc( arg->mfImage, ARUint8, handle->xsize*handle->ysize );
+    if( arg->templ == NULL ) {
+        arg->templ = ar2GenTemplate( handle->templateSize1, handle->templateSize2 );
+        arMalloc( arg->subImage, ARUint32, ar2GetBestMatchingSubImageSize(arg->templ) );
+    }
+
+    for(;;) {
+        t = queueTakeHead( &(handle->queue[arg->worker]) );
+        // Once our own deque is empty, steal from the tails of the others. No tasks are added
+        // while the workers run, so when every deque is empty there is nothing left to do.
+        for( v = 1; t < 0 && v < handle->workerNum; v++ ) {
+            t = queueStealTail( &(handle->queue[(arg->worker + v) % handle->workerNum]) );
+        }
+        if( t < 0 ) break;
+
+        task = &(handle->task[t]);
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-        arg->ret = ar2Tracking2dSub( arg->ar2Handle, arg->surfaceSet, arg->candidate,
-                                     arg->dataPtr, arg->mfImage, &(arg->templ), &(arg->templ2), &(arg->result) );
+        task->ret = ar2Tracking2dSub( handle, handle->surfaceSet, task->candidate,
+                                      handle->dataPtr, arg->mfImage, arg->subImage, &(arg->templ), &(arg->templ2), &(task->result) );
 #else
-        arg->ret = ar2Tracking2dSub( arg->ar2Handle, arg->surfaceSet, arg->candidate,
-                                     arg->dataPtr, arg->mfImage, &(arg->templ), &(arg->result) );
+        task->ret = ar2Tracking2dSub( handle, handle->surfaceSet, task->candidate,
+                                      handle->dataPtr, arg->mfImage, arg->subImage, &(arg->templ), &(task->result) );
 #endif
-        threadEndSignal(threadHandle);
     }
-    ARLOGi("End tracking_thread #%d.\n", ID);
+}
 
-    return NULL;
+// Search radius for one feature. In adaptive mode this is the radius for features at rest, widened by
+// the distance the feature moved over the last frame, since faster features are predicted less accurately.
+static int ar2Tracking2dSearchRadius( AR2HandleT *handle, int search[3][2] )
+{
+    int     r, dx, dy;
+
+    r = handle->searchRadius;
+    if( r >= handle->searchSize ) return handle->searchSize;
+    if( search[1][0] >= 0 ) {
+        dx = abs(search[1][0] - search[0][0]);
+        dy = abs(search[1][1] - search[0][1]);
+        r += (dx > dy ? dx : dy)/4;
+    }
+    return (r < handle->searchSize ? r : handle->searchSize);
+}
+
+static uint64_t queueRange( int head, int tail )
+{
+    return ((uint64_t)(uint32_t)tail << 32) | (uint32_t)head;
+}
+
+static uint64_t queueLoad( volatile uint64_t *p )
+{
+#if defined(_MSC_VER)
+    return (uint64_t)InterlockedCompareExchange64( (volatile LONG64 *)p, 0, 0 );
+#else
+    return __atomic_load_n( p, __ATOMIC_ACQUIRE );
+#endif
+}
+
+static int queueCAS( volatile uint64_t *p, uint64_t expected, uint64_t desired )
+{
+#if defined(_MSC_VER)
+    return ((uint64_t)InterlockedCompareExchange64( (volatile LONG64 *)p, (LONG64)desired, (LONG64)expected ) == expected);
+#else
+    return __atomic_compare_exchange_n( p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+#endif
+}
+
+// Returns the index of the task taken from the head of the deque, or -1 if it is empty.
+static int queueTakeHead( AR2Tracking2DQueueT *queue )
+{
+    uint64_t  r;
+    int       head, tail;
+
+    do {
+        r = queueLoad( &(queue->range) );
+        head = (int)(uint32_t)r;
+        tail = (int)(uint32_t)(r >> 32);
+        if( head >= tail ) return -1;
+    } while( !queueCAS( &(queue->range), r, queueRange(head + 1, tail) ) );
+    return head;
+}
+
+// Returns the index of the task stolen from the tail of the deque, or -1 if it is empty.
+static int queueStealTail( AR2Tracking2DQueueT *queue )
+{
+    uint64_t  r;
+    int       head, tail;
+
+    do {
+        r = queueLoad( &(queue->range) );
+        head = (int)(uint32_t)r;
+        tail = (int)(uint32_t)(r >> 32);
+        if( head >= tail ) return -1;
+    } while( !queueCAS( &(queue->range), r, queueRange(head, tail - 1) ) );
+    return tail - 1;
 }
 
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
 static int ar2Tracking2dSub ( AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                              ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+                              ARUint8 *dataPtr, ARUint8 *mfImage, ARUint32 *subImage, AR2TemplateT **templ,
                               AR2Template2T **templ2, AR2Tracking2DResultT *result )
 #else
 static int ar2Tracking2dSub ( AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                              ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+                              ARUint8 *dataPtr, ARUint8 *mfImage, ARUint32 *subImage, AR2TemplateT **templ,
                               AR2Tracking2DResultT *result )
 #endif
 {
@@ -99,12 +228,14 @@ static int ar2Tracking2dSub ( AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR
     int                   snum, level, fnum;
     int                   search[3][2];
     int                   bx, by;
+    int                   rx, dx, dy;
+    int                   i;
+    int                   ret;
 
     snum  = candidate->snum;
     level = candidate->level;
     fnum  = candidate->num;
 
-    if( *templ == NULL )  *templ = ar2GenTemplate( handle->templateSize1, handle->templateSize2 );
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     if( *templ2 == NULL ) *templ2 = ar2GenTemplate2( handle->templateSize1, handle->templateSize2 );
 #endif
@@ -178,54 +309,67 @@ static int ar2Tracking2dSub ( AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR
                            search );
     }
 
+    rx = ar2Tracking2dSearchRadius( handle, search );
+    for(;;) {
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-    if( handle->blurMethod == AR2_CONSTANT_BLUR ) {
-        if( ar2GetBestMatching( dataPtr,
-                                mfImage,
-                                handle->xsize,
-                                handle->ysize,
-                                handle->pixFormat,
-                               *templ,
-                                handle->searchSize,
-                                handle->searchSize,
-                                search,
-                                &bx, &by,
-                              &(result->sim)) < 0 ) {
-            return -1;
+        if( handle->blurMethod == AR2_CONSTANT_BLUR ) {
+            ret = ar2GetBestMatchingWithSubImage( dataPtr,
+                                                  mfImage,
+                                                  subImage,
+                                                  handle->xsize,
+                                                  handle->ysize,
+                                                  handle->pixFormat,
+                                                 *templ,
+                                                  rx,
+                                                  rx,
+                                                  search,
+                                                  &bx, &by,
+                                                &(result->sim));
+            result->blurLevel = handle->blurLevel;
         }
-        result->blurLevel = handle->blurLevel;
-    }
-    else {
-        if( ar2GetBestMatching2( dataPtr,
-                                 mfImage,
-                                 handle->xsize,
-                                 handle->ysize,
-                                 handle->pixFormat,
-                                *templ2,
-                                 handle->searchSize,
-                                 handle->searchSize,
-                                 search,
-                                 &bx, &by,
-                               &(result->sim),
-                               &(result->blurLevel)) < 0 ) {
-            return -1;
+        else {
+            ret = ar2GetBestMatching2( dataPtr,
+                                       mfImage,
+                                       handle->xsize,
+                                       handle->ysize,
+                                       handle->pixFormat,
+                                      *templ2,
+                                       rx,
+                                       rx,
+                                       search,
+                                       &bx, &by,
+                                     &(result->sim),
+                                     &(result->blurLevel));
         }
-    }
 #else
-    if( ar2GetBestMatching( dataPtr,
-                            mfImage,
-                            handle->xsize,
-                            handle->ysize,
-                            handle->pixFormat,
-                           *templ,
-                            handle->searchSize,
-                            handle->searchSize,
-                            search,
-                            &bx, &by,
-                          &(result->sim)) < 0 ) {
-        return -1;
-    }
+        ret = ar2GetBestMatchingWithSubImage( dataPtr,
+                                              mfImage,
+                                              subImage,
+                                              handle->xsize,
+                                              handle->ysize,
+                                              handle->pixFormat,
+                                             *templ,
+                                              rx,
+                                              rx,
+                                              search,
+                                              &bx, &by,
+                                            &(result->sim));
 #endif
+        // A feature not found within a reduced search window is searched for again within the full one.
+        if( rx >= handle->searchSize || (ret == 0 && result->sim > handle->simThresh) ) break;
+        rx = handle->searchSize;
+    }
+    if( ret < 0 ) return -1;
+
+    // Distance of the match from the nearest position predicted for it.
+    result->residual = -1.0F;
+    for( i = 0; i < 3; i++ ) {
+        if( search[i][0] < 0 ) break;
+        dx = abs(bx - search[i][0]);
+        dy = abs(by - search[i][1]);
+        if( dy > dx ) dx = dy;
+        if( result->residual < 0.0F || (float)dx < result->residual ) result->residual = (float)dx;
+    }
 
     result->pos2d[0] = (float)bx;
     result->pos2d[1] = (float)by;
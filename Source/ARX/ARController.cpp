@@ -69,6 +69,7 @@ ARController::ARController() :
     m_updateFrameStamp0({0,0}),
     m_updateFrameStamp1({0,0}),
     m_arVideoViews{NULL},
+    m_cparamLTType(AR_PARAM_LT_TYPE_FLOAT),
     m_error(ARX_ERROR_NONE)
 {
 }
@@ -154,6 +155,17 @@ bail:
     return false;
 }
 
+bool ARController::setCameraParametersLookupTable(int type, const char* cacheDir)
+{
+    if (type != AR_PARAM_LT_TYPE_FLOAT && type != AR_PARAM_LT_TYPE_COMPACT) {
+        ARLOGe("Invalid camera parameters lookup table type %d.\n", type);
+        return false;
+    }
+    m_cparamLTType = type;
+    m_cparamLTCacheDir = (cacheDir ? cacheDir : "");
+    return true;
+}
+
 bool ARController::startRunning(const char* vconf, const char* cparaName, const char* cparaBuff, const long cparaBuffLen)
 {
 	ARLOGi("Starting...\n");
@@ -171,6 +183,7 @@ bool ARController::startRunning(const char* vconf, const char* cparaName, const
 	}
 
 	m_videoSource0->configure(vconf, false, cparaName, cparaBuff, cparaBuffLen);
+    m_videoSource0->setCameraParametersLookupTable(m_cparamLTType, m_cparamLTCacheDir.empty() ? NULL : m_cparamLTCacheDir.c_str());
 
     if (!m_videoSource0->open()) {
         if (m_videoSource0->getError() == ARX_ERROR_DEVICE_UNAVAILABLE) {
@@ -231,6 +244,8 @@ bool ARController::startRunningStereo(const char* vconfL, const char* cparaNameL
 
 	m_videoSource0->configure(vconfL, false, cparaNameL, cparaBuffL, cparaBuffLenL);
 	m_videoSource1->configure(vconfR, false, cparaNameR, cparaBuffR, cparaBuffLenR);
+    m_videoSource0->setCameraParametersLookupTable(m_cparamLTType, m_cparamLTCacheDir.empty() ? NULL : m_cparamLTCacheDir.c_str());
+    m_videoSource1->setCameraParametersLookupTable(m_cparamLTType, m_cparamLTCacheDir.empty() ? NULL : m_cparamLTCacheDir.c_str());
 
     if (!m_videoSource0->open()) {
         if (m_videoSource0->getError() == ARX_ERROR_DEVICE_UNAVAILABLE) {
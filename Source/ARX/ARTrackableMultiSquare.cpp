@@ -197,8 +197,9 @@ bool ARTrackableMultiSquare::getPatternImage(int patternIndex, uint32_t *pattIma
     if (!config || patternIndex < 0 || patternIndex >= config->marker_num) return false;
 
     if (config->marker[patternIndex].patt_type == AR_MULTI_PATTERN_TYPE_TEMPLATE) {
-        if (!m_arPattHandle || !m_arPattHandle->pattf[config->marker[patternIndex].patt_id]) return false;
-        const int *arr = m_arPattHandle->patt[config->marker[patternIndex].patt_id * 4];
+        int patt_id = config->marker[patternIndex].patt_id;
+        if (!m_arPattHandle || patt_id < 0 || patt_id >= m_arPattHandle->pattCapacity || !m_arPattHandle->pattf[patt_id]) return false;
+        const int *arr = m_arPattHandle->patt[patt_id * 4];
         for (int y = 0; y < m_arPattHandle->pattSize; y++) {
             for (int x = 0; x < m_arPattHandle->pattSize; x++) {
 
@@ -190,8 +190,8 @@ bool ARTrackableSquare::updateWithDetectedMarkers(ARMarkerInfo* markerInfo, int
         if (patt_type == AR_PATTERN_TYPE_TEMPLATE) { 
             // Iterate over all detected markers.
             for (int j = 0; j < markerNum; j++ ) {
-                if (markerInfo[j].matched) continue;
                 if (patt_id != markerInfo[j].idPatt) continue;
+                if (markerInfo[j].matched) continue; // Checked after the ID, so that only markers this trackable could claim are read.
                 // The pattern of detected trapezoid matches marker[k].
                 if (k == -1) {
                     if (markerInfo[j].cfPatt > m_cfMin) k = j; // Count as a match if match confidence exceeds cfMin.
@@ -204,13 +204,13 @@ bool ARTrackableSquare::updateWithDetectedMarkers(ARMarkerInfo* markerInfo, int
             }
         } else {
             for (int j = 0; j < markerNum; j++) {
-                if (markerInfo[j].matched) continue;
                 // Check if we need to examine the globalID rather than patt_id.
                 if (markerInfo[j].idMatrix == 0 && markerInfo[j].globalID != 0ULL) {
                     if (markerInfo[j].globalID != globalID ) continue;
                 } else {
                     if (markerInfo[j].idMatrix != patt_id ) continue;
                 }
+                if (markerInfo[j].matched) continue;
                 if (k == -1) {
                     if (markerInfo[j].cfMatrix >= m_cfMin) k = j; // Count as a match if match confidence exceeds cfMin.
                 } else if (markerInfo[j].cfMatrix > markerInfo[k].cfMatrix) k = j; // Or if it exceeds match confidence of a different already matched trapezoid (i.e. assume only one instance of each marker).
@@ -393,7 +393,7 @@ bool ARTrackableSquare::getPatternImage(int patternIndex, uint32_t *pattImageBuf
     if (patternIndex != 0) return false;
 
     if (patt_type == AR_PATTERN_TYPE_TEMPLATE) {
-        if (!m_arPattHandle || !m_arPattHandle->pattf[patt_id]) return false;
+        if (!m_arPattHandle || patt_id < 0 || patt_id >= m_arPattHandle->pattCapacity || !m_arPattHandle->pattf[patt_id]) return false;
         const int *arr = m_arPattHandle->patt[patt_id * 4];
         for (int y = 0; y < m_arPattHandle->pattSize; y++) {
             for (int x = 0; x < m_arPattHandle->pattSize; x++) {
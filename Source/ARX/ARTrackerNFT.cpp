@@ -49,12 +49,17 @@ ARTrackerNFT::ARTrackerNFT() :
     m_trackables(),
     m_videoSourceIsStereo(false),
     m_nftMultiMode(false),
+    m_nftAdaptiveSearch(false),
     m_kpmRequired(true),
     m_kpmBusy(false),
     trackingThreadHandle(NULL),
     m_ar2Handle(NULL),
+    m_pageAR2Handle{NULL},
     m_kpmHandle(NULL),
     m_surfaceSet{NULL},
+    m_pageWorkers(),
+    m_pageBatch(),
+    m_pageBatchImage(NULL),
     m_pageCount(0)
 {
 }
@@ -79,6 +84,21 @@ bool ARTrackerNFT::NFTMultiMode() const
     return m_nftMultiMode;
 }
 
+void ARTrackerNFT::setNFTAdaptiveSearch(bool on)
+{
+    m_nftAdaptiveSearch = on;
+    int searchSizeMode = (on ? AR2_SEARCH_SIZE_ADAPTIVE : AR2_SEARCH_SIZE_FIXED);
+    if (m_ar2Handle) ar2SetSearchSizeMode(m_ar2Handle, searchSizeMode);
+    for (int i = 0; i < m_pageCount; i++) {
+        if (m_pageAR2Handle[i]) ar2SetSearchSizeMode(m_pageAR2Handle[i], searchSizeMode);
+    }
+}
+
+bool ARTrackerNFT::NFTAdaptiveSearch() const
+{
+    return m_nftAdaptiveSearch;
+}
+
 bool ARTrackerNFT::start(ARParamLT *paramLT, AR_PIXEL_FORMAT pixelFormat)
 {
     if (!paramLT || pixelFormat == AR_PIXEL_FORMAT_INVALID) return false;
@@ -91,8 +111,8 @@ bool ARTrackerNFT::start(ARParamLT *paramLT, AR_PIXEL_FORMAT pixelFormat)
     }
     //kpmSetProcMode( m_kpmHandle, KpmProcHalfSize );
     
-    // AR2 init.
-    if (!(m_ar2Handle = ar2CreateHandle(paramLT, AR_PIXEL_FORMAT_MONO, AR2_TRACKING_DEFAULT_THREAD_NUM))) { // Since we're guaranteed to have luma available, we'll use it as it is the optimal case.
+    // AR2 init. This handle only holds the settings; each page gets its own handle with worker threads once the pages are loaded.
+    if (!(m_ar2Handle = ar2CreateHandle(paramLT, AR_PIXEL_FORMAT_MONO, 1))) { // Since we're guaranteed to have luma available, we'll use it as it is the optimal case.
         ARLOGe("ar2CreateHandle\n");
         kpmDeleteHandle(&m_kpmHandle);
         return (false);
@@ -116,6 +136,7 @@ bool ARTrackerNFT::start(ARParamLT *paramLT, AR_PIXEL_FORMAT pixelFormat)
         ar2SetTemplateSize1(m_ar2Handle, 6);
         ar2SetTemplateSize2(m_ar2Handle, 6);
     }
+    ar2SetSearchSizeMode(m_ar2Handle, (m_nftAdaptiveSearch ? AR2_SEARCH_SIZE_ADAPTIVE : AR2_SEARCH_SIZE_FIXED));
     ARLOGd("ARTrackerNFT::start(): done.\n");
     return (true);
 }
@@ -139,6 +160,7 @@ bool ARTrackerNFT::unloadNFTData(void)
         trackingInitQuit(&trackingThreadHandle);
         m_kpmBusy = false;
     }
+    pageHandlesFinal();
     for (i = 0; i < PAGES_MAX; i++) m_surfaceSet[i] = NULL; // Discard weak-references.
     m_kpmRequired = true;
     m_pageCount = 0;
@@ -195,6 +217,11 @@ bool ARTrackerNFT::loadNFTData()
     }
     kpmDeleteRefDataSet(&refDataSet);
     
+    if (!pageHandlesInit()) {
+        ARLOGe("Unable to create NFT page tracking handles.\n");
+        return false;
+    }
+
     // Start the KPM tracking thread.
     ARLOGi("Starting NFT tracking thread.\n");
     trackingThreadHandle = trackingInitInit(m_kpmHandle);
@@ -234,7 +261,6 @@ bool ARTrackerNFT::update(AR2VideoBufferT *buff)
     if (trackingThreadHandle) {
         
         // Do KPM tracking.
-        float err;
         float trackingTrans[3][4];
         
         if (m_kpmRequired) {
@@ -263,36 +289,164 @@ bool ARTrackerNFT::update(AR2VideoBufferT *buff)
             }
         }
         
-        // Do AR2 tracking and update NFT markers.
-        int page = 0;
+        // Do AR2 tracking of the pages found previously, then update NFT markers in trackable order.
         int pagesTracked = 0;
         bool success = true;
         ARdouble *transL2R = (m_videoSourceIsStereo ? (ARdouble *)m_transL2R : NULL);
         
+        m_pageBatch.clear();
         for (std::vector<std::shared_ptr<ARTrackable>>::iterator it = m_trackables.begin(); it != m_trackables.end(); ++it) {
             std::shared_ptr<ARTrackableNFT> t = std::static_pointer_cast<ARTrackableNFT>(*it);
+            if (t->pageNo >= 0 && m_surfaceSet[t->pageNo]->contNum > 0) m_pageBatch.push_back(t->pageNo);
+        }
+        trackPages(buff->buffLuma);
 
-            if (m_surfaceSet[page]->contNum > 0) {
-                if (ar2Tracking(m_ar2Handle, m_surfaceSet[page], buff->buffLuma, trackingTrans, &err) < 0) {
-                    ARLOGd("Tracking lost on page %d.\n", page);
-                    success &= t->updateWithNFTResults(-1, NULL, NULL);
-                } else {
-                    ARLOGd("Tracked page %d (pos = {% 4f, % 4f, % 4f}).\n", page, trackingTrans[0][3], trackingTrans[1][3], trackingTrans[2][3]);
-                    success &= t->updateWithNFTResults(page, trackingTrans, (ARdouble (*)[4])transL2R);
-                    pagesTracked++;
-                }
-            }
+        size_t i = 0;
+        for (std::vector<std::shared_ptr<ARTrackable>>::iterator it = m_trackables.begin(); it != m_trackables.end() && i < m_pageBatch.size(); ++it) {
+            std::shared_ptr<ARTrackableNFT> t = std::static_pointer_cast<ARTrackableNFT>(*it);
+            int page = m_pageBatch[i];
+            if (t->pageNo != page) continue;
 
-            page++;
+            if (m_pageBatchResult[i] < 0) {
+                ARLOGd("Tracking lost on page %d.\n", page);
+                success &= t->updateWithNFTResults(-1, NULL, NULL);
+            } else {
+                ARLOGd("Tracked page %d (pos = {% 4f, % 4f, % 4f}).\n", page, m_pageBatchTrans[i][0][3], m_pageBatchTrans[i][1][3], m_pageBatchTrans[i][2][3]);
+                success &= t->updateWithNFTResults(page, m_pageBatchTrans[i], (ARdouble (*)[4])transL2R);
+                pagesTracked++;
+            }
+            i++;
         }
         
-        m_kpmRequired = (pagesTracked < (m_nftMultiMode ? page : 1));
+        m_kpmRequired = (pagesTracked < (m_nftMultiMode ? m_pageCount : 1));
         
     } // trackingThreadHandle
 
     return true;
 }
 
+// ----------------------------------------------------------------------------------------------------
+#pragma mark  Parallel page tracking
+
+bool ARTrackerNFT::pageHandlesInit()
+{
+    pageHandlesFinal();
+    if (!m_ar2Handle || m_pageCount < 1) return true;
+
+    // Split the CPUs between the pages. ar2Tracking() results do not depend on the number of threads.
+    int cpuCount = threadGetCPU();
+    int workerCount = std::min(cpuCount, m_pageCount);
+    int ar2ThreadCount = std::max(1, cpuCount / m_pageCount);
+
+    int trackingMode, searchSize, searchSizeMode, templateSize1, templateSize2, searchFeatureNum;
+    float simThresh, trackingThresh;
+    ar2GetTrackingMode(m_ar2Handle, &trackingMode);
+    ar2GetSearchSize(m_ar2Handle, &searchSize);
+    ar2GetSearchSizeMode(m_ar2Handle, &searchSizeMode);
+    ar2GetTemplateSize1(m_ar2Handle, &templateSize1);
+    ar2GetTemplateSize2(m_ar2Handle, &templateSize2);
+    ar2GetSearchFeatureNum(m_ar2Handle, &searchFeatureNum);
+    ar2GetSimThresh(m_ar2Handle, &simThresh);
+    ar2GetTrackingThresh(m_ar2Handle, &trackingThresh);
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+    int blurMethod, blurLevel;
+    ar2GetBlurMethod(m_ar2Handle, &blurMethod);
+    ar2GetBlurLevel(m_ar2Handle, &blurLevel);
+#endif
+    for (int i = 0; i < m_pageCount; i++) {
+        if (!(m_pageAR2Handle[i] = ar2CreateHandle(m_ar2Handle->cparamLT, m_ar2Handle->pixFormat, ar2ThreadCount))) {
+            ARLOGe("ar2CreateHandle\n");
+            pageHandlesFinal();
+            return false;
+        }
+        ar2SetTrackingMode(m_pageAR2Handle[i], trackingMode);
+        ar2SetSearchSize(m_pageAR2Handle[i], searchSize);
+        ar2SetSearchSizeMode(m_pageAR2Handle[i], searchSizeMode);
+        ar2SetTemplateSize1(m_pageAR2Handle[i], templateSize1);
+        ar2SetTemplateSize2(m_pageAR2Handle[i], templateSize2);
+        ar2SetSearchFeatureNum(m_pageAR2Handle[i], searchFeatureNum);
+        ar2SetSimThresh(m_pageAR2Handle[i], simThresh);
+        ar2SetTrackingThresh(m_pageAR2Handle[i], trackingThresh);
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+        ar2SetBlurMethod(m_pageAR2Handle[i], blurMethod);
+        ar2SetBlurLevel(m_pageAR2Handle[i], blurLevel);
+#endif
+    }
+
+    // Worker 0 runs on the calling thread.
+    if (workerCount < 2) return true;
+    m_pageWorkers.resize(workerCount); // Not resized again until pageHandlesFinal(), so workers can hold pointers to their entries.
+    for (int i = 0; i < workerCount; i++) {
+        m_pageWorkers[i].tracker = this;
+        m_pageWorkers[i].index = i;
+        m_pageWorkers[i].threadHandle = NULL;
+        if (i > 0) {
+            m_pageWorkers[i].threadHandle = threadInit(i, &m_pageWorkers[i], pageWorker);
+            if (!m_pageWorkers[i].threadHandle) {
+                ARLOGe("Error: unable to start NFT page thread %d.\n", i);
+                m_pageWorkers.resize(i);
+                break;
+            }
+        }
+    }
+    if (m_pageWorkers.size() < 2) m_pageWorkers.clear();
+    ARLOGi("Tracking NFT pages on %d threads, with %d feature search threads each.\n", m_pageWorkers.empty() ? 1 : (int)m_pageWorkers.size(), ar2ThreadCount);
+    return true;
+}
+
+void ARTrackerNFT::pageHandlesFinal()
+{
+    for (size_t i = 1; i < m_pageWorkers.size(); i++) {
+        threadWaitQuit(m_pageWorkers[i].threadHandle);
+        threadFree(&m_pageWorkers[i].threadHandle);
+    }
+    m_pageWorkers.clear();
+    for (int i = 0; i < PAGES_MAX; i++) {
+        if (m_pageAR2Handle[i]) ar2DeleteHandle(&m_pageAR2Handle[i]); // Sets m_pageAR2Handle[i] to NULL.
+    }
+}
+
+// Tracks the pages in m_pageBatch. Each page has its own tracking handle and surface set, and the
+// image is only read, so the pages can be tracked concurrently with the same results as serially.
+void ARTrackerNFT::trackPages(ARUint8 *image)
+{
+    m_pageBatchImage = image;
+
+    size_t workerNum = std::min(m_pageWorkers.size(), m_pageBatch.size());
+    if (workerNum < 2) {
+        for (size_t i = 0; i < m_pageBatch.size(); i++) {
+            float err;
+            int page = m_pageBatch[i];
+            m_pageBatchResult[i] = ar2Tracking(m_pageAR2Handle[page], m_surfaceSet[page], image, m_pageBatchTrans[i], &err);
+        }
+        return;
+    }
+    for (size_t i = 1; i < workerNum; i++) threadStartSignal(m_pageWorkers[i].threadHandle);
+    trackPagesWorker(&m_pageWorkers[0]);
+    for (size_t i = 1; i < workerNum; i++) threadEndWait(m_pageWorkers[i].threadHandle);
+}
+
+void ARTrackerNFT::trackPagesWorker(PageWorker *worker)
+{
+    size_t workerNum = std::min(m_pageWorkers.size(), m_pageBatch.size());
+    for (size_t i = worker->index; i < m_pageBatch.size(); i += workerNum) {
+        float err;
+        int page = m_pageBatch[i];
+        m_pageBatchResult[i] = ar2Tracking(m_pageAR2Handle[page], m_surfaceSet[page], m_pageBatchImage, m_pageBatchTrans[i], &err);
+    }
+}
+
+void *ARTrackerNFT::pageWorker(THREAD_HANDLE_T *threadHandle)
+{
+    PageWorker *worker = (PageWorker *)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0) {
+        worker->tracker->trackPagesWorker(worker);
+        threadEndSignal(threadHandle);
+    }
+    return (NULL);
+}
+
 bool ARTrackerNFT::update(AR2VideoBufferT *buff0, AR2VideoBufferT *buff1)
 {
     return update(buff0);
@@ -309,6 +463,7 @@ bool ARTrackerNFT::stop()
 
     // NFT cleanup.
     //ARLOGd("Cleaning up artoolkitX NFT handles.\n");
+    pageHandlesFinal();
     if (m_ar2Handle) {
         ar2DeleteHandle(&m_ar2Handle); // Sets m_ar2Handle to NULL.
     }
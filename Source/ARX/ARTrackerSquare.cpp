@@ -44,6 +44,7 @@
 #include <ARX/ARTrackableMultiSquareAuto.h>
 #include <ARX/AR/ar.h>
 #include <algorithm>
+#include <map>
 
 ARTrackerSquare::ARTrackerSquare() :
     m_trackables(),
@@ -51,6 +52,13 @@ ARTrackerSquare::ARTrackerSquare() :
     m_thresholdMode(AR_LABELING_THRESH_MODE_DEFAULT),
     m_imageProcMode(AR_DEFAULT_IMAGE_PROC_MODE),
     m_labelingMode(AR_DEFAULT_LABELING_MODE),
+    m_labelingThreadCount(AR_LABELING_THREAD_COUNT_DEFAULT),
+    m_markerInfoThreadCount(AR_MARKER_INFO_THREAD_COUNT_DEFAULT),
+    m_ROITracking(false),
+    m_thresholdAutoBracketingMode(AR_DEFAULT_LABELING_THRESH_AUTO_BRACKETING_MODE),
+    m_poseThreadCount(AR_POSE_THREAD_COUNT_DEFAULT),
+    m_stereoDetectionThreaded(false),
+    m_stereoEpipolarSearch(false),
     m_pattRatio(AR_PATT_RATIO),
     m_patternDetectionMode(AR_DEFAULT_PATTERN_DETECTION_MODE),
     m_matrixCodeType(AR_MATRIX_CODE_TYPE_DEFAULT),
@@ -63,8 +71,18 @@ ARTrackerSquare::ARTrackerSquare() :
     m_arHandle0(NULL),
     m_arHandle1(NULL),
     m_arPattHandle(NULL),
+    m_matrixCodeDictionary(NULL),
+    m_matrixCodeDictionaryMaxErrors(-1),
     m_ar3DHandle(NULL),
-    m_ar3DStereoHandle(NULL)
+    m_ar3DStereoHandle(NULL),
+    m_poseWorkers(),
+    m_poseBatch(),
+    m_poseBatchSuccess(),
+    m_poseBatchMarkerInfo(NULL),
+    m_poseBatchMarkerNum(0),
+    m_stereoDetectionThread(NULL),
+    m_stereoDetectionBuff1(NULL),
+    m_stereoDetectionResult1(0)
 {
     
 }
@@ -81,6 +99,7 @@ bool ARTrackerSquare::initialize()
         ARLOGe("Error: arPattCreateHandle2.\n");
         return false;
     }
+    if (m_matrixCodeDictionary) arPattAttachMatrixCodeDictionary(m_arPattHandle, m_matrixCodeDictionary);
     
     return true;
 }
@@ -187,6 +206,121 @@ int ARTrackerSquare::labelingMode() const
     return m_labelingMode;
 }
 
+void ARTrackerSquare::setLabelingThreadCount(int threadCount)
+{
+    m_labelingThreadCount = threadCount;
+    if (m_arHandle0) {
+        arSetLabelingThreadCount(m_arHandle0, m_labelingThreadCount);
+        ARLOGi("Labeling thread count set to %d\n", arGetLabelingThreadCount(m_arHandle0));
+    }
+    if (m_arHandle1) {
+        arSetLabelingThreadCount(m_arHandle1, m_labelingThreadCount);
+        ARLOGi("Labeling thread count set to %d\n", arGetLabelingThreadCount(m_arHandle1));
+    }
+}
+
+int ARTrackerSquare::labelingThreadCount() const
+{
+    if (m_arHandle0) return arGetLabelingThreadCount(m_arHandle0);
+    return m_labelingThreadCount;
+}
+
+void ARTrackerSquare::setMarkerInfoThreadCount(int threadCount)
+{
+    m_markerInfoThreadCount = threadCount;
+    if (m_arHandle0) {
+        arSetMarkerInfoThreadCount(m_arHandle0, m_markerInfoThreadCount);
+        ARLOGi("Marker decoding thread count set to %d\n", arGetMarkerInfoThreadCount(m_arHandle0));
+    }
+    if (m_arHandle1) {
+        arSetMarkerInfoThreadCount(m_arHandle1, m_markerInfoThreadCount);
+        ARLOGi("Marker decoding thread count set to %d\n", arGetMarkerInfoThreadCount(m_arHandle1));
+    }
+}
+
+int ARTrackerSquare::markerInfoThreadCount() const
+{
+    if (m_arHandle0) return arGetMarkerInfoThreadCount(m_arHandle0);
+    return m_markerInfoThreadCount;
+}
+
+void ARTrackerSquare::setROITracking(bool on)
+{
+    m_ROITracking = on;
+    if (m_arHandle0) {
+        arSetROITrackingMode(m_arHandle0, m_ROITracking ? AR_ROI_TRACKING_ENABLE : AR_ROI_TRACKING_DISABLE);
+        ARLOGi("Region-of-interest tracking set to %s.\n", on ? "on" : "off");
+    }
+    if (m_arHandle1) {
+        arSetROITrackingMode(m_arHandle1, m_ROITracking ? AR_ROI_TRACKING_ENABLE : AR_ROI_TRACKING_DISABLE);
+        ARLOGi("Region-of-interest tracking set to %s.\n", on ? "on" : "off");
+    }
+}
+
+bool ARTrackerSquare::ROITracking() const
+{
+    return m_ROITracking;
+}
+
+void ARTrackerSquare::setPoseThreadCount(int threadCount)
+{
+    m_poseThreadCount = threadCount;
+    if (m_ar3DHandle) {
+        poseWorkersFinal();
+        poseWorkersInit();
+        ARLOGi("Pose thread count set to %d\n", m_poseWorkers.empty() ? 1 : (int)m_poseWorkers.size());
+    }
+}
+
+int ARTrackerSquare::poseThreadCount() const
+{
+    if (m_ar3DHandle) return (m_poseWorkers.empty() ? 1 : (int)m_poseWorkers.size());
+    return m_poseThreadCount;
+}
+
+void ARTrackerSquare::setStereoDetectionThreaded(bool threaded)
+{
+    m_stereoDetectionThreaded = threaded;
+    if (m_arHandle1) {
+        stereoDetectionWorkerFinal();
+        stereoDetectionWorkerInit();
+        ARLOGi("Stereo detection set to %s.\n", m_stereoDetectionThread ? "concurrent" : "serial");
+    }
+}
+
+bool ARTrackerSquare::stereoDetectionThreaded() const
+{
+    return m_stereoDetectionThreaded;
+}
+
+void ARTrackerSquare::setStereoEpipolarSearch(bool on)
+{
+    m_stereoEpipolarSearch = on;
+}
+
+bool ARTrackerSquare::stereoEpipolarSearch() const
+{
+    return m_stereoEpipolarSearch;
+}
+
+void ARTrackerSquare::setThresholdAutoBracketingMode(int mode)
+{
+    m_thresholdAutoBracketingMode = mode;
+    if (m_arHandle0) {
+        arSetLabelingThreshAutoBracketingMode(m_arHandle0, m_thresholdAutoBracketingMode);
+        ARLOGi("Auto-threshold bracketing mode set to %d.\n", arGetLabelingThreshAutoBracketingMode(m_arHandle0));
+    }
+    if (m_arHandle1) {
+        arSetLabelingThreshAutoBracketingMode(m_arHandle1, m_thresholdAutoBracketingMode);
+        ARLOGi("Auto-threshold bracketing mode set to %d.\n", arGetLabelingThreshAutoBracketingMode(m_arHandle1));
+    }
+}
+
+int ARTrackerSquare::thresholdAutoBracketingMode() const
+{
+    return m_thresholdAutoBracketingMode;
+}
+
 void ARTrackerSquare::setPatternDetectionMode(int mode)
 {
     m_patternDetectionMode = mode;
@@ -256,6 +390,7 @@ void ARTrackerSquare::setPatternSize(int patternSize)
     arPattDeleteHandle(m_arPattHandle);
     m_patternSize = patternSize;
     m_arPattHandle = arPattCreateHandle2(m_patternSize, m_patternCountMax);
+    if (m_arPattHandle && m_matrixCodeDictionary) arPattAttachMatrixCodeDictionary(m_arPattHandle, m_matrixCodeDictionary);
 }
 
 int ARTrackerSquare::patternSize() const
@@ -269,7 +404,7 @@ void ARTrackerSquare::setPatternCountMax(int patternCountMax)
     if (m_arPattHandle->patt_num > 0) {
         ARLOGe("Attempt to set pattern count max but patterns already loaded. Unload first and then retry.\n");
     }
-    if (patternCountMax > AR_PATT_NUM_MAX || patternCountMax <= 0) {
+    if (patternCountMax <= 0) {
         ARLOGe("Attempt to set pattern count max to invalid value %d.\n", patternCountMax);
         return;
     }
@@ -277,6 +412,7 @@ void ARTrackerSquare::setPatternCountMax(int patternCountMax)
     arPattDeleteHandle(m_arPattHandle);
     m_patternCountMax = patternCountMax;
     m_arPattHandle = arPattCreateHandle2(m_patternSize, m_patternCountMax);
+    if (m_arPattHandle && m_matrixCodeDictionary) arPattAttachMatrixCodeDictionary(m_arPattHandle, m_matrixCodeDictionary);
 }
 
 int ARTrackerSquare::patternCountMax() const
@@ -284,6 +420,44 @@ int ARTrackerSquare::patternCountMax() const
     return m_patternCountMax;
 }
 
+bool ARTrackerSquare::loadMatrixCodeDictionary(const char *path)
+{
+    ARMatrixCodeDictionary *dict = arMatrixCodeDictionaryLoad(path);
+    if (!dict) {
+        ARLOGe("Error loading matrix code dictionary from '%s'.\n", path);
+        return false;
+    }
+    if (m_matrixCodeDictionaryMaxErrors >= 0) arMatrixCodeDictionarySetMaxErrors(dict, m_matrixCodeDictionaryMaxErrors);
+    
+    if (m_matrixCodeDictionary) {
+        if (m_arPattHandle) arPattDetachMatrixCodeDictionary(m_arPattHandle);
+        arMatrixCodeDictionaryDelete(&m_matrixCodeDictionary);
+    }
+    m_matrixCodeDictionary = dict;
+    if (m_arPattHandle) arPattAttachMatrixCodeDictionary(m_arPattHandle, m_matrixCodeDictionary);
+    ARLOGi("Loaded %d %dx%d matrix codes from dictionary '%s'.\n", arMatrixCodeDictionaryGetCodeNum(dict), arMatrixCodeDictionaryGetSize(dict), arMatrixCodeDictionaryGetSize(dict), path);
+    return true;
+}
+
+void ARTrackerSquare::setMatrixCodeDictionaryMaxErrors(int maxErrors)
+{
+    if (maxErrors < -1) {
+        ARLOGe("Attempt to set matrix code dictionary max errors to invalid value %d.\n", maxErrors);
+        return;
+    }
+    m_matrixCodeDictionaryMaxErrors = maxErrors;
+    if (m_matrixCodeDictionary) {
+        if (maxErrors >= 0) arMatrixCodeDictionarySetMaxErrors(m_matrixCodeDictionary, maxErrors);
+        else arMatrixCodeDictionarySetMaxErrors(m_matrixCodeDictionary, (arMatrixCodeDictionaryGetMinDistance(m_matrixCodeDictionary) - 1)/2);
+    }
+}
+
+int ARTrackerSquare::matrixCodeDictionaryMaxErrors() const
+{
+    if (m_matrixCodeDictionary) return arMatrixCodeDictionaryGetMaxErrors(m_matrixCodeDictionary);
+    return m_matrixCodeDictionaryMaxErrors;
+}
+
 bool ARTrackerSquare::start(ARParamLT *paramLT, AR_PIXEL_FORMAT pixelFormat)
 {
     return start(paramLT, pixelFormat, NULL, AR_PIXEL_FORMAT_INVALID, NULL);
@@ -310,6 +484,10 @@ bool ARTrackerSquare::start(ARParamLT *paramLT0, AR_PIXEL_FORMAT pixelFormat0, A
     arSetImageProcMode(m_arHandle0, m_imageProcMode);
     arSetDebugMode(m_arHandle0, m_debugMode);
     arSetLabelingMode(m_arHandle0, m_labelingMode);
+    arSetLabelingThreadCount(m_arHandle0, m_labelingThreadCount);
+    arSetMarkerInfoThreadCount(m_arHandle0, m_markerInfoThreadCount);
+    arSetROITrackingMode(m_arHandle0, m_ROITracking ? AR_ROI_TRACKING_ENABLE : AR_ROI_TRACKING_DISABLE);
+    arSetLabelingThreshAutoBracketingMode(m_arHandle0, m_thresholdAutoBracketingMode);
     arSetPattRatio(m_arHandle0, m_pattRatio);
     arSetPatternDetectionMode(m_arHandle0, m_patternDetectionMode);
     arSetMatrixCodeType(m_arHandle0, m_matrixCodeType);
@@ -332,6 +510,10 @@ bool ARTrackerSquare::start(ARParamLT *paramLT0, AR_PIXEL_FORMAT pixelFormat0, A
         arSetImageProcMode(m_arHandle1, m_imageProcMode);
         arSetDebugMode(m_arHandle1, m_debugMode);
         arSetLabelingMode(m_arHandle1, m_labelingMode);
+        arSetLabelingThreadCount(m_arHandle1, m_labelingThreadCount);
+        arSetMarkerInfoThreadCount(m_arHandle1, m_markerInfoThreadCount);
+        arSetROITrackingMode(m_arHandle1, m_ROITracking ? AR_ROI_TRACKING_ENABLE : AR_ROI_TRACKING_DISABLE);
+        arSetLabelingThreshAutoBracketingMode(m_arHandle1, m_thresholdAutoBracketingMode);
         arSetPattRatio(m_arHandle1, m_pattRatio);
         arSetPatternDetectionMode(m_arHandle1, m_patternDetectionMode);
         arSetMatrixCodeType(m_arHandle1, m_matrixCodeType);
@@ -343,6 +525,7 @@ bool ARTrackerSquare::start(ARParamLT *paramLT0, AR_PIXEL_FORMAT pixelFormat0, A
             ARLOGe("ar3DCreateHandle\n");
             goto bail2;
         }
+        poseWorkersInit();
     } else{
         memcpy(m_transL2R, transL2R, sizeof(ARdouble)*12);
         m_ar3DStereoHandle = ar3DStereoCreateHandle(&paramLT0->param, &paramLT1->param, AR_TRANS_MAT_IDENTITY, m_transL2R);
@@ -350,6 +533,7 @@ bool ARTrackerSquare::start(ARParamLT *paramLT0, AR_PIXEL_FORMAT pixelFormat0, A
             ARLOGe("ar3DStereoCreateHandle\n");
             goto bail2;
         }
+        stereoDetectionWorkerInit();
     }
     
     ARLOGd("ARTrackerSquare::start() done.\n");
@@ -386,24 +570,48 @@ bool ARTrackerSquare::update(AR2VideoBufferT *buff0, AR2VideoBufferT *buff1)
 
     if (!buff0 || !m_arHandle0 || (buff1 && !m_arHandle1)) return false;
 
-    if (arDetectMarker(m_arHandle0, buff0) < 0) {
-        ARLOGe("arDetectMarker().\n");
-        return false;
+    // The two handles share only the pattern handle, which detection reads but doesn't write, so
+    // the second image can be processed concurrently. Both are joined here, before any trackable update.
+    if (buff1 && m_stereoEpipolarSearch) {
+        if (arDetectMarker(m_arHandle0, buff0) < 0) {
+            ARLOGe("arDetectMarker().\n");
+            return false;
+        }
+        if (!detectMarkersInEpipolarBands(buff1)) {
+            ARLOGe("arDetectMarkerInWindows().\n");
+            return false;
+        }
+    } else if (buff1 && m_stereoDetectionThread) {
+        m_stereoDetectionBuff1 = buff1;
+        threadStartSignal(m_stereoDetectionThread);
+        int result0 = arDetectMarker(m_arHandle0, buff0);
+        threadEndWait(m_stereoDetectionThread);
+        if (result0 < 0 || m_stereoDetectionResult1 < 0) {
+            ARLOGe("arDetectMarker().\n");
+            return false;
+        }
+    } else {
+        if (arDetectMarker(m_arHandle0, buff0) < 0) {
+            ARLOGe("arDetectMarker().\n");
+            return false;
+        }
+        if (buff1 && arDetectMarker(m_arHandle1, buff1) < 0) {
+            ARLOGe("arDetectMarker().\n");
+            return false;
+        }
     }
     markerInfo0 = arGetMarker(m_arHandle0);
     markerNum0 = arGetMarkerNum(m_arHandle0);
     if (buff1) {
-        if (arDetectMarker(m_arHandle1, buff1) < 0) {
-            ARLOGe("arDetectMarker().\n");
-            return false;
-        }
         markerInfo1 = arGetMarker(m_arHandle1);
         markerNum1 = arGetMarkerNum(m_arHandle1);
     }
 
     // Update square markers.
     bool success = true;
-    if (!buff1) {
+    if (!buff1 && !m_poseWorkers.empty() && trackablesClaimDisjointMarkers(markerInfo0, markerNum0)) {
+        success = updatePoseBatch(markerInfo0, markerNum0);
+    } else if (!buff1) {
         for (std::vector<std::shared_ptr<ARTrackable>>::iterator it = m_trackables.begin(); it != m_trackables.end(); ++it) {
             if ((*it)->type == ARTrackable::SINGLE) {
                 success &= (std::static_pointer_cast<ARTrackableSquare>(*it))->updateWithDetectedMarkers(markerInfo0, markerNum0, m_ar3DHandle);
@@ -475,9 +683,234 @@ bool ARTrackerSquare::update(AR2VideoBufferT *buff0, AR2VideoBufferT *buff1)
     return true;
 }
 
+// ----------------------------------------------------------------------------------------------------
+#pragma mark  Parallel pose estimation
+
+void ARTrackerSquare::poseWorkersInit()
+{
+    int threadCount = (m_poseThreadCount == AR_POSE_THREAD_COUNT_AUTO ? threadGetCPU() : m_poseThreadCount);
+    if (threadCount > AR_POSE_THREAD_MAX) threadCount = AR_POSE_THREAD_MAX;
+    if (threadCount < 2 || !m_ar3DHandle) return;
+
+    // Worker 0 runs on the calling thread. Each other worker has its own pose estimator, as
+    // the ICP handle holds per-call state (inlier probability, scratch arena).
+    m_poseWorkers.resize(threadCount); // Not resized again until poseWorkersFinal(), so workers can hold pointers to their entries.
+    for (int i = 0; i < threadCount; i++) {
+        m_poseWorkers[i].tracker = this;
+        m_poseWorkers[i].index = i;
+        m_poseWorkers[i].ar3DHandle = (i == 0 ? m_ar3DHandle : ar3DCreateHandle2((const ARdouble (*)[4])m_ar3DHandle->icpHandle->matXc2U));
+        m_poseWorkers[i].threadHandle = NULL;
+        if (!m_poseWorkers[i].ar3DHandle) {
+            ARLOGe("ar3DCreateHandle2\n");
+            m_poseWorkers.resize(i);
+            break;
+        }
+        if (i > 0) {
+            m_poseWorkers[i].threadHandle = threadInit(i, &m_poseWorkers[i], poseWorker);
+            if (!m_poseWorkers[i].threadHandle) {
+                ARLOGe("Error: unable to start pose thread %d.\n", i);
+                ar3DDeleteHandle(&m_poseWorkers[i].ar3DHandle);
+                m_poseWorkers.resize(i);
+                break;
+            }
+        }
+    }
+    if (m_poseWorkers.size() < 2) poseWorkersFinal();
+}
+
+void ARTrackerSquare::poseWorkersFinal()
+{
+    for (size_t i = 1; i < m_poseWorkers.size(); i++) {
+        threadWaitQuit(m_poseWorkers[i].threadHandle);
+        threadFree(&m_poseWorkers[i].threadHandle);
+        ar3DDeleteHandle(&m_poseWorkers[i].ar3DHandle);
+    }
+    m_poseWorkers.clear();
+}
+
+// Returns true if no detected marker could be claimed by more than one trackable, and so the
+// trackables can be updated in any order, or concurrently, with the same results. Claims are
+// judged by ID alone, ignoring confidence cutoffs, so this errs on the side of false.
+bool ARTrackerSquare::trackablesClaimDisjointMarkers(ARMarkerInfo *markerInfo, int markerNum) const
+{
+    enum { CLAIM_TEMPLATE, CLAIM_MATRIX, CLAIM_GLOBAL_ID };
+    typedef std::multimap<std::pair<int, uint64_t>, const ARTrackable *> ClaimMap;
+    ClaimMap claims;
+
+    for (std::vector<std::shared_ptr<ARTrackable>>::const_iterator it = m_trackables.begin(); it != m_trackables.end(); ++it) {
+        if ((*it)->type == ARTrackable::SINGLE) {
+            ARTrackableSquare *t = (ARTrackableSquare *)it->get();
+            if (t->patt_id < 0) continue;
+            if (t->patt_type == AR_PATTERN_TYPE_TEMPLATE) {
+                claims.insert(ClaimMap::value_type(std::make_pair((int)CLAIM_TEMPLATE, (uint64_t)t->patt_id), t));
+            } else {
+                claims.insert(ClaimMap::value_type(std::make_pair((int)CLAIM_MATRIX, (uint64_t)t->patt_id), t));
+                if (t->globalID) claims.insert(ClaimMap::value_type(std::make_pair((int)CLAIM_GLOBAL_ID, t->globalID), t));
+            }
+        } else if ((*it)->type == ARTrackable::MULTI) {
+            ARTrackableMultiSquare *t = (ARTrackableMultiSquare *)it->get();
+            if (!t->config) continue;
+            for (int i = 0; i < t->config->marker_num; i++) {
+                const ARMultiEachMarkerInfoT *m = &t->config->marker[i];
+                if (m->patt_type == AR_MULTI_PATTERN_TYPE_TEMPLATE) {
+                    claims.insert(ClaimMap::value_type(std::make_pair((int)CLAIM_TEMPLATE, (uint64_t)m->patt_id), t));
+                } else {
+                    claims.insert(ClaimMap::value_type(std::make_pair((int)CLAIM_MATRIX, (uint64_t)m->patt_id), t));
+                    if (m->globalID) claims.insert(ClaimMap::value_type(std::make_pair((int)CLAIM_GLOBAL_ID, m->globalID), t));
+                }
+            }
+        } else {
+            return false; // E.g. MULTI_AUTO, which claims any marker.
+        }
+    }
+
+    for (int j = 0; j < markerNum; j++) {
+        const ARTrackable *claimant = NULL;
+        std::pair<int, uint64_t> keys[2];
+        int keyNum = 0;
+        if (markerInfo[j].idPatt >= 0) keys[keyNum++] = std::make_pair((int)CLAIM_TEMPLATE, (uint64_t)markerInfo[j].idPatt);
+        if (markerInfo[j].idMatrix == 0 && markerInfo[j].globalID != 0ULL) keys[keyNum++] = std::make_pair((int)CLAIM_GLOBAL_ID, markerInfo[j].globalID);
+        else if (markerInfo[j].idMatrix >= 0) keys[keyNum++] = std::make_pair((int)CLAIM_MATRIX, (uint64_t)markerInfo[j].idMatrix);
+        for (int k = 0; k < keyNum; k++) {
+            std::pair<ClaimMap::const_iterator, ClaimMap::const_iterator> range = claims.equal_range(keys[k]);
+            for (ClaimMap::const_iterator c = range.first; c != range.second; ++c) {
+                if (!claimant) claimant = c->second;
+                else if (c->second != claimant) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Updates the single and multi-square trackables on the pose workers. Each trackable reads and
+// writes only the markers it could claim, which trackablesClaimDisjointMarkers() has checked
+// are disjoint, and its own state, so the results are those of updating them in order.
+bool ARTrackerSquare::updatePoseBatch(ARMarkerInfo *markerInfo, int markerNum)
+{
+    m_poseBatch.clear();
+    for (std::vector<std::shared_ptr<ARTrackable>>::iterator it = m_trackables.begin(); it != m_trackables.end(); ++it) {
+        m_poseBatch.push_back(it->get());
+    }
+    m_poseBatchSuccess.assign(m_poseBatch.size(), 1);
+    m_poseBatchMarkerInfo = markerInfo;
+    m_poseBatchMarkerNum = markerNum;
+
+    size_t workerNum = std::min(m_poseWorkers.size(), m_poseBatch.size());
+    for (size_t i = 1; i < workerNum; i++) threadStartSignal(m_poseWorkers[i].threadHandle);
+    if (workerNum > 0) updatePoseBatchWorker(&m_poseWorkers[0]);
+    for (size_t i = 1; i < workerNum; i++) threadEndWait(m_poseWorkers[i].threadHandle);
+
+    bool success = true;
+    for (size_t i = 0; i < m_poseBatch.size(); i++) success &= (m_poseBatchSuccess[i] != 0);
+    return success;
+}
+
+void ARTrackerSquare::updatePoseBatchWorker(PoseWorker *worker)
+{
+    size_t workerNum = std::min(m_poseWorkers.size(), m_poseBatch.size());
+    for (size_t i = worker->index; i < m_poseBatch.size(); i += workerNum) {
+        ARTrackable *t = m_poseBatch[i];
+        bool success = true;
+        if (t->type == ARTrackable::SINGLE) {
+            success = ((ARTrackableSquare *)t)->updateWithDetectedMarkers(m_poseBatchMarkerInfo, m_poseBatchMarkerNum, worker->ar3DHandle);
+        } else if (t->type == ARTrackable::MULTI) {
+            success = ((ARTrackableMultiSquare *)t)->updateWithDetectedMarkers(m_poseBatchMarkerInfo, m_poseBatchMarkerNum, worker->ar3DHandle);
+        }
+        m_poseBatchSuccess[i] = success;
+    }
+}
+
+void *ARTrackerSquare::poseWorker(THREAD_HANDLE_T *threadHandle)
+{
+    PoseWorker *worker = (PoseWorker *)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0) {
+        worker->tracker->updatePoseBatchWorker(worker);
+        threadEndSignal(threadHandle);
+    }
+    return (NULL);
+}
+
+// ----------------------------------------------------------------------------------------------------
+#pragma mark  Stereo detection
+
+// The width of the trackable which could claim the marker, or 0 if none is known.
+ARdouble ARTrackerSquare::markerWidth(const ARMarkerInfo *markerInfo) const
+{
+    for (std::vector<std::shared_ptr<ARTrackable>>::const_iterator it = m_trackables.begin(); it != m_trackables.end(); ++it) {
+        if ((*it)->type == ARTrackable::SINGLE) {
+            ARTrackableSquare *t = (ARTrackableSquare *)it->get();
+            if (t->patt_id < 0) continue;
+            if (t->patt_type == AR_PATTERN_TYPE_TEMPLATE ? markerInfo->idPatt == t->patt_id
+                                                         : (t->globalID ? markerInfo->globalID == t->globalID : markerInfo->idMatrix == t->patt_id)) return t->width();
+        } else if ((*it)->type == ARTrackable::MULTI) {
+            ARTrackableMultiSquare *t = (ARTrackableMultiSquare *)it->get();
+            if (!t->config) continue;
+            for (int i = 0; i < t->config->marker_num; i++) {
+                const ARMultiEachMarkerInfoT *m = &t->config->marker[i];
+                if (m->patt_type == AR_MULTI_PATTERN_TYPE_TEMPLATE ? markerInfo->idPatt == m->patt_id
+                                                                   : (m->globalID ? markerInfo->globalID == m->globalID : markerInfo->idMatrix == m->patt_id)) return m->width;
+            }
+        }
+    }
+    if (m_matrixModeAutoCreateNewTrackables && markerInfo->idMatrix >= 0) return m_matrixModeAutoCreateNewTrackablesDefaultWidth;
+    return 0.0;
+}
+
+// Searches the second image of a stereo pair only in the windows in which markers identified in the first must lie.
+bool ARTrackerSquare::detectMarkersInEpipolarBands(AR2VideoBufferT *buff1)
+{
+    ARMarkerInfo *markerInfo0 = arGetMarker(m_arHandle0);
+    int markerNum0 = arGetMarkerNum(m_arHandle0);
+    int win[AR_SQUARE_MAX][4];
+    const ARMarkerInfo *expected[AR_SQUARE_MAX];
+    int winNum = 0;
+
+    for (int i = 0; i < markerNum0; i++) {
+        if (markerInfo0[i].idPatt < 0 && markerInfo0[i].idMatrix < 0) continue;
+        if (arGetStereoEpipolarWindow(m_ar3DStereoHandle, &(m_arHandle1->arParamLT->paramLTf), m_arHandle1->xsize, m_arHandle1->ysize,
+                                      &markerInfo0[i], markerWidth(&markerInfo0[i]), win[winNum]) < 0) continue;
+        expected[winNum++] = &markerInfo0[i];
+    }
+
+    // Windows alone can't set a threshold, so use the first image's.
+    if (m_thresholdMode != AR_LABELING_THRESH_MODE_MANUAL) arSetLabelingThresh(m_arHandle1, arGetLabelingThresh(m_arHandle0));
+
+    return (arDetectMarkerInWindows(m_arHandle1, buff1, win, expected, winNum) == 0);
+}
+
+void ARTrackerSquare::stereoDetectionWorkerInit()
+{
+    if (!m_stereoDetectionThreaded || !m_arHandle1) return;
+    m_stereoDetectionThread = threadInit(1, this, stereoDetectionWorker);
+    if (!m_stereoDetectionThread) {
+        ARLOGe("Error: unable to start stereo detection thread.\n");
+    }
+}
+
+void ARTrackerSquare::stereoDetectionWorkerFinal()
+{
+    if (!m_stereoDetectionThread) return;
+    threadWaitQuit(m_stereoDetectionThread);
+    threadFree(&m_stereoDetectionThread);
+}
+
+void *ARTrackerSquare::stereoDetectionWorker(THREAD_HANDLE_T *threadHandle)
+{
+    ARTrackerSquare *tracker = (ARTrackerSquare *)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0) {
+        tracker->m_stereoDetectionResult1 = arDetectMarker(tracker->m_arHandle1, tracker->m_stereoDetectionBuff1);
+        threadEndSignal(threadHandle);
+    }
+    return (NULL);
+}
+
 bool ARTrackerSquare::stop()
 {
     //ARLOGd("Cleaning up artoolkitX handles.\n");
+    poseWorkersFinal();
+    stereoDetectionWorkerFinal();
     if (m_ar3DHandle) {
         ar3DDeleteHandle(&m_ar3DHandle); // Sets ar3DHandle0 to NULL.
     }
@@ -505,6 +938,7 @@ void ARTrackerSquare::terminate()
         arPattDeleteHandle(m_arPattHandle);
         m_arPattHandle = NULL;
     }
+    arMatrixCodeDictionaryDelete(&m_matrixCodeDictionary);
 }
 
 int ARTrackerSquare::newTrackable(std::vector<std::string> config)
@@ -66,6 +66,8 @@ ARVideoSource::ARVideoSource() :
     cameraParamBuffer(NULL),
     cameraParamBufferLen(0L),
     cparamLT(NULL),
+    m_cparamLTType(AR_PARAM_LT_TYPE_FLOAT),
+    m_cparamLTCacheDir(NULL),
     videoConfiguration(NULL),
     videoWidth(0),
     videoHeight(0),
@@ -97,6 +99,7 @@ ARVideoSource::~ARVideoSource()
         cameraParamBuffer = NULL;
         cameraParamBufferLen = 0;
     }
+    free(m_cparamLTCacheDir);
 
     pthread_rwlock_destroy(&m_frameBufferLock);
 }
@@ -137,6 +140,23 @@ void ARVideoSource::configure(const char* vconf, bool noCpara, const char* cpara
     }
 }
 
+void ARVideoSource::setCameraParametersLookupTable(int type, const char* cacheDir)
+{
+    if (deviceState != DEVICE_CLOSED) {
+        ARLOGe("ARVideoSource::setCameraParametersLookupTable(): error: device is already open.\n");
+        return;
+    }
+
+    m_cparamLTType = type;
+
+    free(m_cparamLTCacheDir);
+    m_cparamLTCacheDir = NULL;
+    if (cacheDir) {
+        m_cparamLTCacheDir = strdup(cacheDir);
+        ARLOGi("Caching camera parameter lookup tables in '%s'.\n", m_cparamLTCacheDir);
+    }
+}
+
 bool ARVideoSource::open()
 {
     ARLOGi("Opening artoolkitX video using configuration '%s'.\n", videoConfiguration);
@@ -262,7 +282,7 @@ bool ARVideoSource::open3(const ARParam *cparam_p)
 #endif
             arParamChangeSize(&cparam, videoWidth, videoHeight, &cparam);
         }
-        if (!(cparamLT = arParamLTCreate(&cparam, AR_PARAM_LT_DEFAULT_OFFSET))) {
+        if (!(cparamLT = arParamLTCreate2(&cparam, AR_PARAM_LT_DEFAULT_OFFSET, m_cparamLTType, m_cparamLTCacheDir))) {
             ARLOGe("Error: failed to create camera parameters lookup table.\n");
             this->close();
             return false;
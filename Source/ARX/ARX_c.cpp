@@ -133,6 +133,12 @@ bool arwChangeToResourcesDir(const char *resourcesDirectoryPath)
     return (ok);
 }
 
+bool arwSetCameraParametersLookupTable(int type, const char *cacheDir)
+{
+    if (!gARTK) return false;
+    return gARTK->setCameraParametersLookupTable(type, cacheDir);
+}
+
 bool arwStartRunning(const char *vconf, const char *cparaName)
 {
     if (!gARTK) return false;
@@ -399,10 +405,21 @@ void arwSetTrackerOptionBool(int option, bool value)
     } else if (option == ARW_TRACKER_OPTION_NFT_MULTIMODE) {
 #if HAVE_NFT
         gARTK->getNFTTracker()->setNFTMultiMode(value);
+#endif
+        return;
+    } else if (option == ARW_TRACKER_OPTION_NFT_ADAPTIVE_SEARCH) {
+#if HAVE_NFT
+        gARTK->getNFTTracker()->setNFTAdaptiveSearch(value);
 #endif
         return;
     } else if (option == ARW_TRACKER_OPTION_SQUARE_DEBUG_MODE) {
         gARTK->getSquareTracker()->setDebugMode(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_ROI_TRACKING) {
+        gARTK->getSquareTracker()->setROITracking(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_STEREO_DETECTION_THREADED) {
+        gARTK->getSquareTracker()->setStereoDetectionThreaded(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_STEREO_EPIPOLAR_SEARCH) {
+        gARTK->getSquareTracker()->setStereoEpipolarSearch(value);
     } else if (option == ARW_TRACKER_OPTION_2D_THREADED) {
 #if HAVE_2D
         gARTK->get2dTracker()->setThreaded(value);
@@ -421,6 +438,16 @@ void arwSetTrackerOptionInt(int option, int value)
         gARTK->getSquareTracker()->setThresholdMode((AR_LABELING_THRESH_MODE)value);
     } else if (option == ARW_TRACKER_OPTION_SQUARE_LABELING_MODE) {
         gARTK->getSquareTracker()->setLabelingMode(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_LABELING_THREAD_COUNT) {
+        gARTK->getSquareTracker()->setLabelingThreadCount(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_MARKER_INFO_THREAD_COUNT) {
+        gARTK->getSquareTracker()->setMarkerInfoThreadCount(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_THRESHOLD_AUTO_BRACKETING_MODE) {
+        gARTK->getSquareTracker()->setThresholdAutoBracketingMode(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_POSE_THREAD_COUNT) {
+        gARTK->getSquareTracker()->setPoseThreadCount(value);
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_DICTIONARY_MAX_ERRORS) {
+        gARTK->getSquareTracker()->setMatrixCodeDictionaryMaxErrors(value);
     } else if (option == ARW_TRACKER_OPTION_SQUARE_PATTERN_DETECTION_MODE) {
         gARTK->getSquareTracker()->setPatternDetectionMode(value);
     } else if (option == ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_TYPE) {
@@ -473,9 +500,19 @@ bool arwGetTrackerOptionBool(int option)
     } else if (option == ARW_TRACKER_OPTION_NFT_MULTIMODE) {
 #if HAVE_NFT
         return  gARTK->getNFTTracker()->NFTMultiMode();
+#endif
+    } else if (option == ARW_TRACKER_OPTION_NFT_ADAPTIVE_SEARCH) {
+#if HAVE_NFT
+        return  gARTK->getNFTTracker()->NFTAdaptiveSearch();
 #endif
     } else if (option == ARW_TRACKER_OPTION_SQUARE_DEBUG_MODE) {
         return gARTK->getSquareTracker()->debugMode();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_ROI_TRACKING) {
+        return gARTK->getSquareTracker()->ROITracking();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_STEREO_DETECTION_THREADED) {
+        return gARTK->getSquareTracker()->stereoDetectionThreaded();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_STEREO_EPIPOLAR_SEARCH) {
+        return gARTK->getSquareTracker()->stereoEpipolarSearch();
     } else if (option == ARW_TRACKER_OPTION_2D_THREADED) {
 #if HAVE_2D
         return gARTK->get2dTracker()->threaded();
@@ -494,6 +531,16 @@ int arwGetTrackerOptionInt(int option)
         return gARTK->getSquareTracker()->thresholdMode();
     } else if (option == ARW_TRACKER_OPTION_SQUARE_LABELING_MODE) {
         return (int)gARTK->getSquareTracker()->labelingMode();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_LABELING_THREAD_COUNT) {
+        return gARTK->getSquareTracker()->labelingThreadCount();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_MARKER_INFO_THREAD_COUNT) {
+        return gARTK->getSquareTracker()->markerInfoThreadCount();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_THRESHOLD_AUTO_BRACKETING_MODE) {
+        return gARTK->getSquareTracker()->thresholdAutoBracketingMode();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_POSE_THREAD_COUNT) {
+        return gARTK->getSquareTracker()->poseThreadCount();
+    } else if (option == ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_DICTIONARY_MAX_ERRORS) {
+        return gARTK->getSquareTracker()->matrixCodeDictionaryMaxErrors();
     } else if (option == ARW_TRACKER_OPTION_SQUARE_PATTERN_DETECTION_MODE) {
         return gARTK->getSquareTracker()->patternDetectionMode();
     } else if (option == ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_TYPE) {
@@ -537,6 +584,12 @@ float arwGetTrackerOptionFloat(int option)
     return (NAN);
 }
 
+bool arwLoadMatrixCodeDictionary(const char *path)
+{
+    if (!gARTK || !path) return false;
+    return gARTK->getSquareTracker()->loadMatrixCodeDictionary(path);
+}
+
 // ----------------------------------------------------------------------------------------------------
 #pragma mark  Trackable management
 // ---------------------------------------------------------------------------------------------
@@ -1097,6 +1150,7 @@ extern "C" {
 	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwInitialiseAR(JNIEnv *env, jobject obj));
 	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwChangeToResourcesDir(JNIEnv *env, jobject obj, jstring resourcesDirectoryPath));
 	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwShutdownAR(JNIEnv *env, jobject obj));
+	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwSetCameraParametersLookupTable(JNIEnv *env, jobject obj, jint type, jstring cacheDir));
 	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwStartRunning(JNIEnv *env, jobject obj, jstring vconf, jstring cparaName));
 	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwStartRunningStereo(JNIEnv *env, jobject obj, jstring vconfL, jstring cparaNameL, jstring vconfR, jstring cparaNameR, jstring transL2RName));
 	JNIEXPORT jboolean JNICALL JNIFUNCTION(arwIsRunning(JNIEnv *env, jobject obj));
@@ -1126,6 +1180,7 @@ extern "C" {
     JNIEXPORT jboolean JNICALL JNIFUNCTION(arwGetTrackerOptionBool(JNIEnv *env, jobject obj, jint option));
     JNIEXPORT jint JNICALL JNIFUNCTION(arwGetTrackerOptionInt(JNIEnv *env, jobject obj, jint option));
     JNIEXPORT jfloat JNICALL JNIFUNCTION(arwGetTrackerOptionFloat(JNIEnv *env, jobject obj, jint option));
+    JNIEXPORT jboolean JNICALL JNIFUNCTION(arwLoadMatrixCodeDictionary(JNIEnv *env, jobject obj, jstring path));
     JNIEXPORT void JNICALL JNIFUNCTION(arwSetTrackableOptionBool(JNIEnv *env, jobject obj, jint trackableUID, jint option, jboolean value));
     JNIEXPORT void JNICALL JNIFUNCTION(arwSetTrackableOptionInt(JNIEnv *env, jobject obj, jint trackableUID, jint option, jint value));
     JNIEXPORT void JNICALL JNIFUNCTION(arwSetTrackableOptionFloat(JNIEnv *env, jobject obj, jint trackableUID, jint option, jfloat value));
@@ -1206,6 +1261,17 @@ JNIEXPORT jboolean JNICALL JNIFUNCTION(arwShutdownAR(JNIEnv *env, jobject obj))
 	return arwShutdownAR();
 }
 
+JNIEXPORT jboolean JNICALL JNIFUNCTION(arwSetCameraParametersLookupTable(JNIEnv *env, jobject obj, jint type, jstring cacheDir))
+{
+    const char *cacheDirC = (env->IsSameObject(cacheDir, NULL) ? NULL : env->GetStringUTFChars(cacheDir, NULL));
+
+    bool ok = arwSetCameraParametersLookupTable(type, cacheDirC);
+
+    if (cacheDirC) env->ReleaseStringUTFChars(cacheDir, cacheDirC);
+
+    return ok;
+}
+
 JNIEXPORT jboolean JNICALL JNIFUNCTION(arwStartRunning(JNIEnv *env, jobject obj, jstring vconf, jstring cparaName))
 {
     const char *vconfC = (env->IsSameObject(vconf, NULL) ? NULL : env->GetStringUTFChars(vconf, NULL));
@@ -1441,6 +1507,18 @@ JNIEXPORT jfloat JNICALL JNIFUNCTION(arwGetTrackerOptionFloat(JNIEnv *env, jobje
     return arwGetTrackerOptionFloat(option);
 }
 
+JNIEXPORT jboolean JNICALL JNIFUNCTION(arwLoadMatrixCodeDictionary(JNIEnv *env, jobject obj, jstring path))
+{
+    bool ok;
+
+    if (path == NULL) return false;
+    const char *pathC = env->GetStringUTFChars(path, NULL);
+    ok = arwLoadMatrixCodeDictionary(pathC);
+    env->ReleaseStringUTFChars(path, pathC);
+
+    return ok;
+}
+
 JNIEXPORT void JNICALL JNIFUNCTION(arwSetTrackableOptionBool(JNIEnv *env, jobject obj, jint trackableUID, jint option, jboolean value))
 {
     return arwSetTrackableOptionBool(trackableUID, option, value);
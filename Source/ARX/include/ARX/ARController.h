@@ -104,6 +104,8 @@ private:
     AR2VideoTimestampT m_updateFrameStamp0;
     AR2VideoTimestampT m_updateFrameStamp1;
     ARVideoView *m_arVideoViews[2];
+    int m_cparamLTType;
+    std::string m_cparamLTCacheDir;
 
     std::shared_ptr<ARTrackerSquare> m_squareTracker;
 #if HAVE_NFT
@@ -161,6 +163,14 @@ public:
 	 */
 	bool isInited();
 
+	/**
+	 * Set the type of camera parameter lookup table built by subsequent calls to startRunning() and startRunningStereo().
+	 * @param type			AR_PARAM_LT_TYPE_FLOAT (the default) or AR_PARAM_LT_TYPE_COMPACT.
+	 * @param cacheDir		NULL (the default) to build the tables each time, or the path to an existing, writable directory in which to cache them between runs.
+	 * @return				true if the type was valid, otherwise false.
+	 */
+	bool setCameraParametersLookupTable(int type, const char* cacheDir);
+
 	/**
 	 * Start video capture and tracking. (AR/NFT initialisation will begin on a subsequent call to update().)
 	 * @param vconf			Video configuration string.
@@ -72,6 +72,11 @@ public:
     void setNFTMultiMode(bool on);
     bool NFTMultiMode() const;
     
+    /// If true, each feature is searched for within a window sized to how accurately its position has
+    /// recently been predicted (see ar2SetSearchSizeMode()), rather than always within the full search size.
+    void setNFTAdaptiveSearch(bool on);
+    bool NFTAdaptiveSearch() const;
+    
     bool start(ARParamLT *paramLT, AR_PIXEL_FORMAT pixelFormat) override;
     bool start(ARParamLT *paramLT0, AR_PIXEL_FORMAT pixelFormat0, ARParamLT *paramLT1, AR_PIXEL_FORMAT pixelFormat1, const ARdouble transL2R[3][4]) override;
     bool isRunning() override;
@@ -89,17 +94,35 @@ public:
     void deleteAllTrackables() override;
 
 private:
+    struct PageWorker {
+        ARTrackerNFT *tracker;
+        int index;                      ///< This worker tracks batch entries index, index + worker count, ...
+        THREAD_HANDLE_T *threadHandle;  ///< NULL for worker 0.
+    };
+    bool pageHandlesInit();
+    void pageHandlesFinal();
+    void trackPages(ARUint8 *image);
+    void trackPagesWorker(PageWorker *worker);
+    static void *pageWorker(THREAD_HANDLE_T *threadHandle);
+
     std::vector<std::shared_ptr<ARTrackable>> m_trackables;
     bool m_videoSourceIsStereo;
     bool m_nftMultiMode;
+    bool m_nftAdaptiveSearch;
     bool m_kpmRequired;
     bool m_kpmBusy;
     // NFT data.
     THREAD_HANDLE_T     *trackingThreadHandle;
-    AR2HandleT          *m_ar2Handle;
+    AR2HandleT          *m_ar2Handle;      // Holds the tracking settings, which are copied to the per-page handles.
+    AR2HandleT          *m_pageAR2Handle[PAGES_MAX]; // Tracking state of each loaded page, so that pages can be tracked concurrently.
     KpmHandle           *m_kpmHandle;
     AR2SurfaceSetT      *m_surfaceSet[PAGES_MAX]; // Weak-reference. Strong reference is now in ARTrackableNFT class.
     ARdouble m_transL2R[3][4];          ///< For stereo tracking, transformation matrix from left camera to right camera.
+    std::vector<PageWorker> m_pageWorkers; ///< Empty unless pages are tracked in parallel.
+    std::vector<int> m_pageBatch;       ///< Pages being tracked in this frame, in trackable order.
+    ARUint8 *m_pageBatchImage;
+    int m_pageBatchResult[PAGES_MAX];   ///< ar2Tracking() result for each entry of m_pageBatch.
+    float m_pageBatchTrans[PAGES_MAX][3][4];
 
     bool unloadNFTData();
     bool loadNFTData();
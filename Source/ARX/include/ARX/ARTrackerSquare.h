@@ -46,6 +46,7 @@
 #include <ARX/ARTrackableMultiSquare.h>
 #include <ARX/ARTrackerVideo.h>
 #include <ARX/AR/ar.h>
+#include <ARX/ARUtil/thread_sub.h>
 
 class ARTrackerSquare : public ARTrackerVideo {
 public:
@@ -129,6 +130,136 @@ public:
      */
     int labelingMode() const;
     
+    /**
+     * Sets the number of threads used for labeling.
+     * @param threadCount     Number of threads. 1 for serial labeling (the default), greater than 1
+     *                        to label the image in horizontal bands in parallel, or
+     *                        AR_LABELING_THREAD_COUNT_AUTO for one thread per online CPU.
+     * @see                    labelingThreadCount()
+     */
+    void setLabelingThreadCount(int threadCount);
+    
+    /**
+     * Returns the number of threads used for labeling.
+     * @return                The number of labeling threads in use, with AR_LABELING_THREAD_COUNT_AUTO
+     *                        resolved to a count. Before the tracker is started, the number requested.
+     * @see                    setLabelingThreadCount()
+     */
+    int labelingThreadCount() const;
+    
+    /**
+     * Sets the number of threads used to decode marker candidates.
+     * @param threadCount     Number of threads. 1 for serial decoding (the default), greater than 1
+     *                        to match or decode candidate squares in parallel, or
+     *                        AR_MARKER_INFO_THREAD_COUNT_AUTO for one thread per online CPU.
+     * @see                    markerInfoThreadCount()
+     */
+    void setMarkerInfoThreadCount(int threadCount);
+    
+    /**
+     * Returns the number of threads used to decode marker candidates.
+     * @return                The number of decoding threads in use, with AR_MARKER_INFO_THREAD_COUNT_AUTO
+     *                        resolved to a count. Before the tracker is started, the number requested.
+     * @see                    setMarkerInfoThreadCount()
+     */
+    int markerInfoThreadCount() const;
+    
+    /**
+     * Enables or disables region-of-interest tracking.
+     * When enabled, frames following one in which markers were identified are searched only in
+     * windows around those markers, with a full-frame scan at least every
+     * AR_ROI_TRACKING_FULL_SCAN_INTERVAL_DEFAULT + 1 frames and whenever a marker is lost.
+     * @param on              true to enable, false to disable (the default).
+     * @see                    ROITracking()
+     * @see                    arSetROITrackingMode()
+     */
+    void setROITracking(bool on);
+    
+    /**
+     * Returns whether region-of-interest tracking is enabled.
+     * @return                true when region-of-interest tracking is enabled.
+     * @see                    setROITracking()
+     */
+    bool ROITracking() const;
+    
+    /**
+     * Sets how the passes of auto-threshold bracketing are run, when the threshold mode is
+     * AR_LABELING_THRESH_MODE_AUTO_BRACKETING.
+     * @param mode            AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL (the default),
+     *                        AR_LABELING_THRESH_AUTO_BRACKETING_THREADED, or
+     *                        AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS.
+     * @see                    thresholdAutoBracketingMode()
+     * @see                    arSetLabelingThreshAutoBracketingMode()
+     */
+    void setThresholdAutoBracketingMode(int mode);
+    
+    /**
+     * Returns how the passes of auto-threshold bracketing are run.
+     * @return                The auto-threshold bracketing mode.
+     * @see                    setThresholdAutoBracketingMode()
+     */
+    int thresholdAutoBracketingMode() const;
+    
+    /**
+     * Sets the number of threads used to estimate the poses of single and multi-square trackables.
+     * Trackables are only updated in parallel in frames in which no detected marker could be
+     * claimed by more than one of them, and no auto-creating multi-square trackable is present, so
+     * the results are always those of serial updating. Stereo tracking always updates serially.
+     * @param threadCount     Number of threads. 1 for serial pose estimation (the default), greater than 1
+     *                        to estimate poses in parallel, or AR_POSE_THREAD_COUNT_AUTO for one thread
+     *                        per online CPU.
+     * @see                    poseThreadCount()
+     */
+    void setPoseThreadCount(int threadCount);
+    
+    /**
+     * Returns the number of threads used to estimate the poses of trackables.
+     * @return                The number of pose estimation threads in use, with AR_POSE_THREAD_COUNT_AUTO
+     *                        resolved to a count, and 1 if worker threads could not be started. Before
+     *                        the tracker is started, the number requested.
+     * @see                    setPoseThreadCount()
+     */
+    int poseThreadCount() const;
+    
+    /**
+     * Sets whether, in stereo tracking, markers are detected in the two images concurrently.
+     * When on, the second image is processed on a thread of its own while the first is processed
+     * on the calling thread. Both are complete before any trackable is updated, so the results are
+     * the same as detecting serially.
+     * @param threaded        true to detect concurrently, false to detect serially (the default).
+     * @see                    stereoDetectionThreaded()
+     */
+    void setStereoDetectionThreaded(bool threaded);
+    
+    /**
+     * Returns whether, in stereo tracking, markers are detected in the two images concurrently.
+     * @return                true if detection is concurrent.
+     * @see                    setStereoDetectionThreaded()
+     */
+    bool stereoDetectionThreaded() const;
+    
+    /**
+     * Sets whether, in stereo tracking, markers in the second image are only searched for near
+     * the epipolar bands of markers identified in the first image.
+     * When on, the second image is not labeled in full. Instead, for each marker identified in the
+     * first image, the window of the second image in which it must appear is found from the two
+     * cameras' parameters and the stereo transform. The marker's distance is estimated from its
+     * size when a trackable gives its width, narrowing the window. Only those windows are labeled, at the
+     * first image's threshold. A marker found there is rejected if its ID doesn't match the marker
+     * whose window contains it. Markers visible only in the second image are not found. As the
+     * second search depends on the first, setStereoDetectionThreaded() has no effect while this is on.
+     * @param on              true to search epipolar bands only, false to search the whole of both images (the default).
+     * @see                    stereoEpipolarSearch()
+     */
+    void setStereoEpipolarSearch(bool on);
+    
+    /**
+     * Returns whether, in stereo tracking, the second image is only searched near epipolar bands.
+     * @return                true if the search is guided by epipolar bands.
+     * @see                    setStereoEpipolarSearch()
+     */
+    bool stereoEpipolarSearch() const;
+    
     void setPatternDetectionMode(int mode);
     
     int patternDetectionMode() const;
@@ -149,6 +280,33 @@ public:
     
     int patternCountMax() const;
     
+    /**
+     * Loads a dictionary of matrix codewords, replacing any previously loaded.
+     * The dictionary is used when the matrix code type is one of the AR_MATRIX_CODE_*_DICTIONARY
+     * types of the same size as the dictionary's codewords. Trackables then take the index of
+     * their codeword in the dictionary as their barcode ID.
+     * @param path            Path to the dictionary file, e.g. as written by genMatrixCodeDictionary.
+     * @return                true if the dictionary was loaded, false in case of error.
+     * @see                    setMatrixCodeDictionaryMaxErrors()
+     */
+    bool loadMatrixCodeDictionary(const char *path);
+    
+    /**
+     * Sets the maximum number of erroneous cells corrected when looking up a matrix code in the dictionary.
+     * @param maxErrors       The maximum error-correction distance, 0 to accept exact matches only,
+     *                        or -1 to use the dictionary's default of half its minimum Hamming distance, rounded down.
+     * @see                    matrixCodeDictionaryMaxErrors()
+     * @see                    loadMatrixCodeDictionary()
+     */
+    void setMatrixCodeDictionaryMaxErrors(int maxErrors);
+    
+    /**
+     * Returns the maximum number of erroneous cells corrected when looking up a matrix code in the dictionary.
+     * @return                The maximum error-correction distance, or -1 if the default is set and no dictionary is loaded.
+     * @see                    setMatrixCodeDictionaryMaxErrors()
+     */
+    int matrixCodeDictionaryMaxErrors() const;
+    
     void setMatrixModeAutoCreateNewTrackables(bool on) { m_matrixModeAutoCreateNewTrackables = on; }
 
     bool matrixModeAutoCreateNewTrackables() const { return m_matrixModeAutoCreateNewTrackables; }
@@ -182,11 +340,36 @@ public:
     bool updateDebugTextureRGBA32(const int videoSourceIndex, uint32_t* buffer);
     
 private:
+    struct PoseWorker {
+        ARTrackerSquare *tracker;
+        int index;                      ///< This worker updates batch entries index, index + worker count, ...
+        AR3DHandle *ar3DHandle;         ///< Pose estimator state for this worker. Worker 0 (the calling thread) uses m_ar3DHandle.
+        THREAD_HANDLE_T *threadHandle;  ///< NULL for worker 0.
+    };
+    void poseWorkersInit();
+    void poseWorkersFinal();
+    bool trackablesClaimDisjointMarkers(ARMarkerInfo *markerInfo, int markerNum) const;
+    bool updatePoseBatch(ARMarkerInfo *markerInfo, int markerNum);
+    void updatePoseBatchWorker(PoseWorker *worker);
+    static void *poseWorker(THREAD_HANDLE_T *threadHandle);
+    void stereoDetectionWorkerInit();
+    void stereoDetectionWorkerFinal();
+    static void *stereoDetectionWorker(THREAD_HANDLE_T *threadHandle);
+    ARdouble markerWidth(const ARMarkerInfo *markerInfo) const;
+    bool detectMarkersInEpipolarBands(AR2VideoBufferT *buff1);
+
     std::vector<std::shared_ptr<ARTrackable>> m_trackables;
     int m_threshold;
     AR_LABELING_THRESH_MODE m_thresholdMode;
     int m_imageProcMode;
     int m_labelingMode;
+    int m_labelingThreadCount;
+    int m_markerInfoThreadCount;
+    bool m_ROITracking;
+    int m_thresholdAutoBracketingMode;
+    int m_poseThreadCount;
+    bool m_stereoDetectionThreaded;
+    bool m_stereoEpipolarSearch;
     ARdouble m_pattRatio;
     int m_patternDetectionMode;
     AR_MATRIX_CODE_TYPE m_matrixCodeType;
@@ -200,9 +383,19 @@ private:
     ARHandle *m_arHandle0;              ///< Structure containing square tracker state.
     ARHandle *m_arHandle1;              ///< For stereo tracking, structure containing square tracker state for second tracker in stereo pair.
     ARPattHandle *m_arPattHandle;       ///< Structure containing information about trained patterns.
+    ARMatrixCodeDictionary *m_matrixCodeDictionary; ///< Attached to m_arPattHandle, or NULL if none loaded.
+    int m_matrixCodeDictionaryMaxErrors; ///< -1 to use the dictionary's default.
     AR3DHandle *m_ar3DHandle;           ///< Structure used to compute 3D poses from tracking data.
     ARdouble m_transL2R[3][4];          ///< For stereo tracking, transformation matrix from left camera to right camera.
     AR3DStereoHandle *m_ar3DStereoHandle; ///< For stereo tracking, additional tracker state.
+    std::vector<PoseWorker> m_poseWorkers; ///< Empty unless poses are estimated in parallel.
+    std::vector<ARTrackable *> m_poseBatch; ///< Trackables being updated by the pose workers, in update order.
+    std::vector<char> m_poseBatchSuccess; ///< Result of updating each entry of m_poseBatch.
+    ARMarkerInfo *m_poseBatchMarkerInfo;
+    int m_poseBatchMarkerNum;
+    THREAD_HANDLE_T *m_stereoDetectionThread; ///< Detects markers in the second image of a stereo pair, when m_stereoDetectionThreaded.
+    AR2VideoBufferT *m_stereoDetectionBuff1;
+    int m_stereoDetectionResult1;      ///< Result of arDetectMarker() on m_arHandle1.
 };
 
 #endif // !ARTRACKERSQUARE_H
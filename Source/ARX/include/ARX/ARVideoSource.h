@@ -70,6 +70,8 @@ private:
     char* cameraParamBuffer;
     size_t cameraParamBufferLen;
     ARParamLT *cparamLT;                ///< Camera paramaters
+    int m_cparamLTType;                 ///< Type of lookup table built for cparamLT.
+    char* m_cparamLTCacheDir;           ///< Directory caching lookup tables, or NULL.
     ARParam cparamAdjusted;             ///< Adjusted camera parameters (no lookup table).
 
     char* videoConfiguration;           ///< Video configuration string
@@ -125,6 +127,14 @@ public:
      */
     void configure(const char* vconf, bool noCpara, const char* cparaName, const char* cparaBuff, size_t cparaBuffLen);
 
+    /**
+        @brief Sets the type of camera parameter lookup table which will be built when the video source is opened.
+        @param type AR_PARAM_LT_TYPE_FLOAT (the default) or AR_PARAM_LT_TYPE_COMPACT.
+        @param cacheDir Either NULL (the default), to build the table each time, or a C-string containing the path to an existing, writable directory in which to cache tables between runs.
+        @see arParamLTCreate2
+     */
+    void setCameraParametersLookupTable(int type, const char* cacheDir);
+
     /**
         @brief Returns the camera parameters for the video source.
         @return  The camera parameters, if some are available, or NULL if no parameters are available.
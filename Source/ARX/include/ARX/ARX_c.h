@@ -112,6 +112,16 @@ extern "C" {
 	 */
 	ARX_EXTERN bool arwChangeToResourcesDir(const char *resourcesDirectoryPath);
 
+	/**
+	 * Sets the type of camera parameter lookup table built when video capture is started by arwStartRunning
+	 * or its variants. Compact tables are much smaller and faster to build than the default floating point tables.
+	 * @param type		0 (AR_PARAM_LT_TYPE_FLOAT, the default) or 1 (AR_PARAM_LT_TYPE_COMPACT).
+	 * @param cacheDir	NULL (the default) to build the tables each time video capture starts, or the path to
+	 *					an existing, writable directory in which to cache them between runs.
+	 * @return			true if successful, false if an error occurred
+	 */
+	ARX_EXTERN bool arwSetCameraParametersLookupTable(int type, const char *cacheDir);
+
 	/**
 	 * Initialises and starts video capture.
 	 * @param vconf		The video configuration string
@@ -425,12 +435,21 @@ extern "C" {
         ARW_TRACKER_OPTION_SQUARE_IMAGE_PROC_MODE = 7,                 ///< int.
         ARW_TRACKER_OPTION_SQUARE_DEBUG_MODE = 8,                      ///< Enables or disable state of debug mode in the tracker. When enabled, a black and white debug image is generated during marker detection. The debug image is useful for visualising the binarization process and choosing a threshold value. bool.
         ARW_TRACKER_OPTION_SQUARE_PATTERN_SIZE = 9,                    ///< Number of rows and columns in square template (pattern) markers. Defaults to AR_PATT_SIZE1, which is 16 in all versions of ARToolKit prior to 5.3. int.
-        ARW_TRACKER_OPTION_SQUARE_PATTERN_COUNT_MAX = 10,              ///< Maximum number of square template (pattern) markers that may be loaded at once. Defaults to AR_PATT_NUM_MAX, which is at least 25 in all versions of ARToolKit prior to 5.3. int.
+        ARW_TRACKER_OPTION_SQUARE_PATTERN_COUNT_MAX = 10,              ///< Maximum number of square template (pattern) markers that may be loaded at once. Defaults to AR_PATT_NUM_MAX, which is at least 25 in all versions of ARToolKit prior to 5.3. Larger values are permitted; storage is allocated as patterns are loaded. int.
         ARW_TRACKER_OPTION_2D_TRACKER_FEATURE_TYPE = 11,               ///< Feature detector type used in the 2d Tracker - 0 AKAZE, 1 ORB, 2 BRISK, 3 KAZE, 4 SIFT.
         ARW_TRACKER_OPTION_2D_MAXIMUM_MARKERS_TO_TRACK = 12,           ///< Maximum number of markers able to be tracked simultaneously. Defaults to 1. Should not be set higher than the number of 2D markers loaded.
         ARW_TRACKER_OPTION_SQUARE_MATRIX_MODE_AUTOCREATE_NEW_TRACKABLES = 13, ///< If true, when the square tracker is detecting matrix (barcode) markers, new trackables will be created for unmatched markers. Defaults to false. bool.
         ARW_TRACKER_OPTION_SQUARE_MATRIX_MODE_AUTOCREATE_NEW_TRACKABLES_DEFAULT_WIDTH = 14, ///< If ARW_TRACKER_OPTION_SQUARE_MATRIX_MODE_AUTOCREATE_NEW_TRACKABLES is true, this value will be used for the initial width of new trackables for unmatched markers. Defaults to 80.0f. float.
         ARW_TRACKER_OPTION_2D_THREADED = 15,                           ///< bool, If false, 2D tracking updates synchronously, and arwUpdateAR will not return until 2D tracking is complete. If true, 2D tracking updates asychronously on a secondary thread, and arwUpdateAR will not block if the track is busy. Defaults to true.
+        ARW_TRACKER_OPTION_SQUARE_LABELING_THREAD_COUNT = 16,          ///< Number of threads used by the square tracker to label the image in horizontal bands. 1 (the default) labels serially, -1 uses one thread per CPU. int.
+        ARW_TRACKER_OPTION_SQUARE_MARKER_INFO_THREAD_COUNT = 17,       ///< Number of threads used by the square tracker to match or decode candidate markers. 1 (the default) decodes serially, -1 uses one thread per CPU. int.
+        ARW_TRACKER_OPTION_SQUARE_ROI_TRACKING = 18,                   ///< Search only windows around markers found in the previous frame, scanning the full frame periodically and when a marker is lost. Defaults to false. bool.
+        ARW_TRACKER_OPTION_SQUARE_THRESHOLD_AUTO_BRACKETING_MODE = 19, ///< When the threshold mode is AR_LABELING_THRESH_MODE_AUTO_BRACKETING, how the three bracketing passes are run: serially (AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL, the default), concurrently (AR_LABELING_THRESH_AUTO_BRACKETING_THREADED), or concurrently after labeling at all three thresholds in one pass (AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS). int.
+        ARW_TRACKER_OPTION_SQUARE_POSE_THREAD_COUNT = 20,              ///< Number of threads used by the square tracker to estimate the poses of single and multi-square trackables. 1 (the default) estimates serially, -1 uses one thread per CPU. int.
+        ARW_TRACKER_OPTION_SQUARE_STEREO_DETECTION_THREADED = 21,      ///< In stereo tracking, detect markers in the two images concurrently. Defaults to false. bool.
+        ARW_TRACKER_OPTION_SQUARE_STEREO_EPIPOLAR_SEARCH = 22,         ///< In stereo tracking, search the second image only in the epipolar bands of markers identified in the first. Defaults to false. bool.
+        ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_DICTIONARY_MAX_ERRORS = 23, ///< Maximum number of erroneous cells corrected when looking up matrix codes in the dictionary loaded by arwLoadMatrixCodeDictionary. -1 (the default) corrects up to half the dictionary's minimum Hamming distance, rounded down. int.
+        ARW_TRACKER_OPTION_NFT_ADAPTIVE_SEARCH = 24,                   ///< Search for each NFT feature only as far from its predicted position as recent predictions have been wrong, widened for fast-moving features, instead of always within the full search size. Cuts the matching work when the camera is nearly still. Defaults to false. bool.
     };
 
     /**
@@ -475,6 +494,16 @@ extern "C" {
      */
     ARX_EXTERN float arwGetTrackerOptionFloat(int option);
 
+    /**
+     * Loads a dictionary of matrix codewords for the square tracker.
+     * The dictionary is used when ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_TYPE is one of the
+     * AR_MATRIX_CODE_*_DICTIONARY types of the same size. Barcode IDs of "single_barcode"
+     * trackables are then indices of codewords in the dictionary.
+     * @param path Path to the dictionary file, as written by the genMatrixCodeDictionary utility.
+     * @return true if the dictionary was loaded, false if an error occurred.
+     */
+    ARX_EXTERN bool arwLoadMatrixCodeDictionary(const char *path);
+
     // ----------------------------------------------------------------------------------------------------
 #pragma mark  Trackable management
     // ----------------------------------------------------------------------------------------------------
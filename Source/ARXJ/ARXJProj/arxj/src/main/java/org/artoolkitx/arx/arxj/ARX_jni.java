@@ -129,6 +129,16 @@ public class ARX_jni {
      */
     public static native boolean arwChangeToResourcesDir(String resourcesDirectoryPath);
 
+    /**
+     * Sets the type of camera parameter lookup table built when video capture is started.
+     * Compact tables are much smaller and faster to build than the default floating point tables.
+     * @param type			0 (floating point, the default) or 1 (compact).
+     * @param cacheDir		null (the default) to build the tables each time video capture starts,
+     *						or the path to an existing, writable directory in which to cache them between runs.
+     * @return				true on success, false if an error occurred.
+     */
+    public static native boolean arwSetCameraParametersLookupTable(int type, String cacheDir);
+
     /**
      * Initialises video capture. The native library will start to expect video
      * frames.
@@ -451,12 +461,21 @@ public class ARX_jni {
 							ARW_TRACKER_OPTION_SQUARE_IMAGE_PROC_MODE = 7,                 ///< int.
 							ARW_TRACKER_OPTION_SQUARE_DEBUG_MODE = 8,                      ///< Enables or disable state of debug mode in the tracker. When enabled, a black and white debug image is generated during marker detection. The debug image is useful for visualising the binarization process and choosing a threshold value. bool.
 							ARW_TRACKER_OPTION_SQUARE_PATTERN_SIZE = 9,                    ///< Number of rows and columns in square template (pattern) markers. Defaults to AR_PATT_SIZE1, which is 16 in all versions of ARToolKit prior to 5.3. int.
-							ARW_TRACKER_OPTION_SQUARE_PATTERN_COUNT_MAX = 10,              ///< Maximum number of square template (pattern) markers that may be loaded at once. Defaults to AR_PATT_NUM_MAX, which is at least 25 in all versions of ARToolKit prior to 5.3. int.
+							ARW_TRACKER_OPTION_SQUARE_PATTERN_COUNT_MAX = 10,              ///< Maximum number of square template (pattern) markers that may be loaded at once. Defaults to AR_PATT_NUM_MAX, which is at least 25 in all versions of ARToolKit prior to 5.3. Larger values are permitted; storage is allocated as patterns are loaded. int.
 							ARW_TRACKER_OPTION_2D_TRACKER_FEATURE_TYPE = 11,               ///< Feature detector type used in the 2d Tracker - 0 AKAZE, 1 ORB, 2 BRISK, 3 KAZE, 4 SIFT.
 							ARW_TRACKER_OPTION_2D_MAXIMUM_MARKERS_TO_TRACK = 12,           ///< Maximum number of markers able to be tracked simultaneously. Defaults to 1. Should not be set higher than the number of 2D markers loaded.
 							ARW_TRACKER_OPTION_SQUARE_MATRIX_MODE_AUTOCREATE_NEW_TRACKABLES = 13, ///< If true, when the square tracker is detecting matrix (barcode) markers, new trackables will be created for unmatched markers. Defaults to false. bool.
 							ARW_TRACKER_OPTION_SQUARE_MATRIX_MODE_AUTOCREATE_NEW_TRACKABLES_DEFAULT_WIDTH = 14, ///< If ARW_TRACKER_OPTION_SQUARE_MATRIX_MODE_AUTOCREATE_NEW_TRACKABLES is true, this value will be used for the initial width of new trackables for unmatched markers. Defaults to 80.0f. float.
-							ARW_TRACKER_OPTION_2D_THREADED = 15;                           ///< bool, If false, 2D tracking updates synchronously, and arwUpdateAR will not return until 2D tracking is complete. If true, 2D tracking updates asychronously on a secondary thread, and arwUpdateAR will not block if the track is busy. Defaults to true.
+							ARW_TRACKER_OPTION_2D_THREADED = 15,                           ///< bool, If false, 2D tracking updates synchronously, and arwUpdateAR will not return until 2D tracking is complete. If true, 2D tracking updates asychronously on a secondary thread, and arwUpdateAR will not block if the track is busy. Defaults to true.
+							ARW_TRACKER_OPTION_SQUARE_LABELING_THREAD_COUNT = 16,          ///< Number of threads used by the square tracker to label the image in horizontal bands. 1 (the default) labels serially, -1 uses one thread per CPU. int.
+							ARW_TRACKER_OPTION_SQUARE_MARKER_INFO_THREAD_COUNT = 17,       ///< Number of threads used by the square tracker to match or decode candidate markers. 1 (the default) decodes serially, -1 uses one thread per CPU. int.
+							ARW_TRACKER_OPTION_SQUARE_ROI_TRACKING = 18,                   ///< Search only windows around markers found in the previous frame, scanning the full frame periodically and when a marker is lost. Defaults to false. bool.
+							ARW_TRACKER_OPTION_SQUARE_THRESHOLD_AUTO_BRACKETING_MODE = 19, ///< When the threshold mode is AR_LABELING_THRESH_MODE_AUTO_BRACKETING, how the three bracketing passes are run. int.
+							ARW_TRACKER_OPTION_SQUARE_POSE_THREAD_COUNT = 20,              ///< Number of threads used by the square tracker to estimate trackable poses. 1 (the default) estimates serially, -1 uses one thread per CPU. int.
+							ARW_TRACKER_OPTION_SQUARE_STEREO_DETECTION_THREADED = 21,      ///< In stereo tracking, detect markers in the two images concurrently. Defaults to false. bool.
+							ARW_TRACKER_OPTION_SQUARE_STEREO_EPIPOLAR_SEARCH = 22,         ///< In stereo tracking, search the second image only in the epipolar bands of markers identified in the first. Defaults to false. bool.
+							ARW_TRACKER_OPTION_SQUARE_MATRIX_CODE_DICTIONARY_MAX_ERRORS = 23, ///< Maximum number of erroneous cells corrected when looking up matrix codes in the dictionary loaded by arwLoadMatrixCodeDictionary. -1 (the default) corrects up to half the dictionary's minimum Hamming distance, rounded down. int.
+							ARW_TRACKER_OPTION_NFT_ADAPTIVE_SEARCH = 24;                   ///< Search for each NFT feature only as far from its predicted position as recent predictions have been wrong, widened for fast-moving features, instead of always within the full search size. Cuts the matching work when the camera is nearly still. Defaults to false. bool.
 
     // ARW_TRACKER_OPTION_SQUARE_THRESHOLD_MODE
     public static final int AR_LABELING_THRESH_MODE_MANUAL = 0,
@@ -465,6 +484,11 @@ public class ARX_jni {
     	    				AR_LABELING_THRESH_MODE_AUTO_ADAPTIVE = 3,
 							AR_LABELING_THRESH_MODE_AUTO_BRACKETING = 4;
 
+    // ARW_TRACKER_OPTION_SQUARE_THRESHOLD_AUTO_BRACKETING_MODE
+    public static final int AR_LABELING_THRESH_AUTO_BRACKETING_SERIAL = 0,
+    						AR_LABELING_THRESH_AUTO_BRACKETING_THREADED = 1,
+    						AR_LABELING_THRESH_AUTO_BRACKETING_SINGLE_PASS = 2;
+
     // ARW_TRACKER_OPTION_SQUARE_LABELING_MODE
 	public static final int AR_LABELING_WHITE_REGION = 0,
     						AR_LABELING_BLACK_REGION = 1;
@@ -487,10 +511,16 @@ public class ARX_jni {
     						AR_MATRIX_CODE_5x5_BCH_22_7_7 = 0x505,                                      // Matrix code in range 0-127.
     						AR_MATRIX_CODE_5x5 = 0x05,                                                  // Matrix code in range 0-4194303.
     						AR_MATRIX_CODE_6x6 = 0x06,                                                  // Matrix code in range 0-8589934591.
-    						AR_MATRIX_CODE_GLOBAL_ID = 0xb0e;
+    						AR_MATRIX_CODE_GLOBAL_ID = 0xb0e,
+    						AR_MATRIX_CODE_4x4_DICTIONARY = 0xf04,                                      // Matrix code in range 0 to (number of codewords in the loaded dictionary - 1).
+    						AR_MATRIX_CODE_5x5_DICTIONARY = 0xf05,                                      // Matrix code in range 0 to (number of codewords in the loaded dictionary - 1).
+    						AR_MATRIX_CODE_6x6_DICTIONARY = 0xf06,                                      // Matrix code in range 0 to (number of codewords in the loaded dictionary - 1).
+    						AR_MATRIX_CODE_7x7_DICTIONARY = 0xf07;                                      // Matrix code in range 0 to (number of codewords in the loaded dictionary - 1).
 
 	public static final int AR_IMAGE_PROC_FRAME_IMAGE = 0,
-    						AR_IMAGE_PROC_FIELD_IMAGE = 1;
+    						AR_IMAGE_PROC_FIELD_IMAGE = 1,
+    						AR_IMAGE_PROC_PYRAMID_2X = 2,
+    						AR_IMAGE_PROC_PYRAMID_4X = 3;
 
 	/**
 	 * Set boolean options associated with a tracker.
@@ -534,6 +564,14 @@ public class ARX_jni {
 	 */
 	public static native float arwGetTrackerOptionFloat(int option);
 
+	/**
+	 * Loads a dictionary of matrix codewords for the square tracker, used when the matrix code type
+	 * is one of the AR_MATRIX_CODE_*_DICTIONARY types of the same size.
+	 * @param path Path to the dictionary file, as written by the genMatrixCodeDictionary utility.
+	 * @return true if the dictionary was loaded, false if an error occurred.
+	 */
+	public static native boolean arwLoadMatrixCodeDictionary(String path);
+
     public static final int ARW_TRACKABLE_OPTION_TYPE = 0,                             ///< readonly int enum, trackable type as per ARW_TRACKABLE_TYPE_* enum .
 							ARW_TRACKABLE_OPTION_FILTERED = 1,                         ///< bool, true for filtering enabled.
 							ARW_TRACKABLE_OPTION_FILTER_SAMPLE_RATE = 2,               ///< float, sample rate for filter calculations.
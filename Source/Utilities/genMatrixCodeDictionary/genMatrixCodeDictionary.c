@@ -0,0 +1,196 @@
+/*
+ *  genMatrixCodeDictionary.c
+ *  artoolkitX
+ *
+ *  Generates dictionaries of matrix codewords with large inter-codeword Hamming distance.
+ *
+ *  Run with "--help" parameter to see usage.
+ *
+ *  This file is part of artoolkitX.
+ *
+ *  artoolkitX is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  artoolkitX is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with artoolkitX.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2023 Philip Lamb
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ARX/AR/ar.h>
+
+enum {
+    E_NO_ERROR = 0,
+    E_BAD_PARAMETER = 64,
+    E_DATA_PROCESSING_ERROR = 70,
+    E_GENERIC_ERROR = 255
+};
+
+static int      size = 6;
+static int      codeNum = 50;
+static int      minDistance = 0;      // 0 = as large as can be found.
+static int      attempts = 100000;    // Consecutive rejected candidates before the distance is relaxed.
+static uint64_t seed = 0;
+static char    *outputFilePath = NULL;
+
+static uint64_t rngState;
+
+static void     usage(char *com);
+static uint64_t rng(void);
+static int      distance(uint64_t a, uint64_t b);
+
+int main(int argc, char *argv[])
+{
+    uint64_t *codes;
+    uint64_t  mask, c;
+    int       num, i, k, tau, rejected, ok;
+    ARMatrixCodeDictionary *dict;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-size=", 6) == 0) {
+            if (sscanf(&argv[i][6], "%d", &size) != 1 || size < AR_MATRIX_CODE_DICTIONARY_SIZE_MIN || size > AR_MATRIX_CODE_DICTIONARY_SIZE_MAX) usage(argv[0]);
+        } else if (strncmp(argv[i], "-count=", 7) == 0) {
+            if (sscanf(&argv[i][7], "%d", &codeNum) != 1 || codeNum < 1 || codeNum > AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX) usage(argv[0]);
+        } else if (strncmp(argv[i], "-min_distance=", 14) == 0) {
+            if (sscanf(&argv[i][14], "%d", &minDistance) != 1 || minDistance < 1) usage(argv[0]);
+        } else if (strncmp(argv[i], "-attempts=", 10) == 0) {
+            if (sscanf(&argv[i][10], "%d", &attempts) != 1 || attempts < 1) usage(argv[0]);
+        } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            unsigned long long s;
+            if (sscanf(&argv[i][6], "%llu", &s) != 1) usage(argv[0]);
+            seed = (uint64_t)s;
+        } else if (strncmp(argv[i], "-loglevel=", 10) == 0) {
+            if (strcmp(&(argv[i][10]), "DEBUG") == 0) arLogLevel = AR_LOG_LEVEL_DEBUG;
+            else if (strcmp(&(argv[i][10]), "INFO") == 0) arLogLevel = AR_LOG_LEVEL_INFO;
+            else if (strcmp(&(argv[i][10]), "WARN") == 0) arLogLevel = AR_LOG_LEVEL_WARN;
+            else if (strcmp(&(argv[i][10]), "ERROR") == 0) arLogLevel = AR_LOG_LEVEL_ERROR;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-version") == 0 || strcmp(argv[i], "-v") == 0) {
+            ARPRINT("%s version %s\n", argv[0], AR_HEADER_VERSION_STRING);
+            exit(E_NO_ERROR);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-help") == 0 || strcmp(argv[i], "-h") == 0 || argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            if (!outputFilePath) outputFilePath = argv[i];
+            else usage(argv[0]);
+        }
+    }
+    if (!outputFilePath) usage(argv[0]);
+
+    rngState = (seed ? seed : (uint64_t)time(NULL)) ^ 0x9e3779b97f4a7c15ull;
+    if (!rngState) rngState = 1;
+    mask = (1ull << (size*size)) - 1;
+
+    // Greedy search. A random candidate is accepted if it is at least tau cells from
+    // every rotation of itself and of every codeword already accepted. If too many
+    // candidates in a row are rejected, tau is relaxed, unless fixed by -min_distance.
+    arMalloc(codes, uint64_t, codeNum);
+    num = 0;
+    tau = (minDistance ? minDistance : size*size/2);
+    rejected = 0;
+    while (num < codeNum) {
+        c = rng() & mask;
+        ok = 1;
+        for (k = 1; k < 4 && ok; k++) if (distance(c, arMatrixCodeRotate(c, size, k)) < tau) ok = 0;
+        for (i = 0; i < num && ok; i++) {
+            for (k = 0; k < 4 && ok; k++) if (distance(c, arMatrixCodeRotate(codes[i], size, k)) < tau) ok = 0;
+        }
+        if (ok) {
+            codes[num++] = c;
+            rejected = 0;
+            ARLOGd("Codeword %d accepted at distance %d.\n", num - 1, tau);
+        } else if (++rejected >= attempts) {
+            if (minDistance || tau == 1) {
+                ARPRINTE("Error: found only %d codewords of size %dx%d at minimum distance %d.\n", num, size, size, tau);
+                free(codes);
+                exit(E_DATA_PROCESSING_ERROR);
+            }
+            tau--;
+            rejected = 0;
+            ARLOGi("Relaxing minimum distance to %d after %d codewords.\n", tau, num);
+        }
+    }
+
+    dict = arMatrixCodeDictionaryCreate(size, codes, codeNum);
+    free(codes);
+    if (!dict) {
+        ARPRINTE("Error creating dictionary.\n");
+        exit(E_GENERIC_ERROR);
+    }
+    if (arMatrixCodeDictionarySave(dict, outputFilePath) < 0) {
+        ARPRINTE("Error saving dictionary to '%s'.\n", outputFilePath);
+        arMatrixCodeDictionaryDelete(&dict);
+        exit(E_GENERIC_ERROR);
+    }
+    ARPRINT("Wrote %d %dx%d codewords to '%s'. Minimum Hamming distance %d, corrects up to %d errors.\n",
+            codeNum, size, size, outputFilePath, arMatrixCodeDictionaryGetMinDistance(dict), arMatrixCodeDictionaryGetMaxErrors(dict));
+    ARPRINT("Use with matrix code type AR_MATRIX_CODE_%dx%d_DICTIONARY.\n", size, size);
+    arMatrixCodeDictionaryDelete(&dict);
+
+    return (E_NO_ERROR);
+}
+
+static void usage(char *com)
+{
+    ARPRINT("Usage: %s [options] <filename>\n\n", com);
+    ARPRINT("Where <filename> is path to the dictionary file to write.\n\n");
+    ARPRINT("Options:\n");
+    ARPRINT("  -size=n: Number of rows and columns in the codewords, in range [%d, %d]. Default %d.\n", AR_MATRIX_CODE_DICTIONARY_SIZE_MIN, AR_MATRIX_CODE_DICTIONARY_SIZE_MAX, size);
+    ARPRINT("  -count=n: Number of codewords to generate, at most %d. Default %d.\n", AR_MATRIX_CODE_DICTIONARY_CODE_NUM_MAX, codeNum);
+    ARPRINT("  -min_distance=n: Require a minimum Hamming distance of n between all rotations\n");
+    ARPRINT("             of all codewords, and fail if count codewords can't be found.\n");
+    ARPRINT("             By default the distance starts at size*size/2 and is relaxed\n");
+    ARPRINT("             as needed.\n");
+    ARPRINT("  -attempts=n: Number of consecutive rejected candidates before relaxing the\n");
+    ARPRINT("             minimum distance, or failing. Default %d.\n", attempts);
+    ARPRINT("  -seed=n: Seed for the random number generator. Default is the current time.\n");
+    ARPRINT("  --version: Print artoolkitX version and exit.\n");
+    ARPRINT("  -loglevel=l: Set the log level to l, where l is one of DEBUG INFO WARN ERROR.\n");
+    ARPRINT("  -h -help --help: show this message\n");
+    exit(E_BAD_PARAMETER);
+}
+
+// xorshift64*.
+static uint64_t rng(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (rngState * 0x2545f4914f6cdd1dull);
+}
+
+static int distance(uint64_t a, uint64_t b)
+{
+    uint64_t x = a ^ b;
+    int n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return (n);
+}
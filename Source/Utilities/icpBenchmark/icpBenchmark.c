@@ -0,0 +1,165 @@
+/*
+ *  icpBenchmark.c
+ *  artoolkitX
+ *
+ *  Measures the speed of ICP pose estimation (icpPoint and icpPointRobust) for a range of point counts.
+ *
+ *  Run with "--help" parameter to see usage.
+ *
+ *  This file is part of artoolkitX.
+ *
+ *  artoolkitX is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  artoolkitX is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with artoolkitX.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2023 Philip Lamb
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ARX/AR/ar.h>
+#include <ARX/AR/icp.h>
+#include <ARX/ARUtil/time.h>
+
+enum {
+    E_NO_ERROR = 0,
+    E_BAD_PARAMETER = 64,
+    E_GENERIC_ERROR = 255
+};
+
+#define MAX_LOOP 10
+
+static const int pointNums[] = {4, 8, 16, 32, 64, 128, 256, 512, 1000};
+static double    seconds = 0.25;   // Minimum time to run each case for.
+
+static void     usage(char *com);
+static double   frand(void);
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+int main(int argc, char *argv[])
+{
+    ARdouble     matXc2U[3][4] = {{800.0, 0.0, 640.0, 0.0}, {0.0, 800.0, 360.0, 0.0}, {0.0, 0.0, 1.0, 0.0}};
+    ARdouble     pose[3][4] = {{1.0, 0.0, 0.0, 10.0}, {0.0, 1.0, 0.0, -5.0}, {0.0, 0.0, 1.0, 700.0}};
+    ARdouble     initMat[3][4], mat[3][4], err;
+    ICPHandleT  *handle;
+    ICPDataT     data;
+    ICP2DCoordT *screenCoord;
+    ICP3DCoordT *worldCoord;
+    int          robust, calls, num;
+    int          i, j, k, q;
+    double       t;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-seconds=", 9) == 0) {
+            if (sscanf(&argv[i][9], "%lf", &seconds) != 1 || seconds <= 0.0) usage(argv[0]);
+        } else if (strncmp(argv[i], "-loglevel=", 10) == 0) {
+            if (strcmp(&(argv[i][10]), "DEBUG") == 0) arLogLevel = AR_LOG_LEVEL_DEBUG;
+            else if (strcmp(&(argv[i][10]), "INFO") == 0) arLogLevel = AR_LOG_LEVEL_INFO;
+            else if (strcmp(&(argv[i][10]), "WARN") == 0) arLogLevel = AR_LOG_LEVEL_WARN;
+            else if (strcmp(&(argv[i][10]), "ERROR") == 0) arLogLevel = AR_LOG_LEVEL_ERROR;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-version") == 0 || strcmp(argv[i], "-v") == 0) {
+            ARPRINT("%s version %s\n", argv[0], AR_HEADER_VERSION_STRING);
+            exit(E_NO_ERROR);
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (!(handle = icpCreateHandle((const ARdouble (*)[4])matXc2U))) {
+        ARPRINTE("Error creating ICP handle.\n");
+        exit(E_GENERIC_ERROR);
+    }
+    // Run every call for exactly MAX_LOOP iterations, so that rates are comparable between point counts.
+    icpSetMaxLoop(handle, MAX_LOOP);
+    icpSetBreakLoopErrorThresh(handle, 0.0);
+    icpSetBreakLoopErrorThresh2(handle, 0.0);
+
+    ARPRINT("%6s %10s %14s %14s %10s\n", "points", "estimator", "iterations/s", "points/s", "error");
+    for (q = 0; q < (int)(sizeof(pointNums)/sizeof(pointNums[0])); q++) {
+        num = pointNums[q];
+        arMalloc(screenCoord, ICP2DCoordT, num);
+        arMalloc(worldCoord, ICP3DCoordT, num);
+
+        // A plane of points facing the camera, observed with up to 0.5 pixels of noise, and an initial
+        // pose a few millimetres out.
+        for (j = 0; j < num; j++) {
+            worldCoord[j].x = frand()*160.0 - 80.0;
+            worldCoord[j].y = frand()*160.0 - 80.0;
+            worldCoord[j].z = 0.0;
+            screenCoord[j].x = matXc2U[0][0]*(worldCoord[j].x + pose[0][3])/pose[2][3] + matXc2U[0][2] + frand() - 0.5;
+            screenCoord[j].y = matXc2U[1][1]*(worldCoord[j].y + pose[1][3])/pose[2][3] + matXc2U[1][2] + frand() - 0.5;
+        }
+        for (j = 0; j < 3; j++) for (k = 0; k < 4; k++) initMat[j][k] = pose[j][k];
+        initMat[0][3] += 3.0;
+        initMat[2][3] += 15.0;
+        data.screenCoord = screenCoord;
+        data.worldCoord = worldCoord;
+        data.num = num;
+
+        for (robust = 0; robust < 2; robust++) {
+            calls = 0;
+            arUtilTimerReset();
+            do {
+                for (k = 0; k < 16; k++) {
+                    if (robust) icpPointRobust(handle, &data, initMat, mat, &err);
+                    else        icpPoint(handle, &data, initMat, mat, &err);
+                }
+                calls += 16;
+            } while ((t = arUtilTimer()) < seconds);
+            ARPRINT("%6d %10s %14.0f %14.0f %10.4f\n", num, (robust ? "robust" : "plain"), calls*MAX_LOOP/t, (double)calls*MAX_LOOP*num/t, (double)err);
+        }
+        free(screenCoord);
+        free(worldCoord);
+    }
+
+    icpDeleteHandle(&handle);
+    return (E_NO_ERROR);
+}
+
+static void usage(char *com)
+{
+    ARPRINT("Usage: %s [options]\n\n", com);
+    ARPRINT("Reports the rate of ICP pose estimation iterations, for synthetic planar data with\n");
+    ARPRINT("4 to 1000 points.\n\n");
+    ARPRINT("Options:\n");
+    ARPRINT("  -seconds=t: Run each case for at least t seconds. Default %g.\n", seconds);
+    ARPRINT("  --version: Print artoolkitX version and exit.\n");
+    ARPRINT("  -loglevel=l: Set the log level to l, where l is one of DEBUG INFO WARN ERROR.\n");
+    ARPRINT("  -h -help --help: show this message\n");
+    exit(E_BAD_PARAMETER);
+}
+
+// Uniform in [0, 1), from xorshift64*, so that every run uses the same data.
+static double frand(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return ((double)((rngState * 0x2545f4914f6cdd1dull) >> 11) * (1.0/9007199254740992.0));
+}
@@ -0,0 +1,290 @@
+/*
+ *  matchingBenchmark.c
+ *  artoolkitX
+ *
+ *  Checks that NFT template matching (ar2GetBestMatching) gives the same results with and without its
+ *  SIMD kernels, and measures the speed of both.
+ *
+ *  Run with "--help" parameter to see usage.
+ *
+ *  This file is part of artoolkitX.
+ *
+ *  artoolkitX is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  artoolkitX is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with artoolkitX.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2023 Philip Lamb
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ARX/AR/ar.h>
+#include <ARX/AR2/template.h>
+#include <ARX/ARUtil/time.h>
+
+enum {
+    E_NO_ERROR = 0,
+    E_BAD_PARAMETER = 64,
+    E_DATA_PROCESSING_ERROR = 70,
+    E_GENERIC_ERROR = 255
+};
+
+#define IMAGE_XSIZE 640
+#define IMAGE_YSIZE 480
+#define SEARCH_SIZE 24     // Search window half-size, as used by the NFT tracker.
+#define TRIALS      2000   // Number of templates compared for the mono format. The other formats use a tenth as many.
+#define TIMING_TEMPLATE_NUM 256 // Number of different templates matched in the timing.
+
+// The same matching, built with AR2_MATCHING_SIMD 0 (see matchingScalar.c).
+int matchingScalarGetBestMatching( ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
+                                   AR2TemplateT *mtemp, int rx, int ry,
+                                   int search[3][2], int *bx, int *by, float *val);
+int matchingScalarGetBestMatchingWithSubImage( ARUint8 *img, ARUint8 *mfImage, ARUint32 *subImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
+                                   AR2TemplateT *mtemp, int rx, int ry,
+                                   int search[3][2], int *bx, int *by, float *val);
+
+static const struct {
+    AR_PIXEL_FORMAT format;
+    int             bpp;
+    const char     *name;
+} formats[] = {
+    {AR_PIXEL_FORMAT_MONO, 1, "MONO"},
+    {AR_PIXEL_FORMAT_RGB,  3, "RGB"},
+    {AR_PIXEL_FORMAT_RGBA, 4, "RGBA"},
+    {AR_PIXEL_FORMAT_ARGB, 4, "ARGB"},
+    {AR_PIXEL_FORMAT_2vuy, 2, "2vuy"},
+    {AR_PIXEL_FORMAT_yuvs, 2, "yuvs"}
+};
+
+static double    seconds = 1.0;   // Minimum time to run each timing for.
+
+static void     usage(char *com);
+static uint64_t rand64(void);
+static void     setTemplate(AR2TemplateT *templ, const ARUint8 *mono, int cx, int cy, int nullPercent);
+static double   timeMatching(int scalar, ARUint8 *mono, ARUint8 *mfImage, ARUint32 *subImage, AR2TemplateT **templs, int search[][3][2]);
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+int main(int argc, char *argv[])
+{
+    ARUint8      *mono, *image, *mfImage;
+    ARUint32     *subImage;
+    AR2TemplateT *templ, *templs[TIMING_TEMPLATE_NUM];
+    int           search[3][2];
+    static int    timingSearch[TIMING_TEMPLATE_NUM][3][2];
+    int           ts1, ts2, cx, cy, trials;
+    int           ret, bx, by, retScalar, bxScalar, byScalar;
+    float         val, valScalar;
+    int           found, mismatches, mismatchesTotal = 0;
+    double        t, tScalar;
+    int           f, n, i, x, y;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-seconds=", 9) == 0) {
+            if (sscanf(&argv[i][9], "%lf", &seconds) != 1 || seconds <= 0.0) usage(argv[0]);
+        } else if (strncmp(argv[i], "-loglevel=", 10) == 0) {
+            if (strcmp(&(argv[i][10]), "DEBUG") == 0) arLogLevel = AR_LOG_LEVEL_DEBUG;
+            else if (strcmp(&(argv[i][10]), "INFO") == 0) arLogLevel = AR_LOG_LEVEL_INFO;
+            else if (strcmp(&(argv[i][10]), "WARN") == 0) arLogLevel = AR_LOG_LEVEL_WARN;
+            else if (strcmp(&(argv[i][10]), "ERROR") == 0) arLogLevel = AR_LOG_LEVEL_ERROR;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-version") == 0 || strcmp(argv[i], "-v") == 0) {
+            ARPRINT("%s version %s\n", argv[0], AR_HEADER_VERSION_STRING);
+            exit(E_NO_ERROR);
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    // A smooth texture with some noise, so that matching has a clear best position.
+    arMalloc(mono, ARUint8, IMAGE_XSIZE*IMAGE_YSIZE);
+    arMallocClear(mfImage, ARUint8, IMAGE_XSIZE*IMAGE_YSIZE);
+    for (y = 0; y < IMAGE_YSIZE; y++) {
+        for (x = 0; x < IMAGE_XSIZE; x++) {
+            mono[y*IMAGE_XSIZE + x] = (ARUint8)(128 + 60*sin(x*0.07 + y*0.03) + 40*cos(x*0.021 - y*0.11) + (int)(rand64() % 40) - 20);
+        }
+    }
+
+    // Compare positions and similarity values for random templates, including ones near the frame edges and ones
+    // with null pixels, for every pixel format.
+    ARPRINT("%-6s %10s %10s %12s\n", "format", "templates", "found", "mismatches");
+    for (f = 0; f < (int)(sizeof(formats)/sizeof(formats[0])); f++) {
+        arMalloc(image, ARUint8, IMAGE_XSIZE*IMAGE_YSIZE*formats[f].bpp);
+        for (i = 0; i < IMAGE_XSIZE*IMAGE_YSIZE; i++) memset(&image[i*formats[f].bpp], mono[i], formats[f].bpp);
+        trials = (formats[f].format == AR_PIXEL_FORMAT_MONO ? TRIALS : TRIALS/10);
+        found = mismatches = 0;
+        for (n = 0; n < trials; n++) {
+            if (n % 3 == 0) ts1 = ts2 = AR2_DEFAULT_TS1;
+            else {
+                ts1 = 1 + (int)(rand64() % 14);
+                ts2 = 1 + (int)(rand64() % 14);
+            }
+            if (!(templ = ar2GenTemplate(ts1, ts2))) {
+                ARPRINTE("Error creating template.\n");
+                exit(E_GENERIC_ERROR);
+            }
+            if (n % 7 == 0) {
+                cx = (int)(rand64() % 40);
+                cy = (int)(rand64() % 40);
+            } else if (n % 5 == 0) {
+                cx = IMAGE_XSIZE - 1 - (int)(rand64() % 40);
+                cy = IMAGE_YSIZE - 1 - (int)(rand64() % 40);
+            } else {
+                cx = (int)(rand64() % IMAGE_XSIZE);
+                cy = (int)(rand64() % IMAGE_YSIZE);
+            }
+            setTemplate(templ, mono, cx, cy, (n % 4 == 1 ? 20 : 0));
+            for (i = 0; i < 3; i++) {
+                search[i][0] = cx + (int)(rand64() % 21) - 10; if (search[i][0] < 0) search[i][0] = 0;
+                search[i][1] = cy + (int)(rand64() % 21) - 10; if (search[i][1] < 0) search[i][1] = 0;
+            }
+            if (n % 2) search[2][0] = -1;
+
+            bx = by = bxScalar = byScalar = -1;
+            val = valScalar = 0.0f;
+            ret = ar2GetBestMatching(image, mfImage, IMAGE_XSIZE, IMAGE_YSIZE, formats[f].format, templ, SEARCH_SIZE, SEARCH_SIZE, search, &bx, &by, &val);
+            retScalar = matchingScalarGetBestMatching(image, mfImage, IMAGE_XSIZE, IMAGE_YSIZE, formats[f].format, templ, SEARCH_SIZE, SEARCH_SIZE, search, &bxScalar, &byScalar, &valScalar);
+            if (ret == 0) found++;
+            if (ret != retScalar || (ret == 0 && (bx != bxScalar || by != byScalar || memcmp(&val, &valScalar, sizeof(float)) != 0))) {
+                if (mismatches < 5) ARPRINTE("%s template %dx%d at %d,%d: (%d,%d) %f, scalar (%d,%d) %f.\n", formats[f].name, ts1, ts2, cx, cy, bx, by, val, bxScalar, byScalar, valScalar);
+                mismatches++;
+            }
+            ar2FreeTemplate(templ);
+        }
+        ARPRINT("%-6s %10d %9d%% %12d\n", formats[f].name, trials, found*100/trials, mismatches);
+        mismatchesTotal += mismatches;
+        free(image);
+    }
+
+    // Time the default template size on a mono frame, as used by the NFT tracker.
+    for (n = 0; n < TIMING_TEMPLATE_NUM; n++) {
+        if (!(templs[n] = ar2GenTemplate(AR2_DEFAULT_TS1, AR2_DEFAULT_TS2))) {
+            ARPRINTE("Error creating template.\n");
+            exit(E_GENERIC_ERROR);
+        }
+        cx = SEARCH_SIZE*2 + (int)(rand64() % (IMAGE_XSIZE - SEARCH_SIZE*4));
+        cy = SEARCH_SIZE*2 + (int)(rand64() % (IMAGE_YSIZE - SEARCH_SIZE*4));
+        setTemplate(templs[n], mono, cx, cy, 0);
+        timingSearch[n][0][0] = cx + 3; timingSearch[n][0][1] = cy - 2;
+        timingSearch[n][1][0] = cx - 5; timingSearch[n][1][1] = cy + 4;
+        timingSearch[n][2][0] = -1;     timingSearch[n][2][1] = -1;
+    }
+    arMalloc(subImage, ARUint32, ar2GetBestMatchingSubImageSize(templs[0]));
+    t = timeMatching(0, mono, mfImage, subImage, templs, timingSearch);
+    tScalar = timeMatching(1, mono, mfImage, subImage, templs, timingSearch);
+    ARPRINT("\nTemplate %dx%d, MONO: %.2f us per match, scalar %.2f us per match (%.2fx).\n", AR2_DEFAULT_TS1*2 + 1, AR2_DEFAULT_TS2*2 + 1, t*1.0e6, tScalar*1.0e6, tScalar/t);
+    free(subImage);
+    for (n = 0; n < TIMING_TEMPLATE_NUM; n++) ar2FreeTemplate(templs[n]);
+
+    free(mfImage);
+    free(mono);
+
+    if (mismatchesTotal) {
+        ARPRINTE("Matching with and without the SIMD kernels gave different results.\n");
+        return (E_DATA_PROCESSING_ERROR);
+    }
+    return (E_NO_ERROR);
+}
+
+static void usage(char *com)
+{
+    ARPRINT("Usage: %s [options]\n\n", com);
+    ARPRINT("Checks that ar2GetBestMatching gives the same positions and similarity values as the\n");
+    ARPRINT("same matching built without SIMD kernels, for synthetic templates in every pixel format,\n");
+    ARPRINT("and reports the time per match of both.\n\n");
+    ARPRINT("Options:\n");
+    ARPRINT("  -seconds=t: Run each timing for at least t seconds. Default %g.\n", seconds);
+    ARPRINT("  --version: Print artoolkitX version and exit.\n");
+    ARPRINT("  -loglevel=l: Set the log level to l, where l is one of DEBUG INFO WARN ERROR.\n");
+    ARPRINT("  -h -help --help: show this message\n");
+    exit(E_BAD_PARAMETER);
+}
+
+// xorshift64*, so that every run uses the same data.
+static uint64_t rand64(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (rngState * 0x2545f4914f6cdd1dull);
+}
+
+// Samples the template from the mono image around (cx, cy), with a little noise, and with about nullPercent
+// percent of its pixels null, then sets its sums as ar2SetTemplateSub does.
+static void setTemplate(AR2TemplateT *templ, const ARUint8 *mono, int cx, int cy, int nullPercent)
+{
+    int i, j, x, y, v, k = 0, idx = 0, sum = 0, sum2 = 0, vlen;
+
+    for (j = -templ->yts1; j <= templ->yts2; j++) {
+        for (i = -templ->xts1; i <= templ->xts2; i++, idx++) {
+            if (nullPercent && (int)(rand64() % 100) < nullPercent) {
+                templ->img1[idx] = AR2_TEMPLATE_NULL_PIXEL;
+                continue;
+            }
+            x = cx + i*AR2_TEMP_SCALE;
+            y = cy + j*AR2_TEMP_SCALE;
+            v = (x >= 0 && y >= 0 && x < IMAGE_XSIZE && y < IMAGE_YSIZE ? mono[y*IMAGE_XSIZE + x] : 128) + (int)(rand64() % 21) - 10;
+            if (v < 0) v = 0;
+            else if (v > 255) v = 255;
+            templ->img1[idx] = (ARUint16)v;
+            sum += v;
+            sum2 += v*v;
+            k++;
+        }
+    }
+    if (k == 0) { // Keep at least one valid pixel.
+        templ->img1[0] = 128;
+        sum = 128;
+        sum2 = 128*128;
+        k = 1;
+    }
+    vlen = sum2 - sum*sum/k;
+    templ->vlen = (int)sqrtf((float)vlen);
+    if (templ->vlen == 0) templ->vlen = 1;
+    templ->sum = sum;
+    templ->validNum = k;
+}
+
+// Matches each of the templates repeatedly for at least 'seconds', and returns the time per match.
+static double timeMatching(int scalar, ARUint8 *mono, ARUint8 *mfImage, ARUint32 *subImage, AR2TemplateT **templs, int search[][3][2])
+{
+    int    bx, by, matches = 0, n;
+    float  val;
+    double t;
+
+    arUtilTimerReset();
+    do {
+        for (n = 0; n < TIMING_TEMPLATE_NUM; n++) {
+            if (scalar) matchingScalarGetBestMatchingWithSubImage(mono, mfImage, subImage, IMAGE_XSIZE, IMAGE_YSIZE, AR_PIXEL_FORMAT_MONO, templs[n], SEARCH_SIZE, SEARCH_SIZE, search[n], &bx, &by, &val);
+            else        ar2GetBestMatchingWithSubImage(mono, mfImage, subImage, IMAGE_XSIZE, IMAGE_YSIZE, AR_PIXEL_FORMAT_MONO, templs[n], SEARCH_SIZE, SEARCH_SIZE, search[n], &bx, &by, &val);
+        }
+        matches += TIMING_TEMPLATE_NUM;
+    } while ((t = arUtilTimer()) < seconds);
+
+    return (t/matches);
+}
@@ -0,0 +1,272 @@
+/*
+ *  matrixCodeBenchmark.c
+ *  artoolkitX
+ *
+ *  Measures the speed of matrix code (2D barcode) decoding for every matrix code type.
+ *
+ *  Run with "--help" parameter to see usage.
+ *
+ *  This file is part of artoolkitX.
+ *
+ *  artoolkitX is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  artoolkitX is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with artoolkitX.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2023 Philip Lamb
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ARX/AR/ar.h>
+#include <ARX/ARUtil/time.h>
+
+enum {
+    E_NO_ERROR = 0,
+    E_BAD_PARAMETER = 64,
+    E_DATA_PROCESSING_ERROR = 70,
+    E_GENERIC_ERROR = 255
+};
+
+#define IMAGE_SIZE  320     // Width and height of the synthetic images, in pixels.
+#define IMAGE_NUM   64      // Number of different markers decoded for each type.
+#define DICT_CODE_NUM 64    // Number of codewords in the dictionaries used for the AR_MATRIX_CODE_*_DICTIONARY types.
+
+static const struct {
+    AR_MATRIX_CODE_TYPE type;
+    const char         *name;
+} types[] = {
+    {AR_MATRIX_CODE_3x3,             "3x3"},
+    {AR_MATRIX_CODE_3x3_PARITY65,    "3x3_PARITY65"},
+    {AR_MATRIX_CODE_3x3_HAMMING63,   "3x3_HAMMING63"},
+    {AR_MATRIX_CODE_4x4,             "4x4"},
+    {AR_MATRIX_CODE_4x4_BCH_13_9_3,  "4x4_BCH_13_9_3"},
+    {AR_MATRIX_CODE_4x4_BCH_13_5_5,  "4x4_BCH_13_5_5"},
+    {AR_MATRIX_CODE_5x5,             "5x5"},
+    {AR_MATRIX_CODE_5x5_BCH_22_12_5, "5x5_BCH_22_12_5"},
+    {AR_MATRIX_CODE_5x5_BCH_22_7_7,  "5x5_BCH_22_7_7"},
+    {AR_MATRIX_CODE_6x6,             "6x6"},
+    {AR_MATRIX_CODE_GLOBAL_ID,       "GLOBAL_ID"},
+    {AR_MATRIX_CODE_4x4_DICTIONARY,  "4x4_DICTIONARY"},
+    {AR_MATRIX_CODE_5x5_DICTIONARY,  "5x5_DICTIONARY"},
+    {AR_MATRIX_CODE_6x6_DICTIONARY,  "6x6_DICTIONARY"},
+    {AR_MATRIX_CODE_7x7_DICTIONARY,  "7x7_DICTIONARY"}
+};
+
+typedef struct {
+    int      code;
+    int      dir;
+    int      errorCorrected;
+    uint64_t globalID;
+} Result;
+
+static double    seconds = 0.25;   // Minimum time to run each case for.
+
+static void     usage(char *com);
+static uint64_t rand64(void);
+static void     renderCells(ARUint8 *image, const int size, const uint64_t *cells);
+static ARMatrixCodeDictionary *createDictionary(const int size);
+static double   decodeAll(ARPattHandle *pattHandle, ARUint8 **images, ARParamLTf *paramLTf, ARdouble vertex[4][2], AR_MATRIX_CODE_TYPE type, Result *results, int *decoded_p);
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+int main(int argc, char *argv[])
+{
+    ARParam                 cparam;
+    ARParamLT              *paramLT;
+    ARHandle               *arHandle;
+    ARPattHandle           *pattHandle;
+    ARMatrixCodeDictionary *dict;
+    ARUint8                *images[IMAGE_NUM];
+    ARdouble                vertex[4][2] = {{IMAGE_SIZE/5, IMAGE_SIZE/5}, {IMAGE_SIZE - IMAGE_SIZE/5, IMAGE_SIZE/5}, {IMAGE_SIZE - IMAGE_SIZE/5, IMAGE_SIZE - IMAGE_SIZE/5}, {IMAGE_SIZE/5, IMAGE_SIZE - IMAGE_SIZE/5}};
+    Result                  results[IMAGE_NUM], resultsNoHandle[IMAGE_NUM];
+    uint64_t                cells[4], code;
+    double                  tSelect, rate, rateNoHandle;
+    int                     size, decoded, decodedNoHandle, mismatches, mismatchesTotal = 0;
+    int                     i, j, q;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-seconds=", 9) == 0) {
+            if (sscanf(&argv[i][9], "%lf", &seconds) != 1 || seconds <= 0.0) usage(argv[0]);
+        } else if (strncmp(argv[i], "-loglevel=", 10) == 0) {
+            if (strcmp(&(argv[i][10]), "DEBUG") == 0) arLogLevel = AR_LOG_LEVEL_DEBUG;
+            else if (strcmp(&(argv[i][10]), "INFO") == 0) arLogLevel = AR_LOG_LEVEL_INFO;
+            else if (strcmp(&(argv[i][10]), "WARN") == 0) arLogLevel = AR_LOG_LEVEL_WARN;
+            else if (strcmp(&(argv[i][10]), "ERROR") == 0) arLogLevel = AR_LOG_LEVEL_ERROR;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-version") == 0 || strcmp(argv[i], "-v") == 0) {
+            ARPRINT("%s version %s\n", argv[0], AR_HEADER_VERSION_STRING);
+            exit(E_NO_ERROR);
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    arParamClear(&cparam, IMAGE_SIZE, IMAGE_SIZE, AR_DIST_FUNCTION_VERSION_DEFAULT);
+    if (!(paramLT = arParamLTCreate(&cparam, AR_PARAM_LT_DEFAULT_OFFSET)) || !(arHandle = arCreateHandle(paramLT)) || !(pattHandle = arPattCreateHandle())) {
+        ARPRINTE("Error creating handles.\n");
+        exit(E_GENERIC_ERROR);
+    }
+    arPattAttach(arHandle, pattHandle);
+    for (j = 0; j < IMAGE_NUM; j++) arMalloc(images[j], ARUint8, IMAGE_SIZE*IMAGE_SIZE);
+
+    ARPRINT("%-16s %10s %14s %16s %10s %12s\n", "type", "select ms", "decodes/s", "no handle /s", "decoded", "mismatches");
+    for (q = 0; q < (int)(sizeof(types)/sizeof(types[0])); q++) {
+        size = (types[q].type & AR_MATRIX_CODE_TYPE_SIZE_MASK);
+        dict = NULL;
+
+        // Random cells. For the dictionary types, every other marker is a rotated codeword, so that decoding both
+        // succeeds and fails.
+        if ((types[q].type & AR_MATRIX_CODE_TYPE_ECC_MASK) == AR_MATRIX_CODE_TYPE_ECC_DICTIONARY) {
+            if (!(dict = createDictionary(size))) {
+                ARPRINTE("Error creating %dx%d dictionary.\n", size, size);
+                exit(E_GENERIC_ERROR);
+            }
+            arPattAttachMatrixCodeDictionary(pattHandle, dict);
+        }
+        for (j = 0; j < IMAGE_NUM; j++) {
+            for (i = 0; i < 4; i++) cells[i] = rand64();
+            if (dict && j % 2 == 0) {
+                arMatrixCodeDictionaryGetCode(dict, (int)(rand64() % DICT_CODE_NUM), &code);
+                cells[0] = arMatrixCodeRotate(code, size, (int)(rand64() % 4));
+            }
+            renderCells(images[j], size, cells);
+        }
+
+        // Selecting the type prepares anything it needs, e.g. the lookup table for a BCH code.
+        arUtilTimerReset();
+        arSetMatrixCodeType(arHandle, types[q].type);
+        tSelect = arUtilTimer();
+
+        rate = decodeAll(pattHandle, images, &paramLT->paramLTf, vertex, types[q].type, results, &decoded);
+
+        // Without a pattern handle, the built-in types are decoded without lookup tables, with the same results.
+        mismatches = 0;
+        if (!dict) {
+            rateNoHandle = decodeAll(NULL, images, &paramLT->paramLTf, vertex, types[q].type, resultsNoHandle, &decodedNoHandle);
+            for (j = 0; j < IMAGE_NUM; j++) {
+                if (memcmp(&results[j], &resultsNoHandle[j], sizeof(Result)) != 0) mismatches++;
+            }
+            ARPRINT("%-16s %10.0f %14.0f %16.0f %9d%% %12d\n", types[q].name, tSelect*1000.0, rate, rateNoHandle, decoded*100/IMAGE_NUM, mismatches);
+        } else {
+            ARPRINT("%-16s %10.0f %14.0f %16s %9d%% %12s\n", types[q].name, tSelect*1000.0, rate, "-", decoded*100/IMAGE_NUM, "-");
+            arPattDetachMatrixCodeDictionary(pattHandle);
+            arMatrixCodeDictionaryDelete(&dict);
+        }
+        mismatchesTotal += mismatches;
+    }
+
+    for (j = 0; j < IMAGE_NUM; j++) free(images[j]);
+    arPattDetach(arHandle);
+    arPattDeleteHandle(pattHandle);
+    arDeleteHandle(arHandle);
+    arParamLTFree(&paramLT);
+
+    if (mismatchesTotal) {
+        ARPRINTE("Decoding with and without a pattern handle gave different results.\n");
+        return (E_DATA_PROCESSING_ERROR);
+    }
+    return (E_NO_ERROR);
+}
+
+static void usage(char *com)
+{
+    ARPRINT("Usage: %s [options]\n\n", com);
+    ARPRINT("Reports the rate of matrix code decoding by arPattGetIDGlobal for every matrix code type,\n");
+    ARPRINT("from synthetic images of %d markers, with and without a pattern handle, and checks\n", IMAGE_NUM);
+    ARPRINT("that both give the same results.\n\n");
+    ARPRINT("Options:\n");
+    ARPRINT("  -seconds=t: Run each case for at least t seconds. Default %g.\n", seconds);
+    ARPRINT("  --version: Print artoolkitX version and exit.\n");
+    ARPRINT("  -loglevel=l: Set the log level to l, where l is one of DEBUG INFO WARN ERROR.\n");
+    ARPRINT("  -h -help --help: show this message\n");
+    exit(E_BAD_PARAMETER);
+}
+
+// xorshift64*, so that every run uses the same data.
+static uint64_t rand64(void)
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (rngState * 0x2545f4914f6cdd1dull);
+}
+
+// A black-bordered marker, with size x size cells in its inner half. Cells are taken in row-major order from the
+// top-left, from bit size*size - 1 of the 256-bit value {cells[3], ..., cells[0]} down, with a 1 bit black.
+static void renderCells(ARUint8 *image, const int size, const uint64_t *cells)
+{
+    const int o0 = IMAGE_SIZE/5, o1 = IMAGE_SIZE - IMAGE_SIZE/5;
+    const int i0 = IMAGE_SIZE/2 - (o1 - o0)/4, i1 = IMAGE_SIZE/2 + (o1 - o0)/4;
+    int       x, y, bit;
+
+    memset(image, 255, IMAGE_SIZE*IMAGE_SIZE);
+    for (y = o0; y < o1; y++) for (x = o0; x < o1; x++) image[y*IMAGE_SIZE + x] = 0;
+    for (y = i0; y < i1; y++) {
+        for (x = i0; x < i1; x++) {
+            bit = size*size - 1 - ((y - i0)*size/(i1 - i0)*size + (x - i0)*size/(i1 - i0));
+            image[y*IMAGE_SIZE + x] = ((cells[bit/64] >> (bit%64)) & 1 ? 20 : 235);
+        }
+    }
+}
+
+// Random codewords, none identical to any rotation of itself or of another.
+static ARMatrixCodeDictionary *createDictionary(const int size)
+{
+    uint64_t codes[DICT_CODE_NUM], c;
+    int      num = 0, ok, i, k;
+
+    while (num < DICT_CODE_NUM) {
+        c = rand64() & ((1ull << (size*size)) - 1);
+        ok = 1;
+        for (k = 1; k < 4 && ok; k++) if (arMatrixCodeRotate(c, size, k) == c) ok = 0;
+        for (i = 0; i < num && ok; i++) for (k = 0; k < 4 && ok; k++) if (arMatrixCodeRotate(codes[i], size, k) == c) ok = 0;
+        if (ok) codes[num++] = c;
+    }
+    return (arMatrixCodeDictionaryCreate(size, codes, num));
+}
+
+// Decodes each image repeatedly for at least 'seconds', and returns the number of decodes per second.
+static double decodeAll(ARPattHandle *pattHandle, ARUint8 **images, ARParamLTf *paramLTf, ARdouble vertex[4][2], AR_MATRIX_CODE_TYPE type, Result *results, int *decoded_p)
+{
+    int      codePatt, dirPatt, decodes = 0, j;
+    ARdouble cfPatt, cfMatrix;
+    double   t;
+
+    arUtilTimerReset();
+    do {
+        for (j = 0; j < IMAGE_NUM; j++) {
+            memset(&results[j], 0, sizeof(Result));
+            arPattGetIDGlobal(pattHandle, AR_IMAGE_PROC_FRAME_IMAGE, AR_MATRIX_CODE_DETECTION, images[j], IMAGE_SIZE, IMAGE_SIZE, AR_PIXEL_FORMAT_MONO, paramLTf, vertex, 0.5,
+                              &codePatt, &dirPatt, &cfPatt, &results[j].code, &results[j].dir, &cfMatrix, type, &results[j].errorCorrected, &results[j].globalID);
+        }
+        decodes += IMAGE_NUM;
+    } while ((t = arUtilTimer()) < seconds);
+
+    *decoded_p = 0;
+    for (j = 0; j < IMAGE_NUM; j++) if (results[j].code >= 0) (*decoded_p)++;
+    return (decodes/t);
+}